@@ -0,0 +1,117 @@
+/*!
+* \file test_async.cpp
+* \brief Regression test of the asynchronous batch evaluation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CThreadPool.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Batches submitted asynchronously are evaluated in submission order and
+ * reproduce PredictANNBatch; errors of the completion function are passed on
+ * through the future. ---*/
+static void TestAsync(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+                      const string &name) {
+  const size_t n_batches = 8;
+  vector<vector<vector<mlpdouble>>> inputs(n_batches), outputs(n_batches);
+  vector<CReference> references(n_batches);
+  for (auto iBatch = 0u; iBatch < n_batches; iBatch++) {
+    inputs[iBatch] = SampleInputs(ANN, ioMap, 200 + 50 * iBatch, iBatch + 1);
+    references[iBatch].n_outside =
+        ANN.PredictANNBatch(&ioMap, inputs[iBatch], references[iBatch].outputs);
+  }
+
+  mutex order_mutex;
+  vector<size_t> completion_order;
+  vector<future<unsigned long>> results;
+  for (auto iBatch = 0u; iBatch < n_batches; iBatch++)
+    results.push_back(ANN.PredictANNAsync(
+        &ioMap, inputs[iBatch], outputs[iBatch],
+        [&, iBatch](unsigned long) {
+          lock_guard<mutex> lock(order_mutex);
+          completion_order.push_back(iBatch);
+        }));
+  bool outside_match = true;
+  for (auto iBatch = 0u; iBatch < n_batches; iBatch++)
+    outside_match = outside_match &&
+                    (results[iBatch].get() == references[iBatch].n_outside);
+  Check(name + " range", outside_match, "");
+  bool in_order = completion_order.size() == n_batches;
+  for (auto iBatch = 0u; in_order && (iBatch < n_batches); iBatch++)
+    in_order = (completion_order[iBatch] == iBatch);
+  Check(name + " order", in_order, "");
+  for (auto iBatch = 0u; iBatch < n_batches; iBatch++)
+    CheckOutputs(name + " batch " + to_string(iBatch), outputs[iBatch],
+                 references[iBatch], 0);
+
+  /*--- A failing completion function does not affect later batches. ---*/
+  auto failing = ANN.PredictANNAsync(
+      &ioMap, inputs[0], outputs[0],
+      [](unsigned long) { throw runtime_error("completion failed"); });
+  auto next = ANN.PredictANNAsync(&ioMap, inputs[1], outputs[1]);
+  ANN.WaitForAsyncBatches();
+  bool passed_on = false;
+  try {
+    failing.get();
+  } catch (const runtime_error &) {
+    passed_on = true;
+  }
+  Check(name + " completion error", passed_on, "");
+  Check(name + " after error",
+        (next.wait_for(chrono::seconds(0)) == future_status::ready) &&
+            (next.get() == references[1].n_outside),
+        "");
+  CheckOutputs(name + " after error outputs", outputs[1], references[1], 0);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+
+  /*--- Without workers, batches are evaluated before the call returns. ---*/
+  for (size_t n_threads : {4, 1}) {
+    MLPToolbox::CThreadPool::GetInstance().SetNThreads(n_threads);
+    TestAsync(ANN, ioMap, "Async " + to_string(n_threads) + "t");
+  }
+
+  return n_failures == 0 ? 0 : 1;
+}
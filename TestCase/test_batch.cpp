@@ -0,0 +1,99 @@
+/*!
+* \file test_batch.cpp
+* \brief Regression test of batched evaluation of look-up operations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- PredictANNBatch reproduces the outputs of PredictANN, with the default
+ * kernels and with the kernels tuned for batches. ---*/
+static void TestBatch(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+                      const string &name) {
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 1000);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+  vector<vector<mlpdouble>> outputs;
+  unsigned long n_outside = ANN.PredictANNBatch(&ioMap, inputs, outputs);
+  CheckOutputs(name, outputs, reference, 1e-12);
+  CheckOutside(name, n_outside, reference.n_outside);
+
+  ANN.TuneKernels(ioMap, 0, 64);
+  n_outside = ANN.PredictANNBatch(&ioMap, inputs, outputs);
+  CheckOutputs(name + " tuned", outputs, reference, 1e-12);
+  CheckOutside(name + " tuned", n_outside, reference.n_outside);
+
+  vector<vector<mlpdouble>> no_inputs;
+  n_outside = ANN.PredictANNBatch(&ioMap, no_inputs, outputs);
+  Check(name + " empty", (n_outside == 0) &&
+                             (outputs.size() == reference.outputs.size()) &&
+                             outputs[0].empty(),
+        "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string tuning_filename = "test_batch.tuning";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+  remove(tuning_filename.c_str());
+  ANN.SetTuningFile(tuning_filename);
+
+  /*--- A map with all outputs and a map with a reduced output layer and a
+   * bound input. ---*/
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"},
+                 bound_output_names = {"Output_4"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_bound(input_names, bound_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_bound);
+  auto bounds = ANN.GetInputNorm(&ioMap_bound, 2);
+  ANN.BindInputs(ioMap_bound, {input_names[2]},
+                 {0.3 * bounds.first + 0.7 * bounds.second});
+
+  TestBatch(ANN, ioMap, "Batch");
+  TestBatch(ANN, ioMap_bound, "Batch bound input");
+
+  /*--- Batches are tuned separately from single queries. ---*/
+  ANN.TuneKernels(ioMap, 0);
+  size_t n_decisions = 0;
+  ifstream tuning_file(tuning_filename);
+  for (string line; getline(tuning_file, line);)
+    n_decisions++;
+  Check("Batch tuning keys",
+        n_decisions == 2 * ioMap.GetNMLPs() + ioMap_bound.GetNMLPs(),
+        to_string(n_decisions) + " decisions");
+
+  remove(tuning_filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*!
+* \file test_bind_inputs.cpp
+* \brief Regression test of look-up operations with inputs bound to a fixed
+value.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Bound inputs reproduce the outputs and derivatives of queries in which
+ * the bound value is passed explicitly. ---*/
+static void TestBoundInputs(MLPToolbox::CLookUp_ANN &ANN,
+                            vector<string> input_names,
+                            vector<string> output_names) {
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_bound(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_bound);
+  auto bounds = ANN.GetInputNorm(&ioMap, 1);
+  const mlpdouble bound_value = 0.5 * (bounds.first + bounds.second);
+  ANN.BindInputs(ioMap_bound, {input_names[1]}, {bound_value});
+
+  vector<vector<mlpdouble>> queries = SampleInputs(ANN, ioMap, 200);
+  for (auto &query : queries)
+    query[1] = bound_value;
+  CReference reference = Evaluate(ANN, ioMap, queries);
+
+  /*--- The value passed for a bound input is ignored. ---*/
+  for (auto &query : queries)
+    query[1] = -bound_value;
+  CReference bound = Evaluate(ANN, ioMap_bound, queries);
+
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < queries.size(); iPoint++) {
+      error.Add(bound.outputs[iOutput][iPoint],
+                reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error.Add(bound.doutputs[iOutput][iInput][iPoint],
+                  reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          error.Add(bound.d2outputs[iOutput][iInput][jInput][iPoint],
+                    reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError("BindInputs", error, 1e-10);
+  CheckOutside("BindInputs", bound.n_outside, reference.n_outside);
+
+  /*--- Released inputs are read from the query again. ---*/
+  ANN.UnbindInputs(ioMap_bound);
+  CReference unbound = Evaluate(ANN, ioMap_bound, queries);
+  CReference unbound_reference = Evaluate(ANN, ioMap, queries);
+  CheckOutputs("UnbindInputs", unbound.outputs, unbound_reference, 0);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  TestBoundInputs(ANN, {"CV_2", "CV_3", "CV_1"},
+                  {"Output_6", "Output_1", "Output_3"});
+
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+/*!
+* \file test_c_api.c
+* \brief Regression test of the C interface, evaluating the same queries
+through buffers of different strides.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MLPCppC.h"
+
+#define N_POINTS 50
+#define N_INPUTS 3
+#define N_OUTPUTS 2
+
+static int n_failures = 0;
+
+static void Check(const char *name, int passed, const char *details) {
+  printf("%-32s %s  %s\n", name, passed ? "passed" : "FAILED", details);
+  if (!passed)
+    n_failures++;
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  char filename_1[4096], filename_2[4096];
+  const char *directory = argc > 1 ? argv[1] : ".";
+  snprintf(filename_1, sizeof(filename_1), "%s/MLP_1.mlp", directory);
+  snprintf(filename_2, sizeof(filename_2), "%s/MLP_2.mlp", directory);
+  const char *filenames[2] = {filename_1, filename_2};
+  const char *input_names[N_INPUTS] = {"CV_1", "CV_2", "CV_3"};
+  const char *output_names[N_OUTPUTS] = {"Output_6", "Output_2"};
+  const char *unknown_names[1] = {"Unknown"};
+  const char *missing_files[1] = {"missing.mlp"};
+
+  Check("ABI version", mlp_abi_version() == MLP_C_ABI_VERSION, "");
+  mlp_collection *collection = mlp_collection_load(missing_files, 1);
+  Check("Missing file rejected", collection == NULL, mlp_last_error());
+
+  collection = mlp_collection_load(filenames, 2);
+  Check("Collection loaded", collection != NULL,
+        collection != NULL ? "" : mlp_last_error());
+  if (collection == NULL)
+    return 1;
+  mlp_plan *plan =
+      mlp_plan_create(collection, input_names, N_INPUTS, unknown_names, 1);
+  Check("Unknown output rejected", plan == NULL, mlp_last_error());
+  plan = mlp_plan_create(collection, input_names, N_INPUTS,
+                                   output_names, N_OUTPUTS);
+  Check("Plan created",
+        (plan != NULL) && (mlp_plan_n_inputs(plan) == N_INPUTS) &&
+            (mlp_plan_n_outputs(plan) == N_OUTPUTS),
+        plan != NULL ? "" : mlp_last_error());
+  if (plan == NULL)
+    return 1;
+
+  /*--- Reference evaluation with contiguous row-major buffers. ---*/
+  static double inputs[N_POINTS][N_INPUTS], outputs[N_POINTS][N_OUTPUTS],
+      doutputs[N_POINTS][N_OUTPUTS][N_INPUTS],
+      d2outputs[N_POINTS][N_OUTPUTS][N_INPUTS][N_INPUTS];
+  /*--- Queries spread over the input ranges of the MLPs, the last ones
+   * beyond them. ---*/
+  const double lower[N_INPUTS] = {-1.19, -4.35e6, 4.5e-4},
+               upper[N_INPUTS] = {0.46, 1.95e6, 0.10};
+  for (size_t iPoint = 0; iPoint < N_POINTS; iPoint++)
+    for (size_t iInput = 0; iInput < N_INPUTS; iInput++)
+      inputs[iPoint][iInput] =
+          lower[iInput] +
+          (upper[iInput] - lower[iInput]) *
+              (fmod(0.37 * (iPoint + 1) * (iInput + 1), 1.0) +
+               (iPoint < N_POINTS - 5 ? 0.0 : 1.2));
+  const ptrdiff_t input_strides[2] = {N_INPUTS, 1},
+                  output_strides[2] = {N_OUTPUTS, 1},
+                  doutput_strides[3] = {N_OUTPUTS * N_INPUTS, N_INPUTS, 1},
+                  d2output_strides[4] = {N_OUTPUTS * N_INPUTS * N_INPUTS,
+                                         N_INPUTS * N_INPUTS, N_INPUTS, 1};
+  unsigned long n_outside = 0;
+  int status = mlp_evaluate(plan, N_POINTS, &inputs[0][0], input_strides,
+                            &outputs[0][0], output_strides, &doutputs[0][0][0],
+                            doutput_strides, &d2outputs[0][0][0][0],
+                            d2output_strides, &n_outside);
+  Check("Contiguous evaluation", status == MLP_C_SUCCESS,
+        status == MLP_C_SUCCESS ? "" : mlp_last_error());
+
+  /*--- Inputs stored column-major, outputs interleaved with padding, first
+   * derivatives in reverse query order and second derivatives with the query
+   * varying fastest. ---*/
+  const size_t padding = 3;
+  double *strided_inputs = calloc(N_INPUTS * N_POINTS, sizeof(double)),
+         *strided_outputs = calloc(N_POINTS * N_OUTPUTS * padding, sizeof(double)),
+         *strided_doutputs =
+             calloc(N_POINTS * N_OUTPUTS * N_INPUTS, sizeof(double)),
+         *strided_d2outputs =
+             calloc(N_POINTS * N_OUTPUTS * N_INPUTS * N_INPUTS, sizeof(double));
+  for (size_t iPoint = 0; iPoint < N_POINTS; iPoint++)
+    for (size_t iInput = 0; iInput < N_INPUTS; iInput++)
+      strided_inputs[iInput * N_POINTS + iPoint] = inputs[iPoint][iInput];
+  for (size_t i = 0; i < N_POINTS * N_OUTPUTS * padding; i++)
+    strided_outputs[i] = -1.0;
+  const ptrdiff_t strided_input_strides[2] = {1, N_POINTS},
+                  strided_output_strides[2] = {N_OUTPUTS * padding, padding},
+                  strided_doutput_strides[3] = {-N_OUTPUTS * N_INPUTS, N_INPUTS,
+                                                1},
+                  strided_d2output_strides[4] = {
+                      1, N_INPUTS * N_INPUTS * N_POINTS, N_INPUTS * N_POINTS,
+                      N_POINTS};
+  double *last_doutputs =
+      strided_doutputs + (N_POINTS - 1) * N_OUTPUTS * N_INPUTS;
+  unsigned long n_outside_strided = 0;
+  status = mlp_evaluate(plan, N_POINTS, strided_inputs, strided_input_strides,
+                        strided_outputs, strided_output_strides, last_doutputs,
+                        strided_doutput_strides, strided_d2outputs,
+                        strided_d2output_strides, &n_outside_strided);
+  Check("Strided evaluation", status == MLP_C_SUCCESS,
+        status == MLP_C_SUCCESS ? "" : mlp_last_error());
+
+  double max_difference = 0;
+  int padding_kept = 1;
+  for (size_t iPoint = 0; iPoint < N_POINTS; iPoint++)
+    for (size_t iOutput = 0; iOutput < N_OUTPUTS; iOutput++) {
+      const double *values =
+          &strided_outputs[(iPoint * N_OUTPUTS + iOutput) * padding];
+      max_difference = fmax(max_difference, fabs(values[0] - outputs[iPoint][iOutput]));
+      padding_kept = padding_kept && (values[1] == -1.0) && (values[2] == -1.0);
+      for (size_t iInput = 0; iInput < N_INPUTS; iInput++) {
+        max_difference = fmax(
+            max_difference,
+            fabs(last_doutputs[-(ptrdiff_t)(iPoint * N_OUTPUTS * N_INPUTS) +
+                               iOutput * N_INPUTS + iInput] -
+                 doutputs[iPoint][iOutput][iInput]));
+        for (size_t jInput = 0; jInput < N_INPUTS; jInput++)
+          max_difference = fmax(
+              max_difference,
+              fabs(strided_d2outputs[iPoint +
+                                     ((iOutput * N_INPUTS + iInput) * N_INPUTS +
+                                      jInput) *
+                                         N_POINTS] -
+                   d2outputs[iPoint][iOutput][iInput][jInput]));
+      }
+    }
+  char details[64];
+  snprintf(details, sizeof(details), "max difference %.3e", max_difference);
+  Check("Strided results", max_difference == 0, details);
+  Check("Strided padding untouched", padding_kept, "");
+  snprintf(details, sizeof(details), "%lu outside, expected %lu",
+           n_outside_strided, n_outside);
+  Check("Strided range", n_outside_strided == n_outside, details);
+
+  status = mlp_evaluate(plan, N_POINTS, &inputs[0][0], input_strides,
+                        &outputs[0][0], output_strides, NULL, NULL,
+                        &d2outputs[0][0][0][0], d2output_strides, NULL);
+  Check("Second order alone rejected", status == MLP_C_FAILURE,
+        mlp_last_error());
+
+  free(strided_inputs);
+  free(strided_outputs);
+  free(strided_doutputs);
+  free(strided_d2outputs);
+  mlp_plan_free(plan);
+  mlp_collection_free(collection);
+  return n_failures == 0 ? 0 : 1;
+}
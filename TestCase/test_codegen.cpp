@@ -0,0 +1,113 @@
+/*!
+* \file test_codegen.cpp
+* \brief Regression test of the networks generated ahead of time by MLPCodeGen.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+/*--- Generated by MLPCodeGen from the MLP files in the source directory. ---*/
+#include "MLP_1.hpp"
+#include "MLP_2.hpp"
+
+using namespace std;
+
+/*--- Copy an MLP file with a trailing empty line, such that its content no
+ * longer matches the generated code and it is evaluated interpreted. ---*/
+static void CopyModified(const string &source, const string &destination) {
+  ifstream source_stream(source);
+  ofstream destination_stream(destination);
+  destination_stream << source_stream.rdbuf() << "\n";
+}
+
+static void CheckCompiled(const string &name, const string &filename,
+                          bool compiled) {
+  MLPToolbox::CReadNeuralNetwork Reader(filename);
+  Reader.ReadMLPFile();
+  const bool found =
+      MLPToolbox::CCompiledMLPRegistry::GetInstance().Find(
+          MLPToolbox::CModelCache::HashFile(filename), Reader.GetNInputs(),
+          Reader.GetNOutputs()) != nullptr;
+  Check(name, found == compiled, found ? "compiled" : "interpreted");
+}
+
+/*--- The compiled networks reproduce the outputs and derivatives of the
+ * interpreted networks. ---*/
+static void TestCompiled(MLPToolbox::CLookUp_ANN &ANN,
+                         MLPToolbox::CLookUp_ANN &interpreted_ANN) {
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      interpreted_ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  interpreted_ANN.PairVariableswithMLPs(interpreted_ioMap);
+
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 200);
+  CReference reference = Evaluate(interpreted_ANN, interpreted_ioMap, inputs),
+             compiled = Evaluate(ANN, ioMap, inputs);
+  CErrorNorm error, error_d1, error_d2;
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+      error.Add(compiled.outputs[iOutput][iPoint],
+                reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error_d1.Add(compiled.doutputs[iOutput][iInput][iPoint],
+                     reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          error_d2.Add(compiled.d2outputs[iOutput][iInput][jInput][iPoint],
+                       reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError("Compiled outputs", error, 1e-12);
+  CheckError("Compiled first derivatives", error_d1, 1e-12);
+  CheckError("Compiled second derivatives", error_d2, 1e-10);
+  CheckOutside("Compiled outputs", compiled.n_outside, reference.n_outside);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"},
+         interpreted_filenames[] = {"test_codegen_1.mlp", "test_codegen_2.mlp"};
+  for (auto i_MLP = 0u; i_MLP < 2; i_MLP++) {
+    CopyModified(input_filenames[i_MLP], interpreted_filenames[i_MLP]);
+    CheckCompiled("Generated code registered", input_filenames[i_MLP], true);
+    CheckCompiled("Changed file not compiled", interpreted_filenames[i_MLP],
+                  false);
+  }
+
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames),
+      interpreted_ANN(2, interpreted_filenames);
+  TestCompiled(ANN, interpreted_ANN);
+
+  for (auto &filename : interpreted_filenames)
+    remove(filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
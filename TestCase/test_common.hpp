@@ -0,0 +1,242 @@
+/*!
+* \file test_common.hpp
+* \brief Reference evaluation, sampling and reporting shared by the regression
+tests.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CLookUp_ANN.hpp"
+
+/*--- Reference evaluation of a look-up operation through PredictANN, which
+ * every other evaluation path has to reproduce. ---*/
+struct CReference {
+  std::vector<std::vector<mlpdouble>> outputs; /*!< [output][query] */
+  std::vector<std::vector<std::vector<mlpdouble>>>
+      doutputs; /*!< [output][input][query] */
+  std::vector<std::vector<std::vector<std::vector<mlpdouble>>>>
+      d2outputs; /*!< [output][input][input][query] */
+  unsigned long n_outside{0};
+};
+
+/*--- Largest deviation of a set of values relative to the largest reference
+ * magnitude of the set. ---*/
+struct CErrorNorm {
+  mlpdouble max_difference{0}, max_reference{0};
+  void Add(mlpdouble value, mlpdouble reference) {
+    max_difference = std::max(max_difference, std::fabs(value - reference));
+    max_reference = std::max(max_reference, std::fabs(reference));
+  }
+  mlpdouble Get() const {
+    return max_reference > 0 ? max_difference / max_reference : max_difference;
+  }
+};
+
+static int n_failures = 0;
+
+static void Check(const std::string &name, bool passed,
+                  const std::string &details) {
+  printf("%-32s %s  %s\n", name.c_str(), passed ? "passed" : "FAILED",
+         details.c_str());
+  if (!passed)
+    n_failures++;
+}
+
+static void CheckError(const std::string &name, const CErrorNorm &error,
+                       mlpdouble tolerance) {
+  char details[64];
+  snprintf(details, sizeof(details), "relative error %.3e", error.Get());
+  Check(name, error.Get() <= tolerance, details);
+}
+
+static void CheckOutside(const std::string &name, unsigned long n_outside,
+                         unsigned long n_reference) {
+  Check(name + " range", n_outside == n_reference,
+        std::to_string(n_outside) + " outside, expected " +
+            std::to_string(n_reference));
+}
+
+/*--- Compare outputs stored per output variable and query with the
+ * reference. ---*/
+static void CheckOutputs(const std::string &name,
+                         const std::vector<std::vector<mlpdouble>> &outputs,
+                         const CReference &reference, mlpdouble tolerance) {
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < reference.outputs[iOutput].size();
+         iPoint++)
+      error.Add(outputs[iOutput][iPoint], reference.outputs[iOutput][iPoint]);
+  CheckError(name, error, tolerance);
+}
+
+static CReference Evaluate(MLPToolbox::CLookUp_ANN &ANN,
+                           MLPToolbox::CIOMap &ioMap,
+                           const std::vector<std::vector<mlpdouble>> &inputs) {
+  const std::size_t nInputs = ioMap.GetInputVars().size(),
+                    nOutputs = ioMap.GetOutputVars().size(),
+                    nPoints = inputs.size();
+  CReference reference;
+  reference.outputs.assign(nOutputs, std::vector<mlpdouble>(nPoints));
+  reference.doutputs.assign(
+      nOutputs, std::vector<std::vector<mlpdouble>>(
+                    nInputs, std::vector<mlpdouble>(nPoints)));
+  reference.d2outputs.assign(
+      nOutputs, std::vector<std::vector<std::vector<mlpdouble>>>(
+                    nInputs, std::vector<std::vector<mlpdouble>>(
+                                 nInputs, std::vector<mlpdouble>(nPoints))));
+
+  std::vector<mlpdouble> y(nOutputs);
+  std::vector<std::vector<mlpdouble>> dy(nOutputs,
+                                         std::vector<mlpdouble>(nInputs));
+  std::vector<std::vector<std::vector<mlpdouble>>> d2y(
+      nOutputs, std::vector<std::vector<mlpdouble>>(
+                    nInputs, std::vector<mlpdouble>(nInputs)));
+  std::vector<mlpdouble *> y_refs(nOutputs);
+  std::vector<std::vector<mlpdouble *>> dy_refs(
+      nOutputs, std::vector<mlpdouble *>(nInputs));
+  std::vector<std::vector<std::vector<mlpdouble *>>> d2y_refs(
+      nOutputs, std::vector<std::vector<mlpdouble *>>(
+                    nInputs, std::vector<mlpdouble *>(nInputs)));
+  for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+    y_refs[iOutput] = &y[iOutput];
+    for (auto iInput = 0u; iInput < nInputs; iInput++) {
+      dy_refs[iOutput][iInput] = &dy[iOutput][iInput];
+      for (auto jInput = 0u; jInput < nInputs; jInput++)
+        d2y_refs[iOutput][iInput][jInput] = &d2y[iOutput][iInput][jInput];
+    }
+  }
+
+  /*--- Outputs not provided by the selected MLP are left untouched, so they
+   * are reset for every query. ---*/
+  for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+    std::fill(y.begin(), y.end(), 0.0);
+    for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+      std::fill(dy[iOutput].begin(), dy[iOutput].end(), 0.0);
+      for (auto iInput = 0u; iInput < nInputs; iInput++)
+        std::fill(d2y[iOutput][iInput].begin(), d2y[iOutput][iInput].end(),
+                  0.0);
+    }
+    reference.n_outside +=
+        ANN.PredictANN(&ioMap, inputs[iPoint], y_refs, &dy_refs, &d2y_refs);
+    for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+      reference.outputs[iOutput][iPoint] = y[iOutput];
+      for (auto iInput = 0u; iInput < nInputs; iInput++) {
+        reference.doutputs[iOutput][iInput][iPoint] = dy[iOutput][iInput];
+        for (auto jInput = 0u; jInput < nInputs; jInput++)
+          reference.d2outputs[iOutput][iInput][jInput][iPoint] =
+              d2y[iOutput][iInput][jInput];
+      }
+    }
+  }
+  return reference;
+}
+
+/*--- Random queries spanning slightly more than the normalization range of
+ * the paired MLPs, such that some of them select no MLP. ---*/
+static std::vector<std::vector<mlpdouble>>
+SampleInputs(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+             std::size_t nPoints, unsigned seed = 1) {
+  const std::size_t nInputs = ioMap.GetInputVars().size();
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<mlpdouble> fraction(-0.1, 1.1);
+  std::vector<std::vector<mlpdouble>> inputs(nPoints,
+                                             std::vector<mlpdouble>(nInputs));
+  for (auto &query : inputs)
+    for (auto iInput = 0u; iInput < nInputs; iInput++) {
+      auto bounds = ANN.GetInputNorm(&ioMap, iInput);
+      query[iInput] =
+          bounds.first + fraction(generator) * (bounds.second - bounds.first);
+    }
+  return inputs;
+}
+
+/*--- Write an MLP input file with random weights and biases. Inputs are
+ * normalized over [0, 1] and outputs are not normalized. ---*/
+static void WriteMLP(const std::string &filename,
+                     const std::vector<std::size_t> &neurons_per_layer,
+                     const std::string &hidden_activation,
+                     const std::vector<std::string> &input_names,
+                     const std::vector<std::string> &output_names,
+                     unsigned seed = 1) {
+  std::mt19937 generator(seed);
+  std::normal_distribution<mlpdouble> distribution(0.0, 1.0);
+  const std::size_t nLayers = neurons_per_layer.size();
+  char value[32];
+  auto random_value = [&](mlpdouble scale) {
+    snprintf(value, sizeof(value), "%+.16e", scale * distribution(generator));
+    return std::string(value);
+  };
+
+  std::ofstream file_stream(filename);
+  file_stream << "<header>\n\n[number of layers]\n" << nLayers
+              << "\n\n[neurons per layer]\n";
+  for (auto n_neurons : neurons_per_layer)
+    file_stream << n_neurons << "\n";
+  file_stream << "\n[activation function]\n";
+  for (auto iLayer = 0u; iLayer < nLayers; iLayer++)
+    file_stream << ((iLayer == 0 || iLayer == nLayers - 1) ? "linear"
+                                                           : hidden_activation)
+                << "\n";
+  file_stream << "\n[input names]\n";
+  for (auto &name : input_names)
+    file_stream << name << "\n";
+  file_stream << "\n[input normalization]\n";
+  for (auto iInput = 0u; iInput < input_names.size(); iInput++)
+    file_stream << "0\t1\n";
+  file_stream << "\n[output names]\n";
+  for (auto &name : output_names)
+    file_stream << name << "\n";
+  file_stream << "\n[output normalization]\n";
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    file_stream << "0\t1\n";
+  file_stream << "\n</header>\n\n[weights per layer]\n";
+  for (auto iLayer = 0u; iLayer + 1 < nLayers; iLayer++) {
+    file_stream << "<layer>\n";
+    const mlpdouble scale =
+        1.0 / std::sqrt(mlpdouble(neurons_per_layer[iLayer]));
+    for (auto iNeuron = 0u; iNeuron < neurons_per_layer[iLayer]; iNeuron++) {
+      for (auto jNeuron = 0u; jNeuron < neurons_per_layer[iLayer + 1];
+           jNeuron++)
+        file_stream << (jNeuron > 0 ? "\t" : "") << random_value(scale);
+      file_stream << "\n";
+    }
+    file_stream << "</layer>\n";
+  }
+  file_stream << "\n[biases per layer]\n";
+  for (auto n_neurons : neurons_per_layer) {
+    for (auto iNeuron = 0u; iNeuron < n_neurons; iNeuron++)
+      file_stream << (iNeuron > 0 ? "\t" : "") << random_value(0.1);
+    file_stream << "\n";
+  }
+}
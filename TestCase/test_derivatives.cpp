@@ -0,0 +1,118 @@
+/*!
+* \file test_derivatives.cpp
+* \brief Regression test of the first and second order derivatives and the input
+range check of PredictANN.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- First and second order derivatives of PredictANN against central
+ * differences of the outputs and first order derivatives, with steps relative
+ * to the input ranges. ---*/
+static void TestDerivatives(MLPToolbox::CLookUp_ANN &ANN,
+                            MLPToolbox::CIOMap &ioMap,
+                            const vector<vector<mlpdouble>> &inputs) {
+  const size_t nInputs = ioMap.GetInputVars().size(),
+               nOutputs = ioMap.GetOutputVars().size();
+  CErrorNorm error, second_error;
+  for (auto &query : inputs)
+    for (auto iInput = 0u; iInput < nInputs; iInput++) {
+      auto bounds = ANN.GetInputNorm(&ioMap, iInput);
+      const mlpdouble range = bounds.second - bounds.first,
+                      step = 1e-5 * range;
+      vector<vector<mlpdouble>> queries = {query, query, query};
+      queries[1][iInput] += step;
+      queries[2][iInput] -= step;
+      CReference reference = Evaluate(ANN, ioMap, queries);
+      if (reference.n_outside != 0)
+        continue;
+      for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+        error.Add((reference.outputs[iOutput][1] -
+                   reference.outputs[iOutput][2]) /
+                      (2 * step) * range,
+                  reference.doutputs[iOutput][iInput][0] * range);
+        for (auto jInput = 0u; jInput < nInputs; jInput++) {
+          auto bounds_j = ANN.GetInputNorm(&ioMap, jInput);
+          const mlpdouble range_j = bounds_j.second - bounds_j.first;
+          second_error.Add((reference.doutputs[iOutput][jInput][1] -
+                            reference.doutputs[iOutput][jInput][2]) /
+                               (2 * step) * range * range_j,
+                           reference.d2outputs[iOutput][jInput][iInput][0] *
+                               range * range_j);
+        }
+      }
+    }
+  CheckError("PredictANN derivatives", error, 1e-5);
+  CheckError("PredictANN second derivatives", second_error, 1e-4);
+}
+
+/*--- A query is only within the range of an MLP if every one of its inputs
+ * is. ---*/
+static void TestRange(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap) {
+  const size_t nInputs = ioMap.GetInputVars().size();
+  vector<mlpdouble> query(nInputs);
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    auto bounds = ANN.GetInputNorm(&ioMap, iInput);
+    query[iInput] = 0.5 * (bounds.first + bounds.second);
+  }
+  Check("PredictANN range center", Evaluate(ANN, ioMap, {query}).n_outside == 0,
+        "");
+  unsigned long n_outside = 0;
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    vector<mlpdouble> outside_query = query;
+    auto bounds = ANN.GetInputNorm(&ioMap, iInput);
+    outside_query[iInput] = bounds.second + 10 * (bounds.second - bounds.first);
+    n_outside += Evaluate(ANN, ioMap, {outside_query}).n_outside;
+  }
+  Check("PredictANN input range", n_outside == nInputs,
+        to_string(n_outside) + " of " + to_string(nInputs) +
+            " queries outside");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  /*--- Outputs of both MLPs, with the inputs in a different order than in the
+   * MLP files. ---*/
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+
+  TestDerivatives(ANN, ioMap, SampleInputs(ANN, ioMap, 200));
+  TestRange(ANN, ioMap);
+
+  return n_failures == 0 ? 0 : 1;
+}
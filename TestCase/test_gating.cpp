@@ -0,0 +1,150 @@
+/*!
+* \file test_gating.cpp
+* \brief Regression test of the selection of expert MLPs through a gating
+network.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Outputs of the expert with the highest gating network output, evaluated
+ * through collections holding a single network. ---*/
+static CReference EvaluateExperts(const vector<string> &expert_files,
+                                  const string &gating_file,
+                                  vector<string> input_names,
+                                  vector<string> output_names,
+                                  const vector<vector<mlpdouble>> &inputs) {
+  vector<string> gating_outputs = {"g_1", "g_2"};
+  string gating_filenames[] = {gating_file};
+  MLPToolbox::CLookUp_ANN gating_ANN(1, gating_filenames);
+  MLPToolbox::CIOMap gating_map(input_names, gating_outputs);
+  gating_ANN.PairVariableswithMLPs(gating_map);
+  CReference gating = Evaluate(gating_ANN, gating_map, inputs);
+
+  vector<CReference> experts;
+  for (auto &expert_file : expert_files) {
+    string filenames[] = {expert_file};
+    MLPToolbox::CLookUp_ANN ANN(1, filenames);
+    MLPToolbox::CIOMap ioMap(input_names, output_names);
+    ANN.PairVariableswithMLPs(ioMap);
+    experts.push_back(Evaluate(ANN, ioMap, inputs));
+  }
+
+  CReference reference = experts[0];
+  for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+    const CReference &expert =
+        experts[gating.outputs[1][iPoint] > gating.outputs[0][iPoint] ? 1 : 0];
+    for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++) {
+      reference.outputs[iOutput][iPoint] = expert.outputs[iOutput][iPoint];
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        reference.doutputs[iOutput][iInput][iPoint] =
+            expert.doutputs[iOutput][iInput][iPoint];
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          reference.d2outputs[iOutput][iInput][jInput][iPoint] =
+              expert.d2outputs[iOutput][iInput][jInput][iPoint];
+      }
+    }
+  }
+  return reference;
+}
+
+/*--- Point-wise and grid evaluations of a collection with a gating network
+ * return the outputs of the selected expert, also where the training ranges
+ * of the experts overlap. ---*/
+static void TestGating(const vector<string> &expert_files,
+                       const string &gating_file) {
+  vector<string> input_names = {"x_2", "x_1"}, output_names = {"y_1", "y_2"};
+  string filenames[] = {expert_files[0], expert_files[1]};
+  MLPToolbox::CLookUp_ANN ANN(2, filenames);
+  ANN.LoadGatingNetwork(gating_file);
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+
+  mt19937 generator(5);
+  uniform_real_distribution<mlpdouble> fraction(0.0, 1.0);
+  vector<vector<mlpdouble>> inputs(300, vector<mlpdouble>(input_names.size()));
+  for (auto &query : inputs)
+    for (auto &value : query)
+      value = fraction(generator);
+
+  CReference reference = EvaluateExperts(expert_files, gating_file, input_names,
+                                         output_names, inputs),
+             gated = Evaluate(ANN, ioMap, inputs);
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+      error.Add(gated.outputs[iOutput][iPoint],
+                reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error.Add(gated.doutputs[iOutput][iInput][iPoint],
+                  reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          error.Add(gated.d2outputs[iOutput][iInput][jInput][iPoint],
+                    reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError("Gating network", error, 1e-12);
+  CheckOutside("Gating network", gated.n_outside, 0);
+
+  /*--- Grid points are ordered with the last axis varying fastest. ---*/
+  vector<vector<mlpdouble>> axes = {{0.0, 0.2, 0.5, 0.7, 1.0},
+                                    {0.1, 0.3, 0.4, 0.6, 0.8, 0.9}},
+                            points, outputs;
+  for (auto x_0 : axes[0])
+    for (auto x_1 : axes[1])
+      points.push_back({x_0, x_1});
+  unsigned long n_outside = ANN.PredictANNGrid(&ioMap, axes, outputs);
+  reference = EvaluateExperts(expert_files, gating_file, input_names,
+                              output_names, points);
+  CheckOutputs("Gating network grid", outputs, reference, 1e-12);
+  CheckOutside("Gating network grid", n_outside, 0);
+}
+
+int main() {
+  /*--- Two experts over the same input range and a gating network choosing
+   * each of them in about half of the range. ---*/
+  vector<string> expert_files = {"test_gating_1.mlp", "test_gating_2.mlp"};
+  const string gating_file = "test_gating_gate.mlp";
+  WriteMLP(expert_files[0], {2, 8, 2}, "tanh", {"x_1", "x_2"}, {"y_1", "y_2"},
+           1);
+  WriteMLP(expert_files[1], {2, 6, 6, 2}, "tanh", {"x_1", "x_2"},
+           {"y_2", "y_1"}, 2);
+  WriteMLP(gating_file, {2, 8, 2}, "tanh", {"x_2", "x_1"}, {"g_1", "g_2"}, 11);
+
+  TestGating(expert_files, gating_file);
+
+  for (auto &filename : expert_files)
+    remove(filename.c_str());
+  remove(gating_file.c_str());
+
+  return n_failures == 0 ? 0 : 1;
+}
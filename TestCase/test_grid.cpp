@@ -0,0 +1,83 @@
+/*!
+* \file test_grid.cpp
+* \brief Regression test of the evaluation of look-up operations on Cartesian
+grids.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Grid evaluation reproduces PredictANN at every grid point, including
+ * points outside the range of the MLPs. ---*/
+static void TestGrid(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap) {
+  const size_t nInputs = ioMap.GetInputVars().size();
+  vector<vector<mlpdouble>> axes(nInputs);
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    auto bounds = ANN.GetInputNorm(&ioMap, iInput);
+    const size_t nCoordinates = 3 + 4 * iInput;
+    for (auto iCoordinate = 0u; iCoordinate < nCoordinates; iCoordinate++)
+      axes[iInput].push_back(
+          bounds.first + (bounds.second - bounds.first) *
+                             (-0.1 + 1.2 * iCoordinate / (nCoordinates - 1)));
+  }
+
+  vector<vector<mlpdouble>> outputs;
+  unsigned long n_outside = ANN.PredictANNGrid(&ioMap, axes, outputs);
+
+  /*--- Grid points are ordered with the last axis varying fastest. ---*/
+  vector<vector<mlpdouble>> points(1, vector<mlpdouble>());
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    vector<vector<mlpdouble>> extended;
+    for (auto &point : points)
+      for (auto coordinate : axes[iInput]) {
+        extended.push_back(point);
+        extended.back().push_back(coordinate);
+      }
+    points.swap(extended);
+  }
+  CReference reference = Evaluate(ANN, ioMap, points);
+  CheckOutputs("PredictANNGrid", outputs, reference, 1e-10);
+  CheckOutside("PredictANNGrid", n_outside, reference.n_outside);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  TestGrid(ANN, ioMap);
+
+  return n_failures == 0 ? 0 : 1;
+}
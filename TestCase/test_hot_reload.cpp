@@ -0,0 +1,118 @@
+/*!
+* \file test_hot_reload.cpp
+* \brief Regression test of reloading MLP files during evaluation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+static vector<string> input_names = {"x_1", "x_2", "x_3"};
+
+/*--- Replace an MLP file through a rename, as done by applications
+ * publishing a new version. ---*/
+static void ReplaceMLP(const string &filename, const string &output_name,
+                       unsigned seed) {
+  const string temporary_name = filename + ".tmp";
+  WriteMLP(temporary_name, {3, 10, 1}, "tanh", input_names, {output_name},
+           seed);
+  rename(temporary_name.c_str(), filename.c_str());
+}
+
+/*--- Outputs of a freshly loaded version of an MLP file. ---*/
+static CReference EvaluateVersion(const string &output_name, unsigned seed,
+                                  const vector<vector<mlpdouble>> &inputs) {
+  const string filename = "test_hot_reload_reference.mlp";
+  WriteMLP(filename, {3, 10, 1}, "tanh", input_names, {output_name}, seed);
+  MLPToolbox::CLookUp_ANN ANN(1, &filename);
+  vector<string> output_names = {output_name};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+  remove(filename.c_str());
+  return reference;
+}
+
+int main() {
+  const string filename = "test_hot_reload.mlp";
+  ReplaceMLP(filename, "y", 1);
+  MLPToolbox::CLookUp_ANN ANN(1, &filename);
+  vector<string> output_names = {"y"}, other_output_names = {"z"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 100);
+  CReference version_1 = Evaluate(ANN, ioMap, inputs);
+
+  /*--- A new version with the same variables replaces the loaded one at the
+   * next evaluation. ---*/
+  ReplaceMLP(filename, "y", 2);
+  MLPToolbox::CLookUp_ANN::ReloadMLP(filename);
+  CReference version_2 = EvaluateVersion("y", 2, inputs);
+  CheckOutputs("Reload outputs", Evaluate(ANN, ioMap, inputs).outputs,
+               version_2, 0);
+  CErrorNorm change;
+  for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++)
+    change.Add(version_2.outputs[0][iPoint], version_1.outputs[0][iPoint]);
+  Check("Reload changes outputs", change.Get() > 1e-3, "");
+
+  /*--- A version with other variables is not published. ---*/
+  ReplaceMLP(filename, "z", 3);
+  bool rejected = false;
+  try {
+    MLPToolbox::CLookUp_ANN::ReloadMLP(filename);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  Check("Incompatible reload rejected", rejected, "");
+  CheckOutputs("Rejected reload outputs", Evaluate(ANN, ioMap, inputs).outputs,
+               version_2, 0);
+
+  /*--- A collection which loaded the version with other variables keeps
+   * evaluating it when a version compatible with the first collection is
+   * published. ---*/
+  MLPToolbox::CLookUp_ANN other_ANN(1, &filename);
+  MLPToolbox::CIOMap other_ioMap(input_names, other_output_names);
+  other_ANN.PairVariableswithMLPs(other_ioMap);
+  ReplaceMLP(filename, "y", 4);
+  MLPToolbox::CLookUp_ANN::ReloadMLP(filename);
+  CheckOutputs("Second reload outputs", Evaluate(ANN, ioMap, inputs).outputs,
+               EvaluateVersion("y", 4, inputs), 0);
+  CheckOutputs("Skipped reload outputs",
+               Evaluate(other_ANN, other_ioMap, inputs).outputs,
+               EvaluateVersion("z", 3, inputs), 0);
+  Check("Skipped reload listed",
+        (other_ANN.GetRejectedReloads().count(filename) == 1) &&
+            ANN.GetRejectedReloads().empty(),
+        "");
+
+  remove(filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*!
+* \file test_inference_server.cpp
+* \brief Regression test of a round trip through the inference server and
+client, including the rejection of malformed requests.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CInferenceClient.hpp"
+#include "CInferenceServer.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Connect a raw socket to the server, for requests the client does not
+ * send. ---*/
+static int Connect(const string &socket_path) {
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connect(socket_fd, reinterpret_cast<sockaddr *>(&address),
+              sizeof(address)) != 0) {
+    close(socket_fd);
+    return -1;
+  }
+  return socket_fd;
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string socket_path = "test_inference_server.sock";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_6", "Output_2"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+
+  /*--- Reference results, evaluated before the server shares the
+   * collection. ---*/
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 200);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+
+  MLPToolbox::CInferenceServer server(ANN);
+  thread server_thread([&] { server.Run(socket_path); });
+
+  /*--- Wait for the server to listen. ---*/
+  int raw_fd = -1;
+  for (auto iAttempt = 0u; (iAttempt < 500) && (raw_fd < 0); iAttempt++) {
+    raw_fd = Connect(socket_path);
+    if (raw_fd < 0)
+      this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  Check("Server listening", raw_fd >= 0, socket_path);
+  if (raw_fd < 0) {
+    server.Stop();
+    server_thread.join();
+    return 1;
+  }
+
+  {
+    MLPToolbox::CInferenceClient client(socket_path);
+    auto iPlan = client.RegisterPlan(input_names, output_names);
+
+    for (auto order = 0u; order < 3; order++) {
+      vector<vector<mlpdouble>> y;
+      vector<vector<vector<mlpdouble>>> dy;
+      vector<vector<vector<vector<mlpdouble>>>> d2y;
+      client.Predict(iPlan, inputs, y, order > 0 ? &dy : nullptr,
+                     order > 1 ? &d2y : nullptr);
+      CErrorNorm error;
+      for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+        for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+          error.Add(y[iOutput][iPoint], reference.outputs[iOutput][iPoint]);
+          for (auto iInput = 0u; (order > 0) && (iInput < input_names.size());
+               iInput++) {
+            error.Add(dy[iOutput][iInput][iPoint],
+                      reference.doutputs[iOutput][iInput][iPoint]);
+            for (auto jInput = 0u;
+                 (order > 1) && (jInput < input_names.size()); jInput++)
+              error.Add(d2y[iOutput][iInput][jInput][iPoint],
+                        reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+          }
+        }
+      CheckError("Server round trip order " + to_string(order), error, 1e-12);
+    }
+
+    bool rejected = false;
+    try {
+      vector<string> unknown_outputs = {"Unknown"};
+      client.RegisterPlan(input_names, unknown_outputs);
+    } catch (invalid_argument &) {
+      rejected = true;
+    }
+    Check("Unknown output rejected", rejected, "");
+  }
+
+  /*--- A request announcing more queries than it holds is answered with an
+   * error, after which the connection keeps working. ---*/
+  {
+    MLPToolbox::CInferenceMessage plan_request(
+        MLPToolbox::CInferenceMessage::REGISTER_PLAN);
+    plan_request.WriteSize(input_names.size());
+    for (auto &name : input_names)
+      plan_request.WriteString(name);
+    plan_request.WriteSize(output_names.size());
+    for (auto &name : output_names)
+      plan_request.WriteString(name);
+    plan_request.Send(raw_fd);
+    MLPToolbox::CInferenceMessage reply;
+    reply.Receive(raw_fd);
+    const auto iPlan = reply.ReadSize();
+
+    const double query[3] = {inputs[0][0], inputs[0][1], inputs[0][2]};
+    MLPToolbox::CInferenceMessage truncated(
+        MLPToolbox::CInferenceMessage::PREDICT);
+    truncated.WriteSize(iPlan);
+    truncated.WriteSize(0);
+    truncated.WriteSize(std::uint64_t(1) << 40);
+    truncated.WriteValues(query, 3);
+    truncated.Send(raw_fd);
+    reply.Receive(raw_fd);
+    Check("Truncated request rejected",
+          reply.GetType() == MLPToolbox::CInferenceMessage::ERROR_REPLY,
+          reply.GetType() == MLPToolbox::CInferenceMessage::ERROR_REPLY
+              ? reply.ReadString()
+              : "");
+
+    MLPToolbox::CInferenceMessage truncated_plan(
+        MLPToolbox::CInferenceMessage::REGISTER_PLAN);
+    truncated_plan.WriteSize(std::uint64_t(1) << 40);
+    truncated_plan.WriteString(input_names[0]);
+    truncated_plan.Send(raw_fd);
+    reply.Receive(raw_fd);
+    Check("Truncated plan rejected",
+          reply.GetType() == MLPToolbox::CInferenceMessage::ERROR_REPLY,
+          reply.GetType() == MLPToolbox::CInferenceMessage::ERROR_REPLY
+              ? reply.ReadString()
+              : "");
+
+    MLPToolbox::CInferenceMessage request(
+        MLPToolbox::CInferenceMessage::PREDICT);
+    request.WriteSize(iPlan);
+    request.WriteSize(0);
+    request.WriteSize(1);
+    request.WriteValues(query, 3);
+    request.Send(raw_fd);
+    reply.Receive(raw_fd);
+    double y[2] = {0, 0};
+    if (reply.GetType() == MLPToolbox::CInferenceMessage::REPLY)
+      reply.ReadValues(y, 2);
+    CErrorNorm error;
+    for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+      error.Add(y[iOutput], reference.outputs[iOutput][0]);
+    CheckError("Request after rejection", error, 1e-12);
+    close(raw_fd);
+  }
+
+  server.Stop();
+  server_thread.join();
+  return n_failures == 0 ? 0 : 1;
+}
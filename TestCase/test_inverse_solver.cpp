@@ -0,0 +1,167 @@
+/*!
+* \file test_inverse_solver.cpp
+* \brief Regression test of the Newton solver for inverse look-up operations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CInverseSolver.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Maximum relative deviation of the outputs of PredictANN at the given
+ * inputs from the targets, as measured by the solver. ---*/
+static mlpdouble Residual(MLPToolbox::CLookUp_ANN &ANN,
+                          MLPToolbox::CIOMap &ioMap,
+                          const vector<mlpdouble> &inputs,
+                          const vector<mlpdouble> &targets) {
+  CReference reference = Evaluate(ANN, ioMap, {inputs});
+  mlpdouble residual = 0;
+  for (auto iOutput = 0u; iOutput < targets.size(); iOutput++) {
+    mlpdouble scale = (targets[iOutput] != 0) ? fabs(targets[iOutput]) : 1.0;
+    residual = max(residual,
+                   fabs(reference.outputs[iOutput][0] - targets[iOutput]) /
+                       scale);
+  }
+  return residual;
+}
+
+/*--- Targets are the outputs at random points in the interior of the input
+ * range, from which the free inputs are recovered starting at a perturbed
+ * initial guess. ---*/
+static void TestSolve(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+                      const vector<size_t> &free_inputs) {
+  const size_t nInputs = ioMap.GetInputVars().size(), nPoints = 100;
+  mt19937 generator(3);
+  uniform_real_distribution<mlpdouble> fraction(0.3, 0.7),
+      perturbation(-0.05, 0.05);
+  vector<vector<mlpdouble>> solutions(nPoints, vector<mlpdouble>(nInputs)),
+      targets(nPoints), guesses;
+  for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+    for (auto iInput = 0u; iInput < nInputs; iInput++) {
+      auto bounds = ANN.GetInputBounds(&ioMap, iInput);
+      solutions[iPoint][iInput] =
+          bounds.first + fraction(generator) * (bounds.second - bounds.first);
+    }
+    CReference reference = Evaluate(ANN, ioMap, {solutions[iPoint]});
+    for (auto &output : reference.outputs)
+      targets[iPoint].push_back(output[0]);
+  }
+  guesses = solutions;
+  for (auto &guess : guesses)
+    for (auto iInput : free_inputs) {
+      auto bounds = ANN.GetInputBounds(&ioMap, iInput);
+      guess[iInput] += perturbation(generator) * (bounds.second - bounds.first);
+    }
+
+  MLPToolbox::CInverseSolver solver;
+  solver.SetTolerance(1e-8);
+  vector<vector<mlpdouble>> inputs = guesses;
+  vector<bool> converged;
+  size_t n_converged = solver.SolveBatch(ANN, &ioMap, inputs, targets,
+                                         free_inputs, &converged);
+
+  /*--- Converged points reproduce their targets, and the inputs that are not
+   * solved for keep their value. ---*/
+  mlpdouble max_residual = 0;
+  bool fixed_kept = true;
+  for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+    if (converged[iPoint])
+      max_residual = max(max_residual,
+                         Residual(ANN, ioMap, inputs[iPoint], targets[iPoint]));
+    for (auto iInput = 0u; iInput < nInputs; iInput++)
+      if (find(free_inputs.begin(), free_inputs.end(), iInput) ==
+          free_inputs.end())
+        fixed_kept = fixed_kept &&
+                     (inputs[iPoint][iInput] == guesses[iPoint][iInput]);
+  }
+  const string name =
+      "CInverseSolver " + to_string(ioMap.GetOutputVars().size()) + " outputs";
+  Check(name, n_converged >= 0.9 * nPoints,
+        to_string(n_converged) + " of " + to_string(nPoints) + " converged");
+  char details[64];
+  snprintf(details, sizeof(details), "relative residual %.3e", max_residual);
+  Check(name + " residual", max_residual <= 1e-8, details);
+  Check(name + " fixed inputs", fixed_kept, "");
+}
+
+/*--- An unreachable target stops the iteration before the iteration limit, at
+ * a point within the input range of which the reported residual is the
+ * actual one. ---*/
+static void TestUnreachable(MLPToolbox::CLookUp_ANN &ANN,
+                            MLPToolbox::CIOMap &ioMap) {
+  const size_t nInputs = ioMap.GetInputVars().size();
+  vector<mlpdouble> inputs(nInputs);
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    auto bounds = ANN.GetInputBounds(&ioMap, iInput);
+    inputs[iInput] = 0.5 * (bounds.first + bounds.second);
+  }
+  CReference reference = Evaluate(ANN, ioMap, {inputs});
+  vector<mlpdouble> targets;
+  for (auto &output : reference.outputs)
+    targets.push_back(output[0] + 1e3 * (fabs(output[0]) + 1));
+
+  MLPToolbox::CInverseSolver solver;
+  bool converged = solver.Solve(ANN, &ioMap, inputs, targets, {0, 1});
+  bool within_bounds = true;
+  for (auto iInput = 0u; iInput < nInputs; iInput++) {
+    auto bounds = ANN.GetInputBounds(&ioMap, iInput);
+    within_bounds = within_bounds && inputs[iInput] >= bounds.first &&
+                    inputs[iInput] <= bounds.second;
+  }
+  const mlpdouble residual = Residual(ANN, ioMap, inputs, targets);
+  Check("CInverseSolver unreachable target",
+        !converged && within_bounds && solver.GetNIterations() < 50 &&
+            fabs(residual - solver.GetResidual()) <= 1e-12 * residual,
+        "stopped after " + to_string(solver.GetNIterations()) + " iterations");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(1, input_filenames);
+
+  /*--- Square system for two outputs and a least-squares system for three
+   * outputs. ---*/
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_1", "Output_2"},
+                 output_names_3 = {"Output_1", "Output_2", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_3(input_names, output_names_3);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_3);
+
+  TestSolve(ANN, ioMap, {0, 1});
+  TestSolve(ANN, ioMap_3, {0, 2});
+  TestUnreachable(ANN, ioMap);
+
+  return n_failures == 0 ? 0 : 1;
+}
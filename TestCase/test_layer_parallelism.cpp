@@ -0,0 +1,87 @@
+/*!
+* \file test_layer_parallelism.cpp
+* \brief Regression test of splitting wide layers over the thread pool.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CThreadPool.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Layers split over the thread pool reproduce the serial evaluation,
+ * including the derivatives and batches. ---*/
+static void TestLayerParallelism(const string &filename) {
+  vector<string> input_names = {"x_1", "x_2", "x_3"},
+                 output_names = {"y_2", "y_1"};
+  MLPToolbox::CLookUp_ANN ANN(1, &filename), parallel_ANN(1, &filename);
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      parallel_ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  parallel_ANN.PairVariableswithMLPs(parallel_ioMap);
+  parallel_ANN.SetLayerParallelism(1);
+
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 100);
+  CReference reference = Evaluate(ANN, ioMap, inputs),
+             parallel = Evaluate(parallel_ANN, parallel_ioMap, inputs);
+  CErrorNorm error, error_d1, error_d2;
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+      error.Add(parallel.outputs[iOutput][iPoint],
+                reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error_d1.Add(parallel.doutputs[iOutput][iInput][iPoint],
+                     reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          error_d2.Add(parallel.d2outputs[iOutput][iInput][jInput][iPoint],
+                       reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError("Parallel layers", error, 1e-12);
+  CheckError("Parallel layers derivatives", error_d1, 1e-12);
+  CheckError("Parallel layers 2nd derivatives", error_d2, 1e-12);
+
+  vector<vector<mlpdouble>> outputs;
+  unsigned long n_outside =
+      parallel_ANN.PredictANNBatch(&parallel_ioMap, inputs, outputs);
+  CheckOutputs("Parallel layers batch", outputs, reference, 1e-12);
+  CheckOutside("Parallel layers batch", n_outside, reference.n_outside);
+}
+
+int main() {
+  const string filename = "test_layer_parallelism.mlp";
+  WriteMLP(filename, {3, 300, 300, 2}, "tanh", {"x_1", "x_2", "x_3"},
+           {"y_1", "y_2"});
+  MLPToolbox::CThreadPool::GetInstance().SetNThreads(4);
+
+  TestLayerParallelism(filename);
+
+  remove(filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*!
+* \file test_lazy_loading.cpp
+* \brief Regression test of lazily loading the weights of MLP collections.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+static void CopyFile(const string &source, const string &destination) {
+  ifstream source_stream(source, ios::binary);
+  ofstream(destination, ios::binary) << source_stream.rdbuf();
+}
+
+/*--- Only the MLPs paired with an evaluated look-up operation are loaded,
+ * and the lazily loaded collection reproduces the eagerly loaded one. ---*/
+static void TestLazyLoading(MLPToolbox::CLookUp_ANN &ANN,
+                            const string *lazy_filenames) {
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names_1 = {"Output_6"},
+                 output_names_2 = {"Output_3", "Output_1"};
+  MLPToolbox::CIOMap ioMap_1(input_names, output_names_1),
+      ioMap_2(input_names, output_names_2), ioMap_lazy_1 = ioMap_1,
+      ioMap_lazy_2 = ioMap_2;
+  ANN.PairVariableswithMLPs(ioMap_1);
+  ANN.PairVariableswithMLPs(ioMap_2);
+
+  auto &cache = MLPToolbox::CModelCache::GetInstance();
+  const size_t n_networks = cache.GetNNetworks();
+  MLPToolbox::CLookUp_ANN lazy_ANN(2, lazy_filenames, true);
+  lazy_ANN.PairVariableswithMLPs(ioMap_lazy_1);
+  lazy_ANN.PairVariableswithMLPs(ioMap_lazy_2);
+  Check("Lazy construction", cache.GetNNetworks() == n_networks,
+        to_string(cache.GetNNetworks() - n_networks) + " networks loaded");
+
+  /*--- The first evaluation loads the MLP paired with the look-up. ---*/
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap_1, 200);
+  CReference reference = Evaluate(ANN, ioMap_1, inputs),
+             lazy_reference = Evaluate(lazy_ANN, ioMap_lazy_1, inputs);
+  Check("Lazy first evaluation", cache.GetNNetworks() == n_networks + 1,
+        to_string(cache.GetNNetworks() - n_networks) + " networks loaded");
+  CheckOutputs("Lazy outputs", lazy_reference.outputs, reference, 0);
+  CheckOutside("Lazy outputs", lazy_reference.n_outside, reference.n_outside);
+
+  /*--- WarmUp loads the MLP paired with the other look-up beforehand. ---*/
+  lazy_ANN.WarmUp(&ioMap_lazy_2);
+  Check("Lazy warm-up", cache.GetNNetworks() == n_networks + 2,
+        to_string(cache.GetNNetworks() - n_networks) + " networks loaded");
+  reference = Evaluate(ANN, ioMap_2, inputs);
+  lazy_reference = Evaluate(lazy_ANN, ioMap_lazy_2, inputs);
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++)
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++)
+        error.Add(lazy_reference.doutputs[iOutput][iInput][iPoint],
+                  reference.doutputs[iOutput][iInput][iPoint]);
+  CheckError("Lazy warm-up derivatives", error, 0);
+}
+
+/*--- A file changed after its header was read is not evaluated with the
+ * header of the previous version. ---*/
+static void TestChangedFile(const string *lazy_filenames) {
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_6"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  MLPToolbox::CLookUp_ANN lazy_ANN(2, lazy_filenames, true);
+  lazy_ANN.PairVariableswithMLPs(ioMap);
+  ofstream(lazy_filenames[0], ios::app) << "\n";
+
+  vector<mlpdouble> inputs(input_names.size());
+  for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+    auto bounds = lazy_ANN.GetInputNorm(&ioMap, iInput);
+    inputs[iInput] = 0.5 * (bounds.first + bounds.second);
+  }
+  mlpdouble output;
+  vector<mlpdouble *> outputs = {&output};
+  bool rejected = false;
+  try {
+    lazy_ANN.PredictANN(&ioMap, inputs, outputs);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  Check("Lazy changed file rejected", rejected, "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"},
+         lazy_filenames[] = {"test_lazy_loading_1.mlp",
+                             "test_lazy_loading_2.mlp"};
+  for (auto i_MLP = 0u; i_MLP < 2; i_MLP++)
+    CopyFile(input_filenames[i_MLP], lazy_filenames[i_MLP]);
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  TestLazyLoading(ANN, lazy_filenames);
+  TestChangedFile(lazy_filenames);
+
+  for (auto &filename : lazy_filenames)
+    remove(filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
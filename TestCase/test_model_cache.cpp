@@ -0,0 +1,106 @@
+/*!
+* \file test_model_cache.cpp
+* \brief Regression test of the process-wide cache of loaded MLPs.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Collections loading the same files share the cached networks, evaluate
+ * independently from several threads and release the networks when they are
+ * destroyed. ---*/
+static void TestSharedNetworks(const string &directory) {
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_2"};
+  string filenames_a[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"},
+         filenames_b[] = {directory + "MLP_2.mlp"};
+  const size_t n_cached = MLPToolbox::CModelCache::GetInstance().GetNNetworks();
+  {
+    MLPToolbox::CLookUp_ANN ANN_a(2, filenames_a), ANN_b(1, filenames_b);
+    Check("Model cache entries",
+          MLPToolbox::CModelCache::GetInstance().GetNNetworks() == n_cached + 2,
+          to_string(MLPToolbox::CModelCache::GetInstance().GetNNetworks()) +
+              " cached networks");
+
+    MLPToolbox::CIOMap ioMap_a(input_names, output_names),
+        ioMap_b(input_names, output_names);
+    ANN_a.PairVariableswithMLPs(ioMap_a);
+    ANN_b.PairVariableswithMLPs(ioMap_b);
+    vector<vector<mlpdouble>> inputs_a = SampleInputs(ANN_a, ioMap_a, 300, 1),
+                              inputs_b = SampleInputs(ANN_b, ioMap_b, 300, 2);
+    CReference reference_a = Evaluate(ANN_a, ioMap_a, inputs_a),
+               reference_b = Evaluate(ANN_b, ioMap_b, inputs_b), result_a,
+               result_b;
+    thread thread_a([&]() { result_a = Evaluate(ANN_a, ioMap_a, inputs_a); });
+    result_b = Evaluate(ANN_b, ioMap_b, inputs_b);
+    thread_a.join();
+    CheckOutputs("Model cache concurrent look-ups", result_a.outputs,
+                 reference_a, 0);
+    CheckOutputs("Model cache concurrent look-ups", result_b.outputs,
+                 reference_b, 0);
+  }
+  Check("Model cache release",
+        MLPToolbox::CModelCache::GetInstance().GetNNetworks() == n_cached,
+        to_string(MLPToolbox::CModelCache::GetInstance().GetNNetworks()) +
+            " cached networks");
+}
+
+/*--- A file of which the content changed is loaded anew. ---*/
+static void TestChangedFile() {
+  const string filename = "test_model_cache.mlp";
+  vector<string> input_names = {"x_1", "x_2"}, output_names = {"y"};
+  string filenames[] = {filename};
+  WriteMLP(filename, {2, 6, 1}, "tanh", input_names, output_names, 1);
+  MLPToolbox::CLookUp_ANN ANN(1, filenames);
+  WriteMLP(filename, {2, 6, 1}, "tanh", input_names, output_names, 2);
+  MLPToolbox::CLookUp_ANN ANN_changed(1, filenames);
+  remove(filename.c_str());
+
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_changed(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN_changed.PairVariableswithMLPs(ioMap_changed);
+  CReference reference = Evaluate(ANN, ioMap, {{0.3, 0.6}}),
+             changed = Evaluate(ANN_changed, ioMap_changed, {{0.3, 0.6}});
+  Check("Model cache changed file",
+        reference.outputs[0][0] != changed.outputs[0][0], "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  TestSharedNetworks(directory);
+  TestChangedFile();
+
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/*!
+* \file test_model_parallel.cpp
+* \brief Regression test of the model-parallel batch evaluation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CThreadPool.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- PredictANNModelParallel reproduces the outputs of PredictANN, also
+ * for batches exceeding the capacity of the route queues. ---*/
+static void TestModelParallel(MLPToolbox::CLookUp_ANN &ANN,
+                              MLPToolbox::CIOMap &ioMap, size_t n_points,
+                              const string &name) {
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, n_points);
+  CReference reference;
+  reference.n_outside = ANN.PredictANNBatch(&ioMap, inputs, reference.outputs);
+  for (size_t n_threads : {4, 1}) {
+    MLPToolbox::CThreadPool::GetInstance().SetNThreads(n_threads);
+    const string threads = name + " " + to_string(n_threads) + "t";
+    vector<vector<mlpdouble>> outputs;
+    unsigned long n_outside =
+        ANN.PredictANNModelParallel(&ioMap, inputs, outputs);
+    CheckOutputs(threads, outputs, reference, 0);
+    CheckOutside(threads, n_outside, reference.n_outside);
+  }
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"},
+                 bound_output_names = {"Output_2"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_bound(input_names, bound_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_bound);
+  auto bounds = ANN.GetInputNorm(&ioMap_bound, 1);
+  ANN.BindInputs(ioMap_bound, {input_names[1]},
+                 {0.5 * (bounds.first + bounds.second)});
+
+  /*--- The outputs are compared against the PredictANN reference once, the
+   * model-parallel evaluation against the batched evaluation, which uses the
+   * same kernels, for large batches. ---*/
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 500), outputs;
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+  unsigned long n_outside =
+      ANN.PredictANNModelParallel(&ioMap, inputs, outputs);
+  CheckOutputs("Model parallel", outputs, reference, 1e-12);
+  CheckOutside("Model parallel", n_outside, reference.n_outside);
+
+  TestModelParallel(ANN, ioMap, 5000, "Model parallel batch");
+  TestModelParallel(ANN, ioMap_bound, 5000, "Model parallel bound");
+  TestModelParallel(ANN, ioMap, 20, "Model parallel small");
+
+  return n_failures == 0 ? 0 : 1;
+}
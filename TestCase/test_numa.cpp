@@ -0,0 +1,100 @@
+/*!
+* \file test_numa.cpp
+* \brief Regression test of parallel evaluation with weights replicated per NUMA
+node.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CNumaTopology.hpp"
+#include "CThreadPool.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Parallel evaluations on workers pinned to the NUMA nodes, with and
+ * without replicated weights, reproduce PredictANN. ---*/
+static void TestReplication(MLPToolbox::CLookUp_ANN &ANN,
+                            MLPToolbox::CIOMap &ioMap) {
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 500);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+
+  for (bool replicate : {true, false, true}) {
+    ANN.SetNUMAReplication(replicate);
+    CReference parallel;
+    unsigned long n_outside =
+        ANN.PredictANNParallel(&ioMap, inputs, parallel.outputs,
+                               &parallel.doutputs, &parallel.d2outputs);
+    CErrorNorm error_d2;
+    for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+      for (auto iInput = 0u; iInput < reference.doutputs[iOutput].size();
+           iInput++)
+        for (auto jInput = 0u; jInput < reference.doutputs[iOutput].size();
+             jInput++)
+          for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++)
+            error_d2.Add(parallel.d2outputs[iOutput][iInput][jInput][iPoint],
+                         reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+    const string name = replicate ? "Replicated" : "Not replicated";
+    CheckOutputs(name + " outputs", parallel.outputs, reference, 0);
+    CheckError(name + " 2nd derivatives", error_d2, 0);
+    CheckOutside(name + " outputs", n_outside, reference.n_outside);
+  }
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+
+  Check("CPU list parsing",
+        MLPToolbox::CNumaTopology::ParseCPUList("0-3,8,10-11\n") ==
+            vector<int>({0, 1, 2, 3, 8, 10, 11}),
+        "");
+
+  auto &pool = MLPToolbox::CThreadPool::GetInstance();
+  pool.SetNThreads(4);
+  pool.SetPinning(true);
+  bool nodes_valid = pool.IsPinned();
+  for (auto iThread = 0u; iThread < pool.GetNThreads(); iThread++)
+    nodes_valid = nodes_valid &&
+                  (pool.GetThreadNode(iThread) <
+                   MLPToolbox::CNumaTopology::GetInstance().GetNNodes());
+  Check("Pinned thread nodes", nodes_valid,
+        to_string(MLPToolbox::CNumaTopology::GetInstance().GetNNodes()) +
+            " nodes");
+
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  TestReplication(ANN, ioMap);
+
+  pool.SetPinning(false);
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/*!
+* \file test_parallel.cpp
+* \brief Regression test of the work-stealing parallel batch evaluation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CThreadPool.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- PredictANNParallel reproduces PredictANN for the outputs and their
+ * first and second order derivatives. ---*/
+static void TestParallel(MLPToolbox::CLookUp_ANN &ANN,
+                         MLPToolbox::CIOMap &ioMap,
+                         const vector<vector<mlpdouble>> &inputs,
+                         const CReference &reference, const string &name) {
+  CReference parallel;
+
+  unsigned long n_outside =
+      ANN.PredictANNParallel(&ioMap, inputs, parallel.outputs);
+  CheckOutputs(name, parallel.outputs, reference, 1e-12);
+  CheckOutside(name, n_outside, reference.n_outside);
+
+  n_outside = ANN.PredictANNParallel(&ioMap, inputs, parallel.outputs,
+                                     &parallel.doutputs, &parallel.d2outputs);
+  CErrorNorm error_d1, error_d2;
+  for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+    for (auto iInput = 0u; iInput < reference.doutputs[iOutput].size();
+         iInput++)
+      for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+        error_d1.Add(parallel.doutputs[iOutput][iInput][iPoint],
+                     reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < reference.doutputs[iOutput].size();
+             jInput++)
+          error_d2.Add(parallel.d2outputs[iOutput][iInput][jInput][iPoint],
+                       reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+  CheckOutputs(name + " outputs", parallel.outputs, reference, 1e-12);
+  CheckError(name + " derivatives", error_d1, 1e-12);
+  CheckError(name + " 2nd derivatives", error_d2, 1e-12);
+  CheckOutside(name + " derivatives", n_outside, reference.n_outside);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"},
+                 bound_output_names = {"Output_5"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_bound(input_names, bound_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_bound);
+  auto bounds = ANN.GetInputNorm(&ioMap_bound, 0);
+  ANN.BindInputs(ioMap_bound, {input_names[0]},
+                 {0.5 * (bounds.first + bounds.second)});
+
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 500),
+                            inputs_bound = SampleInputs(ANN, ioMap_bound, 500);
+  CReference reference = Evaluate(ANN, ioMap, inputs),
+             reference_bound = Evaluate(ANN, ioMap_bound, inputs_bound);
+
+  /*--- The results do not depend on the number of threads. ---*/
+  for (size_t n_threads : {4, 1}) {
+    MLPToolbox::CThreadPool::GetInstance().SetNThreads(n_threads);
+    const string threads = " " + to_string(n_threads) + "t";
+    TestParallel(ANN, ioMap, inputs, reference, "Parallel" + threads);
+    TestParallel(ANN, ioMap_bound, inputs_bound, reference_bound,
+                 "Parallel bound" + threads);
+  }
+
+  /*--- Second order derivatives require the first order derivatives. ---*/
+  vector<vector<mlpdouble>> outputs;
+  vector<vector<vector<vector<mlpdouble>>>> d2outputs;
+  bool rejected = false;
+  try {
+    ANN.PredictANNParallel(&ioMap, inputs, outputs, nullptr, &d2outputs);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  Check("Parallel derivative request", rejected, "");
+
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*!
+* \file test_pruned_outputs.cpp
+* \brief Regression test of look-up operations using a subset of the outputs of
+an MLP.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Outputs, derivatives and incremental updates of a look-up operation using
+ * some of the outputs of an MLP match those of a look-up operation using all
+ * of them. ---*/
+static void TestPrunedOutputs(MLPToolbox::CLookUp_ANN &ANN,
+                              vector<string> input_names,
+                              vector<string> all_output_names,
+                              vector<size_t> used_outputs, bool bind_input) {
+  vector<string> output_names;
+  for (auto iOutput : used_outputs)
+    output_names.push_back(all_output_names[iOutput]);
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_all(input_names, all_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_all);
+
+  vector<vector<mlpdouble>> queries = SampleInputs(ANN, ioMap, 200);
+  const string name = bind_input ? "Pruned outputs, bound input"
+                                 : "Pruned outputs";
+  if (bind_input) {
+    auto bounds = ANN.GetInputNorm(&ioMap, 0);
+    const mlpdouble bound_value = 0.5 * (bounds.first + bounds.second);
+    ANN.BindInputs(ioMap, {input_names[0]}, {bound_value});
+    ANN.BindInputs(ioMap_all, {input_names[0]}, {bound_value});
+    for (auto &query : queries)
+      query[0] = bound_value;
+  }
+
+  CReference pruned = Evaluate(ANN, ioMap, queries),
+             reference = Evaluate(ANN, ioMap_all, queries);
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < used_outputs.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < queries.size(); iPoint++) {
+      const size_t jOutput = used_outputs[iOutput];
+      error.Add(pruned.outputs[iOutput][iPoint],
+                reference.outputs[jOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error.Add(pruned.doutputs[iOutput][iInput][iPoint],
+                  reference.doutputs[jOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          error.Add(pruned.d2outputs[iOutput][iInput][jInput][iPoint],
+                    reference.d2outputs[jOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError(name, error, 1e-12);
+  CheckOutside(name, pruned.n_outside, reference.n_outside);
+
+  /*--- Incremental updates sweeping the last input. ---*/
+  vector<mlpdouble> y(output_names.size());
+  vector<mlpdouble *> y_refs(output_names.size());
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    y_refs[iOutput] = &y[iOutput];
+  CErrorNorm update_error;
+  for (auto iPoint = 0u; iPoint < queries.size(); iPoint++) {
+    vector<mlpdouble> query = queries[0];
+    query.back() = queries[iPoint].back();
+    ANN.PredictANNUpdate(&ioMap, query, y_refs);
+    CReference query_reference = Evaluate(ANN, ioMap_all, {query});
+    for (auto iOutput = 0u; iOutput < used_outputs.size(); iOutput++)
+      update_error.Add(y[iOutput],
+                       query_reference.outputs[used_outputs[iOutput]][0]);
+  }
+  CheckError(name + " update", update_error, 1e-12);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(1, input_filenames);
+
+  vector<string> input_names = {"CV_3", "CV_1", "CV_2"},
+                 output_names = {"Output_1", "Output_2", "Output_3",
+                                 "Output_4", "Output_5"};
+  TestPrunedOutputs(ANN, input_names, output_names, {4, 1}, false);
+  TestPrunedOutputs(ANN, input_names, output_names, {2}, true);
+
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+/*!
+* \file test_region_cache.cpp
+* \brief Regression test of the activation region cache of piecewise-linear
+MLPs.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Clusters of nearby queries, such that most of them fall in a region
+ * visited before. ---*/
+static vector<vector<mlpdouble>> SampleClusters(size_t nInputs,
+                                                size_t nClusters,
+                                                size_t nPoints) {
+  mt19937 generator(4);
+  uniform_real_distribution<mlpdouble> center(0.1, 0.9), offset(-1e-3, 1e-3);
+  vector<vector<mlpdouble>> inputs;
+  for (auto iCluster = 0u; iCluster < nClusters; iCluster++) {
+    vector<mlpdouble> cluster_center(nInputs);
+    for (auto &value : cluster_center)
+      value = center(generator);
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+      inputs.push_back(cluster_center);
+      for (auto &value : inputs.back())
+        value += offset(generator);
+    }
+  }
+  return inputs;
+}
+
+/*--- Queries evaluated through cached regions reproduce the outputs and first
+ * order derivatives of the full evaluation, with vanishing second order
+ * derivatives. ---*/
+static void TestRegionCache(const string &filename) {
+  vector<string> input_names = {"x_2", "x_1", "x_3"},
+                 output_names = {"y_2", "y_1"};
+  string input_filenames[] = {filename};
+  MLPToolbox::CLookUp_ANN ANN(1, input_filenames),
+      ANN_cached(1, input_filenames);
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_cached(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN_cached.PairVariableswithMLPs(ioMap_cached);
+  ANN_cached.SetRegionCacheSize(16);
+
+  vector<vector<mlpdouble>> inputs = SampleClusters(input_names.size(), 8, 50);
+  CReference reference = Evaluate(ANN, ioMap, inputs),
+             cached = Evaluate(ANN_cached, ioMap_cached, inputs);
+  CErrorNorm error, second_error;
+  for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++)
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+      error.Add(cached.outputs[iOutput][iPoint],
+                reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+        error.Add(cached.doutputs[iOutput][iInput][iPoint],
+                  reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0u; jInput < input_names.size(); jInput++)
+          second_error.Add(cached.d2outputs[iOutput][iInput][jInput][iPoint],
+                           0.0);
+      }
+    }
+  CheckError("Region cache", error, 1e-12);
+  CheckError("Region cache second derivatives", second_error, 0);
+  Check("Region cache hits",
+        ANN_cached.GetNRegionCacheHits() > inputs.size() / 2,
+        to_string(ANN_cached.GetNRegionCacheHits()) + " of " +
+            to_string(inputs.size()) + " queries");
+}
+
+/*--- Networks with smooth activation functions ignore the cache. ---*/
+static void TestSmoothNetwork(const string &directory) {
+  string input_filenames[] = {directory + "MLP_1.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(1, input_filenames);
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_6"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 50);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+  ANN.SetRegionCacheSize(16);
+  CReference cached = Evaluate(ANN, ioMap, inputs);
+  CheckOutputs("Region cache smooth network", cached.outputs, reference, 0);
+  Check("Region cache smooth network hits", ANN.GetNRegionCacheHits() == 0,
+        to_string(ANN.GetNRegionCacheHits()) + " hits");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string filename = "test_region_cache.mlp";
+  WriteMLP(filename, {3, 12, 10, 2}, "relu", {"x_1", "x_2", "x_3"},
+           {"y_1", "y_2"});
+  TestRegionCache(filename);
+  remove(filename.c_str());
+  TestSmoothNetwork(directory);
+
+  return n_failures == 0 ? 0 : 1;
+}
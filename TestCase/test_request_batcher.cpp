@@ -0,0 +1,138 @@
+/*!
+* \file test_request_batcher.cpp
+* \brief Regression test of the dynamic request batcher.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CRequestBatcher.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Queries submitted concurrently from several threads for two look-up
+ * operations receive the outputs of PredictANN. ---*/
+static void TestConcurrentSubmission(MLPToolbox::CLookUp_ANN &ANN,
+                                     vector<MLPToolbox::CIOMap *> ioMaps) {
+  const size_t n_threads = 4, n_points = 250;
+  vector<vector<vector<mlpdouble>>> inputs(ioMaps.size());
+  vector<CReference> references(ioMaps.size());
+  for (auto i_map = 0u; i_map < ioMaps.size(); i_map++) {
+    inputs[i_map] = SampleInputs(ANN, *ioMaps[i_map], n_threads * n_points);
+    references[i_map] = Evaluate(ANN, *ioMaps[i_map], inputs[i_map]);
+  }
+
+  /*--- Outputs per map, stored per output variable and query. ---*/
+  vector<vector<vector<mlpdouble>>> outputs(ioMaps.size());
+  for (auto i_map = 0u; i_map < ioMaps.size(); i_map++)
+    outputs[i_map].assign(references[i_map].outputs.size(),
+                          vector<mlpdouble>(n_threads * n_points));
+  {
+    MLPToolbox::CRequestBatcher batcher(ANN);
+    batcher.SetMaxBatchSize(32);
+    batcher.SetMaxLatency(chrono::microseconds(200));
+    vector<thread> callers;
+    for (auto iThread = 0u; iThread < n_threads; iThread++)
+      callers.emplace_back([&, iThread] {
+        for (auto iPoint = iThread * n_points;
+             iPoint < (iThread + 1) * n_points; iPoint++)
+          for (auto i_map = 0u; i_map < ioMaps.size(); i_map++) {
+            auto query_outputs =
+                batcher.Submit(ioMaps[i_map], inputs[i_map][iPoint]).get();
+            for (auto iOutput = 0u; iOutput < query_outputs.size(); iOutput++)
+              outputs[i_map][iOutput][iPoint] = query_outputs[iOutput];
+          }
+      });
+    for (auto &caller : callers)
+      caller.join();
+
+    const unsigned long n_queries = ioMaps.size() * n_threads * n_points;
+    Check("Batcher statistics",
+          (batcher.GetNQueries() == n_queries) &&
+              (batcher.GetNBatches() >= n_queries / 32) &&
+              (batcher.GetNBatches() <= n_queries),
+          to_string(batcher.GetNQueries()) + " queries in " +
+              to_string(batcher.GetNBatches()) + " batches");
+  }
+  for (auto i_map = 0u; i_map < ioMaps.size(); i_map++)
+    CheckOutputs("Batcher outputs " + to_string(i_map), outputs[i_map],
+                 references[i_map], 1e-12);
+}
+
+/*--- Pending queries are evaluated when the batcher is destroyed, without
+ * waiting for the latency limit. ---*/
+static void TestPendingQueries(MLPToolbox::CLookUp_ANN &ANN,
+                               MLPToolbox::CIOMap &ioMap) {
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 5);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+  vector<future<vector<mlpdouble>>> results;
+  auto start = chrono::steady_clock::now();
+  {
+    MLPToolbox::CRequestBatcher batcher(ANN);
+    batcher.SetMaxBatchSize(100);
+    batcher.SetMaxLatency(chrono::seconds(60));
+    for (auto &query : inputs)
+      results.push_back(batcher.Submit(&ioMap, query));
+  }
+  const bool early = chrono::steady_clock::now() - start < chrono::seconds(30);
+  vector<vector<mlpdouble>> outputs(reference.outputs.size(),
+                                    vector<mlpdouble>(inputs.size()));
+  bool ready = true;
+  for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+    ready = ready && (results[iPoint].wait_for(chrono::seconds(0)) ==
+                      future_status::ready);
+    auto query_outputs = results[iPoint].get();
+    for (auto iOutput = 0u; iOutput < query_outputs.size(); iOutput++)
+      outputs[iOutput][iPoint] = query_outputs[iOutput];
+  }
+  Check("Batcher pending queries", early && ready, "");
+  CheckOutputs("Batcher pending outputs", outputs, reference, 1e-12);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"},
+                 other_output_names = {"Output_5", "Output_2"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      other_ioMap(input_names, other_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(other_ioMap);
+
+  TestConcurrentSubmission(ANN, {&ioMap, &other_ioMap});
+  TestPendingQueries(ANN, ioMap);
+
+  return n_failures == 0 ? 0 : 1;
+}
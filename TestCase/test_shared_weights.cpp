@@ -0,0 +1,150 @@
+/*!
+* \file test_shared_weights.cpp
+* \brief Regression test of sharing network weights between processes through
+POSIX shared memory.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Whether the shared memory segment of a network exists. ---*/
+static bool SegmentExists(uint64_t content_hash) {
+  const string name = MLPToolbox::CSharedWeights::GetSegmentName(content_hash);
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  close(fd);
+  return true;
+}
+
+/*--- A process loading a copy of a published file under another name
+ * evaluates it through the published segment and reproduces the outputs of
+ * the publishing process. The segment is removed once the publishing
+ * process releases the network. ---*/
+static void TestSharedWeights(const string &filename) {
+  const string copy_filename = "test_shared_weights_copy.mlp";
+  vector<string> input_names = {"x_1", "x_2"}, output_names = {"y_1", "y_2"};
+  const uint64_t content_hash = MLPToolbox::CModelCache::HashFile(filename);
+  {
+    ifstream source(filename, ios::binary);
+    ofstream(copy_filename, ios::binary) << source.rdbuf();
+  }
+
+  vector<vector<mlpdouble>> inputs = {{0.1, 0.2}, {0.5, 0.9}, {0.8, 0.3}};
+  {
+    string filenames[] = {filename};
+    MLPToolbox::CLookUp_ANN ANN(1, filenames);
+    Check("Shared memory segment created", SegmentExists(content_hash),
+          MLPToolbox::CSharedWeights::GetSegmentName(content_hash));
+    MLPToolbox::CIOMap ioMap(input_names, output_names);
+    ANN.PairVariableswithMLPs(ioMap);
+    CReference reference = Evaluate(ANN, ioMap, inputs);
+
+    int outputs_pipe[2];
+    if (pipe(outputs_pipe) != 0) {
+      Check("Shared memory child process", false, "no pipe");
+      return;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+      close(outputs_pipe[0]);
+      string copy_filenames[] = {copy_filename};
+      MLPToolbox::CLookUp_ANN ANN_child(1, copy_filenames);
+      MLPToolbox::CIOMap ioMap_child(input_names, output_names);
+      ANN_child.PairVariableswithMLPs(ioMap_child);
+      CReference result = Evaluate(ANN_child, ioMap_child, inputs);
+      for (auto &output : result.outputs)
+        if (write(outputs_pipe[1], output.data(),
+                  output.size() * sizeof(mlpdouble)) < 0)
+          _exit(1);
+      _exit(0);
+    }
+    close(outputs_pipe[1]);
+    vector<vector<mlpdouble>> outputs(output_names.size(),
+                                      vector<mlpdouble>(inputs.size()));
+    bool received = true;
+    for (auto &output : outputs) {
+      const size_t n_bytes = output.size() * sizeof(mlpdouble);
+      received = received &&
+                 read(outputs_pipe[0], output.data(), n_bytes) ==
+                     ssize_t(n_bytes);
+    }
+    close(outputs_pipe[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    Check("Shared memory child process",
+          received && WIFEXITED(status) && WEXITSTATUS(status) == 0, "");
+    if (received)
+      CheckOutputs("Shared memory look-up", outputs, reference, 0);
+  }
+  remove(copy_filename.c_str());
+  Check("Shared memory segment removed", !SegmentExists(content_hash), "");
+}
+
+/*--- A segment of which the creator died before initializing it is replaced
+ * by the next process sharing the weights. ---*/
+static void TestAbandonedSegment() {
+  const uint64_t content_hash = 0x6d6c7063707074ull;
+  const string name = MLPToolbox::CSharedWeights::GetSegmentName(content_hash);
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd >= 0)
+    close(fd);
+
+  vector<mlpdouble> weights = {1.0, -2.0, 3.5, 0.25};
+  auto shared_weights = MLPToolbox::CSharedWeights::Share(
+      content_hash, weights.data(), weights.size(), 0.1);
+  Check("Abandoned segment replaced",
+        shared_weights != nullptr &&
+            memcmp(shared_weights.get(), weights.data(),
+                   weights.size() * sizeof(mlpdouble)) == 0,
+        name);
+  shared_weights.reset();
+  Check("Abandoned segment removed", !SegmentExists(content_hash), "");
+}
+
+int main() {
+  const string filename = "test_shared_weights.mlp";
+  WriteMLP(filename, {2, 10, 10, 2}, "tanh", {"x_1", "x_2"}, {"y_1", "y_2"},
+           6);
+  MLPToolbox::CModelCache::GetInstance().SetSharedMemory(true);
+  TestSharedWeights(filename);
+  TestAbandonedSegment();
+  remove(filename.c_str());
+
+  return n_failures == 0 ? 0 : 1;
+}
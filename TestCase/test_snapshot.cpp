@@ -0,0 +1,133 @@
+/*!
+* \file test_snapshot.cpp
+* \brief Regression test of writing and restoring snapshots of MLP collections.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- A restored collection reproduces the outputs and derivatives of the
+ * collection it was written from, for every input-output map. ---*/
+static void TestSnapshot(MLPToolbox::CLookUp_ANN &ANN,
+                         vector<MLPToolbox::CIOMap *> ioMaps,
+                         const string &snapshot_file) {
+  ANN.WriteSnapshot(snapshot_file, vector<const MLPToolbox::CIOMap *>(
+                                        ioMaps.begin(), ioMaps.end()));
+  vector<MLPToolbox::CIOMap> restored_maps;
+  MLPToolbox::CLookUp_ANN restored(snapshot_file, restored_maps);
+  Check("Snapshot maps", restored_maps.size() == ioMaps.size(),
+        to_string(restored_maps.size()) + " restored maps");
+  if (restored_maps.size() != ioMaps.size())
+    return;
+
+  for (auto i_map = 0u; i_map < ioMaps.size(); i_map++) {
+    vector<vector<mlpdouble>> inputs = SampleInputs(ANN, *ioMaps[i_map], 200);
+    CReference reference = Evaluate(ANN, *ioMaps[i_map], inputs),
+               restored_reference =
+                   Evaluate(restored, restored_maps[i_map], inputs);
+    CErrorNorm error;
+    for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+      for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+        error.Add(restored_reference.outputs[iOutput][iPoint],
+                  reference.outputs[iOutput][iPoint]);
+        for (auto iInput = 0u; iInput < reference.doutputs[iOutput].size();
+             iInput++)
+          error.Add(restored_reference.doutputs[iOutput][iInput][iPoint],
+                    reference.doutputs[iOutput][iInput][iPoint]);
+      }
+    const string name = "Snapshot round trip " + to_string(i_map);
+    CheckError(name, error, 0);
+    CheckOutside(name, restored_reference.n_outside, reference.n_outside);
+  }
+}
+
+/*--- Whether restoring a modified copy of a snapshot file is rejected. ---*/
+static bool IsRejected(const string &snapshot_file, const string &content) {
+  const string modified_file = snapshot_file + ".modified";
+  ofstream(modified_file, ios::binary).write(content.data(), content.size());
+  vector<MLPToolbox::CIOMap> restored_maps;
+  bool rejected = false;
+  try {
+    MLPToolbox::CLookUp_ANN restored(modified_file, restored_maps);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  remove(modified_file.c_str());
+  return rejected;
+}
+
+/*--- Truncated snapshots and snapshots of another format version are
+ * rejected. ---*/
+static void TestCorruptSnapshots(const string &snapshot_file) {
+  ifstream file_stream(snapshot_file, ios::binary);
+  const string content((istreambuf_iterator<char>(file_stream)),
+                       istreambuf_iterator<char>());
+  bool all_rejected = true;
+  for (auto size : {content.size() / 4, content.size() / 2, content.size() - 1})
+    all_rejected = all_rejected &&
+                   IsRejected(snapshot_file, content.substr(0, size));
+  Check("Truncated snapshot rejected", all_rejected, "");
+
+  /*--- The format version follows the file identifier. ---*/
+  string other_version = content;
+  other_version[8] ^= 0x7f;
+  Check("Snapshot version rejected", IsRejected(snapshot_file, other_version),
+        "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string snapshot_file = "test_snapshot.bin";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  /*--- A map with a reduced output layer and a map with a bound input. ---*/
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"},
+                 bound_output_names = {"Output_2"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      ioMap_bound(input_names, bound_output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.PairVariableswithMLPs(ioMap_bound);
+  auto bounds = ANN.GetInputNorm(&ioMap_bound, 1);
+  ANN.BindInputs(ioMap_bound, {input_names[1]},
+                 {0.5 * (bounds.first + bounds.second)});
+
+  TestSnapshot(ANN, {&ioMap, &ioMap_bound}, snapshot_file);
+  TestCorruptSnapshots(snapshot_file);
+  remove(snapshot_file.c_str());
+
+  return n_failures == 0 ? 0 : 1;
+}
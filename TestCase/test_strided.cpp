@@ -0,0 +1,137 @@
+/*!
+* \file test_strided.cpp
+* \brief Regression test of the evaluation of queries in strided memory layouts.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- PredictANNStrided reproduces PredictANN for arbitrary memory layouts of
+ * the inputs, outputs and derivatives. ---*/
+static void TestStrided(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+                        const vector<vector<mlpdouble>> &inputs,
+                        const CReference &reference) {
+  const ptrdiff_t nInputs = ioMap.GetInputVars().size(),
+                  nOutputs = ioMap.GetOutputVars().size(),
+                  nPoints = inputs.size();
+
+  /*--- Inputs stored column-major with padding, outputs stored row-major in
+   * reverse query order and derivatives with the query varying fastest. ---*/
+  const ptrdiff_t input_strides[2] = {1, nPoints + 3},
+                  output_strides[2] = {-nOutputs, 1},
+                  doutput_strides[3] = {1, nInputs * nPoints, nPoints},
+                  d2output_strides[4] = {1, nInputs * nInputs * nPoints,
+                                         nInputs * nPoints, nPoints};
+  vector<mlpdouble> input_buffer(nInputs * (nPoints + 3)),
+      output_buffer(nOutputs * nPoints),
+      doutput_buffer(nOutputs * nInputs * nPoints),
+      d2output_buffer(nOutputs * nInputs * nInputs * nPoints);
+  for (auto iPoint = 0; iPoint < nPoints; iPoint++)
+    for (auto iInput = 0; iInput < nInputs; iInput++)
+      input_buffer[iPoint * input_strides[0] + iInput * input_strides[1]] =
+          inputs[iPoint][iInput];
+
+  mlpdouble *outputs = output_buffer.data() + (nPoints - 1) * nOutputs;
+  unsigned long n_outside = ANN.PredictANNStrided(
+      &ioMap, nPoints, input_buffer.data(), input_strides, outputs,
+      output_strides, doutput_buffer.data(), doutput_strides,
+      d2output_buffer.data(), d2output_strides);
+
+  CErrorNorm error;
+  for (auto iPoint = 0; iPoint < nPoints; iPoint++)
+    for (auto iOutput = 0; iOutput < nOutputs; iOutput++) {
+      error.Add(
+          outputs[iPoint * output_strides[0] + iOutput * output_strides[1]],
+          reference.outputs[iOutput][iPoint]);
+      for (auto iInput = 0; iInput < nInputs; iInput++) {
+        error.Add(doutput_buffer[iPoint * doutput_strides[0] +
+                                 iOutput * doutput_strides[1] +
+                                 iInput * doutput_strides[2]],
+                  reference.doutputs[iOutput][iInput][iPoint]);
+        for (auto jInput = 0; jInput < nInputs; jInput++)
+          error.Add(d2output_buffer[iPoint * d2output_strides[0] +
+                                    iOutput * d2output_strides[1] +
+                                    iInput * d2output_strides[2] +
+                                    jInput * d2output_strides[3]],
+                    reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+      }
+    }
+  CheckError("Strided", error, 1e-12);
+  CheckOutside("Strided", n_outside, reference.n_outside);
+
+  /*--- Outputs only, with the queries stored row-major. ---*/
+  const ptrdiff_t row_input_strides[2] = {nInputs, 1},
+                  column_output_strides[2] = {1, nPoints};
+  vector<mlpdouble> row_inputs(nInputs * nPoints);
+  for (auto iPoint = 0; iPoint < nPoints; iPoint++)
+    for (auto iInput = 0; iInput < nInputs; iInput++)
+      row_inputs[iPoint * nInputs + iInput] = inputs[iPoint][iInput];
+  n_outside = ANN.PredictANNStrided(&ioMap, nPoints, row_inputs.data(),
+                                    row_input_strides, output_buffer.data(),
+                                    column_output_strides);
+  CErrorNorm output_error;
+  for (auto iPoint = 0; iPoint < nPoints; iPoint++)
+    for (auto iOutput = 0; iOutput < nOutputs; iOutput++)
+      output_error.Add(output_buffer[iPoint + iOutput * nPoints],
+                       reference.outputs[iOutput][iPoint]);
+  CheckError("Strided outputs", output_error, 1e-12);
+  CheckOutside("Strided outputs", n_outside, reference.n_outside);
+
+  /*--- Missing buffers or strides are rejected. ---*/
+  bool rejected = false;
+  try {
+    ANN.PredictANNStrided(&ioMap, nPoints, row_inputs.data(), nullptr,
+                          output_buffer.data(), column_output_strides);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  Check("Strided missing strides", rejected, "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 500);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+
+  TestStrided(ANN, ioMap, inputs, reference);
+
+  return n_failures == 0 ? 0 : 1;
+}
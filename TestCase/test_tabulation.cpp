@@ -0,0 +1,134 @@
+/*!
+* \file test_tabulation.cpp
+* \brief Regression test of the tabulated surrogates of look-up operations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CTabulatedMLP.hpp"
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Tabulated values approximate PredictANN within the build tolerance
+ * relative to the output range, also after writing and reading the table. ---*/
+static void TestTabulation(MLPToolbox::CLookUp_ANN &ANN,
+                           vector<string> input_names, string output_name,
+                           const string &table_file) {
+  vector<string> output_names = {output_name};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  const mlpdouble tolerance = 5e-2;
+  MLPToolbox::CTabulatedMLP table;
+  table.Build(ANN, &ioMap, tolerance, 5, 2);
+  table.WriteTable(table_file);
+  MLPToolbox::CTabulatedMLP restored_table;
+  restored_table.ReadTable(table_file);
+
+  mt19937 generator(2);
+  uniform_real_distribution<mlpdouble> fraction(0.0, 1.0);
+  mlpdouble y, y_table, y_restored;
+  vector<mlpdouble *> y_refs = {&y}, y_table_refs = {&y_table},
+                      y_restored_refs = {&y_restored};
+  CErrorNorm restored_error;
+  mlpdouble y_min = numeric_limits<mlpdouble>::max(),
+            y_max = numeric_limits<mlpdouble>::lowest(), max_difference = 0;
+  for (auto iPoint = 0u; iPoint < 500; iPoint++) {
+    vector<mlpdouble> query(input_names.size());
+    for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+      auto bounds = ANN.GetInputBounds(&ioMap, iInput);
+      query[iInput] =
+          bounds.first + fraction(generator) * (bounds.second - bounds.first);
+    }
+    y = 0.0;
+    ANN.PredictANN(&ioMap, query, y_refs);
+    table.Predict(query, y_table_refs);
+    restored_table.Predict(query, y_restored_refs);
+    y_min = min(y_min, y);
+    y_max = max(y_max, y);
+    max_difference = max(max_difference, fabs(y_table - y));
+    restored_error.Add(y_restored, y_table);
+  }
+  char details[64];
+  snprintf(details, sizeof(details), "error relative to range %.3e",
+           max_difference / (y_max - y_min));
+  Check("CTabulatedMLP", max_difference <= 2 * tolerance * (y_max - y_min),
+        details);
+  CheckError("CTabulatedMLP table file", restored_error, 0);
+}
+
+/*--- Whether reading a modified copy of a table file is rejected. ---*/
+static bool IsRejected(const string &table_file, const string &content) {
+  const string modified_file = table_file + ".modified";
+  ofstream(modified_file, ios::binary).write(content.data(), content.size());
+  MLPToolbox::CTabulatedMLP table;
+  bool rejected = false;
+  try {
+    table.ReadTable(modified_file);
+  } catch (const invalid_argument &) {
+    rejected = true;
+  }
+  remove(modified_file.c_str());
+  return rejected;
+}
+
+/*--- Truncated table files and tables referring to nodes they do not hold
+ * are rejected. ---*/
+static void TestCorruptTables(const string &table_file) {
+  ifstream file_stream(table_file, ios::binary);
+  const string content((istreambuf_iterator<char>(file_stream)),
+                       istreambuf_iterator<char>());
+  Check("Truncated table rejected",
+        IsRejected(table_file, content.substr(0, content.size() / 2)), "");
+
+  /*--- The last value of the file is a node index of the last cell. ---*/
+  string corrupt = content;
+  const size_t n_nodes = numeric_limits<size_t>::max();
+  corrupt.replace(corrupt.size() - sizeof(size_t), sizeof(size_t),
+                  reinterpret_cast<const char *>(&n_nodes), sizeof(size_t));
+  Check("Invalid table node rejected", IsRejected(table_file, corrupt), "");
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string table_file = "test_tabulation.bin";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  TestTabulation(ANN, {"CV_2", "CV_3", "CV_1"}, "Output_1", table_file);
+  TestCorruptTables(table_file);
+  remove(table_file.c_str());
+
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*!
+* \file test_tuning.cpp
+* \brief Regression test of the kernel auto-tuning and its tuning file.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+static vector<pair<string, string>> ReadDecisions(const string &filename) {
+  vector<pair<string, string>> decisions;
+  ifstream tuning_file(filename);
+  string key, name;
+  while (tuning_file >> key >> name)
+    decisions.emplace_back(key, name);
+  return decisions;
+}
+
+static void CheckDerivatives(const string &name, const CReference &outputs,
+                             const CReference &reference) {
+  CErrorNorm error;
+  for (auto iOutput = 0u; iOutput < reference.outputs.size(); iOutput++)
+    for (auto iInput = 0u; iInput < reference.doutputs[iOutput].size();
+         iInput++)
+      for (auto jInput = 0u; jInput < reference.doutputs[iOutput].size();
+           jInput++)
+        for (auto iPoint = 0u; iPoint < reference.outputs[iOutput].size();
+             iPoint++)
+          error.Add(outputs.d2outputs[iOutput][iInput][jInput][iPoint],
+                    reference.d2outputs[iOutput][iInput][jInput][iPoint]);
+  CheckError(name, error, 1e-12);
+}
+
+/*--- Tuning stores one decision per MLP and derivative order, and the
+ * selected kernels reproduce the default evaluation. ---*/
+static void TestTuning(const string *input_filenames,
+                       const string &tuning_filename) {
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  ANN.SetTuningFile(tuning_filename);
+  vector<vector<mlpdouble>> inputs = SampleInputs(ANN, ioMap, 200);
+  CReference reference = Evaluate(ANN, ioMap, inputs);
+
+  ANN.TuneKernels(ioMap, 0);
+  ANN.TuneKernels(ioMap, 2);
+  auto decisions = ReadDecisions(tuning_filename);
+  Check("Tuning decisions stored", decisions.size() == 2 * ioMap.GetNMLPs(),
+        to_string(decisions.size()) + " decisions");
+  ANN.TuneKernels(ioMap, 2);
+  Check("Tuning decisions reused",
+        ReadDecisions(tuning_filename).size() == decisions.size(), "");
+
+  CReference tuned = Evaluate(ANN, ioMap, inputs);
+  CheckOutputs("Tuned outputs", tuned.outputs, reference, 1e-12);
+  CheckDerivatives("Tuned second derivatives", tuned, reference);
+}
+
+/*--- Another collection reads the decisions from the tuning file instead of
+ * timing the kernels again. ---*/
+static void TestTuningFile(const string *input_filenames,
+                           const string &tuning_filename) {
+  auto decisions = ReadDecisions(tuning_filename);
+  {
+    ofstream tuning_file(tuning_filename);
+    for (auto &decision : decisions)
+      tuning_file << decision.first << " scalar/blocked" << endl;
+  }
+
+  vector<string> input_names = {"CV_1", "CV_2", "CV_3"},
+                 output_names = {"Output_1", "Output_3", "Output_6"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames),
+      reference_ANN(2, input_filenames);
+  MLPToolbox::CIOMap ioMap(input_names, output_names),
+      reference_ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  reference_ANN.PairVariableswithMLPs(reference_ioMap);
+  ANN.SetTuningFile(tuning_filename);
+  ANN.TuneKernels(ioMap, 2);
+
+  bool read_decisions = true;
+  for (auto i_map = 0u; i_map < ioMap.GetNMLPs(); i_map++)
+    read_decisions = read_decisions &&
+                     (ANN.GetKernelChoice(ioMap, i_map) == "scalar/blocked");
+  Check("Tuning file read", read_decisions, "");
+  Check("Tuning file unchanged",
+        ReadDecisions(tuning_filename).size() == decisions.size(), "");
+
+  vector<vector<mlpdouble>> inputs =
+      SampleInputs(reference_ANN, reference_ioMap, 200);
+  CReference reference = Evaluate(reference_ANN, reference_ioMap, inputs),
+             tuned = Evaluate(ANN, ioMap, inputs);
+  CheckOutputs("Tuning file outputs", tuned.outputs, reference, 1e-12);
+  CheckDerivatives("Tuning file second derivatives", tuned, reference);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  const string tuning_filename = "test_tuning.tuning";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  remove(tuning_filename.c_str());
+
+  TestTuning(input_filenames, tuning_filename);
+  TestTuningFile(input_filenames, tuning_filename);
+
+  remove(tuning_filename.c_str());
+  return n_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*!
+* \file test_update.cpp
+* \brief Regression test of the incremental re-evaluation of look-up operations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <string>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace std;
+
+/*--- Incremental re-evaluation reproduces PredictANN while each input is
+ * swept in turn from a base query, as finite-difference probes and line
+ * searches do, and after all inputs change at once. ---*/
+static void TestUpdate(MLPToolbox::CLookUp_ANN &ANN, MLPToolbox::CIOMap &ioMap,
+                       const vector<vector<mlpdouble>> &inputs) {
+  const size_t nInputs = ioMap.GetInputVars().size(),
+               nOutputs = ioMap.GetOutputVars().size();
+  vector<mlpdouble> y(nOutputs), y_update(nOutputs);
+  vector<mlpdouble *> y_refs(nOutputs), y_update_refs(nOutputs);
+  for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+    y_refs[iOutput] = &y[iOutput];
+    y_update_refs[iOutput] = &y_update[iOutput];
+  }
+
+  CErrorNorm error;
+  unsigned long n_outside = 0, n_reference = 0;
+  for (auto iPoint = 0u; iPoint + 1 < inputs.size(); iPoint += 8) {
+    vector<mlpdouble> query = inputs[iPoint];
+    n_outside += ANN.PredictANNUpdate(&ioMap, query, y_update_refs);
+    n_reference += ANN.PredictANN(&ioMap, query, y_refs);
+    for (auto iInput = 0u; iInput < nInputs; iInput++) {
+      for (auto iStep = 0u; iStep < 4; iStep++) {
+        query[iInput] += 0.25 * (inputs[iPoint + 1][iInput] - query[iInput]);
+        fill(y.begin(), y.end(), 0.0);
+        fill(y_update.begin(), y_update.end(), 0.0);
+        n_outside += ANN.PredictANNUpdate(&ioMap, query, y_update_refs);
+        n_reference += ANN.PredictANN(&ioMap, query, y_refs);
+        for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+          error.Add(y_update[iOutput], y[iOutput]);
+      }
+    }
+  }
+  CheckError("PredictANNUpdate", error, 1e-10);
+  CheckOutside("PredictANNUpdate", n_outside, n_reference);
+}
+
+int main(int argc, char **argv) {
+  /*--- The MLP input files are read from the directory given as argument. ---*/
+  const string directory = argc > 1 ? string(argv[1]) + "/" : "";
+  string input_filenames[] = {directory + "MLP_1.mlp", directory + "MLP_2.mlp"};
+  MLPToolbox::CLookUp_ANN ANN(2, input_filenames);
+
+  vector<string> input_names = {"CV_2", "CV_3", "CV_1"},
+                 output_names = {"Output_6", "Output_1", "Output_3"};
+  MLPToolbox::CIOMap ioMap(input_names, output_names);
+  ANN.PairVariableswithMLPs(ioMap);
+  TestUpdate(ANN, ioMap, SampleInputs(ANN, ioMap, 400));
+
+  return n_failures == 0 ? 0 : 1;
+}
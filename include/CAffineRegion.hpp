@@ -0,0 +1,142 @@
+/*!
+* \file CAffineRegion.hpp
+* \brief Collapsed affine map of a piecewise-linear network within one
+activation region.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdlib>
+#include <vector>
+
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CAffineRegion {
+  /*!
+   *\class CAffineRegion
+   *\brief A network with only linear and relu activation functions is affine
+   *within every region of the input space in which the on/off pattern of its
+   *relu neurons is constant. This class stores such a region as a set of
+   *linear inequality constraints on the normalized network inputs, one per
+   *relu neuron, together with the collapsed affine map from the normalized
+   *inputs to the normalized network outputs. Within the region, the network
+   *outputs and their exact Jacobian follow from a single small matrix-vector
+   *product.
+   */
+private:
+  std::size_t n_inputs{0}; /*!< Number of network inputs. */
+  std::vector<mlpdouble>
+      constraint_matrix,  /*!< Constraint coefficients [constraint][input]. */
+      constraint_offsets, /*!< Constraint offsets. */
+      output_matrix,      /*!< Collapsed output map [output][input]. */
+      output_offsets;     /*!< Collapsed output offsets. */
+
+public:
+  /*!
+   * \brief Initialize an empty region.
+   * \param[in] nInputs - Number of network inputs.
+   * \param[in] nOutputs - Number of network outputs.
+   */
+  void Initialize(std::size_t nInputs, std::size_t nOutputs) {
+    n_inputs = nInputs;
+    constraint_matrix.clear();
+    constraint_offsets.clear();
+    output_matrix.assign(nOutputs * nInputs, 0.0);
+    output_offsets.assign(nOutputs, 0.0);
+  }
+
+  /*!
+   * \brief Add the constraint coefficients . x + offset >= 0 to the region.
+   * \param[in] coefficients - Constraint coefficient per normalized input.
+   * \param[in] offset - Constraint offset.
+   */
+  void PushConstraint(const std::vector<mlpdouble> &coefficients,
+                      mlpdouble offset) {
+    constraint_matrix.insert(constraint_matrix.end(), coefficients.begin(),
+                             coefficients.end());
+    constraint_offsets.push_back(offset);
+  }
+
+  /*!
+   * \brief Set the collapsed affine map of a network output.
+   * \param[in] iOutput - Output index.
+   * \param[in] coefficients - Output derivative per normalized input.
+   * \param[in] offset - Output offset.
+   */
+  void SetOutputMap(std::size_t iOutput,
+                    const std::vector<mlpdouble> &coefficients,
+                    mlpdouble offset) {
+    for (auto iInput = 0u; iInput < n_inputs; iInput++)
+      output_matrix[iOutput * n_inputs + iInput] = coefficients[iInput];
+    output_offsets[iOutput] = offset;
+  }
+
+  /*!
+   * \brief Check whether normalized network inputs lie within the region.
+   * \param[in] x_norm - Normalized network inputs.
+   * \returns Inputs lie within the region.
+   */
+  bool Contains(const std::vector<mlpdouble> &x_norm) const {
+    for (auto iConstraint = 0u; iConstraint < constraint_offsets.size();
+         iConstraint++) {
+      mlpdouble value = constraint_offsets[iConstraint];
+      const mlpdouble *coefficients = &constraint_matrix[iConstraint * n_inputs];
+      for (auto iInput = 0u; iInput < n_inputs; iInput++)
+        value += coefficients[iInput] * x_norm[iInput];
+      if (value < 0)
+        return false;
+    }
+    return true;
+  }
+
+  /*!
+   * \brief Evaluate a normalized network output within the region.
+   * \param[in] iOutput - Output index.
+   * \param[in] x_norm - Normalized network inputs.
+   * \returns Normalized network output.
+   */
+  mlpdouble EvaluateOutput(std::size_t iOutput,
+                           const std::vector<mlpdouble> &x_norm) const {
+    mlpdouble y = output_offsets[iOutput];
+    for (auto iInput = 0u; iInput < n_inputs; iInput++)
+      y += output_matrix[iOutput * n_inputs + iInput] * x_norm[iInput];
+    return y;
+  }
+
+  /*!
+   * \brief Get the derivative of a normalized output w.r.t. a normalized
+   * input within the region.
+   * \param[in] iOutput - Output index.
+   * \param[in] iInput - Input index.
+   * \returns Output derivative.
+   */
+  mlpdouble GetOutputDerivative(std::size_t iOutput, std::size_t iInput) const {
+    return output_matrix[iOutput * n_inputs + iInput];
+  }
+};
+
+} // namespace MLPToolbox
@@ -0,0 +1,142 @@
+/*!
+* \file CCompiledMLPRegistry.hpp
+* \brief Registry of ahead-of-time compiled network evaluation functions.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+
+/*!
+ * \brief Compiled network evaluation function. Computes the dimensional
+ * network outputs from the dimensional network inputs and, if the respective
+ * pointers are not null, the output derivatives [output][input] and second
+ * derivatives [output][input][input] in row-major order.
+ */
+using CompiledEvaluation = void (*)(const mlpdouble *inputs,
+                                    mlpdouble *outputs,
+                                    mlpdouble *doutputs_dinputs,
+                                    mlpdouble *d2outputs_dinputs2);
+
+class CCompiledMLPRegistry {
+  /*!
+   *\class CCompiledMLPRegistry
+   *\brief Process-wide registry of network evaluation functions generated
+   *ahead of time by MLPCodeGen. Generated headers register their function
+   *under the content hash of the MLP file they were generated from, such that
+   *CLookUp_ANN evaluates the compiled function in place of the interpreted
+   *network whenever it loads a file with identical content.
+   */
+private:
+  /*!
+   * \brief Registered compiled network.
+   */
+  struct CompiledNetwork {
+    std::size_t n_inputs,   /*!< Number of network inputs. */
+        n_outputs;          /*!< Number of network outputs. */
+    CompiledEvaluation evaluate; /*!< Evaluation function. */
+  };
+
+  std::mutex registry_mutex; /*!< Guards the registry. */
+  std::map<std::uint64_t, CompiledNetwork>
+      networks; /*!< Compiled networks per MLP file content hash. */
+
+  CCompiledMLPRegistry() = default;
+
+public:
+  CCompiledMLPRegistry(const CCompiledMLPRegistry &) = delete;
+  CCompiledMLPRegistry &operator=(const CCompiledMLPRegistry &) = delete;
+
+  /*!
+   *\class Registration
+   *\brief Registers a compiled network on construction. Generated headers
+   *define a static instance of this class.
+   */
+  class Registration {
+  public:
+    Registration(std::uint64_t content_hash, std::size_t n_inputs,
+                 std::size_t n_outputs, CompiledEvaluation evaluate) {
+      GetInstance().Register(content_hash, n_inputs, n_outputs, evaluate);
+    }
+  };
+
+  /*!
+   * \brief Get the process-wide registry.
+   * \returns Reference to the registry.
+   */
+  static CCompiledMLPRegistry &GetInstance() {
+    static CCompiledMLPRegistry instance;
+    return instance;
+  }
+
+  /*!
+   * \brief Register a compiled network.
+   * \param[in] content_hash - Content hash of the MLP input file.
+   * \param[in] n_inputs - Number of network inputs.
+   * \param[in] n_outputs - Number of network outputs.
+   * \param[in] evaluate - Evaluation function.
+   */
+  void Register(std::uint64_t content_hash, std::size_t n_inputs,
+                std::size_t n_outputs, CompiledEvaluation evaluate) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    networks[content_hash] = CompiledNetwork{n_inputs, n_outputs, evaluate};
+  }
+
+  /*!
+   * \brief Find the compiled evaluation function of a network.
+   * \param[in] content_hash - Content hash of the MLP input file.
+   * \param[in] n_inputs - Number of network inputs.
+   * \param[in] n_outputs - Number of network outputs.
+   * \returns Evaluation function, or nullptr if no matching network is
+   * registered.
+   */
+  CompiledEvaluation Find(std::uint64_t content_hash, std::size_t n_inputs,
+                          std::size_t n_outputs) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto it = networks.find(content_hash);
+    if ((it == networks.end()) || (it->second.n_inputs != n_inputs) ||
+        (it->second.n_outputs != n_outputs))
+      return nullptr;
+    return it->second.evaluate;
+  }
+
+  /*!
+   * \brief Get the number of registered compiled networks.
+   * \returns Number of compiled networks.
+   */
+  std::size_t GetNNetworks() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return networks.size();
+  }
+};
+
+} // namespace MLPToolbox
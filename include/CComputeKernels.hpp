@@ -0,0 +1,651 @@
+/*!
+* \file CComputeKernels.hpp
+* \brief Dense linear algebra kernels selected at runtime for the instruction
+set of the processor.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "option_maps.hpp"
+#include "variable_def.hpp"
+
+/* Vectorized kernels are compiled for x86 processors with GCC-compatible
+ * compilers, for the default floating point type only. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&        \
+    !defined(MLP_CUSTOM_TYPE) && !defined(MLP_NO_RUNTIME_DISPATCH)
+#define MLP_HAVE_RUNTIME_DISPATCH
+#include <immintrin.h>
+#endif
+
+/* Optional external BLAS library for the matrix-matrix products of batched
+ * evaluations, declared through its Fortran interface which every BLAS
+ * implementation provides. */
+#ifdef MLP_USE_BLAS
+extern "C" {
+void dgemm_(const char *transa, const char *transb, const int *m, const int *n,
+            const int *k, const double *alpha, const double *a, const int *lda,
+            const double *b, const int *ldb, const double *beta, double *c,
+            const int *ldc);
+void sgemm_(const char *transa, const char *transb, const int *m, const int *n,
+            const int *k, const float *alpha, const float *a, const int *lda,
+            const float *b, const int *ldb, const float *beta, float *c,
+            const int *ldc);
+}
+#endif
+
+namespace MLPToolbox {
+class CComputeKernels {
+  /*!
+   *\class CComputeKernels
+   *\brief Set of the dense kernels used in network evaluation: the dot
+   *product, used for the weighted sums of neuron outputs and their
+   *derivatives, and the matrix-vector product of a weight layer. Every kernel
+   *is compiled for several instruction sets (SSE2, AVX2 with FMA and
+   *AVX-512), independent of the compiler flags of the application. The
+   *matrix-vector product is available row by row and blocked over four rows,
+   *which shares the loads of the vector between rows. The matrix-matrix
+   *product of batched evaluations is vectorized over the batch points, or
+   *handed to an external BLAS library if MLP_USE_BLAS is defined. The
+   *process-wide
+   *default set uses the widest instruction set supported by the processor,
+   *so a portable build uses the vector units of the machine it runs on; the
+   *other variants are available to the auto-tuner of CLookUp_ANN.
+   *The vectorized kernels sum in a different order than the scalar kernels,
+   *so results may differ in the last digits.
+   */
+private:
+  using DotKernel = mlpdouble (*)(const mlpdouble *, const mlpdouble *,
+                                  std::size_t);
+  using GemvKernel = void (*)(const mlpdouble *, const mlpdouble *,
+                              mlpdouble *, std::size_t, std::size_t);
+  using GemmKernel = void (*)(const mlpdouble *, const mlpdouble *,
+                              mlpdouble *, std::size_t, std::size_t,
+                              std::size_t);
+
+  ENUM_INSTRUCTION_SET instruction_set{
+      ENUM_INSTRUCTION_SET::SCALAR}; /*!< Selected instruction set. */
+  bool row_blocking{false}; /*!< Matrix-vector product blocked over rows. */
+  DotKernel dot_kernel{nullptr};     /*!< Selected dot product kernel. */
+  GemvKernel gemv_kernel{nullptr};   /*!< Selected matrix-vector kernel. */
+  GemmKernel gemm_kernel{nullptr};   /*!< Selected matrix-matrix kernel. */
+
+  /*!
+   * \brief Dot product kernel without vectorization.
+   */
+  static mlpdouble DotScalar(const mlpdouble *a, const mlpdouble *b,
+                             std::size_t n) {
+    mlpdouble sum = 0;
+    for (auto i = 0u; i < n; i++)
+      sum += a[i] * b[i];
+    return sum;
+  }
+
+  /*!
+   * \brief Matrix-vector product kernel without vectorization.
+   */
+  static void GemvScalar(const mlpdouble *A, const mlpdouble *x, mlpdouble *y,
+                         std::size_t n_rows, std::size_t n_columns) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++)
+      y[iRow] = DotScalar(A + iRow * n_columns, x, n_columns);
+  }
+
+  /*!
+   * \brief Matrix-vector product kernel without vectorization, blocked over
+   * four rows.
+   */
+  static void GemvBlockedScalar(const mlpdouble *A, const mlpdouble *x,
+                                mlpdouble *y, std::size_t n_rows,
+                                std::size_t n_columns) {
+    std::size_t iRow = 0;
+    for (; iRow + 4 <= n_rows; iRow += 4) {
+      const mlpdouble *a = A + iRow * n_columns;
+      mlpdouble sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+      for (auto i = 0u; i < n_columns; i++) {
+        sum0 += a[i] * x[i];
+        sum1 += a[n_columns + i] * x[i];
+        sum2 += a[2 * n_columns + i] * x[i];
+        sum3 += a[3 * n_columns + i] * x[i];
+      }
+      y[iRow] = sum0;
+      y[iRow + 1] = sum1;
+      y[iRow + 2] = sum2;
+      y[iRow + 3] = sum3;
+    }
+    for (; iRow < n_rows; iRow++)
+      y[iRow] = DotScalar(A + iRow * n_columns, x, n_columns);
+  }
+
+  /*!
+   * \brief Matrix-matrix product kernel without vectorization. The inner loop
+   * runs over the batch points, so every point is summed in the same order as
+   * the dot product kernel.
+   */
+  static void GemmScalar(const mlpdouble *A, const mlpdouble *B, mlpdouble *C,
+                         std::size_t n_rows, std::size_t n_columns,
+                         std::size_t n_points) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++) {
+      mlpdouble *c = C + iRow * n_points;
+      for (auto iPoint = 0u; iPoint < n_points; iPoint++)
+        c[iPoint] = 0;
+      for (auto iColumn = 0u; iColumn < n_columns; iColumn++) {
+        const mlpdouble a = A[iRow * n_columns + iColumn];
+        const mlpdouble *b = B + iColumn * n_points;
+        for (auto iPoint = 0u; iPoint < n_points; iPoint++)
+          c[iPoint] += a * b[iPoint];
+      }
+    }
+  }
+
+#ifdef MLP_HAVE_RUNTIME_DISPATCH
+  __attribute__((target("sse2"))) static double
+  DotSSE2(const double *a, const double *b, std::size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(a + i),
+                                         _mm_loadu_pd(b + i)));
+      acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                                         _mm_loadu_pd(b + i + 2)));
+    }
+    acc0 = _mm_add_pd(acc0, acc1);
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc0, _mm_unpackhi_pd(acc0, acc0)));
+    for (; i < n; i++)
+      sum += a[i] * b[i];
+    return sum;
+  }
+
+  __attribute__((target("sse2"))) static void
+  GemvSSE2(const double *A, const double *x, double *y, std::size_t n_rows,
+           std::size_t n_columns) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++)
+      y[iRow] = DotSSE2(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("sse2"))) static void
+  GemvBlockedSSE2(const double *A, const double *x, double *y,
+                  std::size_t n_rows, std::size_t n_columns) {
+    std::size_t iRow = 0;
+    for (; iRow + 4 <= n_rows; iRow += 4) {
+      const double *a = A + iRow * n_columns;
+      __m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(),
+                        _mm_setzero_pd()};
+      std::size_t i = 0;
+      for (; i + 2 <= n_columns; i += 2) {
+        __m128d xv = _mm_loadu_pd(x + i);
+        for (auto r = 0u; r < 4; r++)
+          acc[r] = _mm_add_pd(
+              acc[r], _mm_mul_pd(_mm_loadu_pd(a + r * n_columns + i), xv));
+      }
+      for (auto r = 0u; r < 4; r++) {
+        double sum = _mm_cvtsd_f64(
+            _mm_add_sd(acc[r], _mm_unpackhi_pd(acc[r], acc[r])));
+        if (i < n_columns)
+          sum += a[r * n_columns + i] * x[i];
+        y[iRow + r] = sum;
+      }
+    }
+    for (; iRow < n_rows; iRow++)
+      y[iRow] = DotSSE2(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("avx2,fma"))) static double
+  DotAVX2(const double *a, const double *b, std::size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                             acc0);
+      acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4),
+                             _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    if (i + 4 <= n) {
+      acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i),
+                             acc0);
+      i += 4;
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    __m128d acc = _mm_add_pd(_mm256_castpd256_pd128(acc0),
+                             _mm256_extractf128_pd(acc0, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; i < n; i++)
+      sum += a[i] * b[i];
+    return sum;
+  }
+
+  __attribute__((target("avx2,fma"))) static void
+  GemvAVX2(const double *A, const double *x, double *y, std::size_t n_rows,
+           std::size_t n_columns) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++)
+      y[iRow] = DotAVX2(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("avx2,fma"))) static void
+  GemvBlockedAVX2(const double *A, const double *x, double *y,
+                  std::size_t n_rows, std::size_t n_columns) {
+    std::size_t iRow = 0;
+    for (; iRow + 4 <= n_rows; iRow += 4) {
+      const double *a = A + iRow * n_columns;
+      __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd(),
+              acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+      std::size_t i = 0;
+      for (; i + 4 <= n_columns; i += 4) {
+        __m256d xv = _mm256_loadu_pd(x + i);
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), xv, acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + n_columns + i), xv, acc1);
+        acc2 =
+            _mm256_fmadd_pd(_mm256_loadu_pd(a + 2 * n_columns + i), xv, acc2);
+        acc3 =
+            _mm256_fmadd_pd(_mm256_loadu_pd(a + 3 * n_columns + i), xv, acc3);
+      }
+      /* Reduce the four accumulators to one vector of row sums. */
+      __m256d sum01 = _mm256_hadd_pd(acc0, acc1),
+              sum23 = _mm256_hadd_pd(acc2, acc3);
+      __m256d sums =
+          _mm256_add_pd(_mm256_permute2f128_pd(sum01, sum23, 0x20),
+                        _mm256_permute2f128_pd(sum01, sum23, 0x31));
+      _mm256_storeu_pd(y + iRow, sums);
+      for (; i < n_columns; i++) {
+        for (auto r = 0u; r < 4; r++)
+          y[iRow + r] += a[r * n_columns + i] * x[i];
+      }
+    }
+    for (; iRow < n_rows; iRow++)
+      y[iRow] = DotAVX2(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("avx2,fma"))) static void
+  GemmAVX2(const double *A, const double *B, double *C, std::size_t n_rows,
+           std::size_t n_columns, std::size_t n_points) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++) {
+      const double *a = A + iRow * n_columns;
+      double *c = C + iRow * n_points;
+      std::size_t iPoint = 0;
+      for (; iPoint + 8 <= n_points; iPoint += 8) {
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+        for (auto iColumn = 0u; iColumn < n_columns; iColumn++) {
+          __m256d av = _mm256_set1_pd(a[iColumn]);
+          const double *b = B + iColumn * n_points + iPoint;
+          acc0 = _mm256_fmadd_pd(av, _mm256_loadu_pd(b), acc0);
+          acc1 = _mm256_fmadd_pd(av, _mm256_loadu_pd(b + 4), acc1);
+        }
+        _mm256_storeu_pd(c + iPoint, acc0);
+        _mm256_storeu_pd(c + iPoint + 4, acc1);
+      }
+      for (; iPoint < n_points; iPoint++) {
+        double sum = 0;
+        for (auto iColumn = 0u; iColumn < n_columns; iColumn++)
+          sum += a[iColumn] * B[iColumn * n_points + iPoint];
+        c[iPoint] = sum;
+      }
+    }
+  }
+
+  /* Explicit reduction. _mm512_reduce_add_pd and the unmasked half
+   * extractions pass an undefined vector to the builtin, which triggers
+   * -Wmaybe-uninitialized inside the intrinsic headers; the zero-masked
+   * extraction does not. */
+  __attribute__((target("avx512f"))) static double
+  ReduceAVX512(__m512d v) {
+    const __mmask8 all = static_cast<__mmask8>(0xF);
+    __m256d half = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(all, v, 0),
+                                 _mm512_maskz_extractf64x4_pd(all, v, 1));
+    __m128d acc = _mm_add_pd(_mm256_castpd256_pd128(half),
+                             _mm256_extractf128_pd(half, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+  }
+
+  __attribute__((target("avx512f"))) static double
+  DotAVX512(const double *a, const double *b, std::size_t n) {
+    __m512d acc = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+      acc = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i),
+                            acc);
+    if (i < n) {
+      /* Masked loads handle the remainder without reading past the end. */
+      __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1);
+      acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i),
+                            _mm512_maskz_loadu_pd(mask, b + i), acc);
+    }
+    return ReduceAVX512(acc);
+  }
+
+  __attribute__((target("avx512f"))) static void
+  GemvAVX512(const double *A, const double *x, double *y, std::size_t n_rows,
+             std::size_t n_columns) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++)
+      y[iRow] = DotAVX512(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("avx512f"))) static void
+  GemvBlockedAVX512(const double *A, const double *x, double *y,
+                    std::size_t n_rows, std::size_t n_columns) {
+    std::size_t iRow = 0;
+    for (; iRow + 4 <= n_rows; iRow += 4) {
+      const double *a = A + iRow * n_columns;
+      __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd(),
+              acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+      for (std::size_t i = 0; i < n_columns; i += 8) {
+        __mmask8 mask = (i + 8 <= n_columns)
+                            ? static_cast<__mmask8>(0xFF)
+                            : static_cast<__mmask8>((1u << (n_columns - i)) - 1);
+        __m512d xv = _mm512_maskz_loadu_pd(mask, x + i);
+        acc0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), xv, acc0);
+        acc1 = _mm512_fmadd_pd(
+            _mm512_maskz_loadu_pd(mask, a + n_columns + i), xv, acc1);
+        acc2 = _mm512_fmadd_pd(
+            _mm512_maskz_loadu_pd(mask, a + 2 * n_columns + i), xv, acc2);
+        acc3 = _mm512_fmadd_pd(
+            _mm512_maskz_loadu_pd(mask, a + 3 * n_columns + i), xv, acc3);
+      }
+      y[iRow] = ReduceAVX512(acc0);
+      y[iRow + 1] = ReduceAVX512(acc1);
+      y[iRow + 2] = ReduceAVX512(acc2);
+      y[iRow + 3] = ReduceAVX512(acc3);
+    }
+    for (; iRow < n_rows; iRow++)
+      y[iRow] = DotAVX512(A + iRow * n_columns, x, n_columns);
+  }
+
+  __attribute__((target("avx512f"))) static void
+  GemmAVX512(const double *A, const double *B, double *C, std::size_t n_rows,
+             std::size_t n_columns, std::size_t n_points) {
+    for (auto iRow = 0u; iRow < n_rows; iRow++) {
+      const double *a = A + iRow * n_columns;
+      double *c = C + iRow * n_points;
+      std::size_t iPoint = 0;
+      for (; iPoint + 16 <= n_points; iPoint += 16) {
+        __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+        for (auto iColumn = 0u; iColumn < n_columns; iColumn++) {
+          __m512d av = _mm512_set1_pd(a[iColumn]);
+          const double *b = B + iColumn * n_points + iPoint;
+          acc0 = _mm512_fmadd_pd(av, _mm512_loadu_pd(b), acc0);
+          acc1 = _mm512_fmadd_pd(av, _mm512_loadu_pd(b + 8), acc1);
+        }
+        _mm512_storeu_pd(c + iPoint, acc0);
+        _mm512_storeu_pd(c + iPoint + 8, acc1);
+      }
+      for (; iPoint < n_points; iPoint += 8) {
+        __mmask8 mask = (iPoint + 8 <= n_points)
+                            ? static_cast<__mmask8>(0xFF)
+                            : static_cast<__mmask8>((1u << (n_points - iPoint)) - 1);
+        __m512d acc = _mm512_setzero_pd();
+        for (auto iColumn = 0u; iColumn < n_columns; iColumn++)
+          acc = _mm512_fmadd_pd(
+              _mm512_set1_pd(a[iColumn]),
+              _mm512_maskz_loadu_pd(mask, B + iColumn * n_points + iPoint),
+              acc);
+        _mm512_mask_storeu_pd(c + iPoint, mask, acc);
+      }
+    }
+  }
+#endif
+
+#ifdef MLP_USE_BLAS
+  /*!
+   * \brief Matrix-matrix product through the external BLAS library. The
+   * row-major product C = A B is computed as the column-major product
+   * C^T = B^T A^T.
+   * \returns The BLAS library supports the floating point type.
+   */
+  static bool GemmBLAS(const double *A, const double *B, double *C,
+                       std::size_t n_rows, std::size_t n_columns,
+                       std::size_t n_points) {
+    const int m = static_cast<int>(n_points), n = static_cast<int>(n_rows),
+              k = static_cast<int>(n_columns);
+    const double alpha = 1, beta = 0;
+    dgemm_("N", "N", &m, &n, &k, &alpha, B, &m, A, &k, &beta, C, &m);
+    return true;
+  }
+
+  static bool GemmBLAS(const float *A, const float *B, float *C,
+                       std::size_t n_rows, std::size_t n_columns,
+                       std::size_t n_points) {
+    const int m = static_cast<int>(n_points), n = static_cast<int>(n_rows),
+              k = static_cast<int>(n_columns);
+    const float alpha = 1, beta = 0;
+    sgemm_("N", "N", &m, &n, &k, &alpha, B, &m, A, &k, &beta, C, &m);
+    return true;
+  }
+
+  template <class T>
+  static bool GemmBLAS(const T *, const T *, T *, std::size_t, std::size_t,
+                       std::size_t) {
+    return false;
+  }
+#endif
+
+  /*!
+   * \brief Set the kernel functions for the selected variant.
+   */
+  void SelectKernels() {
+    switch (instruction_set) {
+#ifdef MLP_HAVE_RUNTIME_DISPATCH
+    case ENUM_INSTRUCTION_SET::AVX512:
+      dot_kernel = DotAVX512;
+      gemv_kernel = row_blocking ? GemvBlockedAVX512 : GemvAVX512;
+      gemm_kernel = GemmAVX512;
+      break;
+    case ENUM_INSTRUCTION_SET::AVX2:
+      dot_kernel = DotAVX2;
+      gemv_kernel = row_blocking ? GemvBlockedAVX2 : GemvAVX2;
+      gemm_kernel = GemmAVX2;
+      break;
+    case ENUM_INSTRUCTION_SET::SSE2:
+      dot_kernel = DotSSE2;
+      gemv_kernel = row_blocking ? GemvBlockedSSE2 : GemvSSE2;
+      gemm_kernel = GemmScalar;
+      break;
+#endif
+    default:
+      dot_kernel = DotScalar;
+      gemv_kernel = row_blocking ? GemvBlockedScalar : GemvScalar;
+      gemm_kernel = GemmScalar;
+      break;
+    }
+  }
+
+  /*!
+   * \brief Define a kernel set.
+   * \param[in] set - Instruction set, which has to be supported.
+   * \param[in] blocked - Block the matrix-vector product over rows.
+   */
+  CComputeKernels(ENUM_INSTRUCTION_SET set, bool blocked) {
+    SetInstructionSet(set);
+    SetRowBlocking(blocked);
+  }
+
+public:
+  CComputeKernels(const CComputeKernels &) = delete;
+  CComputeKernels &operator=(const CComputeKernels &) = delete;
+
+  /*!
+   * \brief Get the process-wide kernel set.
+   * \returns Reference to the kernel set.
+   */
+  static CComputeKernels &GetInstance() {
+    static CComputeKernels instance(GetSupportedInstructionSet(), false);
+    return instance;
+  }
+
+  /*!
+   * \brief Get a fixed kernel set variant.
+   * \param[in] set - Instruction set, which has to be supported.
+   * \param[in] blocked - Block the matrix-vector product over rows.
+   * \returns Reference to the kernel set.
+   */
+  static const CComputeKernels &GetKernels(ENUM_INSTRUCTION_SET set,
+                                           bool blocked) {
+    switch (set) {
+    case ENUM_INSTRUCTION_SET::AVX512: {
+      static const CComputeKernels kernels(set, false), blocked_kernels(set, true);
+      return blocked ? blocked_kernels : kernels;
+    }
+    case ENUM_INSTRUCTION_SET::AVX2: {
+      static const CComputeKernels kernels(set, false), blocked_kernels(set, true);
+      return blocked ? blocked_kernels : kernels;
+    }
+    case ENUM_INSTRUCTION_SET::SSE2: {
+      static const CComputeKernels kernels(set, false), blocked_kernels(set, true);
+      return blocked ? blocked_kernels : kernels;
+    }
+    default: {
+      static const CComputeKernels kernels(set, false), blocked_kernels(set, true);
+      return blocked ? blocked_kernels : kernels;
+    }
+    }
+  }
+
+  /*!
+   * \brief Get the widest instruction set supported by both the processor and
+   * the build.
+   * \returns Supported instruction set.
+   */
+  static ENUM_INSTRUCTION_SET GetSupportedInstructionSet() {
+#ifdef MLP_HAVE_RUNTIME_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return ENUM_INSTRUCTION_SET::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return ENUM_INSTRUCTION_SET::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return ENUM_INSTRUCTION_SET::SSE2;
+#endif
+    return ENUM_INSTRUCTION_SET::SCALAR;
+  }
+
+  /*!
+   * \brief Select the instruction set of the kernels, for example to compare
+   * against the scalar kernels. This should be done before any network is
+   * evaluated.
+   * \param[in] set - Instruction set, which has to be supported.
+   */
+  void SetInstructionSet(ENUM_INSTRUCTION_SET set) {
+    if (static_cast<int>(set) >
+        static_cast<int>(GetSupportedInstructionSet()))
+      throw std::invalid_argument(
+          "Instruction set is not supported on this processor.");
+    instruction_set = set;
+    SelectKernels();
+  }
+
+  /*!
+   * \brief Select whether the matrix-vector product is blocked over rows.
+   * \param[in] blocked - Block the matrix-vector product over rows.
+   */
+  void SetRowBlocking(bool blocked) {
+    row_blocking = blocked;
+    SelectKernels();
+  }
+
+  /*!
+   * \brief Check whether the matrix-vector product is blocked over rows.
+   * \returns Row blocking is applied.
+   */
+  bool GetRowBlocking() const { return row_blocking; }
+
+  /*!
+   * \brief Get a readable name of the kernel set.
+   * \returns Instruction set, followed by "/blocked" if rows are blocked.
+   */
+  std::string GetName() const {
+    const std::string names[] = {"scalar", "sse2", "avx2", "avx512"};
+    return names[static_cast<int>(instruction_set)] +
+           (row_blocking ? "/blocked" : "");
+  }
+
+
+  /*!
+   * \brief Get the selected instruction set.
+   * \returns Instruction set of the kernels.
+   */
+  ENUM_INSTRUCTION_SET GetInstructionSet() const { return instruction_set; }
+
+  /*!
+   * \brief Compute the dot product of two arrays.
+   * \param[in] a - First array.
+   * \param[in] b - Second array.
+   * \param[in] n - Array length.
+   * \returns Dot product.
+   */
+  mlpdouble Dot(const mlpdouble *a, const mlpdouble *b, std::size_t n) const {
+    return dot_kernel(a, b, n);
+  }
+
+  /*!
+   * \brief Compute the product of a row-major matrix and a vector.
+   * \param[in] A - Matrix [row][column].
+   * \param[in] x - Vector of length n_columns.
+   * \param[out] y - Product of length n_rows.
+   * \param[in] n_rows - Number of matrix rows.
+   * \param[in] n_columns - Number of matrix columns.
+   */
+  void Gemv(const mlpdouble *A, const mlpdouble *x, mlpdouble *y,
+            std::size_t n_rows, std::size_t n_columns) const {
+    gemv_kernel(A, x, y, n_rows, n_columns);
+  }
+
+  /*!
+   * \brief Check whether matrix-matrix products are computed by an external
+   * BLAS library.
+   * \returns External BLAS library is used.
+   */
+  static bool UsesBLAS() {
+#ifdef MLP_USE_BLAS
+    return std::is_same<mlpdouble, double>::value ||
+           std::is_same<mlpdouble, float>::value;
+#else
+    return false;
+#endif
+  }
+
+  /*!
+   * \brief Compute the product of two row-major matrices, as used for a
+   * weight layer applied to a batch of points.
+   * \param[in] A - Matrix [row][column].
+   * \param[in] B - Matrix [column][point].
+   * \param[out] C - Product [row][point].
+   * \param[in] n_rows - Number of rows of A.
+   * \param[in] n_columns - Number of columns of A.
+   * \param[in] n_points - Number of columns of B.
+   */
+  void Gemm(const mlpdouble *A, const mlpdouble *B, mlpdouble *C,
+            std::size_t n_rows, std::size_t n_columns,
+            std::size_t n_points) const {
+#ifdef MLP_USE_BLAS
+    if (GemmBLAS(A, B, C, n_rows, n_columns, n_points))
+      return;
+#endif
+    gemm_kernel(A, B, C, n_rows, n_columns, n_points);
+  }
+};
+
+} // namespace MLPToolbox
@@ -28,7 +28,12 @@ operations.
 * SOFTWARE.
 */
 
+#include "CComputeKernels.hpp"
+#include "CReducedLayer.hpp"
+#include "CSnapshotBuffer.hpp"
 #include "variable_def.hpp"
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <vector>
 namespace MLPToolbox {
@@ -83,7 +88,35 @@ private:
       Input_Map,  /*!< Mapping of call variable inputs to matching MLP inputs */
       Output_Map; /*!< Mapping of call variable outputs to matching MLP outputs
                    */
+
+  std::vector<bool> bound_inputs; /*!< Call inputs with a fixed value. */
+  std::vector<mlpdouble>
+      bound_values; /*!< Fixed values of the bound call inputs. */
+  std::vector<CReducedLayer>
+      First_Layers,  /*!< Reduced first weight layer of each mapped MLP over
+                        the free call inputs. */
+      Output_Layers; /*!< Reduced output layer of each mapped MLP over the
+                        mapped outputs. */
+
+  std::vector<const CComputeKernels *>
+      MLP_Kernels; /*!< Tuned dense kernels of each mapped MLP, nullptr for
+                      the process-wide default. */
+
+  unsigned long generation{0}; /*!< Collection generation for which the
+                                  paired MLPs were loaded and the reduced
+                                  layers computed, 0 if not prepared. */
+
+  std::vector<std::size_t>
+      Gating_Inputs; /*!< Call input index of each gating network input. */
+  std::vector<int> Gating_Maps; /*!< Input-output mapping index of each expert
+                                   MLP selected by the gating network, -1 if
+                                   the expert cannot serve the look-up. */
 public:
+  /*!
+   * \brief Empty input-output map, to be restored from a snapshot.
+   */
+  CIOMap() = default;
+
   /*!
    * \brief Initiate input-output map with user-defined input and output
    * variables. \param[in] inputVariables_in - Vector containing input variable
@@ -100,6 +133,8 @@ public:
     for (auto iVar = 0u; iVar < outputVariables_in.size(); iVar++) {
       outputVariables[iVar] = outputVariables_in[iVar];
     }
+    bound_inputs.assign(inputVariables.size(), false);
+    bound_values.assign(inputVariables.size(), 0.0);
   }
 
   /*!
@@ -162,6 +197,15 @@ public:
     return Input_Map[i_Map][iInput].first;
   }
 
+  /*!
+   * \brief Get the number of MLP inputs mapped to call inputs
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \return Number of inputs of the loaded MLP
+   */
+  std::size_t GetNMappedInputs(std::size_t i_Map) const {
+    return Input_Map[i_Map].size();
+  }
+
   /*!
    * \brief Get the call output variable index
    * \param[in] i_Map - input-output mapping index of the IO map
@@ -223,9 +267,306 @@ public:
     MLP_input.resize(Input_Map[i_Map].size());
 
     for (std::size_t iInput = 0; iInput < Input_Map[i_Map].size(); iInput++) {
-      MLP_input[iInput] = inputs[GetInputIndex(i_Map, iInput)];
+      auto iCall = GetInputIndex(i_Map, iInput);
+      MLP_input[iInput] = bound_inputs[iCall] ? bound_values[iCall] : inputs[iCall];
     }
     return MLP_input;
   }
+
+  /*!
+   * \brief Fix the value of a call input variable. The value supplied for this
+   * input during look-up operations is ignored in favour of the bound value.
+   * \param[in] iInput - call input variable index.
+   * \param[in] value - fixed input value.
+   */
+  void BindInput(std::size_t iInput, mlpdouble value) {
+    bound_inputs[iInput] = true;
+    bound_values[iInput] = value;
+  }
+
+  /*!
+   * \brief Release all bound call input variables.
+   */
+  void UnbindInputs() {
+    bound_inputs.assign(inputVariables.size(), false);
+    First_Layers.clear();
+  }
+
+  /*!
+   * \brief Check whether a call input variable is bound to a fixed value.
+   * \param[in] iInput - call input variable index.
+   * \return Input is bound.
+   */
+  bool IsBoundInput(std::size_t iInput) const { return bound_inputs[iInput]; }
+
+  /*!
+   * \brief Get the fixed value of a bound call input variable.
+   * \param[in] iInput - call input variable index.
+   * \return Bound input value.
+   */
+  mlpdouble GetBoundValue(std::size_t iInput) const {
+    return bound_values[iInput];
+  }
+
+  /*!
+   * \brief Check whether any of the call input variables is bound.
+   * \return Any input is bound.
+   */
+  bool HasBoundInputs() const {
+    for (auto iInput = 0u; iInput < bound_inputs.size(); iInput++)
+      if (bound_inputs[iInput])
+        return true;
+    return false;
+  }
+
+  /*!
+   * \brief Get the bound status and values of the inputs of a mapped MLP.
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \param[out] is_bound - per MLP input, whether it is bound.
+   * \param[out] values - per MLP input, the bound value.
+   */
+  void GetMLPBoundInputs(std::size_t i_Map, std::vector<bool> &is_bound,
+                         std::vector<mlpdouble> &values) const {
+    is_bound.assign(Input_Map[i_Map].size(), false);
+    values.assign(Input_Map[i_Map].size(), 0.0);
+    for (auto iInput = 0u; iInput < Input_Map[i_Map].size(); iInput++) {
+      auto iCall = Input_Map[i_Map][iInput].first;
+      auto iMLPInput = Input_Map[i_Map][iInput].second;
+      is_bound[iMLPInput] = bound_inputs[iCall];
+      values[iMLPInput] = bound_values[iCall];
+    }
+  }
+
+  /*!
+   * \brief Store the reduced first weight layer of each mapped MLP.
+   * \param[in] first_layers - reduced first layers, one per mapped MLP.
+   */
+  void SetFirstLayers(const std::vector<CReducedLayer> &first_layers) {
+    First_Layers = first_layers;
+  }
+
+  /*!
+   * \brief Get the reduced first weight layer of a mapped MLP.
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \return Pointer to the reduced first layer, nullptr if no inputs are bound.
+   */
+  const CReducedLayer *GetFirstLayer(std::size_t i_Map) const {
+    return First_Layers.empty() ? nullptr : &First_Layers[i_Map];
+  }
+
+  /*!
+   * \brief Store the reduced output layer of each mapped MLP. An empty reduced
+   * layer indicates that all outputs of the MLP are used.
+   * \param[in] output_layers - reduced output layers, one per mapped MLP.
+   */
+  void SetOutputLayers(const std::vector<CReducedLayer> &output_layers) {
+    Output_Layers = output_layers;
+  }
+
+  /*!
+   * \brief Get the reduced output layer of a mapped MLP.
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \return Pointer to the reduced output layer, nullptr if all MLP outputs
+   * are used.
+   */
+  const CReducedLayer *GetOutputLayer(std::size_t i_Map) const {
+    if (Output_Layers.empty() || Output_Layers[i_Map].GetNNeurons() == 0)
+      return nullptr;
+    return &Output_Layers[i_Map];
+  }
+
+  /*!
+   * \brief Set the collection generation for which the paired MLPs are loaded
+   * and the reduced layers are computed.
+   * \param[in] value - Collection generation, 0 if not prepared.
+   */
+  void SetGeneration(unsigned long value) { generation = value; }
+
+  /*!
+   * \brief Get the collection generation for which the paired MLPs are loaded
+   * and the reduced layers are computed.
+   * \return Collection generation, 0 if not prepared.
+   */
+  unsigned long GetGeneration() const { return generation; }
+
+  /*!
+   * \brief Set the dense kernels with which a mapped MLP is evaluated.
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \param[in] kernel_set - Kernel set, nullptr for the process-wide default.
+   */
+  void SetKernels(std::size_t i_Map, const CComputeKernels *kernel_set) {
+    MLP_Kernels.resize(MLP_indices.size(), nullptr);
+    MLP_Kernels[i_Map] = kernel_set;
+  }
+
+  /*!
+   * \brief Get the dense kernels with which a mapped MLP is evaluated.
+   * \param[in] i_Map - input-output mapping index of the IO map
+   * \return Kernel set, nullptr for the process-wide default.
+   */
+  const CComputeKernels *GetKernels(std::size_t i_Map) const {
+    return (i_Map < MLP_Kernels.size()) ? MLP_Kernels[i_Map] : nullptr;
+  }
+
+  /*!
+   * \brief Store the pairing of the gating network with the look-up.
+   * \param[in] gating_inputs - call input index of each gating network input.
+   * \param[in] gating_maps - input-output mapping index per expert MLP, -1 if
+   * the expert cannot serve the look-up on its own.
+   */
+  void SetGatingNetworkMapping(const std::vector<std::size_t> &gating_inputs,
+                               const std::vector<int> &gating_maps) {
+    Gating_Inputs = gating_inputs;
+    Gating_Maps = gating_maps;
+  }
+
+  /*!
+   * \brief Check whether the look-up is paired with a gating network.
+   * \return Gating network is used for MLP selection.
+   */
+  bool HasGatingNetwork() const { return !Gating_Maps.empty(); }
+
+  /*!
+   * \brief Get the gating network inputs from the call inputs.
+   * \param[in] inputs - call inputs
+   * \return std::vector with call inputs in the order of the gating network.
+   */
+  std::vector<mlpdouble>
+  GetGatingInputs(const std::vector<mlpdouble> &inputs) const {
+    std::vector<mlpdouble> gating_input(Gating_Inputs.size());
+    for (auto iInput = 0u; iInput < Gating_Inputs.size(); iInput++) {
+      auto iCall = Gating_Inputs[iInput];
+      gating_input[iInput] =
+          bound_inputs[iCall] ? bound_values[iCall] : inputs[iCall];
+    }
+    return gating_input;
+  }
+
+  /*!
+   * \brief Get the input-output mapping index of an expert MLP.
+   * \param[in] iExpert - gating network output index (loaded MLP index).
+   * \return Input-output mapping index, -1 if the expert cannot serve the
+   * look-up.
+   */
+  int GetGatingMap(std::size_t iExpert) const { return Gating_Maps[iExpert]; }
+
+  /*!
+   * \brief Append the input-output map and its pairing results to a snapshot.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void WriteSnapshot(CSnapshotBuffer &snapshot) const {
+    snapshot.WriteSize(inputVariables.size());
+    for (auto &name : inputVariables)
+      snapshot.WriteString(name);
+    snapshot.WriteSize(outputVariables.size());
+    for (auto &name : outputVariables)
+      snapshot.WriteString(name);
+
+    snapshot.WriteVector(MLP_indices);
+    auto write_mapping =
+        [&snapshot](const std::vector<std::pair<std::size_t, std::size_t>> &map) {
+          std::vector<std::size_t> indices;
+          for (auto &index_pair : map) {
+            indices.push_back(index_pair.first);
+            indices.push_back(index_pair.second);
+          }
+          snapshot.WriteVector(indices);
+        };
+    for (auto i_Map = 0u; i_Map < MLP_indices.size(); i_Map++) {
+      write_mapping(Input_Map[i_Map]);
+      write_mapping(Output_Map[i_Map]);
+    }
+
+    std::vector<std::size_t> bound(bound_inputs.begin(), bound_inputs.end());
+    snapshot.WriteVector(bound);
+    snapshot.WriteVector(bound_values);
+
+    snapshot.WriteSize(First_Layers.size());
+    for (auto &layer : First_Layers)
+      layer.WriteSnapshot(snapshot);
+    snapshot.WriteSize(Output_Layers.size());
+    for (auto &layer : Output_Layers)
+      layer.WriteSnapshot(snapshot);
+
+    snapshot.WriteVector(Gating_Inputs);
+    snapshot.WriteVector(Gating_Maps);
+    snapshot.WriteSize(generation);
+  }
+
+  /*!
+   * \brief Restore the input-output map and its pairing results from a
+   * snapshot.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void ReadSnapshot(CSnapshotBuffer &snapshot) {
+    auto check = [](bool valid) {
+      if (!valid)
+        throw std::invalid_argument("Snapshot input-output map is corrupt");
+    };
+    inputVariables.resize(snapshot.ReadCount(sizeof(std::uint64_t)));
+    for (auto &name : inputVariables)
+      name = snapshot.ReadString();
+    outputVariables.resize(snapshot.ReadCount(sizeof(std::uint64_t)));
+    for (auto &name : outputVariables)
+      name = snapshot.ReadString();
+
+    snapshot.ReadVector(MLP_indices);
+    Input_Map.resize(MLP_indices.size());
+    Output_Map.resize(MLP_indices.size());
+    auto read_mapping =
+        [&snapshot, &check](std::vector<std::pair<std::size_t, std::size_t>> &map,
+                            std::size_t n_call_variables) {
+          std::vector<std::size_t> indices;
+          snapshot.ReadVector(indices);
+          check(indices.size() % 2 == 0);
+          map.resize(indices.size() / 2);
+          for (auto iPair = 0u; iPair < map.size(); iPair++) {
+            check(indices[2 * iPair] < n_call_variables);
+            map[iPair] = std::make_pair(indices[2 * iPair], indices[2 * iPair + 1]);
+          }
+        };
+    for (auto i_Map = 0u; i_Map < MLP_indices.size(); i_Map++) {
+      read_mapping(Input_Map[i_Map], inputVariables.size());
+      read_mapping(Output_Map[i_Map], outputVariables.size());
+    }
+
+    std::vector<std::size_t> bound;
+    snapshot.ReadVector(bound);
+    bound_inputs.assign(bound.begin(), bound.end());
+    snapshot.ReadVector(bound_values);
+    check((bound_inputs.size() == inputVariables.size()) &&
+          (bound_values.size() == inputVariables.size()));
+
+    /* A reduced layer holds at least the sizes of its four vectors. */
+    First_Layers.resize(snapshot.ReadCount(4 * sizeof(std::uint64_t)));
+    for (auto &layer : First_Layers)
+      layer.ReadSnapshot(snapshot);
+    Output_Layers.resize(snapshot.ReadCount(4 * sizeof(std::uint64_t)));
+    for (auto &layer : Output_Layers)
+      layer.ReadSnapshot(snapshot);
+    check(First_Layers.empty() || (First_Layers.size() == MLP_indices.size()));
+    check(Output_Layers.empty() ||
+          (Output_Layers.size() == MLP_indices.size()));
+
+    snapshot.ReadVector(Gating_Inputs);
+    snapshot.ReadVector(Gating_Maps);
+    for (auto iCall : Gating_Inputs)
+      check(iCall < inputVariables.size());
+    for (auto i_Map : Gating_Maps)
+      check((i_Map >= -1) && (i_Map < static_cast<int>(MLP_indices.size())));
+    generation = snapshot.ReadSize();
+  }
+
+  /*!
+   * \brief Get the number of inputs of the gating network.
+   * \return Number of gating network inputs, 0 without gating network.
+   */
+  std::size_t GetNGatingInputs() const { return Gating_Inputs.size(); }
+
+  /*!
+   * \brief Get the number of experts selected by the gating network.
+   * \return Number of gating network outputs, 0 without gating network.
+   */
+  std::size_t GetNGatingExperts() const { return Gating_Maps.size(); }
 };
 } // namespace MLPToolbox
\ No newline at end of file
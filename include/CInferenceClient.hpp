@@ -0,0 +1,212 @@
+/*!
+* \file CInferenceClient.hpp
+* \brief Client of the local inference server.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CInferenceMessage.hpp"
+#include "variable_def.hpp"
+
+#ifdef MLP_HAVE_UNIX_SOCKETS
+#include <sys/un.h>
+
+namespace MLPToolbox {
+class CInferenceClient {
+  /*!
+   *\class CInferenceClient
+   *\brief Connection to a CInferenceServer on the same node. Look-ups are
+   *defined by registering a query plan with the names of the input and output
+   *variables, after which batches of queries are evaluated by the server with
+   *the same argument layout as CLookUp_ANN::PredictANNParallel. Requests are
+   *blocking; a client object must not be used by several threads at the same
+   *time.
+   */
+private:
+  int socket_fd{-1}; /*!< Connection to the server. */
+  std::map<std::size_t, std::pair<std::size_t, std::size_t>>
+      plan_sizes; /*!< Number of inputs and outputs per registered plan. */
+
+  /*!
+   * \brief Send a request and receive its reply.
+   * \param[in] request - Request.
+   * \returns Reply.
+   */
+  CInferenceMessage Exchange(const CInferenceMessage &request) {
+    request.Send(socket_fd);
+    CInferenceMessage reply;
+    reply.Receive(socket_fd);
+    if (reply.GetType() == CInferenceMessage::ERROR_REPLY)
+      throw std::invalid_argument(reply.ReadString());
+    return reply;
+  }
+
+  /*!
+   * \brief Read values [query] of a reply into an output array.
+   * \param[in] reply - Reply.
+   * \param[out] values - Output values.
+   * \param[in] n_points - Number of queries.
+   */
+  static void ReadValues(CInferenceMessage &reply,
+                         std::vector<mlpdouble> &values, std::size_t n_points) {
+    std::vector<double> buffer(n_points);
+    reply.ReadValues(buffer.data(), n_points);
+    values.assign(buffer.begin(), buffer.end());
+  }
+
+public:
+  /*!
+   * \brief Connect to a server.
+   * \param[in] socket_path - File system path of the server socket.
+   */
+  explicit CInferenceClient(const std::string &socket_path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+      throw std::invalid_argument("Socket path " + socket_path +
+                                  " is too long");
+    std::strncpy(address.sun_path, socket_path.c_str(),
+                 sizeof(address.sun_path) - 1);
+    socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((socket_fd < 0) ||
+        (connect(socket_fd, reinterpret_cast<sockaddr *>(&address),
+                 sizeof(address)) != 0)) {
+      const std::string reason = std::strerror(errno);
+      if (socket_fd >= 0)
+        close(socket_fd);
+      throw std::invalid_argument("Unable to connect to inference server at " +
+                                  socket_path + ": " + reason);
+    }
+  }
+
+  CInferenceClient(const CInferenceClient &) = delete;
+  CInferenceClient &operator=(const CInferenceClient &) = delete;
+
+  ~CInferenceClient() { close(socket_fd); }
+
+  /*!
+   * \brief Register a query plan with the server. Registering the same
+   * variables again returns the same plan.
+   * \param[in] input_names - Input variable names.
+   * \param[in] output_names - Output variable names.
+   * \returns Plan index.
+   */
+  std::size_t RegisterPlan(const std::vector<std::string> &input_names,
+                           const std::vector<std::string> &output_names) {
+    CInferenceMessage request(CInferenceMessage::REGISTER_PLAN);
+    request.WriteSize(input_names.size());
+    for (auto &name : input_names)
+      request.WriteString(name);
+    request.WriteSize(output_names.size());
+    for (auto &name : output_names)
+      request.WriteString(name);
+    CInferenceMessage reply = Exchange(request);
+    const std::size_t iPlan = reply.ReadSize();
+    plan_sizes[iPlan] = std::make_pair(input_names.size(), output_names.size());
+    return iPlan;
+  }
+
+  /*!
+   * \brief Evaluate a batch of queries of a registered plan on the server.
+   * \param[in] iPlan - Plan index.
+   * \param[in] inputs - input values per query.
+   * \param[out] outputs - output values [output][query].
+   * \param[out] doutputs_dinputs - optional output derivatives w.r.t. inputs
+   * [output][input][query].
+   * \param[out] d2outputs_dinputs2 - optional output second order derivatives
+   * w.r.t. inputs [output][input][input][query], which require the first order
+   * derivatives to be evaluated as well.
+   */
+  void Predict(std::size_t iPlan,
+               const std::vector<std::vector<mlpdouble>> &inputs,
+               std::vector<std::vector<mlpdouble>> &outputs,
+               std::vector<std::vector<std::vector<mlpdouble>>>
+                   *doutputs_dinputs = nullptr,
+               std::vector<std::vector<std::vector<std::vector<mlpdouble>>>>
+                   *d2outputs_dinputs2 = nullptr) {
+    if ((d2outputs_dinputs2 != nullptr) && (doutputs_dinputs == nullptr))
+      throw std::invalid_argument("Second order derivatives require the first "
+                                  "order derivatives to be evaluated.");
+    auto sizes = plan_sizes.find(iPlan);
+    if (sizes == plan_sizes.end())
+      throw std::invalid_argument("Query plan was not registered");
+    const std::size_t nInputs = sizes->second.first,
+                      nOutputs = sizes->second.second, nPoints = inputs.size();
+    const unsigned short derivative_order =
+        (d2outputs_dinputs2 != nullptr) ? 2
+                                        : ((doutputs_dinputs != nullptr) ? 1 : 0);
+
+    CInferenceMessage request(CInferenceMessage::PREDICT);
+    request.WriteSize(iPlan);
+    request.WriteSize(derivative_order);
+    request.WriteSize(nPoints);
+    std::vector<double> query(nInputs);
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+      if (inputs[iPoint].size() != nInputs)
+        throw std::invalid_argument("Query has the wrong number of inputs");
+      query.assign(inputs[iPoint].begin(), inputs[iPoint].end());
+      request.WriteValues(query.data(), nInputs);
+    }
+    CInferenceMessage reply = Exchange(request);
+
+    outputs.resize(nOutputs);
+    for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+      ReadValues(reply, outputs[iOutput], nPoints);
+    if (derivative_order > 0) {
+      doutputs_dinputs->resize(nOutputs);
+      for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+        (*doutputs_dinputs)[iOutput].resize(nInputs);
+        for (auto iInput = 0u; iInput < nInputs; iInput++)
+          ReadValues(reply, (*doutputs_dinputs)[iOutput][iInput], nPoints);
+      }
+    }
+    if (derivative_order > 1) {
+      d2outputs_dinputs2->resize(nOutputs);
+      for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+        (*d2outputs_dinputs2)[iOutput].resize(nInputs);
+        for (auto iInput = 0u; iInput < nInputs; iInput++) {
+          (*d2outputs_dinputs2)[iOutput][iInput].resize(nInputs);
+          for (auto jInput = 0u; jInput < nInputs; jInput++)
+            ReadValues(reply, (*d2outputs_dinputs2)[iOutput][iInput][jInput],
+                       nPoints);
+        }
+      }
+    }
+  }
+};
+
+} // namespace MLPToolbox
+#endif
@@ -0,0 +1,272 @@
+/*!
+* \file CInferenceMessage.hpp
+* \brief Binary message exchanged between the inference server and its
+clients.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define MLP_HAVE_UNIX_SOCKETS
+#endif
+
+namespace MLPToolbox {
+class CInferenceMessage {
+  /*!
+   *\class CInferenceMessage
+   *\brief Message of the inference server protocol (see CInferenceServer).
+   *On the wire, a message consists of its type and the byte length of its
+   *payload, both as unsigned 64-bit integers, followed by the payload. The
+   *payload is a sequence of unsigned 64-bit integers, strings stored as their
+   *length followed by their characters, and arrays of double precision
+   *values, in the byte order of the machine, as server and clients run on the
+   *same node. The class serves both as the buffer in which a payload is
+   *written and from which it is read, in the same order.
+   */
+public:
+  /*!
+   * \brief Message types.
+   */
+  enum MessageType : std::uint64_t {
+    REGISTER_PLAN = 1, /*!< Register a query plan by input and output names. */
+    PREDICT = 2,       /*!< Evaluate a batch of queries of a plan. */
+    REPLY = 3,         /*!< Successful reply. */
+    ERROR_REPLY = 4    /*!< Failed request, the payload holds the message. */
+  };
+
+#ifdef MSG_NOSIGNAL
+  static constexpr int SEND_FLAGS =
+      MSG_NOSIGNAL; /*!< Report closed peers as errors instead of signals. */
+#else
+  static constexpr int SEND_FLAGS = 0; /*!< Flags of socket sends. */
+#endif
+
+private:
+  std::uint64_t type{0};      /*!< Message type. */
+  std::vector<char> payload;  /*!< Message payload. */
+  std::size_t position{0};    /*!< Read position within the payload. */
+
+  static constexpr std::size_t HEADER_SIZE =
+      2 * sizeof(std::uint64_t); /*!< Size of the type and length fields. */
+
+  /*!
+   * \brief Check that a number of bytes can be read from the payload.
+   * \param[in] n_bytes - Number of bytes to read.
+   */
+  void CheckRead(std::size_t n_bytes) const {
+    if (position + n_bytes > payload.size())
+      throw std::invalid_argument("Inference message is truncated");
+  }
+
+public:
+  CInferenceMessage() = default;
+
+  /*!
+   * \brief Start an empty message.
+   * \param[in] message_type - Message type.
+   */
+  explicit CInferenceMessage(std::uint64_t message_type)
+      : type(message_type) {}
+
+  /*!
+   * \brief Get the message type.
+   * \returns Message type.
+   */
+  std::uint64_t GetType() const { return type; }
+
+  /*!
+   * \brief Append an unsigned integer to the payload.
+   * \param[in] value - Value to write.
+   */
+  void WriteSize(std::uint64_t value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    payload.insert(payload.end(), bytes, bytes + sizeof(value));
+  }
+
+  /*!
+   * \brief Append a string to the payload.
+   * \param[in] value - String to write.
+   */
+  void WriteString(const std::string &value) {
+    WriteSize(value.size());
+    payload.insert(payload.end(), value.begin(), value.end());
+  }
+
+  /*!
+   * \brief Append an array of values to the payload. The number of values is
+   * not stored, it follows from the preceding fields.
+   * \param[in] values - Pointer to the first value.
+   * \param[in] n_values - Number of values.
+   */
+  void WriteValues(const double *values, std::size_t n_values) {
+    const char *bytes = reinterpret_cast<const char *>(values);
+    payload.insert(payload.end(), bytes, bytes + n_values * sizeof(double));
+  }
+
+  /*!
+   * \brief Read an unsigned integer from the payload.
+   * \returns Value read.
+   */
+  std::uint64_t ReadSize() {
+    std::uint64_t value;
+    CheckRead(sizeof(value));
+    std::memcpy(&value, payload.data() + position, sizeof(value));
+    position += sizeof(value);
+    return value;
+  }
+
+  /*!
+   * \brief Read a string from the payload.
+   * \returns String read.
+   */
+  std::string ReadString() {
+    std::size_t length = ReadSize();
+    CheckRead(length);
+    std::string value(payload.data() + position, length);
+    position += length;
+    return value;
+  }
+
+  /*!
+   * \brief Read an array of values from the payload.
+   * \param[out] values - Pointer to the first value.
+   * \param[in] n_values - Number of values.
+   */
+  void ReadValues(double *values, std::size_t n_values) {
+    if (n_values > (payload.size() - position) / sizeof(double))
+      throw std::invalid_argument("Inference message is truncated");
+    std::memcpy(values, payload.data() + position, n_values * sizeof(double));
+    position += n_values * sizeof(double);
+  }
+
+  /*!
+   * \brief Get the number of payload bytes which have not been read yet.
+   * \returns Number of unread bytes.
+   */
+  std::size_t GetNUnreadBytes() const { return payload.size() - position; }
+
+  /*!
+   * \brief Append the message, including type and length, to a byte stream.
+   * \param[in,out] stream - Byte stream.
+   */
+  void AppendTo(std::vector<char> &stream) const {
+    const std::uint64_t header[2] = {type, payload.size()};
+    const char *bytes = reinterpret_cast<const char *>(header);
+    stream.insert(stream.end(), bytes, bytes + HEADER_SIZE);
+    stream.insert(stream.end(), payload.begin(), payload.end());
+  }
+
+  /*!
+   * \brief Take the first complete message from the front of a byte stream.
+   * \param[in,out] stream - Byte stream, from which the message is removed.
+   * \param[in] max_payload - Largest accepted payload size in bytes.
+   * \returns A complete message was available.
+   */
+  bool ExtractFrom(std::vector<char> &stream, std::uint64_t max_payload) {
+    if (stream.size() < HEADER_SIZE)
+      return false;
+    std::uint64_t header[2];
+    std::memcpy(header, stream.data(), HEADER_SIZE);
+    if (header[1] > max_payload)
+      throw std::invalid_argument("Inference message exceeds the size limit");
+    if (stream.size() < HEADER_SIZE + header[1])
+      return false;
+    type = header[0];
+    payload.assign(stream.begin() + HEADER_SIZE,
+                   stream.begin() + HEADER_SIZE + header[1]);
+    position = 0;
+    stream.erase(stream.begin(), stream.begin() + HEADER_SIZE + header[1]);
+    return true;
+  }
+
+#ifdef MLP_HAVE_UNIX_SOCKETS
+  /*!
+   * \brief Send the message over a blocking socket.
+   * \param[in] socket_fd - Socket descriptor.
+   */
+  void Send(int socket_fd) const {
+    std::vector<char> stream;
+    AppendTo(stream);
+    std::size_t n_sent = 0;
+    while (n_sent < stream.size()) {
+      ssize_t n = send(socket_fd, stream.data() + n_sent,
+                       stream.size() - n_sent, SEND_FLAGS);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        throw std::invalid_argument("Unable to send inference message: " +
+                                    std::string(std::strerror(errno)));
+      n_sent += n;
+    }
+  }
+
+  /*!
+   * \brief Receive a message from a blocking socket.
+   * \param[in] socket_fd - Socket descriptor.
+   */
+  void Receive(int socket_fd) {
+    std::uint64_t header[2];
+    ReceiveBytes(socket_fd, reinterpret_cast<char *>(header), HEADER_SIZE);
+    type = header[0];
+    payload.resize(header[1]);
+    ReceiveBytes(socket_fd, payload.data(), payload.size());
+    position = 0;
+  }
+
+private:
+  /*!
+   * \brief Receive a fixed number of bytes from a blocking socket.
+   * \param[in] socket_fd - Socket descriptor.
+   * \param[out] data - Received bytes.
+   * \param[in] n_bytes - Number of bytes to receive.
+   */
+  static void ReceiveBytes(int socket_fd, char *data, std::size_t n_bytes) {
+    std::size_t n_received = 0;
+    while (n_received < n_bytes) {
+      ssize_t n = recv(socket_fd, data + n_received, n_bytes - n_received, 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        throw std::invalid_argument(
+            "Connection to the inference server was lost");
+      n_received += n;
+    }
+  }
+#endif
+};
+
+} // namespace MLPToolbox
@@ -0,0 +1,507 @@
+/*!
+* \file CInferenceServer.hpp
+* \brief Local server evaluating an MLP collection for several client
+processes.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CInferenceMessage.hpp"
+#include "CLookUp_ANN.hpp"
+#include "variable_def.hpp"
+
+#ifdef MLP_HAVE_UNIX_SOCKETS
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/un.h>
+
+namespace MLPToolbox {
+class CInferenceServer {
+  /*!
+   *\class CInferenceServer
+   *\brief Serves the networks of a single CLookUp_ANN collection to client
+   *processes on the same node over a Unix domain socket, such that tools
+   *needing the same networks do not each load their own copy. Clients first
+   *register a query plan by the names of its input and output variables, and
+   *then send batches of queries for the plan, optionally asking for first or
+   *second order derivatives. Queries of all clients with the same plan and
+   *derivative order are evaluated together: once the pending queries reach
+   *the maximum batch size, or the oldest of them waited for the maximum
+   *latency, they are joined into a single batch evaluation. The server runs
+   *in a single thread; evaluations use the process-wide thread pool. See
+   *CInferenceMessage for the message layout.
+   *
+   *Requests and replies:
+   * - REGISTER_PLAN: number of inputs, input names, number of outputs, output
+   *   names. Reply: plan index.
+   * - PREDICT: plan index, derivative order (0, 1 or 2), number of queries,
+   *   input values [query][input]. Reply: output values [output][query],
+   *   followed by the first order derivatives [output][input][query] and the
+   *   second order derivatives [output][input][input][query] if requested.
+   * - Failed requests are answered by ERROR_REPLY holding the error message.
+   *
+   *A client receives its replies in the order of its requests.
+   */
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * \brief Registered query plan.
+   */
+  struct CPlan {
+    std::vector<std::string> inputs,   /*!< Input variable names. */
+        outputs;                       /*!< Output variable names. */
+    std::unique_ptr<CIOMap> input_output_map; /*!< Paired input-output map. */
+  };
+
+  /*!
+   * \brief Connected client.
+   */
+  struct CClient {
+    int socket_fd{-1};              /*!< Client socket. */
+    std::vector<char> received,     /*!< Received, unprocessed bytes. */
+        reply;                      /*!< Reply bytes not yet sent. */
+    bool waiting{false}; /*!< A prediction of the client is pending. */
+    bool closed{false};  /*!< The connection is to be closed. */
+  };
+
+  /*!
+   * \brief Prediction request waiting to be evaluated.
+   */
+  struct CPendingRequest {
+    std::size_t iClient;            /*!< Requesting client. */
+    std::size_t iPlan;              /*!< Query plan. */
+    unsigned short derivative_order; /*!< Requested derivative order. */
+    std::vector<std::vector<mlpdouble>> inputs; /*!< Input values per query. */
+    Clock::time_point received;     /*!< Time the request was received. */
+  };
+
+  CLookUp_ANN &lookup; /*!< Collection evaluating the queries. */
+  std::vector<CPlan> plans;   /*!< Registered query plans. */
+  std::map<std::size_t, CClient> clients; /*!< Connected clients by index. */
+  std::size_t next_client{0}; /*!< Index of the next client. */
+  std::vector<CPendingRequest> pending; /*!< Requests awaiting evaluation. */
+  std::size_t n_pending_queries{0}; /*!< Number of pending queries. */
+
+  std::size_t max_batch_size{4096}; /*!< Queries per batch. */
+  std::chrono::microseconds max_latency{200}; /*!< Maximum waiting time of a
+                                                 request. */
+  std::uint64_t max_message_size{std::uint64_t(1) << 32}; /*!< Largest
+                                                             accepted request
+                                                             in bytes. */
+  std::atomic<bool> stop_requested{false}; /*!< Run is asked to return. */
+  unsigned long n_batches{0}; /*!< Number of evaluated batches. */
+
+  /*!
+   * \brief Make a socket non-blocking.
+   * \param[in] socket_fd - Socket descriptor.
+   */
+  static void SetNonBlocking(int socket_fd) {
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+  }
+
+  /*!
+   * \brief Queue an error reply for a client.
+   * \param[in] client - Client.
+   * \param[in] message - Error message.
+   */
+  static void ReplyError(CClient &client, const std::string &message) {
+    CInferenceMessage reply(CInferenceMessage::ERROR_REPLY);
+    reply.WriteString(message);
+    reply.AppendTo(client.reply);
+  }
+
+  /*!
+   * \brief Read a list of variable names from a request.
+   * \param[in] request - Request of which the next field is the name list.
+   * \returns Variable names.
+   */
+  static std::vector<std::string> ReadNames(CInferenceMessage &request) {
+    const std::size_t nNames = request.ReadSize();
+    /* Every name holds at least its length, check the count before sizing. */
+    if (nNames > request.GetNUnreadBytes() / sizeof(std::uint64_t))
+      throw std::invalid_argument("Inference message is truncated");
+    std::vector<std::string> names(nNames);
+    for (auto &name : names)
+      name = request.ReadString();
+    return names;
+  }
+
+  /*!
+   * \brief Register a query plan, or find the identical plan registered
+   * before.
+   * \param[in] request - REGISTER_PLAN request.
+   * \returns Plan index.
+   */
+  std::size_t RegisterPlan(CInferenceMessage &request) {
+    std::vector<std::string> inputs = ReadNames(request);
+    std::vector<std::string> outputs = ReadNames(request);
+    for (auto iPlan = 0u; iPlan < plans.size(); iPlan++) {
+      if ((plans[iPlan].inputs == inputs) && (plans[iPlan].outputs == outputs))
+        return iPlan;
+    }
+    CPlan plan;
+    plan.inputs = inputs;
+    plan.outputs = outputs;
+    plan.input_output_map.reset(new CIOMap(inputs, outputs));
+    lookup.PairVariableswithMLPs(*plan.input_output_map);
+    plans.push_back(std::move(plan));
+    return plans.size() - 1;
+  }
+
+  /*!
+   * \brief Read a PREDICT request into the pending requests.
+   * \param[in] iClient - Requesting client.
+   * \param[in] request - PREDICT request.
+   */
+  void QueuePrediction(std::size_t iClient, CInferenceMessage &request) {
+    CPendingRequest prediction;
+    prediction.iClient = iClient;
+    prediction.iPlan = request.ReadSize();
+    if (prediction.iPlan >= plans.size())
+      throw std::invalid_argument("Unknown query plan");
+    const std::uint64_t order = request.ReadSize();
+    if (order > 2)
+      throw std::invalid_argument("Derivative order must be 0, 1 or 2");
+    prediction.derivative_order = static_cast<unsigned short>(order);
+    const std::size_t nPoints = request.ReadSize(),
+                      nInputs = plans[prediction.iPlan].inputs.size();
+    /* Check the query count against the payload before allocating for it. */
+    if (nPoints > request.GetNUnreadBytes() /
+                      (std::max<std::size_t>(nInputs, 1) * sizeof(double)))
+      throw std::invalid_argument("Inference message is truncated");
+    std::vector<double> values(nInputs);
+    prediction.inputs.resize(nPoints);
+    for (auto &query : prediction.inputs) {
+      request.ReadValues(values.data(), nInputs);
+      query.assign(values.begin(), values.end());
+    }
+    prediction.received = Clock::now();
+    n_pending_queries += nPoints;
+    pending.push_back(std::move(prediction));
+    clients[iClient].waiting = true;
+  }
+
+  /*!
+   * \brief Handle the received requests of the clients without pending
+   * predictions. A client sending a prediction is served no further until the
+   * prediction is answered, which keeps its replies in order.
+   */
+  void ProcessRequests() {
+    for (auto &entry : clients) {
+      CClient &client = entry.second;
+      CInferenceMessage request;
+      while (!client.waiting && !client.closed) {
+        try {
+          if (!request.ExtractFrom(client.received, max_message_size))
+            break;
+        } catch (const std::exception &) {
+          client.closed = true;
+          break;
+        }
+        try {
+          if (request.GetType() == CInferenceMessage::REGISTER_PLAN) {
+            const std::size_t iPlan = RegisterPlan(request);
+            CInferenceMessage reply(CInferenceMessage::REPLY);
+            reply.WriteSize(iPlan);
+            reply.AppendTo(client.reply);
+          } else if (request.GetType() == CInferenceMessage::PREDICT) {
+            QueuePrediction(entry.first, request);
+          } else {
+            throw std::invalid_argument("Unknown request type");
+          }
+        } catch (const std::exception &e) {
+          ReplyError(client, e.what());
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Evaluate all pending requests, joining the queries of requests
+   * with the same plan and derivative order into a single batch.
+   */
+  void EvaluatePending() {
+    std::map<std::pair<std::size_t, unsigned short>, std::vector<std::size_t>>
+        groups;
+    for (auto iRequest = 0u; iRequest < pending.size(); iRequest++)
+      groups[std::make_pair(pending[iRequest].iPlan,
+                            pending[iRequest].derivative_order)]
+          .push_back(iRequest);
+
+    for (auto &group : groups) {
+      CIOMap *input_output_map = plans[group.first.first].input_output_map.get();
+      const unsigned short order = group.first.second;
+      std::vector<std::vector<mlpdouble>> inputs, outputs;
+      std::vector<std::vector<std::vector<mlpdouble>>> doutputs_dinputs;
+      std::vector<std::vector<std::vector<std::vector<mlpdouble>>>>
+          d2outputs_dinputs2;
+      for (auto iRequest : group.second)
+        inputs.insert(inputs.end(), pending[iRequest].inputs.begin(),
+                      pending[iRequest].inputs.end());
+
+      std::string error;
+      try {
+        if (order == 0)
+          lookup.PredictANNBatch(input_output_map, inputs, outputs);
+        else
+          lookup.PredictANNParallel(
+              input_output_map, inputs, outputs, &doutputs_dinputs,
+              (order > 1) ? &d2outputs_dinputs2 : nullptr);
+        n_batches++;
+      } catch (const std::exception &e) {
+        error = e.what();
+      }
+
+      /* Split the batch into the replies of the requests. */
+      const std::size_t nInputs = input_output_map->GetInputVars().size(),
+                        nOutputs = input_output_map->GetOutputVars().size();
+      std::size_t iFirst = 0;
+      for (auto iRequest : group.second) {
+        const std::size_t nPoints = pending[iRequest].inputs.size();
+        auto client = clients.find(pending[iRequest].iClient);
+        if (client != clients.end()) {
+          client->second.waiting = false;
+          if (!error.empty()) {
+            ReplyError(client->second, error);
+          } else {
+            CInferenceMessage reply(CInferenceMessage::REPLY);
+            std::vector<double> values(nPoints);
+            auto write = [&](const std::vector<mlpdouble> &batch_values) {
+              for (auto iPoint = 0u; iPoint < nPoints; iPoint++)
+                values[iPoint] = batch_values[iFirst + iPoint];
+              reply.WriteValues(values.data(), nPoints);
+            };
+            for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+              write(outputs[iOutput]);
+            for (auto iOutput = 0u; (order > 0) && (iOutput < nOutputs);
+                 iOutput++)
+              for (auto iInput = 0u; iInput < nInputs; iInput++)
+                write(doutputs_dinputs[iOutput][iInput]);
+            for (auto iOutput = 0u; (order > 1) && (iOutput < nOutputs);
+                 iOutput++)
+              for (auto iInput = 0u; iInput < nInputs; iInput++)
+                for (auto jInput = 0u; jInput < nInputs; jInput++)
+                  write(d2outputs_dinputs2[iOutput][iInput][jInput]);
+            reply.AppendTo(client->second.reply);
+          }
+        }
+        iFirst += nPoints;
+      }
+    }
+    pending.clear();
+    n_pending_queries = 0;
+  }
+
+  /*!
+   * \brief Receive and send data of a client whose socket is ready.
+   * \param[in] client - Client.
+   * \param[in] events - Poll events of the client socket.
+   */
+  static void Communicate(CClient &client, short events) {
+    if (events & (POLLIN | POLLHUP | POLLERR)) {
+      char buffer[65536];
+      for (;;) {
+        ssize_t n = recv(client.socket_fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+          client.received.insert(client.received.end(), buffer, buffer + n);
+          continue;
+        }
+        if ((n == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                         (errno != EINTR)))
+          client.closed = true;
+        break;
+      }
+    }
+    if ((events & POLLOUT) && !client.reply.empty()) {
+      ssize_t n = send(client.socket_fd, client.reply.data(),
+                       client.reply.size(), CInferenceMessage::SEND_FLAGS);
+      if (n > 0)
+        client.reply.erase(client.reply.begin(), client.reply.begin() + n);
+      else if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+               (errno != EINTR))
+        client.closed = true;
+    }
+  }
+
+public:
+  /*!
+   * \brief Define the server of a collection. The collection must not be used
+   * elsewhere while the server runs.
+   * \param[in] lookup_collection - Collection evaluating the queries.
+   */
+  explicit CInferenceServer(CLookUp_ANN &lookup_collection)
+      : lookup(lookup_collection) {}
+
+  /*!
+   * \brief Set the number of pending queries at which they are evaluated
+   * without waiting for the latency limit.
+   * \param[in] n_queries - Maximum batch size.
+   */
+  void SetMaxBatchSize(std::size_t n_queries) {
+    max_batch_size = std::max<std::size_t>(n_queries, 1);
+  }
+
+  /*!
+   * \brief Set the time after which a request is evaluated, even if the batch
+   * is not full. The server waits in steps of a millisecond.
+   * \param[in] latency - Maximum waiting time.
+   */
+  void SetMaxLatency(std::chrono::microseconds latency) {
+    max_latency = latency;
+  }
+
+  /*!
+   * \brief Ask Run to return. This may be called from another thread or from
+   * a signal handler.
+   */
+  void Stop() { stop_requested = true; }
+
+  /*!
+   * \brief Get the number of batches evaluated so far.
+   * \returns Number of batches.
+   */
+  unsigned long GetNBatches() const { return n_batches; }
+
+  /*!
+   * \brief Serve clients on a Unix domain socket until Stop is called. An
+   * existing file at the socket path is replaced, and removed on return.
+   * \param[in] socket_path - File system path of the socket.
+   */
+  void Run(const std::string &socket_path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+      throw std::invalid_argument("Socket path " + socket_path +
+                                  " is too long");
+    std::strncpy(address.sun_path, socket_path.c_str(),
+                 sizeof(address.sun_path) - 1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if ((listen_fd < 0) ||
+        (bind(listen_fd, reinterpret_cast<sockaddr *>(&address),
+              sizeof(address)) != 0) ||
+        (listen(listen_fd, 64) != 0)) {
+      const std::string reason = std::strerror(errno);
+      if (listen_fd >= 0)
+        close(listen_fd);
+      throw std::invalid_argument("Unable to listen on socket " +
+                                  socket_path + ": " + reason);
+    }
+    SetNonBlocking(listen_fd);
+
+    stop_requested = false;
+    std::vector<pollfd> poll_fds;
+    std::vector<std::size_t> poll_clients;
+    while (!stop_requested) {
+      ProcessRequests();
+
+      /* Evaluate once the batch is full or the oldest request is due. */
+      int timeout_ms = 100;
+      if (!pending.empty()) {
+        const Clock::time_point deadline = pending.front().received + max_latency;
+        const Clock::time_point now = Clock::now();
+        if ((n_pending_queries >= max_batch_size) || (deadline <= now)) {
+          EvaluatePending();
+          continue;
+        }
+        timeout_ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - now + std::chrono::microseconds(999))
+                .count());
+      }
+
+      poll_fds.assign(1, pollfd{listen_fd, POLLIN, 0});
+      poll_clients.clear();
+      for (auto &entry : clients) {
+        short events = POLLIN;
+        if (!entry.second.reply.empty())
+          events |= POLLOUT;
+        poll_fds.push_back(pollfd{entry.second.socket_fd, events, 0});
+        poll_clients.push_back(entry.first);
+      }
+      if (poll(poll_fds.data(), poll_fds.size(), timeout_ms) < 0)
+        continue;
+
+      for (auto iPoll = 1u; iPoll < poll_fds.size(); iPoll++)
+        if (poll_fds[iPoll].revents != 0)
+          Communicate(clients[poll_clients[iPoll - 1]], poll_fds[iPoll].revents);
+      if (poll_fds[0].revents & POLLIN) {
+        for (int client_fd = accept(listen_fd, nullptr, nullptr);
+             client_fd >= 0; client_fd = accept(listen_fd, nullptr, nullptr)) {
+          SetNonBlocking(client_fd);
+          clients[next_client++].socket_fd = client_fd;
+        }
+      }
+
+      /* Drop closed clients together with their pending requests. */
+      for (auto entry = clients.begin(); entry != clients.end();) {
+        if (!entry->second.closed) {
+          ++entry;
+          continue;
+        }
+        const std::size_t iClient = entry->first;
+        close(entry->second.socket_fd);
+        entry = clients.erase(entry);
+        for (auto request = pending.begin(); request != pending.end();) {
+          if (request->iClient == iClient) {
+            n_pending_queries -= request->inputs.size();
+            request = pending.erase(request);
+          } else {
+            ++request;
+          }
+        }
+      }
+    }
+
+    for (auto &entry : clients)
+      close(entry.second.socket_fd);
+    clients.clear();
+    pending.clear();
+    n_pending_queries = 0;
+    close(listen_fd);
+    unlink(socket_path.c_str());
+  }
+};
+
+} // namespace MLPToolbox
+#endif
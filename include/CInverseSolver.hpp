@@ -0,0 +1,334 @@
+/*!
+* \file CInverseSolver.hpp
+* \brief Newton solver for the MLP inputs reproducing given outputs.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "CLookUp_ANN.hpp"
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CInverseSolver {
+  /*!
+   *\class CInverseSolver
+   *\brief This class finds the call inputs of a look-up operation for which
+   *the call outputs match a set of target values. For example, temperature
+   *and pressure can be recovered from density and internal energy with an MLP
+   *predicting density and energy from temperature and pressure. The analytical
+   *first-order derivatives of the MLP collection form the Jacobian of a damped
+   *Newton iteration over a subset of free call inputs. The remaining call
+   *inputs keep the value they are given. If the number of free inputs differs
+   *from the number of call outputs, the Gauss-Newton (least-squares) step is
+   *taken instead. Free inputs are kept within the input range of the paired
+   *MLPs.
+   */
+private:
+  unsigned long max_iterations{50}; /*!< Maximum number of Newton iterations. */
+  unsigned short max_backtracking{
+      10}; /*!< Maximum number of step halvings per iteration. */
+  mlpdouble tolerance{1e-10}, /*!< Convergence tolerance on the relative
+                                 output residual. */
+      relaxation{1.0},        /*!< Relaxation factor of the Newton step. */
+      step_tolerance{1e-12};  /*!< Minimum relative change of the free
+                                 inputs per iteration. */
+  bool use_bounds{true}; /*!< Keep free inputs within the MLP input range. */
+
+  unsigned long n_iterations{0}; /*!< Iterations used in the last solve. */
+  mlpdouble residual{0};         /*!< Residual of the last solve. */
+
+  std::vector<mlpdouble> outputs, /*!< Call output values. */
+      lower_bounds,               /*!< Lower bound of each free input. */
+      upper_bounds;               /*!< Upper bound of each free input. */
+  std::vector<mlpdouble *> output_refs; /*!< Pointers to call outputs. */
+  std::vector<std::vector<mlpdouble>>
+      doutputs_dinputs; /*!< Call output derivatives w.r.t. call inputs. */
+  std::vector<std::vector<mlpdouble *>>
+      doutputs_dinputs_refs; /*!< Pointers to call output derivatives. */
+
+  /*!
+   * \brief Size the work arrays for a look-up operation.
+   * \param[in] nInputs - Number of call inputs.
+   * \param[in] nOutputs - Number of call outputs.
+   */
+  void SizeWorkArrays(std::size_t nInputs, std::size_t nOutputs) {
+    outputs.resize(nOutputs);
+    output_refs.resize(nOutputs);
+    doutputs_dinputs.resize(nOutputs);
+    doutputs_dinputs_refs.resize(nOutputs);
+    for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+      output_refs[iOutput] = &outputs[iOutput];
+      doutputs_dinputs[iOutput].resize(nInputs);
+      doutputs_dinputs_refs[iOutput].resize(nInputs);
+      for (auto iInput = 0u; iInput < nInputs; iInput++)
+        doutputs_dinputs_refs[iOutput][iInput] =
+            &doutputs_dinputs[iOutput][iInput];
+    }
+  }
+
+  /*!
+   * \brief Compute the maximum relative residual of the call outputs.
+   * \param[in] targets - Target call output values.
+   * \returns Maximum relative residual.
+   */
+  mlpdouble ComputeResidual(const std::vector<mlpdouble> &targets) const {
+    mlpdouble res_max = 0;
+    for (auto iOutput = 0u; iOutput < targets.size(); iOutput++) {
+      mlpdouble scale = (targets[iOutput] != 0) ? fabs(targets[iOutput]) : 1.0;
+      res_max = std::max(res_max, fabs(outputs[iOutput] - targets[iOutput]) / scale);
+    }
+    return res_max;
+  }
+
+  /*!
+   * \brief Solve a dense linear system through Gaussian elimination with
+   * partial pivoting.
+   * \param[in] A - System matrix, overwritten.
+   * \param[in] b - Right-hand side, overwritten by the solution.
+   * \returns Whether the system is non-singular.
+   */
+  static bool SolveLinearSystem(std::vector<std::vector<mlpdouble>> &A,
+                                std::vector<mlpdouble> &b) {
+    std::size_t n = b.size();
+    for (auto iCol = 0u; iCol < n; iCol++) {
+      std::size_t iPivot = iCol;
+      for (auto iRow = iCol + 1; iRow < n; iRow++)
+        if (fabs(A[iRow][iCol]) > fabs(A[iPivot][iCol]))
+          iPivot = iRow;
+      if (A[iPivot][iCol] == 0)
+        return false;
+      std::swap(A[iPivot], A[iCol]);
+      std::swap(b[iPivot], b[iCol]);
+      for (auto iRow = iCol + 1; iRow < n; iRow++) {
+        mlpdouble factor = A[iRow][iCol] / A[iCol][iCol];
+        for (auto jCol = iCol; jCol < n; jCol++)
+          A[iRow][jCol] -= factor * A[iCol][jCol];
+        b[iRow] -= factor * b[iCol];
+      }
+    }
+    for (auto iRow = n; iRow-- > 0;) {
+      for (auto jCol = iRow + 1; jCol < n; jCol++)
+        b[iRow] -= A[iRow][jCol] * b[jCol];
+      b[iRow] /= A[iRow][iRow];
+    }
+    return true;
+  }
+
+public:
+  /*!
+   * \brief Set the maximum number of Newton iterations.
+   * \param[in] n_iter - Maximum number of iterations.
+   */
+  void SetMaxIterations(unsigned long n_iter) { max_iterations = n_iter; }
+
+  /*!
+   * \brief Set the convergence tolerance on the relative output residual.
+   * \param[in] tol - Tolerance value.
+   */
+  void SetTolerance(mlpdouble tol) { tolerance = tol; }
+
+  /*!
+   * \brief Set the relaxation factor applied to the Newton step.
+   * \param[in] relax - Relaxation factor (0-1].
+   */
+  void SetRelaxationFactor(mlpdouble relax) { relaxation = relax; }
+
+  /*!
+   * \brief Set the maximum number of step halvings when a step does not
+   * reduce the residual.
+   * \param[in] n_backtrack - Maximum number of step halvings.
+   */
+  void SetMaxBacktracking(unsigned short n_backtrack) {
+    max_backtracking = n_backtrack;
+  }
+
+  /*!
+   * \brief Set the minimum relative change of the free inputs per iteration.
+   * The iteration stops once an accepted step changes no free input by more
+   * than this fraction of its value.
+   * \param[in] tol - Step tolerance.
+   */
+  void SetStepTolerance(mlpdouble tol) { step_tolerance = tol; }
+
+  /*!
+   * \brief Keep the free inputs within the input range of the paired MLPs.
+   * \param[in] bounded - Apply input bounds.
+   */
+  void SetBounded(bool bounded) { use_bounds = bounded; }
+
+  /*!
+   * \brief Get the number of iterations used in the last solve.
+   * \returns Number of Newton iterations.
+   */
+  unsigned long GetNIterations() const { return n_iterations; }
+
+  /*!
+   * \brief Get the maximum relative output residual of the last solve.
+   * \returns Residual value.
+   */
+  mlpdouble GetResidual() const { return residual; }
+
+  /*!
+   * \brief Find the call inputs for which the call outputs match the targets.
+   * \param[in] ANN - MLP collection.
+   * \param[in] input_output_map - Input-output map of the look-up operation.
+   * \param[in,out] inputs - Call inputs; initial guess on entry, solution on
+   * exit.
+   * \param[in] targets - Target call output values.
+   * \param[in] free_inputs - Indices of the call inputs to solve for.
+   * \returns Whether the solver converged.
+   */
+  bool Solve(CLookUp_ANN &ANN, CIOMap *input_output_map,
+             std::vector<mlpdouble> &inputs,
+             const std::vector<mlpdouble> &targets,
+             const std::vector<std::size_t> &free_inputs) {
+    std::size_t nFree = free_inputs.size(), nOutputs = targets.size();
+    SizeWorkArrays(inputs.size(), nOutputs);
+
+    lower_bounds.resize(nFree);
+    upper_bounds.resize(nFree);
+    for (auto iFree = 0u; iFree < nFree; iFree++) {
+      if (use_bounds) {
+        auto bounds = ANN.GetInputBounds(input_output_map, free_inputs[iFree]);
+        lower_bounds[iFree] = bounds.first;
+        upper_bounds[iFree] = bounds.second;
+      } else {
+        lower_bounds[iFree] = std::numeric_limits<mlpdouble>::lowest();
+        upper_bounds[iFree] = std::numeric_limits<mlpdouble>::max();
+      }
+    }
+
+    std::vector<std::vector<mlpdouble>> A(nFree, std::vector<mlpdouble>(nFree));
+    std::vector<mlpdouble> delta_x(nFree), x_old(nFree);
+
+    ANN.PredictANN(input_output_map, inputs, output_refs, &doutputs_dinputs_refs);
+    residual = ComputeResidual(targets);
+    n_iterations = 0;
+    while ((residual > tolerance) && (n_iterations < max_iterations)) {
+      n_iterations++;
+
+      /* Assemble the Newton system J dx = -r, or the normal equations
+       * J^T J dx = -J^T r if the system is not square. */
+      if (nFree == nOutputs) {
+        for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+          for (auto iFree = 0u; iFree < nFree; iFree++)
+            A[iOutput][iFree] = doutputs_dinputs[iOutput][free_inputs[iFree]];
+          delta_x[iOutput] = targets[iOutput] - outputs[iOutput];
+        }
+      } else {
+        for (auto iFree = 0u; iFree < nFree; iFree++) {
+          delta_x[iFree] = 0;
+          for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+            delta_x[iFree] += doutputs_dinputs[iOutput][free_inputs[iFree]] *
+                              (targets[iOutput] - outputs[iOutput]);
+          for (auto jFree = 0u; jFree < nFree; jFree++) {
+            A[iFree][jFree] = 0;
+            for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+              A[iFree][jFree] += doutputs_dinputs[iOutput][free_inputs[iFree]] *
+                                 doutputs_dinputs[iOutput][free_inputs[jFree]];
+          }
+        }
+      }
+      if (!SolveLinearSystem(A, delta_x))
+        break;
+
+      /* Damped update, halving the step while the residual increases. */
+      for (auto iFree = 0u; iFree < nFree; iFree++)
+        x_old[iFree] = inputs[free_inputs[iFree]];
+      mlpdouble step = relaxation, residual_old = residual;
+      bool improved = false, stagnated = false;
+      for (auto iBacktrack = 0u; iBacktrack <= max_backtracking; iBacktrack++) {
+        stagnated = true;
+        for (auto iFree = 0u; iFree < nFree; iFree++) {
+          mlpdouble x_new = std::min(
+              std::max(x_old[iFree] + step * delta_x[iFree], lower_bounds[iFree]),
+              upper_bounds[iFree]);
+          stagnated = stagnated && (std::fabs(x_new - x_old[iFree]) <=
+                                    step_tolerance * std::fabs(x_old[iFree]));
+          inputs[free_inputs[iFree]] = x_new;
+        }
+        if (stagnated)
+          break;
+        ANN.PredictANN(input_output_map, inputs, output_refs,
+                       &doutputs_dinputs_refs);
+        residual = ComputeResidual(targets);
+        if (residual < residual_old) {
+          improved = true;
+          break;
+        }
+        step *= 0.5;
+      }
+
+      /* Without a step lowering the residual, the iteration stops at the
+       * last accepted point. */
+      if (!improved) {
+        for (auto iFree = 0u; iFree < nFree; iFree++)
+          inputs[free_inputs[iFree]] = x_old[iFree];
+        residual = residual_old;
+        break;
+      }
+    }
+    return residual <= tolerance;
+  }
+
+  /*!
+   * \brief Find the call inputs for a batch of target outputs. Each point is
+   * solved with the settings of this solver, reusing its work arrays.
+   * \param[in] ANN - MLP collection.
+   * \param[in] input_output_map - Input-output map of the look-up operation.
+   * \param[in,out] inputs - Call inputs per point; initial guess on entry,
+   * solution on exit.
+   * \param[in] targets - Target call output values per point.
+   * \param[in] free_inputs - Indices of the call inputs to solve for.
+   * \param[out] converged - Optional convergence flag per point.
+   * \returns Number of points for which the solver converged.
+   */
+  std::size_t SolveBatch(CLookUp_ANN &ANN, CIOMap *input_output_map,
+                         std::vector<std::vector<mlpdouble>> &inputs,
+                         const std::vector<std::vector<mlpdouble>> &targets,
+                         const std::vector<std::size_t> &free_inputs,
+                         std::vector<bool> *converged = nullptr) {
+    std::size_t n_converged = 0;
+    if (converged != nullptr)
+      converged->resize(inputs.size());
+    for (auto iPoint = 0u; iPoint < inputs.size(); iPoint++) {
+      bool point_converged = Solve(ANN, input_output_map, inputs[iPoint],
+                                   targets[iPoint], free_inputs);
+      if (point_converged)
+        n_converged++;
+      if (converged != nullptr)
+        (*converged)[iPoint] = point_converged;
+    }
+    return n_converged;
+  }
+};
+
+} // namespace MLPToolbox
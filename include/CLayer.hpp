@@ -34,7 +34,6 @@
 #include <limits>
 #include <vector>
 
-#include "CNeuron.hpp"
 #include "variable_def.hpp"
 
 namespace MLPToolbox {
@@ -43,13 +42,21 @@ class CLayer {
    *\class CLayer
    *\brief This class functions as one of the hidden, input, or output layers in
    *the multi-layer perceptron class. The CLayer class is used to communicate
-   *information (activation function inputs and outputs and gradients) between
-   *the CNeuralNetwork class and the CNeuron class. Currently, only a single
+   *information (activation function inputs and outputs and gradients) within
+   *the CNeuralNetwork class. Currently, only a single
    *activation function can be applied to the neuron inputs within the layer.
    */
 private:
   unsigned long number_of_neurons; /*!< Neuron count in current layer */
-  std::vector<CNeuron> neurons;    /*!< Array of neurons in current layer */
+  std::size_t n_inputs{0};         /*!< Number of network inputs for which
+                                      derivatives are stored. */
+  std::vector<mlpdouble>
+      inputs,             /*!< Neuron inputs [neuron]. */
+      biases,             /*!< Neuron biases [neuron]. */
+      outputs,            /*!< Neuron outputs [neuron]. */
+      doutputs_dinputs,   /*!< Neuron output derivatives [input][neuron]. */
+      d2outputs_dinputs2; /*!< Neuron output second derivatives
+                             [input][input][neuron]. */
   bool is_input;                   /*!< Input layer identifyer */
   std::string activation_type;     /*!< Activation function type applied to the
                                       current layer*/
@@ -57,10 +64,9 @@ public:
   CLayer() : CLayer(1) {}
   CLayer(unsigned long n_neurons)
       : number_of_neurons{n_neurons}, is_input{false} {
-    neurons.resize(n_neurons);
-    for (size_t i = 0; i < number_of_neurons; i++) {
-      neurons[i].SetNumber(i + 1);
-    }
+    inputs.assign(n_neurons, 0.0);
+    biases.assign(n_neurons, 0.0);
+    outputs.assign(n_neurons, 0.0);
   }
   /*!
    * \brief Set current layer neuron count
@@ -68,10 +74,11 @@ public:
    */
   void SetNNeurons(unsigned long n_neurons) {
     if (number_of_neurons != n_neurons) {
-      neurons.resize(n_neurons);
-      for (size_t i = 0; i < number_of_neurons; i++) {
-        neurons[i].SetNumber(i + 1);
-      }
+      number_of_neurons = n_neurons;
+      inputs.resize(n_neurons);
+      biases.resize(n_neurons);
+      outputs.assign(n_neurons, 0.0);
+      SizeGradients(n_inputs);
     }
   }
 
@@ -99,7 +106,7 @@ public:
    * \param[in] output_value - Activation function output
    */
   void SetOutput(std::size_t i_neuron, mlpdouble value) {
-    neurons[i_neuron].SetOutput(value);
+    outputs[i_neuron] = value;
   }
 
   /*!
@@ -108,16 +115,22 @@ public:
    * \return Neuron output value
    */
   mlpdouble GetOutput(std::size_t i_neuron) const {
-    return neurons[i_neuron].GetOutput();
+    return outputs[i_neuron];
   }
 
+  /*!
+   * \brief Get the output values of all neurons in the layer
+   * \return Contiguous array of neuron output values
+   */
+  const mlpdouble *GetOutputs() const { return outputs.data(); }
+
   /*!
    * \brief Set the input value of a neuron in the layer
    * \param[in] i_neuron - Neuron index
    * \param[in] input_value - Activation function input
    */
   void SetInput(std::size_t i_neuron, mlpdouble value) {
-    neurons[i_neuron].SetInput(value);
+    inputs[i_neuron] = value;
   }
 
   /*!
@@ -126,7 +139,7 @@ public:
    * \return Neuron input value
    */
   mlpdouble GetInput(std::size_t i_neuron) const {
-    return neurons[i_neuron].GetInput();
+    return inputs[i_neuron];
   }
 
   /*!
@@ -135,7 +148,7 @@ public:
    * \param[in] bias_value - Bias value
    */
   void SetBias(std::size_t i_neuron, mlpdouble value) {
-    neurons[i_neuron].SetBias(value);
+    biases[i_neuron] = value;
   }
 
   /*!
@@ -144,7 +157,7 @@ public:
    * \return Neuron bias value
    */
   mlpdouble GetBias(std::size_t i_neuron) const {
-    return neurons[i_neuron].GetBias();
+    return biases[i_neuron];
   }
 
   /*!
@@ -153,7 +166,16 @@ public:
    * \return Gradient of neuron output wrt input
    */
   mlpdouble GetdYdX(std::size_t i_neuron, std::size_t iInput) const {
-    return neurons[i_neuron].GetGradient(iInput);
+    return doutputs_dinputs[iInput * number_of_neurons + i_neuron];
+  }
+
+  /*!
+   * \brief Get the output-input gradients of all neurons in the layer
+   * \param[in] iInput - Input index
+   * \return Contiguous array of neuron output derivatives wrt the input
+   */
+  const mlpdouble *GetdYdX(std::size_t iInput) const {
+    return doutputs_dinputs.data() + iInput * number_of_neurons;
   }
 
   /*!
@@ -162,23 +184,38 @@ public:
    * \return Gradient of neuron output wrt input
    */
   void SetdYdX(std::size_t i_neuron, std::size_t iInput, mlpdouble dy_dx) {
-    neurons[i_neuron].SetGradient(iInput, dy_dx);
+    doutputs_dinputs[iInput * number_of_neurons + i_neuron] = dy_dx;
+  }
+
+  mlpdouble Getd2YdX2(std::size_t iNeuron, std::size_t iInput, std::size_t jInput) const {
+    return d2outputs_dinputs2[(iInput * n_inputs + jInput) * number_of_neurons +
+                              iNeuron];
   }
 
-  mlpdouble Getd2YdX2(std::size_t iNeuron, std::size_t iInput, std::size_t jInput) {
-    return neurons[iNeuron].GetSecondGradient(iInput, jInput);
+  /*!
+   * \brief Get the output second derivatives of all neurons in the layer
+   * \param[in] iInput - First input index
+   * \param[in] jInput - Second input index
+   * \return Contiguous array of neuron output second derivatives wrt the
+   * inputs
+   */
+  const mlpdouble *Getd2YdX2(std::size_t iInput, std::size_t jInput) const {
+    return d2outputs_dinputs2.data() +
+           (iInput * n_inputs + jInput) * number_of_neurons;
   }
   
   void Setd2YdX2(std::size_t iNeuron, std::size_t iInput, std::size_t jInput, mlpdouble d2y_dx2) {
-    neurons[iNeuron].SetSecondGradient(iInput, jInput, d2y_dx2);
+    d2outputs_dinputs2[(iInput * n_inputs + jInput) * number_of_neurons +
+                       iNeuron] = d2y_dx2;
   }
   /*!
    * \brief Size neuron output derivative wrt network inputs.
    * \param[in] nInputs - Number of network inputs.
    */
   void SizeGradients(std::size_t nInputs) {
-    for (auto iNeuron = 0u; iNeuron < number_of_neurons; iNeuron++)
-      neurons[iNeuron].SizeGradient(nInputs);
+    n_inputs = nInputs;
+    doutputs_dinputs.assign(nInputs * number_of_neurons, 0.0);
+    d2outputs_dinputs2.assign(nInputs * nInputs * number_of_neurons, 0.0);
   }
 
   /*!
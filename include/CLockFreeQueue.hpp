@@ -0,0 +1,114 @@
+/*!
+* \file CLockFreeQueue.hpp
+* \brief Bounded lock-free queue between a single producer and a single
+consumer thread.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+namespace MLPToolbox {
+template <class T> class CLockFreeQueue {
+  /*!
+   *\class CLockFreeQueue
+   *\brief Bounded first-in first-out ring buffer passing items from one
+   *producer thread to one consumer thread without locks. The producer only
+   *advances the tail and the consumer only advances the head, each publishing
+   *its position through an atomic index, which are kept on separate cache
+   *lines such that the two threads do not invalidate each other's cache line
+   *on every item. The producer marks the end of the stream through Close.
+   */
+private:
+  std::vector<T> items;   /*!< Ring buffer. */
+  std::size_t mask{0};    /*!< Capacity minus one, capacity a power of two. */
+  char head_padding[64];                 /*!< Separates the indices. */
+  std::atomic<std::size_t> head{0};      /*!< Next item to pop. */
+  char tail_padding[64];                 /*!< Separates the indices. */
+  std::atomic<std::size_t> tail{0};      /*!< Next slot to push. */
+  std::atomic<bool> closed{false};       /*!< No more items follow. */
+
+public:
+  /*!
+   * \brief Empty the queue and size it for at least the given number of
+   * items. Neither thread may use the queue meanwhile.
+   * \param[in] capacity - Minimum number of items the queue holds.
+   */
+  void Reset(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    items.resize(size);
+    mask = size - 1;
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    closed.store(false, std::memory_order_relaxed);
+  }
+
+  /*!
+   * \brief Append an item; producer only.
+   * \param[in] item - Item to append.
+   * \returns The queue had room for the item.
+   */
+  bool Push(const T &item) {
+    const std::size_t iTail = tail.load(std::memory_order_relaxed);
+    if (iTail - head.load(std::memory_order_acquire) > mask)
+      return false;
+    items[iTail & mask] = item;
+    tail.store(iTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * \brief Take the oldest item; consumer only.
+   * \param[out] item - Oldest item.
+   * \returns An item was available.
+   */
+  bool Pop(T &item) {
+    const std::size_t iHead = head.load(std::memory_order_relaxed);
+    if (iHead == tail.load(std::memory_order_acquire))
+      return false;
+    item = items[iHead & mask];
+    head.store(iHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * \brief Mark the end of the stream; producer only, after the last Push.
+   */
+  void Close() { closed.store(true, std::memory_order_release); }
+
+  /*!
+   * \brief Check whether the producer closed the stream. Items pushed before
+   * closing may still be in the queue.
+   * \returns The stream is closed.
+   */
+  bool IsClosed() const { return closed.load(std::memory_order_acquire); }
+};
+
+} // namespace MLPToolbox
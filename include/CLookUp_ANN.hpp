@@ -28,17 +28,39 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "CCompiledMLPRegistry.hpp"
 #include "CIOMap.hpp"
+#include "CLockFreeQueue.hpp"
+#include "CModelCache.hpp"
 #include "CNeuralNetwork.hpp"
 #include "CReadNeuralNetwork.hpp"
+#include "CSerialTaskQueue.hpp"
+#include "CSnapshotBuffer.hpp"
+#include "CWorkStealingScheduler.hpp"
 #include "variable_def.hpp"
 
 namespace MLPToolbox {
@@ -61,12 +83,173 @@ private:
 
   unsigned short number_of_variables; /*!< Number of loaded ANNs. */
 
+  std::vector<std::shared_ptr<const CNeuralNetwork>>
+      SharedNetworks; /*!< Cached network of which each loaded ANN shares the
+                         weights. */
+  std::shared_ptr<const CNeuralNetwork>
+      SharedGatingNetwork; /*!< Cached network of the gating network. */
+
+  unsigned long generation{1}; /*!< Incremented whenever loaded ANNs are
+                                  replaced, invalidating the reduced layers
+                                  of paired input-output maps. */
+  unsigned long applied_epoch{0}; /*!< Last model cache reload epoch applied
+                                     to the loaded ANNs. */
+  std::set<std::string> rejected_reloads; /*!< MLP files of which the
+                                             published version was skipped. */
+
+  static constexpr std::uint64_t SNAPSHOT_VERSION =
+      1; /*!< Snapshot format version, following the file marker. */
+
+  std::vector<std::string> MLP_filenames; /*!< MLP input file names. */
+  std::vector<std::uint64_t> MLP_hashes; /*!< Content hash of each MLP file
+                                            when its header was read. */
+  bool lazy_loading{false}; /*!< Only load the weights of MLPs once they are
+                               used by a look-up operation. */
+
+  CNeuralNetwork GatingNetwork; /*!< Classifier MLP selecting the expert MLP
+                                   for a query. */
+  bool use_gating_network{false}; /*!< A gating network has been loaded. */
+
+  std::string tuning_filename; /*!< Kernel tuning file, empty for the default
+                                  file next to the first MLP file. */
+  bool tuning_file_read{false}; /*!< The tuning file has been read. */
+  std::map<std::string, std::string>
+      tuning_decisions; /*!< Fastest kernel set per tuning key. */
+
+  bool is_worker{false}; /*!< The collection evaluates the networks of
+                            another collection in a parallel batch. */
+  std::vector<std::unique_ptr<CLookUp_ANN>>
+      worker_collections; /*!< Collection per thread of parallel batches. */
+  CWorkStealingScheduler scheduler; /*!< Distributes parallel batches over
+                                       the threads. */
+  bool numa_replication{false}; /*!< Replicate the weights per NUMA node for
+                                   parallel batches. */
+  bool workers_replicated{false}; /*!< The worker collections use weight
+                                     replicas. */
+  std::vector<std::unique_ptr<
+      CLockFreeQueue<std::pair<std::size_t, std::size_t>>>>
+      route_queues; /*!< Queries [point, mapping index] routed to each thread
+                       in model-parallel batches. */
+  CSerialTaskQueue async_batches; /*!< Pending asynchronous batches, declared
+                                     last such that they are completed before
+                                     the collection is destroyed. */
+
+  /*!
+   * \brief Constructor of worker collections, defined through
+   * ShareCollection.
+   */
+  CLookUp_ANN() = default;
+
+  /*!
+   * \brief Define the collection as a worker of another collection, which
+   * evaluates the same networks on a separate thread of a parallel batch. The
+   * weights of the loaded networks are shared. Worker collections do not
+   * apply reloads or warm up look-up operations; this is left to the source
+   * collection, after which the workers are defined anew.
+   * \param[in] source - collection of which to evaluate the networks.
+   */
+  void ShareCollection(const CLookUp_ANN &source) {
+    is_worker = true;
+    number_of_variables = source.number_of_variables;
+    generation = source.generation;
+    applied_epoch = source.applied_epoch;
+    MLP_filenames = source.MLP_filenames;
+    MLP_hashes = source.MLP_hashes;
+    lazy_loading = source.lazy_loading;
+    SharedNetworks = source.SharedNetworks;
+    NeuralNetworks.resize(source.NeuralNetworks.size());
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++) {
+      const CNeuralNetwork &ANN = source.NeuralNetworks[i_MLP];
+      if (ANN.IsLoaded())
+        NeuralNetworks[i_MLP].ShareArchitecture(ANN);
+      else
+        NeuralNetworks[i_MLP].ShareHeader(ANN);
+      NeuralNetworks[i_MLP].SetRegionCacheSize(ANN.GetRegionCacheSize());
+      NeuralNetworks[i_MLP].SetParallelThreshold(ANN.GetParallelThreshold());
+    }
+    use_gating_network = source.use_gating_network;
+    SharedGatingNetwork = source.SharedGatingNetwork;
+    if (use_gating_network)
+      GatingNetwork.ShareArchitecture(source.GatingNetwork);
+  }
+
+  /*!
+   * \brief Replace the weights of the loaded networks of a worker collection
+   * by copies allocated by the calling thread.
+   */
+  void ReplicateWeights() {
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      if (NeuralNetworks[i_MLP].IsLoaded())
+        NeuralNetworks[i_MLP].ReplicateWeights();
+    if (use_gating_network)
+      GatingNetwork.ReplicateWeights();
+  }
+
+  /*!
+   * \brief Use the weight replicas of another worker collection of the same
+   * source collection.
+   * \param[in] replica - worker collection holding the replicas.
+   */
+  void ShareReplicas(const CLookUp_ANN &replica) {
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      if (NeuralNetworks[i_MLP].IsLoaded())
+        NeuralNetworks[i_MLP].ShareReplica(replica.NeuralNetworks[i_MLP]);
+    if (use_gating_network)
+      GatingNetwork.ShareReplica(replica.GatingNetwork);
+  }
+
+  /*!
+   * \brief Define the worker collections of parallel evaluations, one per
+   * thread of the thread pool, anew if networks were reloaded or loaded since
+   * they were defined.
+   */
+  void UpdateWorkerCollections() {
+    CThreadPool &pool = CThreadPool::GetInstance();
+    const std::size_t nThreads = pool.GetNThreads();
+    const bool replicate = numa_replication && pool.IsPinned();
+    bool workers_valid = (worker_collections.size() == nThreads) &&
+                         (workers_replicated == replicate);
+    for (auto iThread = 0u; workers_valid && (iThread < nThreads); iThread++) {
+      const CLookUp_ANN &worker = *worker_collections[iThread];
+      workers_valid = (worker.generation == generation);
+      for (auto i_MLP = 0u; workers_valid && (i_MLP < NeuralNetworks.size());
+           i_MLP++)
+        workers_valid = (worker.NeuralNetworks[i_MLP].IsLoaded() ==
+                         NeuralNetworks[i_MLP].IsLoaded());
+    }
+    if (!workers_valid) {
+      /* Every worker collection is allocated by the thread using it. The
+       * first thread of each NUMA node copies the weights for its node. */
+      const std::size_t nNodes = CNumaTopology::GetInstance().GetNNodes();
+      std::vector<CLookUp_ANN *> node_replicas(nNodes, nullptr);
+      std::vector<std::mutex> node_mutexes(nNodes);
+      worker_collections.clear();
+      worker_collections.resize(nThreads);
+      pool.ForEachThread([&](std::size_t iThread) {
+        std::unique_ptr<CLookUp_ANN> worker(new CLookUp_ANN());
+        worker->ShareCollection(*this);
+        if (replicate) {
+          const std::size_t iNode = pool.GetThreadNode(iThread);
+          std::lock_guard<std::mutex> lock(node_mutexes[iNode]);
+          if (node_replicas[iNode] == nullptr) {
+            worker->ReplicateWeights();
+            node_replicas[iNode] = worker.get();
+          } else {
+            worker->ShareReplicas(*node_replicas[iNode]);
+          }
+        }
+        worker_collections[iThread] = std::move(worker);
+      });
+      workers_replicated = replicate;
+    }
+  }
+
   /*!
    * \brief Load ANN architecture
    * \param[in] ANN - pointer to target NeuralNetwork class
    * \param[in] filename - filename containing ANN architecture information
    */
-  void GenerateANN(CNeuralNetwork &ANN, std::string filename) {
+  static void GenerateANN(CNeuralNetwork &ANN, std::string filename) {
     /*--- Generate MLP architecture based on information in MLP input file ---*/
 
     /* Read MLP input file */
@@ -129,6 +312,203 @@ private:
       ANN.SetOutputNorm(iOutput, Reader.GetOutputNorm(iOutput).first,
                         Reader.GetOutputNorm(iOutput).second);
     }
+
+    /* Use code generated ahead of time from the same file, if linked in. */
+    if (CCompiledMLPRegistry::GetInstance().GetNNetworks() > 0)
+      ANN.SetCompiledEvaluation(CCompiledMLPRegistry::GetInstance().Find(
+          CModelCache::HashFile(filename), ANN.GetnInputs(),
+          ANN.GetnOutputs()));
+  }
+
+  /*!
+   * \brief Load ANN architecture through the process-wide model cache. The
+   * file is only parsed if no other look-up class holds the same network; the
+   * weights are shared with the cached network.
+   * \param[in] ANN - target NeuralNetwork class
+   * \param[in] filename - filename containing ANN architecture information
+   * \returns Cached network of which the weights are shared.
+   */
+  std::shared_ptr<const CNeuralNetwork> LoadANN(CNeuralNetwork &ANN,
+                                                const std::string &filename) {
+    auto shared_network =
+        CModelCache::GetInstance().GetNetwork(filename, GenerateANN);
+    ANN.ShareArchitecture(*shared_network);
+    return shared_network;
+  }
+
+  /*!
+   * \brief Check whether the pairing results of an input-output map restored
+   * from a snapshot refer to existing networks, variables and neurons.
+   * \param[in] input_output_map - restored input-output map.
+   * \returns The input-output map fits the loaded ANNs.
+   */
+  bool FitsNetworks(const MLPToolbox::CIOMap &input_output_map) const {
+    for (auto i_map = 0u; i_map < input_output_map.GetNMLPs(); i_map++) {
+      const auto i_MLP = input_output_map.GetMLPIndex(i_map);
+      if (i_MLP >= NeuralNetworks.size())
+        return false;
+      const CNeuralNetwork &ANN = NeuralNetworks[i_MLP];
+      if (input_output_map.GetNMappedInputs(i_map) != ANN.GetnInputs())
+        return false;
+      for (auto &index_pair : input_output_map.GetInputMapping(i_map))
+        if (index_pair.second >= ANN.GetnInputs())
+          return false;
+      for (auto &index_pair : input_output_map.GetOutputMapping(i_map))
+        if (index_pair.second >= ANN.GetnOutputs())
+          return false;
+      const auto n_layers = ANN.GetNLayers();
+      auto first_layer = input_output_map.GetFirstLayer(i_map);
+      if (first_layer && !first_layer->FitsLayers(ANN.GetNNeurons(1),
+                                                  ANN.GetnInputs()))
+        return false;
+      auto output_layer = input_output_map.GetOutputLayer(i_map);
+      if (output_layer &&
+          !output_layer->FitsLayers(ANN.GetnOutputs(),
+                                    ANN.GetNNeurons(n_layers - 2)))
+        return false;
+    }
+    if (input_output_map.HasGatingNetwork() &&
+        (!use_gating_network ||
+         (input_output_map.GetNGatingInputs() != GatingNetwork.GetnInputs()) ||
+         (input_output_map.GetNGatingExperts() != NeuralNetworks.size())))
+      return false;
+    return true;
+  }
+
+  /*!
+   * \brief Define the architecture, variable names and normalization of an ANN
+   * from the header of its input file, without reading the weights.
+   * \param[in] ANN - target NeuralNetwork class
+   * \param[in] filename - filename containing ANN architecture information
+   */
+  void GenerateANNHeader(CNeuralNetwork &ANN, const std::string &filename) {
+    CReadNeuralNetwork Reader = CReadNeuralNetwork(filename);
+    Reader.ReadMLPFile(true);
+
+    ANN.SetInputRegularization(Reader.GetInputRegularization());
+    ANN.SetOutputRegularization(Reader.GetOutputRegularization());
+
+    ANN.DefineInputLayer(Reader.GetNInputs());
+    for (auto iInput = 0u; iInput < Reader.GetNInputs(); iInput++) {
+      ANN.SetInputName(iInput, Reader.GetInputName(iInput));
+      ANN.SetInputNorm(iInput, Reader.GetInputNorm(iInput).first,
+                       Reader.GetInputNorm(iInput).second);
+    }
+    for (auto iLayer = 1u; iLayer < Reader.GetNlayers() - 1; iLayer++) {
+      ANN.PushHiddenLayer(Reader.GetNneurons(iLayer));
+    }
+    ANN.DefineOutputLayer(Reader.GetNOutputs());
+    for (auto iOutput = 0u; iOutput < Reader.GetNOutputs(); iOutput++) {
+      ANN.SetOutputName(iOutput, Reader.GetOutputName(iOutput));
+      ANN.SetOutputNorm(iOutput, Reader.GetOutputNorm(iOutput).first,
+                        Reader.GetOutputNorm(iOutput).second);
+    }
+
+    ANN.SizeActivationFunctions(Reader.GetNlayers());
+    for (auto iLayer = 0u; iLayer < Reader.GetNlayers(); iLayer++)
+      ANN.SetActivationFunction(iLayer, Reader.GetActivationFunction(iLayer));
+  }
+
+  /*!
+   * \brief Load the weights of an ANN of which only the header was read. The
+   * latest version published through ReloadMLP is loaded if it has the
+   * variables of the header. Otherwise, the version of the file of which the
+   * header was read is loaded; if the file changed in the meantime,
+   * std::invalid_argument is thrown.
+   * \param[in] i_MLP - loaded MLP index.
+   */
+  void LoadWeights(std::size_t i_MLP) {
+    CNeuralNetwork &ANN = NeuralNetworks[i_MLP];
+    if (ANN.IsLoaded())
+      return;
+    auto shared_network =
+        CModelCache::GetInstance().GetPublishedNetwork(MLP_filenames[i_MLP]);
+    if (shared_network && SameVariables(ANN, *shared_network)) {
+      ANN.Reset();
+      ANN.ShareArchitecture(*shared_network);
+    } else {
+      shared_network = CModelCache::GetInstance().GetNetwork(
+          MLP_filenames[i_MLP], MLP_hashes[i_MLP], GenerateANN);
+      ANN.ShareWeights(*shared_network);
+    }
+    SharedNetworks[i_MLP] = shared_network;
+  }
+
+  /*!
+   * \brief Check whether two versions of an ANN have the same input and output
+   * variables.
+   * \param[in] previous - replaced network.
+   * \param[in] next - new network.
+   * \returns The networks have identical input and output variables.
+   */
+  static bool SameVariables(const CNeuralNetwork &previous,
+                            const CNeuralNetwork &next) {
+    bool same_variables = (previous.GetnInputs() == next.GetnInputs()) &&
+                          (previous.GetnOutputs() == next.GetnOutputs());
+    for (auto iInput = 0u; same_variables && (iInput < next.GetnInputs());
+         iInput++)
+      same_variables =
+          (previous.GetInputName(iInput) == next.GetInputName(iInput));
+    for (auto iOutput = 0u; same_variables && (iOutput < next.GetnOutputs());
+         iOutput++)
+      same_variables =
+          (previous.GetOutputName(iOutput) == next.GetOutputName(iOutput));
+    return same_variables;
+  }
+
+  /*!
+   * \brief Switch the loaded ANNs to the versions most recently published
+   * through ReloadMLP. This happens between evaluations on the thread using
+   * this collection, so no evaluation is in progress on the replaced networks.
+   * A published version with different input or output variables than the
+   * loaded network is skipped: the collection keeps evaluating its current
+   * network and the file is listed by GetRejectedReloads.
+   */
+  void ApplyReloads() {
+    const unsigned long epoch = CModelCache::GetInstance().GetReloadEpoch();
+    std::vector<std::pair<std::size_t, std::shared_ptr<const CNeuralNetwork>>>
+        replacements;
+    for (auto i_MLP = 0u; i_MLP < MLP_filenames.size(); i_MLP++) {
+      /* Networks which are not loaded yet will load the latest version. */
+      if (!NeuralNetworks[i_MLP].IsLoaded())
+        continue;
+      auto published =
+          CModelCache::GetInstance().GetPublishedNetwork(MLP_filenames[i_MLP]);
+      if (!published)
+        continue;
+      if (!SameVariables(NeuralNetworks[i_MLP], *published)) {
+        rejected_reloads.insert(MLP_filenames[i_MLP]);
+        continue;
+      }
+      rejected_reloads.erase(MLP_filenames[i_MLP]);
+      if (published != SharedNetworks[i_MLP])
+        replacements.emplace_back(i_MLP, published);
+    }
+
+    for (auto &replacement : replacements) {
+      CNeuralNetwork &ANN = NeuralNetworks[replacement.first];
+      ANN.Reset();
+      ANN.ShareArchitecture(*replacement.second);
+      SharedNetworks[replacement.first] = replacement.second;
+    }
+    if (!replacements.empty())
+      generation++;
+    applied_epoch = epoch;
+  }
+
+  /*!
+   * \brief Make sure a look-up operation evaluates the latest loaded ANNs with
+   * up-to-date reduced layers. Without pending reloads, this costs a single
+   * atomic load and a comparison.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   */
+  void PrepareEvaluation(MLPToolbox::CIOMap *input_output_map) {
+    if (is_worker)
+      return;
+    if (CModelCache::GetInstance().GetReloadEpoch() != applied_epoch)
+      ApplyReloads();
+    if (input_output_map->GetGeneration() != generation)
+      WarmUp(input_output_map);
   }
 
 public:
@@ -136,20 +516,485 @@ public:
    * \brief ANN collection class constructor
    * \param[in] n_inputs - Number of MLP files to be loaded.
    * \param[in] input_filenames - String array containing MLP input file names.
+   * \param[in] lazy - Only read the file headers on construction. The weights
+   * of an MLP are loaded when a look-up operation paired with it is first
+   * evaluated, or through WarmUp.
    */
   CLookUp_ANN(const unsigned short n_inputs,
-              const std::string *input_filenames) {
+              const std::string *input_filenames, bool lazy = false) {
     /*--- Define collection of MLPs for regression purposes ---*/
     number_of_variables = n_inputs;
+    lazy_loading = lazy;
+    applied_epoch = CModelCache::GetInstance().GetReloadEpoch();
 
     NeuralNetworks.resize(n_inputs);
+    SharedNetworks.resize(n_inputs);
+    MLP_filenames.assign(input_filenames, input_filenames + n_inputs);
+    MLP_hashes.resize(n_inputs);
 
     /*--- Generate an MLP for every filename provided ---*/
     for (auto i_MLP = 0u; i_MLP < n_inputs; i_MLP++) {
-      GenerateANN(NeuralNetworks[i_MLP], input_filenames[i_MLP]);
+      if (lazy_loading) {
+        MLP_hashes[i_MLP] = CModelCache::HashFile(input_filenames[i_MLP]);
+        GenerateANNHeader(NeuralNetworks[i_MLP], input_filenames[i_MLP]);
+      } else
+        SharedNetworks[i_MLP] =
+            LoadANN(NeuralNetworks[i_MLP], input_filenames[i_MLP]);
     }
   }
 
+  /*!
+   * \brief Load the MLPs paired with a look-up operation and apply the
+   * load-time reductions of the look-up. Look-ups are warmed up automatically
+   * on their first evaluation; calling this method beforehand moves the
+   * loading cost out of the first evaluation.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   */
+  void WarmUp(MLPToolbox::CIOMap *input_output_map) {
+    for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++)
+      LoadWeights(input_output_map->GetMLPIndex(i_map));
+    ReduceOutputLayers(*input_output_map);
+    if (input_output_map->HasBoundInputs())
+      ReduceFirstLayers(*input_output_map);
+    input_output_map->SetGeneration(generation);
+  }
+
+private:
+  /*!
+   * \brief Get the name of the kernel tuning file.
+   * \returns Tuning file name.
+   */
+  std::string GetTuningFile() const {
+    if (!tuning_filename.empty() || MLP_filenames.empty())
+      return tuning_filename.empty() ? "MLPCpp.tuning" : tuning_filename;
+    const std::string &filename = MLP_filenames[0];
+    auto separator = filename.find_last_of("/\\");
+    return (separator == std::string::npos)
+               ? "MLPCpp.tuning"
+               : filename.substr(0, separator + 1) + "MLPCpp.tuning";
+  }
+
+  /*!
+   * \brief Read the tuning decisions of earlier runs from the tuning file.
+   */
+  void ReadTuningFile() {
+    tuning_file_read = true;
+    std::ifstream tuning_file(GetTuningFile().c_str());
+    std::string key, name;
+    while (tuning_file >> key >> name)
+      tuning_decisions[key] = name;
+  }
+
+  /*!
+   * \brief Store a tuning decision in the tuning file. The decisions in the
+   * file are merged with the new one and written to a temporary file, which
+   * is renamed into place, such that concurrent processes never see a partly
+   * written file and every tuning key appears once.
+   * \param[in] key - tuning key.
+   * \param[in] name - name of the selected kernel set.
+   */
+  void WriteTuningDecision(const std::string &key, const std::string &name) {
+    const std::string filename = GetTuningFile();
+    std::map<std::string, std::string> decisions;
+    {
+      std::ifstream tuning_file(filename.c_str());
+      std::string file_key, file_name;
+      while (tuning_file >> file_key >> file_name)
+        decisions[file_key] = file_name;
+    }
+    auto decision = decisions.find(key);
+    if ((decision != decisions.end()) && (decision->second == name))
+      return;
+    decisions[key] = name;
+
+    std::ostringstream temporary_name;
+    temporary_name << filename << "." << std::hex << std::random_device()()
+                   << ".tmp";
+    {
+      std::ofstream tuning_file(temporary_name.str().c_str());
+      for (auto &entry : decisions)
+        tuning_file << entry.first << " " << entry.second << std::endl;
+      if (!tuning_file)
+        throw std::invalid_argument("Could not write tuning file " +
+                                    temporary_name.str());
+    }
+    if (std::rename(temporary_name.str().c_str(), filename.c_str()) != 0) {
+      /* Renaming onto an existing file fails on some platforms. */
+      std::remove(filename.c_str());
+      if (std::rename(temporary_name.str().c_str(), filename.c_str()) != 0) {
+        std::remove(temporary_name.str().c_str());
+        throw std::invalid_argument("Could not replace tuning file " +
+                                    filename);
+      }
+    }
+  }
+
+  /*!
+   * \brief Describe the evaluation of a paired MLP for the tuning file: the
+   * supported instruction set, the network shape and activation functions,
+   * the number of evaluated outputs and free inputs, the derivative order and
+   * the batch size.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] derivative_order - derivative order of the evaluations.
+   * \param[in] batch_size - number of queries evaluated at once.
+   * \returns Tuning key.
+   */
+  std::string GetTuningKey(const MLPToolbox::CIOMap &input_output_map,
+                           std::size_t i_map, unsigned short derivative_order,
+                           std::size_t batch_size) const {
+    const CNeuralNetwork &ANN =
+        NeuralNetworks[input_output_map.GetMLPIndex(i_map)];
+    std::ostringstream key;
+    key << CComputeKernels::GetKernels(
+               CComputeKernels::GetSupportedInstructionSet(), false)
+               .GetName()
+        << "|";
+    for (auto iLayer = 0u; iLayer <= ANN.GetNWeightLayers(); iLayer++)
+      key << (iLayer > 0 ? "x" : "") << ANN.GetNNeurons(iLayer);
+    key << "|";
+    for (auto iLayer = 0u; iLayer <= ANN.GetNWeightLayers(); iLayer++)
+      key << (iLayer > 0 ? "," : "") << ANN.GetActivationFunctionName(iLayer);
+
+    const CReducedLayer *first_layer = input_output_map.GetFirstLayer(i_map),
+                        *output_layer = input_output_map.GetOutputLayer(i_map);
+    key << "|outputs=" << ((output_layer != nullptr) ? output_layer->GetNNeurons()
+                                                     : ANN.GetnOutputs())
+        << "|inputs=" << ((first_layer != nullptr) ? first_layer->GetNColumns()
+                                                   : ANN.GetnInputs())
+        << "|order=" << derivative_order << "|batch=" << batch_size;
+    return key.str();
+  }
+
+  /*!
+   * \brief Measure the evaluation time of a paired MLP for every available
+   * kernel set and return the fastest one. Single queries are timed through
+   * the matrix-vector kernels, batches through the matrix-matrix kernels of
+   * PredictBatch. The region cache is disabled while timing, such that the
+   * kernels rather than cached regions are measured.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] derivative_order - derivative order of the evaluations.
+   * \param[in] batch_size - number of queries evaluated at once.
+   * \returns Fastest kernel set.
+   */
+  const CComputeKernels *
+  BenchmarkKernels(const MLPToolbox::CIOMap &input_output_map,
+                   std::size_t i_map, unsigned short derivative_order,
+                   std::size_t batch_size) {
+    using clock = std::chrono::steady_clock;
+    CNeuralNetwork &ANN = NeuralNetworks[input_output_map.GetMLPIndex(i_map)];
+    const CReducedLayer *first_layer = input_output_map.GetFirstLayer(i_map),
+                        *output_layer = input_output_map.GetOutputLayer(i_map);
+    ANN.ComputeFirstOrderGradient(derivative_order > 0);
+    ANN.ComputeSecondOrderGradient(derivative_order > 1);
+    const std::size_t region_cache_size = ANN.GetRegionCacheSize();
+    ANN.SetRegionCacheSize(0);
+
+    /* Random queries within the input range of the network. */
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    std::vector<std::vector<mlpdouble>> queries(
+        batch_size > 1 ? batch_size : 32);
+    for (auto &query : queries) {
+      query.resize(ANN.GetnInputs());
+      for (auto iInput = 0u; iInput < query.size(); iInput++) {
+        auto bounds = ANN.GetInputBounds(iInput);
+        query[iInput] = bounds.first + (bounds.second - bounds.first) *
+                                           distribution(generator);
+      }
+    }
+    auto evaluate_queries = [&]() {
+      if (batch_size > 1) {
+        ANN.PredictBatch(queries, output_layer);
+      } else {
+        for (auto &query : queries)
+          ANN.Predict(query, first_layer, output_layer);
+      }
+    };
+
+    /* Repeat the queries for about a millisecond per measurement. */
+    std::size_t n_repeats = 1;
+    for (;;) {
+      auto start = clock::now();
+      for (auto iRepeat = 0u; iRepeat < n_repeats; iRepeat++)
+        evaluate_queries();
+      if (clock::now() - start > std::chrono::milliseconds(1))
+        break;
+      n_repeats *= 2;
+    }
+
+    const CComputeKernels *fastest_kernels = nullptr;
+    auto fastest_time = clock::duration::max();
+    const int n_sets =
+        static_cast<int>(CComputeKernels::GetSupportedInstructionSet()) + 1;
+    for (auto iSet = 0; iSet < n_sets; iSet++) {
+      for (bool blocked : {false, true}) {
+        const CComputeKernels &kernels = CComputeKernels::GetKernels(
+            static_cast<ENUM_INSTRUCTION_SET>(iSet), blocked);
+        ANN.SetKernels(&kernels);
+        auto time = clock::duration::max();
+        for (auto iTrial = 0u; iTrial < 3; iTrial++) {
+          auto start = clock::now();
+          for (auto iRepeat = 0u; iRepeat < n_repeats; iRepeat++)
+            evaluate_queries();
+          time = std::min(time, clock::now() - start);
+        }
+        if (time < fastest_time) {
+          fastest_time = time;
+          fastest_kernels = &kernels;
+        }
+      }
+    }
+    ANN.SetKernels(nullptr);
+    ANN.SetRegionCacheSize(region_cache_size);
+    return fastest_kernels;
+  }
+
+  /*!
+   * \brief Find the kernel set with a given name.
+   * \param[in] name - Kernel set name, as given by CComputeKernels::GetName.
+   * \returns Kernel set, nullptr if the name is unknown or the kernel set is
+   * not supported on this processor.
+   */
+  static const CComputeKernels *FindKernels(const std::string &name) {
+    const int n_sets =
+        static_cast<int>(CComputeKernels::GetSupportedInstructionSet()) + 1;
+    for (auto iSet = 0; iSet < n_sets; iSet++) {
+      for (bool blocked : {false, true}) {
+        const CComputeKernels &kernels = CComputeKernels::GetKernels(
+            static_cast<ENUM_INSTRUCTION_SET>(iSet), blocked);
+        if (kernels.GetName() == name)
+          return &kernels;
+      }
+    }
+    return nullptr;
+  }
+
+public:
+  /*!
+   * \brief Set the file in which kernel tuning decisions are stored. By
+   * default, the file MLPCpp.tuning in the directory of the first MLP file is
+   * used.
+   * \param[in] filename - Tuning file name.
+   */
+  void SetTuningFile(const std::string &filename) {
+    tuning_filename = filename;
+    tuning_file_read = false;
+  }
+
+  /*!
+   * \brief Select the fastest dense kernels for each MLP paired with a look-up
+   * operation. Every available kernel set (instruction set, with and without
+   * row blocking) is timed on random queries within the input range of the
+   * MLP, using the reduced layers of the look-up. The decisions are stored in
+   * the tuning file under the shape of the network and the look-up, such that
+   * later runs read them instead of timing the kernels again. MLPs evaluated
+   * through compiled code are not tuned.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] derivative_order - derivative order of the evaluations to tune
+   * for (0, 1 or 2).
+   * \param[in] batch_size - number of queries per MLP evaluated at once
+   * through PredictANNBatch, 1 for single queries. Batches only compute
+   * outputs, so the batch size is ignored for derivative orders above 0.
+   */
+  void TuneKernels(MLPToolbox::CIOMap &input_output_map,
+                   unsigned short derivative_order = 0,
+                   std::size_t batch_size = 1) {
+    if ((derivative_order > 0) || (batch_size == 0))
+      batch_size = 1;
+    PrepareEvaluation(&input_output_map);
+    if (!tuning_file_read)
+      ReadTuningFile();
+
+    for (auto i_map = 0u; i_map < input_output_map.GetNMLPs(); i_map++) {
+      if (NeuralNetworks[input_output_map.GetMLPIndex(i_map)].IsCompiled())
+        continue;
+      std::string key =
+          GetTuningKey(input_output_map, i_map, derivative_order, batch_size);
+      /* Another process may have tuned the same shape in the meantime. */
+      if (tuning_decisions.find(key) == tuning_decisions.end())
+        ReadTuningFile();
+      auto decision = tuning_decisions.find(key);
+      const CComputeKernels *kernels = (decision != tuning_decisions.end())
+                                           ? FindKernels(decision->second)
+                                           : nullptr;
+      if (kernels == nullptr) {
+        kernels = BenchmarkKernels(input_output_map, i_map, derivative_order,
+                                   batch_size);
+        tuning_decisions[key] = kernels->GetName();
+        WriteTuningDecision(key, kernels->GetName());
+      }
+      input_output_map.SetKernels(i_map, kernels);
+    }
+  }
+
+  /*!
+   * \brief Get the kernel set with which a paired MLP is evaluated.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \returns Kernel set name, or "compiled" for MLPs evaluated through
+   * compiled code.
+   */
+  std::string GetKernelChoice(const MLPToolbox::CIOMap &input_output_map,
+                              std::size_t i_map) const {
+    if (NeuralNetworks[input_output_map.GetMLPIndex(i_map)].IsCompiled())
+      return "compiled";
+    const CComputeKernels *kernels = input_output_map.GetKernels(i_map);
+    return (kernels != nullptr) ? kernels->GetName()
+                                : CComputeKernels::GetInstance().GetName();
+  }
+
+  /*!
+   * \brief Get all kernel tuning decisions known to the collection, read from
+   * the tuning file or measured in this run.
+   * \returns Kernel set name per tuning key.
+   */
+  const std::map<std::string, std::string> &GetTuningDecisions() const {
+    return tuning_decisions;
+  }
+
+  /*!
+   * \brief Load a new version of an MLP file in the model cache and publish it
+   * to every collection which loaded the file. Each collection switches to the
+   * new version at the start of its next evaluation, after which the paired
+   * look-up operations are warmed up again. The input and output variables of
+   * the new version must match those of the replaced network; otherwise the
+   * new version is not published. This method may be called from a
+   * background thread while other threads keep evaluating.
+   * \param[in] filename - MLP input file name.
+   */
+  static void ReloadMLP(const std::string &filename) {
+    CModelCache::GetInstance().Reload(
+        filename, GenerateANN,
+        [&filename](const CNeuralNetwork &previous,
+                    const CNeuralNetwork &next) {
+          if (!SameVariables(previous, next))
+            throw std::invalid_argument("Reloaded MLP " + filename +
+                                        " has different input or output "
+                                        "variables.");
+        });
+  }
+
+  /*!
+   * \brief Get the MLP files of which the latest version published through
+   * ReloadMLP was skipped by this collection, because its input or output
+   * variables differ from those of the loaded network.
+   * \returns MLP file names.
+   */
+  const std::set<std::string> &GetRejectedReloads() const {
+    return rejected_reloads;
+  }
+
+  /*!
+   * \brief Restore an ANN collection, including the pairing of its look-up
+   * operations, from a snapshot written by WriteSnapshot. The snapshot is read
+   * with a single read operation and the network weights are used directly
+   * from the read buffer, such that no MLP files are parsed and no pairing is
+   * performed. The MLP file names are restored as well, so reloads published
+   * through ReloadMLP and the default tuning file apply to the restored
+   * collection; relative names refer to the working directory.
+   * \param[in] snapshot_filename - Snapshot file name.
+   * \param[out] ioMaps - Restored input-output maps, in the order in which
+   * they were written.
+   */
+  CLookUp_ANN(const std::string &snapshot_filename,
+              std::vector<MLPToolbox::CIOMap> &ioMaps) {
+    CSnapshotBuffer snapshot;
+    snapshot.ReadFile(snapshot_filename);
+    if ((snapshot.ReadBytes(8) != "MLPCPPSS") ||
+        (snapshot.ReadSize() != SNAPSHOT_VERSION) ||
+        (snapshot.ReadSize() != sizeof(mlpdouble)))
+      throw std::invalid_argument(snapshot_filename +
+                                  " is not a compatible snapshot file");
+
+    generation = snapshot.ReadSize();
+    applied_epoch = CModelCache::GetInstance().GetReloadEpoch();
+    MLP_filenames.resize(snapshot.ReadCount(sizeof(std::uint64_t)));
+    for (auto &filename : MLP_filenames)
+      filename = snapshot.ReadString();
+    if ((snapshot.ReadSize() != MLP_filenames.size()) ||
+        (MLP_filenames.size() > std::numeric_limits<unsigned short>::max()))
+      throw std::invalid_argument(snapshot_filename + " is corrupt");
+    number_of_variables = MLP_filenames.size();
+    NeuralNetworks.resize(number_of_variables);
+    SharedNetworks.resize(number_of_variables);
+    MLP_hashes.resize(number_of_variables);
+    for (auto i_MLP = 0u; i_MLP < number_of_variables; i_MLP++)
+      NeuralNetworks[i_MLP].ReadSnapshot(snapshot);
+
+    use_gating_network = (snapshot.ReadSize() != 0);
+    if (use_gating_network)
+      GatingNetwork.ReadSnapshot(snapshot);
+
+    ioMaps.resize(snapshot.ReadCount(sizeof(std::uint64_t)));
+    for (auto &ioMap : ioMaps) {
+      ioMap.ReadSnapshot(snapshot);
+      if (!FitsNetworks(ioMap))
+        throw std::invalid_argument(snapshot_filename + " is corrupt");
+    }
+  }
+
+  /*!
+   * \brief Write the ANN collection, in its evaluation layout, together with
+   * the pairing results of its look-up operations to a binary snapshot. The
+   * collection can be restored from the snapshot without parsing or pairing.
+   * \param[in] snapshot_filename - Snapshot file name.
+   * \param[in] ioMaps - Input-output maps paired with this collection.
+   */
+  void WriteSnapshot(const std::string &snapshot_filename,
+                     const std::vector<const MLPToolbox::CIOMap *> &ioMaps) {
+    if (!std::is_trivially_copyable<mlpdouble>::value)
+      throw std::invalid_argument(
+          "Snapshots require a trivially copyable floating point type");
+
+    /* Networks are stored in their evaluation layout, so load all of them. */
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      LoadWeights(i_MLP);
+
+    CSnapshotBuffer snapshot;
+    snapshot.WriteBytes("MLPCPPSS");
+    snapshot.WriteSize(SNAPSHOT_VERSION);
+    snapshot.WriteSize(sizeof(mlpdouble));
+
+    snapshot.WriteSize(generation);
+    snapshot.WriteSize(MLP_filenames.size());
+    for (auto &filename : MLP_filenames)
+      snapshot.WriteString(filename);
+    snapshot.WriteSize(NeuralNetworks.size());
+    for (auto &ANN : NeuralNetworks)
+      ANN.WriteSnapshot(snapshot);
+
+    snapshot.WriteSize(use_gating_network ? 1 : 0);
+    if (use_gating_network)
+      GatingNetwork.WriteSnapshot(snapshot);
+
+    snapshot.WriteSize(ioMaps.size());
+    for (auto ioMap : ioMaps)
+      ioMap->WriteSnapshot(snapshot);
+
+    snapshot.WriteFile(snapshot_filename);
+  }
+
+  /*!
+   * \brief Load a gating network which selects the expert MLP for a query. The
+   * gating network is a classifier MLP with one output per loaded MLP, in the
+   * order of the MLP collection, of which the highest output marks the expert
+   * to evaluate. Look-up operations paired after loading the gating network
+   * evaluate the selected expert instead of scanning the input ranges of all
+   * paired MLPs. The range scan is used as a fallback whenever the expert does
+   * not provide all call outputs or the query lies outside its training range.
+   * \param[in] filename - gating network input file name.
+   */
+  void LoadGatingNetwork(const std::string &filename) {
+    SharedGatingNetwork = LoadANN(GatingNetwork, filename);
+    if (GatingNetwork.GetnOutputs() != NeuralNetworks.size())
+      throw std::invalid_argument("Gating network in " + filename + " has " +
+                                  std::to_string(GatingNetwork.GetnOutputs()) +
+                                  " outputs, expected one per loaded MLP.");
+    use_gating_network = true;
+  }
+
   /*!
    * \brief Get average input variable bounds of the loaded MLPs for a specific
    * look-up operation. 
@@ -162,21 +1007,54 @@ public:
   GetInputNorm(MLPToolbox::CIOMap *input_output_map,
                std::size_t input_index) const {
     mlpdouble CV_min{0.0}, CV_max{0.0};
+    std::size_t n_MLPs{0};
 
     for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
       auto i_ANN = input_output_map->GetMLPIndex(i_map);
-      auto i_input = input_output_map->GetInputIndex(i_map, input_index);
-      std::pair<mlpdouble, mlpdouble> ANN_input_limits =
-          NeuralNetworks[i_ANN].GetInputNorm(i_input);
-      CV_min += ANN_input_limits.first;
-      CV_max += ANN_input_limits.second;
+      auto input_map = input_output_map->GetInputMapping(i_map);
+      for (auto iInput = 0u; iInput < input_map.size(); iInput++) {
+        if (input_map[iInput].first != input_index)
+          continue;
+        std::pair<mlpdouble, mlpdouble> ANN_input_limits =
+            NeuralNetworks[i_ANN].GetInputNorm(input_map[iInput].second);
+        CV_min += ANN_input_limits.first;
+        CV_max += ANN_input_limits.second;
+        n_MLPs++;
+      }
     }
 
-    CV_min /= input_output_map->GetNMLPs();
-    CV_max /= input_output_map->GetNMLPs();
+    CV_min /= n_MLPs;
+    CV_max /= n_MLPs;
     return std::make_pair(CV_min, CV_max);
   }
 
+  /*!
+   * \brief Get the range of a call input variable covered by the MLPs paired
+   * with a look-up operation.
+   * \param[in] input_output_map - Pointer to input-output map for look-up
+   * operation.
+   * \param[in] input_index - Call input variable index.
+   * \returns Lowest lower bound and highest upper bound of the paired MLPs.
+   */
+  std::pair<mlpdouble, mlpdouble>
+  GetInputBounds(const MLPToolbox::CIOMap *input_output_map,
+                 std::size_t input_index) const {
+    mlpdouble CV_min{std::numeric_limits<mlpdouble>::max()},
+        CV_max{std::numeric_limits<mlpdouble>::lowest()};
+
+    for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
+      auto i_ANN = input_output_map->GetMLPIndex(i_map);
+      auto input_map = input_output_map->GetInputMapping(i_map);
+      for (auto iInput = 0u; iInput < input_map.size(); iInput++) {
+        if (input_map[iInput].first != input_index)
+          continue;
+        auto bounds = NeuralNetworks[i_ANN].GetInputBounds(input_map[iInput].second);
+        CV_min = std::min(CV_min, bounds.first);
+        CV_max = std::max(CV_max, bounds.second);
+      }
+    }
+    return std::make_pair(CV_min, CV_max);
+  }
   
   /*!
    * \brief Get the median input regularization value for a specific look-up operation.
@@ -189,17 +1067,21 @@ public:
   mlpdouble GetInputOffset(MLPToolbox::CIOMap *input_output_map,
                std::size_t input_index) const {
     mlpdouble CV_center{0.0};
+    std::size_t n_MLPs{0};
 
     for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
       auto i_ANN = input_output_map->GetMLPIndex(i_map);
-      auto i_input = input_output_map->GetInputIndex(i_map, input_index);
-      std::pair<mlpdouble, mlpdouble> ANN_input_limits =
-          NeuralNetworks[i_ANN].GetInputNorm(i_input);
-      mlpdouble center = NeuralNetworks[i_ANN].GetRegularizationOffset(i_input, true);
-      CV_center += center;
+      auto input_map = input_output_map->GetInputMapping(i_map);
+      for (auto iInput = 0u; iInput < input_map.size(); iInput++) {
+        if (input_map[iInput].first != input_index)
+          continue;
+        CV_center += NeuralNetworks[i_ANN].GetRegularizationOffset(
+            input_map[iInput].second, true);
+        n_MLPs++;
+      }
     }
 
-    CV_center /= input_output_map->GetNMLPs();
+    CV_center /= n_MLPs;
     return CV_center;
   }
 
@@ -219,6 +1101,509 @@ public:
       const std::vector<std::vector<mlpdouble *>> *doutputs_dinputs = nullptr,
       std::vector<std::vector<std::vector<mlpdouble *>>> *d2outputs_dinputs2 =
           nullptr) {
+    return EvaluateANN(input_output_map, inputs, outputs, doutputs_dinputs,
+                       d2outputs_dinputs2, false);
+  }
+
+  /*!
+   * \brief Evaluate loaded ANNs for inputs which differ from those of the
+   * previous look-up in a single variable, as in finite-difference probes,
+   * line searches, or parameter sweeps. The first hidden layer of the selected
+   * MLPs is then updated with a rank-1 correction instead of being recomputed.
+   * MLPs for which more than one input changed are evaluated in full.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values.
+   * \param[in] outputs - pointers to output variables.
+   * \param[in] doutputs_dinputs - pointers to output derivatives w.r.t. inputs.
+   * \param[in] d2outputs_dinputs2 - pointers to output second order derivatives
+   * w.r.t. inputs. \returns Within output normalization range.
+   */
+  unsigned long PredictANNUpdate(
+      MLPToolbox::CIOMap *input_output_map, const std::vector<mlpdouble> &inputs,
+      std::vector<mlpdouble *> &outputs,
+      const std::vector<std::vector<mlpdouble *>> *doutputs_dinputs = nullptr,
+      std::vector<std::vector<std::vector<mlpdouble *>>> *d2outputs_dinputs2 =
+          nullptr) {
+    return EvaluateANN(input_output_map, inputs, outputs, doutputs_dinputs,
+                       d2outputs_dinputs2, true);
+  }
+
+  /*!
+   * \brief Evaluate loaded ANNs for a batch of queries on the threads of the
+   * process-wide thread pool (see CThreadPool). Each thread evaluates queries
+   * as PredictANN does, using its own copy of the evaluation data of the
+   * networks. The queries are distributed through a work-stealing scheduler,
+   * weighted by the estimated cost of the MLPs each query selects at the
+   * requested derivative order, such that collections of networks of very
+   * different sizes keep all threads busy. See SetNUMAReplication for
+   * placing the weights on the NUMA node of each thread.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values per query.
+   * \param[out] outputs - output values [output][query].
+   * \param[out] doutputs_dinputs - optional output derivatives w.r.t. inputs
+   * [output][input][query].
+   * \param[out] d2outputs_dinputs2 - optional output second order derivatives
+   * w.r.t. inputs [output][input][input][query], which require the first order
+   * derivatives to be evaluated as well.
+   * \returns Number of queries outside the range of all loaded MLPs.
+   */
+  unsigned long PredictANNParallel(
+      MLPToolbox::CIOMap *input_output_map,
+      const std::vector<std::vector<mlpdouble>> &inputs,
+      std::vector<std::vector<mlpdouble>> &outputs,
+      std::vector<std::vector<std::vector<mlpdouble>>> *doutputs_dinputs =
+          nullptr,
+      std::vector<std::vector<std::vector<std::vector<mlpdouble>>>>
+          *d2outputs_dinputs2 = nullptr) {
+    if ((d2outputs_dinputs2 != nullptr) && (doutputs_dinputs == nullptr))
+      throw std::invalid_argument("Second order derivatives require the first "
+                                  "order derivatives to be evaluated.");
+    PrepareEvaluation(input_output_map);
+
+    const std::size_t nPoints = inputs.size(),
+                      nInputs = input_output_map->GetInputVars().size(),
+                      nOutputs = input_output_map->GetOutputVars().size();
+    const unsigned short derivative_order =
+        (d2outputs_dinputs2 != nullptr) ? 2
+                                        : ((doutputs_dinputs != nullptr) ? 1 : 0);
+    outputs.assign(nOutputs, std::vector<mlpdouble>(nPoints, 0.0));
+    if (doutputs_dinputs != nullptr)
+      doutputs_dinputs->assign(
+          nOutputs, std::vector<std::vector<mlpdouble>>(
+                        nInputs, std::vector<mlpdouble>(nPoints, 0.0)));
+    if (d2outputs_dinputs2 != nullptr)
+      d2outputs_dinputs2->assign(
+          nOutputs,
+          std::vector<std::vector<std::vector<mlpdouble>>>(
+              nInputs, std::vector<std::vector<mlpdouble>>(
+                           nInputs, std::vector<mlpdouble>(nPoints, 0.0))));
+
+    return EvaluateParallel(
+        input_output_map, nPoints, derivative_order,
+        [&](std::size_t iPoint, std::vector<mlpdouble> &)
+            -> const std::vector<mlpdouble> & { return inputs[iPoint]; },
+        [&](std::size_t iPoint, std::vector<mlpdouble *> &output_refs,
+            std::vector<std::vector<mlpdouble *>> &doutput_refs,
+            std::vector<std::vector<std::vector<mlpdouble *>>> &d2output_refs) {
+          for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+            output_refs[iOutput] = &outputs[iOutput][iPoint];
+            for (auto iInput = 0u;
+                 (derivative_order > 0) && (iInput < nInputs); iInput++) {
+              doutput_refs[iOutput][iInput] =
+                  &(*doutputs_dinputs)[iOutput][iInput][iPoint];
+              for (auto jInput = 0u;
+                   (derivative_order > 1) && (jInput < nInputs); jInput++)
+                d2output_refs[iOutput][iInput][jInput] =
+                    &(*d2outputs_dinputs2)[iOutput][iInput][jInput][iPoint];
+            }
+          }
+        });
+  }
+
+  /*!
+   * \brief Evaluate loaded ANNs for a batch of queries stored in raw strided
+   * buffers, as PredictANNParallel does. The inputs are read from, and the
+   * outputs and derivatives written to, the caller's buffers in place, such
+   * that arrays owned by other languages are evaluated without conversion.
+   * Strides are counted in values, not bytes, and may be negative.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] n_points - number of queries.
+   * \param[in] inputs - input values, element [query][input].
+   * \param[in] input_strides - strides of the inputs {query, input}.
+   * \param[out] outputs - output values, element [query][output].
+   * \param[in] output_strides - strides of the outputs {query, output}.
+   * \param[out] doutputs_dinputs - optional output derivatives w.r.t. inputs,
+   * element [query][output][input].
+   * \param[in] doutput_strides - strides of the output derivatives {query,
+   * output, input}.
+   * \param[out] d2outputs_dinputs2 - optional output second order derivatives
+   * w.r.t. inputs, element [query][output][input][input], which require the
+   * first order derivatives to be evaluated as well.
+   * \param[in] d2output_strides - strides of the second order derivatives
+   * {query, output, input, input}.
+   * \returns Number of queries outside the range of all loaded MLPs.
+   */
+  unsigned long PredictANNStrided(
+      MLPToolbox::CIOMap *input_output_map, std::size_t n_points,
+      const mlpdouble *inputs, const std::ptrdiff_t *input_strides,
+      mlpdouble *outputs, const std::ptrdiff_t *output_strides,
+      mlpdouble *doutputs_dinputs = nullptr,
+      const std::ptrdiff_t *doutput_strides = nullptr,
+      mlpdouble *d2outputs_dinputs2 = nullptr,
+      const std::ptrdiff_t *d2output_strides = nullptr) {
+    if ((inputs == nullptr) || (input_strides == nullptr) ||
+        (outputs == nullptr) || (output_strides == nullptr))
+      throw std::invalid_argument("Input and output buffers and their strides "
+                                  "are required.");
+    if ((doutputs_dinputs != nullptr) && (doutput_strides == nullptr))
+      throw std::invalid_argument("Output derivative buffer requires strides.");
+    if ((d2outputs_dinputs2 != nullptr) && (d2output_strides == nullptr))
+      throw std::invalid_argument(
+          "Second order derivative buffer requires strides.");
+    if ((d2outputs_dinputs2 != nullptr) && (doutputs_dinputs == nullptr))
+      throw std::invalid_argument("Second order derivatives require the first "
+                                  "order derivatives to be evaluated.");
+    PrepareEvaluation(input_output_map);
+
+    const std::size_t nInputs = input_output_map->GetInputVars().size(),
+                      nOutputs = input_output_map->GetOutputVars().size();
+    const unsigned short derivative_order =
+        (d2outputs_dinputs2 != nullptr) ? 2
+                                        : ((doutputs_dinputs != nullptr) ? 1 : 0);
+    return EvaluateParallel(
+        input_output_map, n_points, derivative_order,
+        [&](std::size_t iPoint, std::vector<mlpdouble> &point_inputs)
+            -> const std::vector<mlpdouble> & {
+          point_inputs.resize(nInputs);
+          const mlpdouble *point = inputs + iPoint * input_strides[0];
+          for (auto iInput = 0u; iInput < nInputs; iInput++)
+            point_inputs[iInput] = point[iInput * input_strides[1]];
+          return point_inputs;
+        },
+        [&](std::size_t iPoint, std::vector<mlpdouble *> &output_refs,
+            std::vector<std::vector<mlpdouble *>> &doutput_refs,
+            std::vector<std::vector<std::vector<mlpdouble *>>> &d2output_refs) {
+          const std::ptrdiff_t p = iPoint;
+          for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+            const std::ptrdiff_t o = iOutput;
+            output_refs[iOutput] =
+                outputs + p * output_strides[0] + o * output_strides[1];
+            *output_refs[iOutput] = 0.0;
+            for (auto iInput = 0u;
+                 (derivative_order > 0) && (iInput < nInputs); iInput++) {
+              const std::ptrdiff_t i = iInput;
+              doutput_refs[iOutput][iInput] =
+                  doutputs_dinputs + p * doutput_strides[0] +
+                  o * doutput_strides[1] + i * doutput_strides[2];
+              *doutput_refs[iOutput][iInput] = 0.0;
+              for (auto jInput = 0u;
+                   (derivative_order > 1) && (jInput < nInputs); jInput++) {
+                const std::ptrdiff_t j = jInput;
+                d2output_refs[iOutput][iInput][jInput] =
+                    d2outputs_dinputs2 + p * d2output_strides[0] +
+                    o * d2output_strides[1] + i * d2output_strides[2] +
+                    j * d2output_strides[3];
+                *d2output_refs[iOutput][iInput][jInput] = 0.0;
+              }
+            }
+          }
+        });
+  }
+
+  /*!
+   * \brief Get the number of query chunks which threads of parallel batch
+   * evaluations took over from other threads.
+   * \returns Number of stolen chunks.
+   */
+  unsigned long GetNStolenChunks() const { return scheduler.GetNSteals(); }
+
+  /*!
+   * \brief Evaluate loaded ANNs for a batch of queries with every MLP owned
+   * by a single thread of the process-wide thread pool (see CThreadPool). The
+   * MLPs of the look-up are dealt to the threads by size, such that each
+   * thread only reads the weights of its own MLPs and keeps them in its
+   * private cache. The calling thread assigns the queries to the paired MLPs
+   * following the same selection as PredictANN and routes them to the owning
+   * threads through lock-free queues, while these already evaluate them in
+   * blocks, as PredictANNBatch does, and write the outputs in place. This
+   * complements PredictANNParallel for collections of many large MLPs, whose
+   * weights together exceed the cache of a core, at moderate batch sizes.
+   * Only output values are computed.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values per query.
+   * \param[out] outputs - output values per call output variable, ordered as
+   * the queries.
+   * \returns Number of queries outside the range of all loaded MLPs.
+   */
+  unsigned long
+  PredictANNModelParallel(MLPToolbox::CIOMap *input_output_map,
+                          const std::vector<std::vector<mlpdouble>> &inputs,
+                          std::vector<std::vector<mlpdouble>> &outputs) {
+    PrepareEvaluation(input_output_map);
+    UpdateWorkerCollections();
+
+    CThreadPool &pool = CThreadPool::GetInstance();
+    const std::size_t nPoints = inputs.size(),
+                      nMaps = input_output_map->GetNMLPs(),
+                      nOutputs = input_output_map->GetOutputVars().size(),
+                      nThreads = pool.GetNThreads(), block_size = 64,
+                      route_capacity = 1024;
+    outputs.assign(nOutputs, std::vector<mlpdouble>(nPoints, 0.0));
+
+    /* Deal the MLPs to the threads, largest first to the least loaded. */
+    std::vector<std::size_t> map_order(nMaps), map_owners(nMaps),
+        n_owned(nThreads, 0);
+    std::vector<double> owned_cost(nThreads, 0);
+    std::iota(map_order.begin(), map_order.end(), 0);
+    auto map_cost = [&](std::size_t i_map) {
+      return NeuralNetworks[input_output_map->GetMLPIndex(i_map)]
+          .GetEvaluationCost(0);
+    };
+    std::stable_sort(map_order.begin(), map_order.end(),
+                     [&](std::size_t i_map, std::size_t j_map) {
+                       return map_cost(i_map) > map_cost(j_map);
+                     });
+    for (auto i_map : map_order) {
+      std::size_t iThread =
+          std::min_element(owned_cost.begin(), owned_cost.end()) -
+          owned_cost.begin();
+      map_owners[i_map] = iThread;
+      owned_cost[iThread] += map_cost(i_map);
+      n_owned[iThread]++;
+    }
+
+    /* When several selected MLPs provide the same output, the last one in
+     * mapping order sets it, as in PredictANN. */
+    std::vector<std::size_t> n_providers(nOutputs, 0);
+    for (auto i_map = 0u; i_map < nMaps; i_map++)
+      for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++)
+        n_providers[input_output_map->GetOutputIndex(i_map, i)]++;
+    const bool shared_outputs =
+        std::any_of(n_providers.begin(), n_providers.end(),
+                    [](std::size_t n) { return n > 1; });
+    std::vector<std::size_t> output_writers(shared_outputs ? nOutputs * nPoints
+                                                           : 0);
+
+    /* The queues have a fixed capacity. The thread evaluating the queries of
+     * a queue holds its consumer mutex; the routing thread drains a full
+     * queue itself when no other thread does, which is the case for its own
+     * queue and when the pool runs the threads' tasks in turn. */
+    route_queues.resize(nThreads);
+    for (auto iThread = 0u; iThread < nThreads; iThread++) {
+      if (!route_queues[iThread])
+        route_queues[iThread].reset(
+            new CLockFreeQueue<std::pair<std::size_t, std::size_t>>());
+      route_queues[iThread]->Reset(route_capacity);
+    }
+    std::vector<std::mutex> consumer_mutexes(nThreads);
+    std::vector<std::vector<std::vector<std::size_t>>> block_points(
+        nThreads, std::vector<std::vector<std::size_t>>(nMaps));
+    std::vector<std::vector<std::vector<std::vector<mlpdouble>>>> block_inputs(
+        nThreads, std::vector<std::vector<std::vector<mlpdouble>>>(nMaps));
+
+    /* Evaluate the queries of a queue per MLP in blocks; requires the consumer
+     * mutex of the queue. */
+    auto evaluate_block = [&](std::size_t iQueue, std::size_t i_map) {
+      std::vector<std::size_t> &points = block_points[iQueue][i_map];
+      if (points.empty())
+        return;
+      CNeuralNetwork &ANN = worker_collections[iQueue]
+                                ->NeuralNetworks[input_output_map->GetMLPIndex(
+                                    i_map)];
+      ANN.SetKernels(input_output_map->GetKernels(i_map));
+      ANN.PredictBatch(block_inputs[iQueue][i_map],
+                       input_output_map->GetOutputLayer(i_map));
+      for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++) {
+        auto iOutput = input_output_map->GetOutputIndex(i_map, i),
+             iMLPOutput = input_output_map->GetMLPOutputIndex(i_map, i);
+        for (auto iBatch = 0u; iBatch < points.size(); iBatch++) {
+          const std::size_t iPoint = points[iBatch];
+          if (!shared_outputs ||
+              (output_writers[iOutput * nPoints + iPoint] == i_map))
+            outputs[iOutput][iPoint] = ANN.GetBatchOutput(iBatch, iMLPOutput);
+        }
+      }
+      points.clear();
+      block_inputs[iQueue][i_map].clear();
+    };
+    auto drain = [&](std::size_t iQueue, bool until_closed) {
+      CLockFreeQueue<std::pair<std::size_t, std::size_t>> &queue =
+          *route_queues[iQueue];
+      std::pair<std::size_t, std::size_t> query;
+      for (;;) {
+        const bool closed = queue.IsClosed();
+        if (queue.Pop(query)) {
+          const std::size_t i_map = query.second;
+          block_points[iQueue][i_map].push_back(query.first);
+          block_inputs[iQueue][i_map].push_back(
+              input_output_map->GetMLPInputs(i_map, inputs[query.first]));
+          if (block_points[iQueue][i_map].size() == block_size)
+            evaluate_block(iQueue, i_map);
+        } else if (closed || !until_closed) {
+          break;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    };
+
+    unsigned long n_outside = 0;
+    pool.ForEachThread([&](std::size_t iThread) {
+      if (iThread == 0) {
+        std::vector<std::size_t> selected_maps;
+        for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+          selected_maps.clear();
+          if (AssignQuery(input_output_map, inputs[iPoint],
+                          [&](std::size_t i_map,
+                              const std::vector<mlpdouble> &) {
+                            selected_maps.push_back(i_map);
+                          }))
+            n_outside++;
+          for (auto i_map : selected_maps) {
+            for (auto i = 0u;
+                 shared_outputs &&
+                 (i < input_output_map->GetNMappedOutputs(i_map));
+                 i++)
+              output_writers[input_output_map->GetOutputIndex(i_map, i) *
+                                 nPoints +
+                             iPoint] = i_map;
+          }
+          for (auto i_map : selected_maps) {
+            const std::size_t iQueue = map_owners[i_map];
+            while (!route_queues[iQueue]->Push(std::make_pair(iPoint, i_map))) {
+              std::unique_lock<std::mutex> lock(consumer_mutexes[iQueue],
+                                                std::try_to_lock);
+              if (lock.owns_lock())
+                drain(iQueue, false);
+              else
+                std::this_thread::yield();
+            }
+          }
+        }
+        for (auto &queue : route_queues)
+          queue->Close();
+      }
+
+      std::lock_guard<std::mutex> lock(consumer_mutexes[iThread]);
+      drain(iThread, true);
+      for (auto i_map = 0u; i_map < nMaps; i_map++)
+        evaluate_block(iThread, i_map);
+    });
+    return n_outside;
+  }
+
+  /*!
+   * \brief Evaluate loaded ANNs for a batch of queries. The queries are
+   * assigned to the paired MLPs following the same selection as PredictANN,
+   * after which every MLP evaluates its queries at once, applying each weight
+   * layer through a single matrix-matrix product. Defining MLP_USE_BLAS hands
+   * these products to an external BLAS library. Only output values are
+   * computed.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values per query.
+   * \param[out] outputs - output values per call output variable, ordered as
+   * the queries.
+   * \returns Number of queries outside the range of all loaded MLPs.
+   */
+  unsigned long
+  PredictANNBatch(MLPToolbox::CIOMap *input_output_map,
+                  const std::vector<std::vector<mlpdouble>> &inputs,
+                  std::vector<std::vector<mlpdouble>> &outputs) {
+    PrepareEvaluation(input_output_map);
+
+    const std::size_t nPoints = inputs.size(),
+                      nMaps = input_output_map->GetNMLPs();
+    outputs.resize(input_output_map->GetOutputVars().size());
+    for (auto iOutput = 0u; iOutput < outputs.size(); iOutput++)
+      outputs[iOutput].resize(nPoints);
+
+    /* Queries and MLP inputs assigned to each paired MLP. */
+    std::vector<std::vector<std::size_t>> map_points(nMaps);
+    std::vector<std::vector<std::vector<mlpdouble>>> map_inputs(nMaps);
+    unsigned long n_outside = 0;
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+      if (AssignQuery(input_output_map, inputs[iPoint],
+                      [&](std::size_t i_map,
+                          const std::vector<mlpdouble> &ANN_inputs) {
+                        map_points[i_map].push_back(iPoint);
+                        map_inputs[i_map].push_back(ANN_inputs);
+                      }))
+        n_outside++;
+    }
+
+    for (auto i_map = 0u; i_map < nMaps; i_map++) {
+      if (map_points[i_map].empty())
+        continue;
+      auto i_ANN = input_output_map->GetMLPIndex(i_map);
+      NeuralNetworks[i_ANN].SetKernels(input_output_map->GetKernels(i_map));
+      NeuralNetworks[i_ANN].PredictBatch(
+          map_inputs[i_map], input_output_map->GetOutputLayer(i_map));
+      for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++) {
+        auto iOutput = input_output_map->GetOutputIndex(i_map, i),
+             iMLPOutput = input_output_map->GetMLPOutputIndex(i_map, i);
+        for (auto iBatch = 0u; iBatch < map_points[i_map].size(); iBatch++)
+          outputs[iOutput][map_points[i_map][iBatch]] =
+              NeuralNetworks[i_ANN].GetBatchOutput(iBatch, iMLPOutput);
+      }
+    }
+    return n_outside;
+  }
+
+  /*!
+   * \brief Evaluate loaded ANNs for a batch of queries asynchronously, as
+   * PredictANNBatch does, on a worker of the process-wide thread pool (see
+   * CThreadPool). The call returns immediately, such that the caller can
+   * continue with other work and submit further batches before waiting on
+   * any of them. The batches of a collection are evaluated one at a time in
+   * submission order. The input and output arrays and the input-output map
+   * must remain valid, and the collection must not be evaluated directly or
+   * moved, until the batch is done. Without workers in the thread pool, the
+   * batch is evaluated before the call returns.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values per query.
+   * \param[out] outputs - output values per call output variable, ordered as
+   * the queries.
+   * \param[in] on_completion - optional function called on the worker with the
+   * number of queries outside the range of all loaded MLPs once the outputs
+   * are written, before the returned future becomes ready.
+   * \returns Future of the number of queries outside the range of all loaded
+   * MLPs, which passes on errors of the evaluation and of the completion
+   * function.
+   */
+  std::future<unsigned long>
+  PredictANNAsync(MLPToolbox::CIOMap *input_output_map,
+                  const std::vector<std::vector<mlpdouble>> &inputs,
+                  std::vector<std::vector<mlpdouble>> &outputs,
+                  std::function<void(unsigned long)> on_completion = nullptr) {
+    std::shared_ptr<std::promise<unsigned long>> done =
+        std::make_shared<std::promise<unsigned long>>();
+    std::future<unsigned long> result = done->get_future();
+    async_batches.Push(
+        [this, input_output_map, &inputs, &outputs, on_completion, done] {
+          try {
+            unsigned long n_outside =
+                PredictANNBatch(input_output_map, inputs, outputs);
+            if (on_completion)
+              on_completion(n_outside);
+            done->set_value(n_outside);
+          } catch (...) {
+            done->set_exception(std::current_exception());
+          }
+        });
+    return result;
+  }
+
+  /*!
+   * \brief Wait until all batches submitted through PredictANNAsync are done.
+   */
+  void WaitForAsyncBatches() { async_batches.Wait(); }
+
+private:
+  /*!
+   * \brief Evaluate loaded ANNs for given inputs and outputs
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] inputs - input values.
+   * \param[in] outputs - pointers to output variables.
+   * \param[in] doutputs_dinputs - pointers to output derivatives w.r.t. inputs.
+   * \param[in] d2outputs_dinputs2 - pointers to output second order derivatives
+   * w.r.t. inputs.
+   * \param[in] incremental - re-use the first hidden layer of the previous
+   * evaluation of each MLP if a single input changed.
+   * \returns Within output normalization range.
+   */
+  unsigned long EvaluateANN(
+      MLPToolbox::CIOMap *input_output_map, const std::vector<mlpdouble> &inputs,
+      std::vector<mlpdouble *> &outputs,
+      const std::vector<std::vector<mlpdouble *>> *doutputs_dinputs,
+      std::vector<std::vector<std::vector<mlpdouble *>>> *d2outputs_dinputs2,
+      bool incremental) {
     /*--- Evaluate MLP based on target input and output variables ---*/
     bool within_range, // Within MLP training set range.
         MLP_was_evaluated =
@@ -227,27 +1612,45 @@ public:
     bool compute_firstorder_gradient = (doutputs_dinputs != nullptr),
          compute_secondorder_gradient = (d2outputs_dinputs2 != nullptr);
 
+    PrepareEvaluation(input_output_map);
+
+    /* Evaluate the expert MLP selected by the gating network if the query lies
+     * within its training data range. */
+    if (input_output_map->HasGatingNetwork()) {
+      int i_map = SelectExpert(input_output_map, inputs);
+      if (i_map >= 0) {
+        auto i_ANN = input_output_map->GetMLPIndex(i_map);
+        auto ANN_inputs = input_output_map->GetMLPInputs(i_map, inputs);
+        if (NeuralNetworks[i_ANN].CheckInputInclusion(ANN_inputs)) {
+          NeuralNetworks[i_ANN].ComputeFirstOrderGradient(
+              compute_firstorder_gradient);
+          NeuralNetworks[i_ANN].ComputeSecondOrderGradient(
+              compute_secondorder_gradient);
+          EvaluateMLP(input_output_map, i_map, ANN_inputs, incremental);
+          CopyMLPOutputs(input_output_map, i_map, outputs, doutputs_dinputs,
+                         d2outputs_dinputs2);
+          return 0;
+        }
+      }
+    }
+
     /* If queries lie outside the training data set, the nearest MLP will be
      * evaluated through extrapolation. */
     mlpdouble distance_to_query = 1e20; // Overall smallest distance between
                                         // training data set middle and query.
-    size_t i_ANN_nearest = 0,           // Index of nearest MLP.
-        i_map_nearest = 0;              // Index of nearest iomap index.
+    size_t i_map_nearest = 0;           // Index of nearest iomap index.
 
     for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
-      within_range = true;
       auto i_ANN = input_output_map->GetMLPIndex(i_map);
       NeuralNetworks[i_ANN].ComputeFirstOrderGradient(
           compute_firstorder_gradient);
       NeuralNetworks[i_ANN].ComputeSecondOrderGradient(
           compute_secondorder_gradient);
       auto ANN_inputs = input_output_map->GetMLPInputs(i_map, inputs);
+      within_range = NeuralNetworks[i_ANN].CheckInputInclusion(ANN_inputs);
 
       mlpdouble distance_to_query_i = 0;
       for (auto i_input = 0u; i_input < ANN_inputs.size(); i_input++) {
-        within_range = NeuralNetworks[i_ANN].CheckInputInclusion(ANN_inputs[i_input], i_input);
-        
-
         /* Calculate distance between MLP training range center point and query
          */
         mlpdouble middle = NeuralNetworks[i_ANN].GetRegularizationOffset(i_input);
@@ -257,40 +1660,14 @@ public:
 
       /* Evaluate MLP when query inputs lie within training data range */
       if (within_range) {
-        NeuralNetworks[i_ANN].Predict(ANN_inputs);
+        EvaluateMLP(input_output_map, i_map, ANN_inputs, incremental);
         MLP_was_evaluated = true;
-        for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++) {
-          *outputs[input_output_map->GetOutputIndex(i_map, i)] =
-              NeuralNetworks[i_ANN].GetANNOutput(
-                  input_output_map->GetMLPOutputIndex(i_map, i));
-          if (compute_firstorder_gradient) {
-            for (auto iInput = 0u; iInput < inputs.size(); iInput++) {
-              *(doutputs_dinputs->at(input_output_map->GetOutputIndex(i_map, i))
-                    .at(iInput)) =
-                  NeuralNetworks[i_ANN].GetdOutputdInput(
-                      input_output_map->GetMLPOutputIndex(i_map, i),
-                      input_output_map->GetInputIndex(i_map, iInput));
-
-              if (compute_secondorder_gradient) {
-                for (auto jInput = 0u; jInput < inputs.size(); jInput++) {
-                  *(d2outputs_dinputs2
-                        ->at(input_output_map->GetOutputIndex(i_map, i))
-                        .at(iInput)
-                        .at(jInput)) =
-                      NeuralNetworks[i_ANN].Getd2OutputdInput2(
-                          input_output_map->GetMLPOutputIndex(i_map, i),
-                          input_output_map->GetInputIndex(i_map, iInput),
-                          input_output_map->GetInputIndex(i_map, jInput));
-                }
-              }
-            }
-          }
-        }
+        CopyMLPOutputs(input_output_map, i_map, outputs, doutputs_dinputs,
+                       d2outputs_dinputs2);
       }
 
       /* Update minimum distance to query */
       if (distance_to_query_i < distance_to_query) {
-        i_ANN_nearest = i_ANN;
         distance_to_query = distance_to_query_i;
         i_map_nearest = i_map;
       }
@@ -299,13 +1676,8 @@ public:
     /* Evaluate nearest MLP in case no query data within range is found */
     if (!MLP_was_evaluated) {
       auto ANN_inputs = input_output_map->GetMLPInputs(i_map_nearest, inputs);
-      NeuralNetworks[i_ANN_nearest].Predict(ANN_inputs);
-      for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map_nearest);
-           i++) {
-        *outputs[input_output_map->GetOutputIndex(i_map_nearest, i)] =
-            NeuralNetworks[i_ANN_nearest].GetANNOutput(
-                input_output_map->GetMLPOutputIndex(i_map_nearest, i));
-      }
+      EvaluateMLP(input_output_map, i_map_nearest, ANN_inputs, incremental);
+      CopyMLPOutputs(input_output_map, i_map_nearest, outputs);
     }
 
     /* Return 1 if query data lies outside the range of any of the loaded MLPs
@@ -313,6 +1685,418 @@ public:
     return MLP_was_evaluated ? 0 : 1;
   }
 
+  /*!
+   * \brief Evaluate a paired MLP of a look-up operation.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] ANN_inputs - MLP inputs.
+   * \param[in] incremental - re-use the first hidden layer of the previous
+   * evaluation if a single input changed.
+   */
+  void EvaluateMLP(const MLPToolbox::CIOMap *input_output_map,
+                   std::size_t i_map, std::vector<mlpdouble> &ANN_inputs,
+                   bool incremental) {
+    auto i_ANN = input_output_map->GetMLPIndex(i_map);
+    NeuralNetworks[i_ANN].SetKernels(input_output_map->GetKernels(i_map));
+    if (incremental)
+      NeuralNetworks[i_ANN].PredictUpdate(
+          ANN_inputs, input_output_map->GetFirstLayer(i_map),
+          input_output_map->GetOutputLayer(i_map));
+    else
+      NeuralNetworks[i_ANN].Predict(ANN_inputs,
+                                    input_output_map->GetFirstLayer(i_map),
+                                    input_output_map->GetOutputLayer(i_map));
+  }
+
+  /*!
+   * \brief Copy the outputs of an evaluated MLP to the call outputs.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] outputs - pointers to output variables.
+   * \param[in] doutputs_dinputs - pointers to output derivatives w.r.t. inputs.
+   * \param[in] d2outputs_dinputs2 - pointers to output second order derivatives
+   * w.r.t. inputs.
+   */
+  void CopyMLPOutputs(
+      const MLPToolbox::CIOMap *input_output_map, std::size_t i_map,
+      std::vector<mlpdouble *> &outputs,
+      const std::vector<std::vector<mlpdouble *>> *doutputs_dinputs = nullptr,
+      std::vector<std::vector<std::vector<mlpdouble *>>> *d2outputs_dinputs2 =
+          nullptr) const {
+    auto i_ANN = input_output_map->GetMLPIndex(i_map);
+    for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++) {
+      *outputs[input_output_map->GetOutputIndex(i_map, i)] =
+          NeuralNetworks[i_ANN].GetANNOutput(
+              input_output_map->GetMLPOutputIndex(i_map, i));
+      /* Derivatives w.r.t. MLP input iInput belong to the call input it is
+       * mapped to. */
+      if (doutputs_dinputs != nullptr) {
+        for (auto iInput = 0u;
+             iInput < input_output_map->GetNMappedInputs(i_map); iInput++) {
+          *(doutputs_dinputs->at(input_output_map->GetOutputIndex(i_map, i))
+                .at(input_output_map->GetInputIndex(i_map, iInput))) =
+              NeuralNetworks[i_ANN].GetdOutputdInput(
+                  input_output_map->GetMLPOutputIndex(i_map, i), iInput);
+
+          if (d2outputs_dinputs2 != nullptr) {
+            for (auto jInput = 0u;
+                 jInput < input_output_map->GetNMappedInputs(i_map); jInput++) {
+              *(d2outputs_dinputs2
+                    ->at(input_output_map->GetOutputIndex(i_map, i))
+                    .at(input_output_map->GetInputIndex(i_map, iInput))
+                    .at(input_output_map->GetInputIndex(i_map, jInput))) =
+                  NeuralNetworks[i_ANN].Getd2OutputdInput2(
+                      input_output_map->GetMLPOutputIndex(i_map, i), iInput,
+                      jInput);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Evaluate a batch of queries on the threads of the thread pool, as
+   * described in PredictANNParallel. The evaluation data must be prepared and
+   * the result buffers sized by the caller.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] nPoints - number of queries.
+   * \param[in] derivative_order - evaluated derivative order.
+   * \param[in] point_inputs - function returning the inputs of a query, given
+   * the query index and a scratch vector it may fill.
+   * \param[in] point_references - function pointing the output and derivative
+   * references at the result locations of a query.
+   * \returns Number of queries outside the range of all loaded MLPs.
+   */
+  template <class InputFunction, class ReferenceFunction>
+  unsigned long EvaluateParallel(MLPToolbox::CIOMap *input_output_map,
+                                 std::size_t nPoints,
+                                 unsigned short derivative_order,
+                                 InputFunction point_inputs,
+                                 ReferenceFunction point_references) {
+    const std::size_t nInputs = input_output_map->GetInputVars().size(),
+                      nOutputs = input_output_map->GetOutputVars().size();
+    UpdateWorkerCollections();
+
+    std::vector<double> costs(nPoints);
+    std::vector<mlpdouble> scratch;
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++)
+      costs[iPoint] = EstimateQueryCost(
+          input_output_map, point_inputs(iPoint, scratch), derivative_order);
+
+    std::atomic<unsigned long> n_outside{0};
+    scheduler.Run(costs, [&](std::size_t iThread, std::size_t iBegin,
+                             std::size_t iEnd) {
+      CLookUp_ANN &worker = *worker_collections[iThread];
+      std::vector<mlpdouble> query_inputs;
+      std::vector<mlpdouble *> output_refs(nOutputs);
+      std::vector<std::vector<mlpdouble *>> doutput_refs(
+          (derivative_order > 0) ? nOutputs : 0,
+          std::vector<mlpdouble *>(nInputs));
+      std::vector<std::vector<std::vector<mlpdouble *>>> d2output_refs(
+          (derivative_order > 1) ? nOutputs : 0,
+          std::vector<std::vector<mlpdouble *>>(
+              nInputs, std::vector<mlpdouble *>(nInputs)));
+      for (auto iPoint = iBegin; iPoint < iEnd; iPoint++) {
+        point_references(iPoint, output_refs, doutput_refs, d2output_refs);
+        n_outside += worker.PredictANN(
+            input_output_map, point_inputs(iPoint, query_inputs), output_refs,
+            (derivative_order > 0) ? &doutput_refs : nullptr,
+            (derivative_order > 1) ? &d2output_refs : nullptr);
+      }
+    });
+    return n_outside;
+  }
+
+  /*!
+   * \brief Select the paired MLPs evaluating a query, following the same
+   * logic as PredictANN: the expert chosen by the gating network if the query
+   * lies within its range, otherwise every MLP containing the query, or the
+   * nearest MLP if none does.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] inputs - call input values of the query.
+   * \param[in] assign - function called with the input-output mapping index
+   * and the MLP inputs of every selected MLP, in mapping order.
+   * \returns The query lies outside the range of all MLPs.
+   */
+  template <class AssignFunction>
+  bool AssignQuery(const MLPToolbox::CIOMap *input_output_map,
+                   const std::vector<mlpdouble> &inputs,
+                   AssignFunction assign) {
+    if (input_output_map->HasGatingNetwork()) {
+      int i_map = SelectExpert(input_output_map, inputs);
+      if (i_map >= 0) {
+        auto i_ANN = input_output_map->GetMLPIndex(i_map);
+        auto ANN_inputs = input_output_map->GetMLPInputs(i_map, inputs);
+        if (NeuralNetworks[i_ANN].CheckInputInclusion(ANN_inputs)) {
+          assign(i_map, ANN_inputs);
+          return false;
+        }
+      }
+    }
+
+    bool MLP_was_evaluated = false;
+    mlpdouble distance_to_query = 1e20;
+    std::size_t i_map_nearest = 0;
+    for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
+      auto i_ANN = input_output_map->GetMLPIndex(i_map);
+      auto ANN_inputs = input_output_map->GetMLPInputs(i_map, inputs);
+      const bool within_range =
+          NeuralNetworks[i_ANN].CheckInputInclusion(ANN_inputs);
+      mlpdouble distance_to_query_i = 0;
+      for (auto i_input = 0u; i_input < ANN_inputs.size(); i_input++) {
+        mlpdouble middle =
+            NeuralNetworks[i_ANN].GetRegularizationOffset(i_input);
+        distance_to_query_i += pow(NeuralNetworks[i_ANN].NormalizeInput(
+                                       ANN_inputs[i_input] - middle, i_input),
+                                   2);
+      }
+      if (within_range) {
+        assign(i_map, ANN_inputs);
+        MLP_was_evaluated = true;
+      }
+      if (distance_to_query_i < distance_to_query) {
+        distance_to_query = distance_to_query_i;
+        i_map_nearest = i_map;
+      }
+    }
+    if (!MLP_was_evaluated)
+      assign(i_map_nearest,
+             input_output_map->GetMLPInputs(i_map_nearest, inputs));
+    return !MLP_was_evaluated;
+  }
+
+  /*!
+   * \brief Select the expert MLP for a query through the gating network. The
+   * expert with the highest gating network output is selected.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] inputs - call input values.
+   * \returns Input-output mapping index of the selected expert, -1 if the
+   * expert cannot serve the look-up.
+   */
+  int SelectExpert(const MLPToolbox::CIOMap *input_output_map,
+                   const std::vector<mlpdouble> &inputs) {
+    auto gating_inputs = input_output_map->GetGatingInputs(inputs);
+    GatingNetwork.ComputeFirstOrderGradient(false);
+    GatingNetwork.ComputeSecondOrderGradient(false);
+    GatingNetwork.Predict(gating_inputs);
+
+    std::size_t i_expert = 0;
+    for (auto iOutput = 1u; iOutput < GatingNetwork.GetnOutputs(); iOutput++) {
+      if (GatingNetwork.GetANNOutput(iOutput) >
+          GatingNetwork.GetANNOutput(i_expert))
+        i_expert = iOutput;
+    }
+    return input_output_map->GetGatingMap(i_expert);
+  }
+
+  /*!
+   * \brief Estimate the cost of a look-up from the MLPs it will evaluate,
+   * following the range checks of PredictANN.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] inputs - call input values.
+   * \param[in] derivative_order - evaluated derivative order.
+   * \returns Estimated number of floating point operations.
+   */
+  double EstimateQueryCost(const MLPToolbox::CIOMap *input_output_map,
+                           const std::vector<mlpdouble> &inputs,
+                           unsigned short derivative_order) const {
+    double cost = 0, nearest_cost = 0;
+    mlpdouble distance_to_query = 1e20;
+    if (input_output_map->HasGatingNetwork())
+      cost += GatingNetwork.GetEvaluationCost(0);
+    for (auto i_map = 0u; i_map < input_output_map->GetNMLPs(); i_map++) {
+      const CNeuralNetwork &ANN =
+          NeuralNetworks[input_output_map->GetMLPIndex(i_map)];
+      auto ANN_inputs = input_output_map->GetMLPInputs(i_map, inputs);
+      mlpdouble distance_to_query_i = 0;
+      for (auto i_input = 0u; i_input < ANN_inputs.size(); i_input++) {
+        distance_to_query_i +=
+            pow(ANN.NormalizeInput(ANN_inputs[i_input] -
+                                       ANN.GetRegularizationOffset(i_input),
+                                   i_input),
+                2);
+      }
+      if (ANN.CheckInputInclusion(ANN_inputs))
+        cost += ANN.GetEvaluationCost(derivative_order);
+      if (distance_to_query_i < distance_to_query) {
+        distance_to_query = distance_to_query_i;
+        nearest_cost = ANN.GetEvaluationCost(derivative_order);
+      }
+    }
+    return (cost > 0) ? cost : nearest_cost;
+  }
+
+public:
+  /*!
+   * \brief Evaluate loaded ANNs on a Cartesian grid of call inputs. The
+   * activation function inputs of the first hidden layer are additive in the
+   * network inputs, so the contribution of every coordinate along every axis is
+   * computed once. The first layer is assembled from partial sums over the
+   * axes, which are kept while the grid advances, such that a step along the
+   * last axis only adds a single contribution per neuron instead of a full
+   * matrix-vector product. MLPs are selected as in PredictANN.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs.
+   * \param[in] axes - coordinate values along each call input axis.
+   * \param[out] outputs - output values per call output variable, ordered with
+   * the last axis varying fastest.
+   * \returns Number of grid points outside the range of all loaded MLPs.
+   */
+  unsigned long PredictANNGrid(MLPToolbox::CIOMap *input_output_map,
+                               const std::vector<std::vector<mlpdouble>> &axes,
+                               std::vector<std::vector<mlpdouble>> &outputs) {
+    PrepareEvaluation(input_output_map);
+
+    std::size_t nAxes = axes.size(), nPoints = 1;
+    for (auto iAxis = 0u; iAxis < nAxes; iAxis++)
+      nPoints *= axes[iAxis].size();
+
+    outputs.resize(input_output_map->GetOutputVars().size());
+    for (auto iOutput = 0u; iOutput < outputs.size(); iOutput++)
+      outputs[iOutput].resize(nPoints);
+
+    std::size_t nMaps = input_output_map->GetNMLPs();
+    std::vector<CGridPartialSums> partial_sums(nMaps);
+    for (auto i_map = 0u; i_map < nMaps; i_map++) {
+      auto i_ANN = input_output_map->GetMLPIndex(i_map);
+      NeuralNetworks[i_ANN].ComputeFirstOrderGradient(false);
+      NeuralNetworks[i_ANN].ComputeSecondOrderGradient(false);
+      InitializeGridPartialSums(input_output_map, i_map, axes,
+                                partial_sums[i_map]);
+    }
+
+    unsigned long n_outside = 0;
+    std::vector<std::size_t> grid_index(nAxes, 0);
+    std::vector<mlpdouble> inputs(nAxes);
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+      for (auto iAxis = 0u; iAxis < nAxes; iAxis++)
+        inputs[iAxis] = axes[iAxis][grid_index[iAxis]];
+
+      if (AssignQuery(input_output_map, inputs,
+                      [&](std::size_t i_map, const std::vector<mlpdouble> &) {
+                        EvaluateGridPoint(input_output_map, i_map,
+                                          partial_sums[i_map], grid_index,
+                                          outputs, iPoint);
+                      }))
+        n_outside++;
+
+      /* Advance the grid index, last axis fastest. Partial sums over the axes
+       * before the lowest changed axis remain valid. */
+      for (auto iAxis = nAxes; iAxis-- > 0;) {
+        if (++grid_index[iAxis] < axes[iAxis].size()) {
+          for (auto &sums : partial_sums) {
+            std::size_t n_unchanged = 0;
+            while ((n_unchanged < sums.input_axes.size()) &&
+                   (sums.input_axes[n_unchanged] < iAxis))
+              n_unchanged++;
+            sums.n_valid = std::min(sums.n_valid, n_unchanged);
+          }
+          break;
+        }
+        grid_index[iAxis] = 0;
+      }
+    }
+    return n_outside;
+  }
+
+private:
+  /*!
+   * \brief First hidden layer partial sums of a paired MLP during a grid
+   * evaluation. The MLP inputs are ordered by call input axis; level L holds
+   * the biases plus the contributions of the first L inputs in that order.
+   */
+  struct CGridPartialSums {
+    std::vector<std::size_t> inputs, /*!< MLP inputs ordered by axis. */
+        input_axes; /*!< Call input axis of each ordered MLP input. */
+    std::vector<std::vector<std::vector<mlpdouble>>>
+        contributions; /*!< Contributions [ordered input][coordinate][neuron]. */
+    std::vector<std::vector<mlpdouble>>
+        levels;            /*!< Partial sums [level][neuron]. */
+    std::size_t n_valid{0}; /*!< Number of up-to-date levels after level 0. */
+  };
+
+  /*!
+   * \brief Compute the per-axis first hidden layer contributions of a paired
+   * MLP and size its partial sums.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] axes - coordinate values along each call input axis.
+   * \param[out] sums - partial sums of the MLP.
+   */
+  void InitializeGridPartialSums(
+      const MLPToolbox::CIOMap *input_output_map, std::size_t i_map,
+      const std::vector<std::vector<mlpdouble>> &axes,
+      CGridPartialSums &sums) const {
+    const CNeuralNetwork &ANN =
+        NeuralNetworks[input_output_map->GetMLPIndex(i_map)];
+    auto nInputs = ANN.GetnInputs();
+    auto nNeurons = ANN.GetNNeurons(1);
+    sums.inputs.resize(nInputs);
+    std::iota(sums.inputs.begin(), sums.inputs.end(), 0);
+    std::stable_sort(sums.inputs.begin(), sums.inputs.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       return input_output_map->GetInputIndex(i_map, a) <
+                              input_output_map->GetInputIndex(i_map, b);
+                     });
+    sums.input_axes.resize(nInputs);
+    sums.contributions.resize(nInputs);
+    for (auto iLevel = 0u; iLevel < nInputs; iLevel++) {
+      auto iInput = sums.inputs[iLevel];
+      auto iAxis = input_output_map->GetInputIndex(i_map, iInput);
+      sums.input_axes[iLevel] = iAxis;
+      sums.contributions[iLevel].resize(axes[iAxis].size());
+      for (auto iCoord = 0u; iCoord < axes[iAxis].size(); iCoord++) {
+        mlpdouble val_input = input_output_map->IsBoundInput(iAxis)
+                                  ? input_output_map->GetBoundValue(iAxis)
+                                  : axes[iAxis][iCoord];
+        ANN.ComputeFirstLayerContribution(iInput, val_input,
+                                          sums.contributions[iLevel][iCoord]);
+      }
+    }
+    sums.levels.assign(nInputs + 1, std::vector<mlpdouble>(nNeurons));
+    for (auto iNeuron = 0u; iNeuron < nNeurons; iNeuron++)
+      sums.levels[0][iNeuron] = ANN.GetBias(1, iNeuron);
+    sums.n_valid = 0;
+  }
+
+  /*!
+   * \brief Evaluate a paired MLP at a single grid point, updating the partial
+   * sums of its first hidden layer which are out of date.
+   * \param[in] input_output_map - input-output map of the look-up operation.
+   * \param[in] i_map - input-output mapping index of the MLP.
+   * \param[in] sums - partial sums of the MLP.
+   * \param[in] grid_index - coordinate index along each call input axis.
+   * \param[out] outputs - output values per call output variable.
+   * \param[in] iPoint - grid point index.
+   */
+  void EvaluateGridPoint(const MLPToolbox::CIOMap *input_output_map,
+                         std::size_t i_map, CGridPartialSums &sums,
+                         const std::vector<std::size_t> &grid_index,
+                         std::vector<std::vector<mlpdouble>> &outputs,
+                         std::size_t iPoint) {
+    auto i_ANN = input_output_map->GetMLPIndex(i_map);
+    auto nLevels = sums.inputs.size();
+    for (auto iLevel = sums.n_valid; iLevel < nLevels; iLevel++) {
+      auto iCoord = grid_index[sums.input_axes[iLevel]];
+      const std::vector<mlpdouble> &previous = sums.levels[iLevel],
+                                   &contribution =
+                                       sums.contributions[iLevel][iCoord];
+      std::vector<mlpdouble> &level = sums.levels[iLevel + 1];
+      for (auto iNeuron = 0u; iNeuron < level.size(); iNeuron++)
+        level[iNeuron] = previous[iNeuron] + contribution[iNeuron];
+    }
+    sums.n_valid = nLevels;
+    NeuralNetworks[i_ANN].PredictFromFirstLayer(
+        sums.levels[nLevels], input_output_map->GetOutputLayer(i_map));
+    for (auto i = 0u; i < input_output_map->GetNMappedOutputs(i_map); i++) {
+      outputs[input_output_map->GetOutputIndex(i_map, i)][iPoint] =
+          NeuralNetworks[i_ANN].GetANNOutput(
+              input_output_map->GetMLPOutputIndex(i_map, i));
+    }
+  }
+
+public:
   /*!
    * \brief Pair inputs and outputs with look-up operations.
    * \param[in] ioMap - input-output map to pair variables with.
@@ -353,6 +2137,173 @@ public:
 
     CheckUseOfInputs(ioMap);
     CheckUseOfOutputs(ioMap);
+
+    if (use_gating_network)
+      PairGatingNetwork(ioMap);
+
+    /* In lazy mode, loading is deferred to the first evaluation. */
+    if (lazy_loading)
+      ioMap.SetGeneration(0);
+    else
+      WarmUp(&ioMap);
+  }
+
+  /*!
+   * \brief Pair the gating network with a look-up operation. The gating network
+   * is only used when all of its inputs are call inputs. Experts are only
+   * selectable when they provide all call outputs.
+   * \param[in] ioMap - input-output map of the look-up operation.
+   */
+  void PairGatingNetwork(MLPToolbox::CIOMap &ioMap) const {
+    auto inputVariables = ioMap.GetInputVars();
+    auto outputVariables = ioMap.GetOutputVars();
+
+    std::vector<std::size_t> gating_inputs(GatingNetwork.GetnInputs());
+    for (auto iInput = 0u; iInput < GatingNetwork.GetnInputs(); iInput++) {
+      auto it = std::find(inputVariables.begin(), inputVariables.end(),
+                          GatingNetwork.GetInputName(iInput));
+      if (it == inputVariables.end())
+        return;
+      gating_inputs[iInput] = it - inputVariables.begin();
+    }
+
+    std::vector<int> gating_maps(NeuralNetworks.size(), -1);
+    for (auto i_map = 0u; i_map < ioMap.GetNMLPs(); i_map++) {
+      if (ioMap.GetNMappedOutputs(i_map) == outputVariables.size())
+        gating_maps[ioMap.GetMLPIndex(i_map)] = i_map;
+    }
+    ioMap.SetGatingNetworkMapping(gating_inputs, gating_maps);
+  }
+
+  /*!
+   * \brief Bind call input variables of a look-up operation to fixed values.
+   * The contribution of the bound inputs to the first hidden layer of every
+   * paired MLP is computed once and folded into an effective bias, such that
+   * subsequent look-ups only evaluate the first weight layer over the free
+   * inputs.
+   * \param[in] ioMap - input-output map of the look-up operation.
+   * \param[in] input_names - names of the call inputs to bind.
+   * \param[in] values - fixed values of the call inputs.
+   */
+  void BindInputs(MLPToolbox::CIOMap &ioMap,
+                  const std::vector<std::string> &input_names,
+                  const std::vector<mlpdouble> &values) {
+    auto inputVariables = ioMap.GetInputVars();
+    for (auto iVar = 0u; iVar < input_names.size(); iVar++) {
+      bool found_input{false};
+      for (auto iInput = 0u; iInput < inputVariables.size(); iInput++) {
+        if (input_names[iVar].compare(inputVariables[iInput]) == 0) {
+          ioMap.BindInput(iInput, values[iVar]);
+          found_input = true;
+        }
+      }
+      if (!found_input)
+        throw std::invalid_argument("Input " + input_names[iVar] +
+                                    " is not a call input of the look-up "
+                                    "operation.");
+    }
+    if ((ioMap.GetNMLPs() > 0) && (ioMap.GetGeneration() == generation))
+      ReduceFirstLayers(ioMap);
+  }
+
+  /*!
+   * \brief Release all bound call inputs of a look-up operation.
+   * \param[in] ioMap - input-output map of the look-up operation.
+   */
+  void UnbindInputs(MLPToolbox::CIOMap &ioMap) const { ioMap.UnbindInputs(); }
+
+  /*!
+   * \brief Compute the reduced first weight layers of the MLPs paired with a
+   * look-up operation for the currently bound call inputs.
+   * \param[in] ioMap - input-output map of the look-up operation.
+   */
+  void ReduceFirstLayers(MLPToolbox::CIOMap &ioMap) const {
+    std::vector<CReducedLayer> first_layers(ioMap.GetNMLPs());
+    std::vector<bool> is_bound;
+    std::vector<mlpdouble> bound_values;
+    for (auto i_map = 0u; i_map < ioMap.GetNMLPs(); i_map++) {
+      ioMap.GetMLPBoundInputs(i_map, is_bound, bound_values);
+      NeuralNetworks[ioMap.GetMLPIndex(i_map)].ReduceFirstLayer(
+          is_bound, bound_values, first_layers[i_map]);
+    }
+    ioMap.SetFirstLayers(first_layers);
+  }
+
+  /*!
+   * \brief Restrict the output layers of the MLPs paired with a look-up
+   * operation to the outputs used by the input-output map, such that unused
+   * outputs are neither evaluated nor de-normalized.
+   * \param[in] ioMap - input-output map of the look-up operation.
+   */
+  void ReduceOutputLayers(MLPToolbox::CIOMap &ioMap) const {
+    std::vector<CReducedLayer> output_layers(ioMap.GetNMLPs());
+    for (auto i_map = 0u; i_map < ioMap.GetNMLPs(); i_map++) {
+      auto i_ANN = ioMap.GetMLPIndex(i_map);
+      std::vector<bool> is_used(NeuralNetworks[i_ANN].GetnOutputs(), false);
+      for (auto iOutput = 0u; iOutput < ioMap.GetNMappedOutputs(i_map);
+           iOutput++)
+        is_used[ioMap.GetMLPOutputIndex(i_map, iOutput)] = true;
+
+      std::vector<std::size_t> used_outputs;
+      for (auto iOutput = 0u; iOutput < is_used.size(); iOutput++)
+        if (is_used[iOutput])
+          used_outputs.push_back(iOutput);
+
+      /* Leave the reduced layer empty if all outputs are used. */
+      if (used_outputs.size() < is_used.size())
+        NeuralNetworks[i_ANN].ReduceOutputLayer(used_outputs,
+                                                output_layers[i_map]);
+    }
+    ioMap.SetOutputLayers(output_layers);
+  }
+
+  /*!
+   * \brief Set the number of activation regions cached per MLP. For MLPs with
+   * only linear and relu activation functions, queries falling within a
+   * recently visited activation region are evaluated through the collapsed
+   * affine map of that region. Other MLPs are not affected.
+   * \param[in] n_regions - Maximum number of cached regions per MLP (0
+   * disables the cache).
+   */
+  void SetRegionCacheSize(std::size_t n_regions) {
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      NeuralNetworks[i_MLP].SetRegionCacheSize(n_regions);
+  }
+
+  /*!
+   * \brief Split the neurons of wide layers over the threads of the
+   * process-wide thread pool (see CThreadPool) to reduce the latency of single
+   * queries and small batches. A layer is evaluated in parallel, including its
+   * derivatives, when its number of neurons times the number of evaluated
+   * points reaches the threshold; narrower layers are evaluated serially, as
+   * the synchronization between layers would outweigh the gain.
+   * \param[in] threshold - Minimum layer width times number of points (0
+   * disables parallel evaluation).
+   */
+  void SetLayerParallelism(std::size_t threshold) {
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      NeuralNetworks[i_MLP].SetParallelThreshold(threshold);
+  }
+
+  /*!
+   * \brief Give the threads of parallel batch evaluations (see
+   * PredictANNParallel) a copy of the network weights on their own NUMA node,
+   * one per node, instead of sharing the weights of this collection. This
+   * takes effect while the workers of the thread pool are pinned through
+   * CThreadPool::SetPinning, and costs one copy of the weights per node.
+   * \param[in] replicate - Replicate the weights per NUMA node.
+   */
+  void SetNUMAReplication(bool replicate) { numa_replication = replicate; }
+
+  /*!
+   * \brief Get the number of MLP evaluations served from the region caches.
+   * \returns Number of region cache hits over all MLPs.
+   */
+  unsigned long GetNRegionCacheHits() const {
+    unsigned long n_hits = 0;
+    for (auto i_MLP = 0u; i_MLP < NeuralNetworks.size(); i_MLP++)
+      n_hits += NeuralNetworks[i_MLP].GetNRegionCacheHits();
+    return n_hits;
   }
 
   /*!
@@ -0,0 +1,398 @@
+/*!
+* \file CMLPCodeGenerator.hpp
+* \brief Generation of C++ evaluation code from MLP input files.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CModelCache.hpp"
+#include "CReadNeuralNetwork.hpp"
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CMLPCodeGenerator {
+  /*!
+   *\class CMLPCodeGenerator
+   *\brief Translates an MLP input file into a self-contained C++ header. The
+   *header holds the weights, biases and normalization values as constexpr
+   *arrays and evaluation functions in which every layer is written out as
+   *straight-line code with the activation functions inlined, for the network
+   *outputs and for their first and second order derivatives. Including the
+   *header registers the evaluation function with CCompiledMLPRegistry under
+   *the content hash of the input file, after which CLookUp_ANN uses it for
+   *that file instead of the interpreted network.
+   */
+private:
+  std::string mlp_filename; /*!< MLP input file name. */
+  CReadNeuralNetwork Reader; /*!< Reader of the MLP input file. */
+  std::size_t n_layers{0}, /*!< Total number of network layers. */
+      n_inputs{0};         /*!< Number of network inputs. */
+  std::vector<mlpdouble> input_offset, /*!< Input normalization offsets. */
+      input_scale,                     /*!< Input normalization scales. */
+      output_offset,                   /*!< Output normalization offsets. */
+      output_scale;                    /*!< Output normalization scales. */
+
+  /*!
+   * \brief Write a floating point value such that it is read back exactly.
+   * \param[in] value - Value to write.
+   * \returns Value literal.
+   */
+  static std::string Literal(mlpdouble value) {
+    std::ostringstream literal;
+    literal << std::setprecision(std::numeric_limits<mlpdouble>::max_digits10)
+            << std::scientific << value;
+    return literal.str();
+  }
+
+  /*!
+   * \brief Write a constexpr array of values.
+   * \param[in] code - Output stream.
+   * \param[in] name - Array name.
+   * \param[in] values - Array values.
+   */
+  static void WriteArray(std::ostream &code, const std::string &name,
+                         const std::vector<mlpdouble> &values) {
+    code << "alignas(64) constexpr mlpdouble " << name << "[" << values.size()
+         << "] = {";
+    for (auto iValue = 0u; iValue < values.size(); iValue++)
+      code << (iValue > 0 ? ",\n    " : "\n    ") << Literal(values[iValue]);
+    code << "};\n";
+  }
+
+  /*!
+   * \brief Write the evaluation of the activation function of a layer. The
+   * expressions are those of CNeuralNetwork::ActivationFunction, applied to
+   * the activation function input "z". They define "phi" and, depending on the
+   * derivative order, "dphi" and "d2phi".
+   * \param[in] code - Output stream.
+   * \param[in] iLayer - Layer index.
+   * \param[in] order - Derivative order (0, 1 or 2).
+   */
+  void WriteActivationFunction(std::ostream &code, std::size_t iLayer,
+                               unsigned short order) const {
+    const std::string name = Reader.GetActivationFunction(iLayer);
+    std::string phi, dphi, d2phi, exp_z;
+    if (name == "linear") {
+      phi = "z";
+      dphi = "1.0";
+      d2phi = "0.0";
+    } else if (name == "relu") {
+      phi = "(z > 0) ? z : 0.0";
+      dphi = "(z > 0) ? 1.0 : 0.0";
+      d2phi = "0.0";
+    } else if (name == "elu") {
+      exp_z = "std::exp(z)";
+      phi = "(z > 0) ? z : exp_z - 1";
+      dphi = "(z > 0) ? 1.0 : exp_z";
+      d2phi = "(z > 0) ? 0.0 : exp_z";
+    } else if (name == "exponential") {
+      phi = "std::exp(z)";
+      dphi = "phi";
+      d2phi = "phi";
+    } else if (name == "swish") {
+      exp_z = "std::exp(z)";
+      phi = "z / (1 + std::exp(-z))";
+      dphi = "exp_z * (z + exp_z + 1) / std::pow(exp_z + 1, 2)";
+      d2phi = "exp_z * (-exp_z * (z - 2) + z + 2) / std::pow(exp_z + 1, 3)";
+    } else if (name == "tanh") {
+      phi = "std::tanh(z)";
+      dphi = "1 / std::pow(std::cosh(z), 2)";
+      d2phi = "-2 * phi * 1 / (std::pow(std::cosh(z), 2))";
+    } else if (name == "sigmoid") {
+      exp_z = "std::exp(-z)";
+      phi = "1.0 / (1 + exp_z)";
+      dphi = "exp_z / std::pow(exp_z + 1, 2)";
+      d2phi = "-(std::exp(z) * (std::exp(z) - 1)) / std::pow(std::exp(z) + 1, "
+              "3)";
+    } else if (name == "selu") {
+      exp_z = "std::exp(z)";
+      phi = "(z > 0) ? 1.05070098 * z : 1.05070098 * 1.67326324 * (exp_z - 1)";
+      dphi = "(z > 0) ? 1.05070098 : phi + 1.05070098 * 1.67326324";
+      d2phi = "(z > 0) ? 0.0 : dphi";
+    } else if (name == "gelu") {
+      exp_z = "0.3989422804014327 * std::exp(-0.5 * z * z)";
+      phi = "0.5 * z * (1 + std::erf(z / std::sqrt(2)))";
+      dphi = "0.5 * (1 + std::erf(z / std::sqrt(2))) + z * exp_z";
+      d2phi = "(2 - z * z) * exp_z";
+    } else if (name == "none") {
+      phi = "0.0";
+      dphi = "0.0";
+      d2phi = "0.0";
+    } else {
+      throw std::invalid_argument("Activation function " + name +
+                                  " is not supported by the code generator.");
+    }
+
+    /* Some activation functions only use the exponential for derivatives. */
+    if (!exp_z.empty() &&
+        ((phi.find("exp_z") != std::string::npos) || (order > 0)))
+      code << "    const mlpdouble exp_z = " << exp_z << ";\n";
+    code << "    const mlpdouble phi = " << phi << ";\n";
+    if (order > 0)
+      code << "    const mlpdouble dphi = " << dphi << ";\n";
+    if (order > 1)
+      code << "    const mlpdouble d2phi = " << d2phi << ";\n";
+  }
+
+  /*!
+   * \brief Write an evaluation function of the network.
+   * \param[in] code - Output stream.
+   * \param[in] order - Derivative order (0, 1 or 2).
+   */
+  void WriteEvaluation(std::ostream &code, unsigned short order) const {
+    const std::string function_names[] = {"EvaluateOutputs",
+                                          "EvaluateGradient",
+                                          "EvaluateHessian"};
+    code << "static inline void " << function_names[order]
+         << "(const mlpdouble *inputs, mlpdouble *outputs";
+    if (order > 0)
+      code << ", mlpdouble *doutputs_dinputs";
+    if (order > 1)
+      code << ", mlpdouble *d2outputs_dinputs2";
+    code << ") {\n";
+
+    /* Input layer: normalization of the network inputs. */
+    code << "  mlpdouble y0[" << n_inputs << "];\n";
+    for (auto iInput = 0u; iInput < n_inputs; iInput++)
+      code << "  y0[" << iInput << "] = (inputs[" << iInput
+           << "] - INPUT_OFFSET[" << iInput << "]) / INPUT_SCALE[" << iInput
+           << "];\n";
+
+    for (auto iLayer = 1u; iLayer < n_layers; iLayer++) {
+      const std::size_t nNeurons = Reader.GetNneurons(iLayer),
+                        nPrevious = Reader.GetNneurons(iLayer - 1);
+      const std::string y = "y" + std::to_string(iLayer),
+                        y_prev = "y" + std::to_string(iLayer - 1),
+                        dy = "dy" + std::to_string(iLayer),
+                        dy_prev = "dy" + std::to_string(iLayer - 1),
+                        d2y = "d2y" + std::to_string(iLayer),
+                        d2y_prev = "d2y" + std::to_string(iLayer - 1),
+                        W = "W" + std::to_string(iLayer),
+                        B = "B" + std::to_string(iLayer);
+
+      code << "\n  /* Layer " << iLayer << " (" << nNeurons << " neurons, "
+           << Reader.GetActivationFunction(iLayer) << "). */\n";
+      code << "  mlpdouble " << y << "[" << nNeurons << "]";
+      if (order > 0)
+        code << ", " << dy << "[" << nNeurons << "][" << n_inputs << "]";
+      if (order > 1)
+        code << ", " << d2y << "[" << nNeurons << "][" << n_inputs << "]["
+             << n_inputs << "]";
+      code << ";\n";
+
+      for (auto iNeuron = 0u; iNeuron < nNeurons; iNeuron++) {
+        const std::string w =
+            W + "[" + std::to_string(iNeuron) + "]";
+        code << "  {\n    const mlpdouble z = " << B << "[" << iNeuron << "]";
+        for (auto jNeuron = 0u; jNeuron < nPrevious; jNeuron++)
+          code << " + " << w << "[" << jNeuron << "] * " << y_prev << "["
+               << jNeuron << "]";
+        code << ";\n";
+        WriteActivationFunction(code, iLayer, order);
+        code << "    " << y << "[" << iNeuron << "] = phi;\n";
+        if (order == 0) {
+          code << "  }\n";
+          continue;
+        }
+
+        /* Weighted sums of the derivatives of the previous layer. The input
+         * layer derivatives are diagonal, which leaves a single term. */
+        for (auto jInput = 0u; jInput < n_inputs; jInput++) {
+          code << "    const mlpdouble psi_" << jInput << " = ";
+          if (iLayer == 1) {
+            code << w << "[" << jInput << "] * (1 / INPUT_SCALE[" << jInput
+                 << "])";
+          } else {
+            code << "0";
+            for (auto kNeuron = 0u; kNeuron < nPrevious; kNeuron++)
+              code << " + " << w << "[" << kNeuron << "] * " << dy_prev << "["
+                   << kNeuron << "][" << jInput << "]";
+          }
+          code << ";\n";
+        }
+        for (auto jInput = 0u; jInput < n_inputs; jInput++)
+          code << "    " << dy << "[" << iNeuron << "][" << jInput
+               << "] = psi_" << jInput << " * dphi;\n";
+
+        if (order > 1) {
+          /* The second derivatives are symmetric in the inputs. */
+          for (auto jInput = 0u; jInput < n_inputs; jInput++) {
+            for (auto kInput = jInput; kInput < n_inputs; kInput++) {
+              code << "    " << d2y << "[" << iNeuron << "][" << jInput << "]["
+                   << kInput << "] = d2phi * psi_" << jInput << " * psi_"
+                   << kInput;
+              if (iLayer > 1) {
+                code << " + dphi * (0";
+                for (auto kNeuron = 0u; kNeuron < nPrevious; kNeuron++)
+                  code << " + " << w << "[" << kNeuron << "] * " << d2y_prev
+                       << "[" << kNeuron << "][" << jInput << "][" << kInput
+                       << "]";
+                code << ")";
+              }
+              code << ";\n";
+              if (kInput > jInput)
+                code << "    " << d2y << "[" << iNeuron << "][" << kInput
+                     << "][" << jInput << "] = " << d2y << "[" << iNeuron
+                     << "][" << jInput << "][" << kInput << "];\n";
+            }
+          }
+        }
+        code << "  }\n";
+      }
+    }
+
+    /* Output layer: de-normalization of the network outputs. */
+    const std::string y_out = "y" + std::to_string(n_layers - 1),
+                      dy_out = "dy" + std::to_string(n_layers - 1),
+                      d2y_out = "d2y" + std::to_string(n_layers - 1);
+    code << "\n";
+    for (auto iOutput = 0u; iOutput < output_scale.size(); iOutput++) {
+      code << "  outputs[" << iOutput << "] = OUTPUT_SCALE[" << iOutput
+           << "] * " << y_out << "[" << iOutput << "] + OUTPUT_OFFSET["
+           << iOutput << "];\n";
+      for (auto jInput = 0u; (order > 0) && (jInput < n_inputs); jInput++) {
+        code << "  doutputs_dinputs[" << iOutput * n_inputs + jInput
+             << "] = OUTPUT_SCALE[" << iOutput << "] * " << dy_out << "["
+             << iOutput << "][" << jInput << "];\n";
+        for (auto kInput = 0u; (order > 1) && (kInput < n_inputs); kInput++)
+          code << "  d2outputs_dinputs2["
+               << (iOutput * n_inputs + jInput) * n_inputs + kInput
+               << "] = OUTPUT_SCALE[" << iOutput << "] * " << d2y_out << "["
+               << iOutput << "][" << jInput << "][" << kInput << "];\n";
+      }
+    }
+    code << "}\n\n";
+  }
+
+public:
+  /*!
+   * \brief Read the MLP input file to generate code for.
+   * \param[in] filename - MLP input file name.
+   */
+  CMLPCodeGenerator(const std::string &filename)
+      : mlp_filename(filename), Reader(filename) {
+    Reader.ReadMLPFile();
+    n_layers = Reader.GetNlayers();
+    n_inputs = Reader.GetNInputs();
+
+    /* Normalization as applied by CNeuralNetwork, which uses the input
+     * regularization method for the inputs and outputs alike. */
+    const bool minmax =
+        (Reader.GetInputRegularization() == ENUM_SCALING_FUNCTIONS::MINMAX);
+    for (auto iInput = 0u; iInput < n_inputs; iInput++) {
+      auto norm = Reader.GetInputNorm(iInput);
+      input_offset.push_back(norm.first);
+      input_scale.push_back(minmax ? norm.second - norm.first : norm.second);
+    }
+    for (auto iOutput = 0u; iOutput < Reader.GetNOutputs(); iOutput++) {
+      auto norm = Reader.GetOutputNorm(iOutput);
+      output_offset.push_back(norm.first);
+      output_scale.push_back(minmax ? norm.second - norm.first : norm.second);
+    }
+  }
+
+  /*!
+   * \brief Write the generated code to a header file.
+   * \param[in] header_filename - Name of the header file to write.
+   * \param[in] name - Name of the namespace holding the generated code.
+   */
+  void WriteHeader(const std::string &header_filename,
+                   const std::string &name) const {
+    std::ofstream code(header_filename.c_str());
+    if (!code.is_open())
+      throw std::invalid_argument("Unable to open " + header_filename +
+                                  " for writing.");
+
+    code << "/* Generated by MLPCodeGen from " << mlp_filename
+         << ". Do not edit. */\n"
+         << "#pragma once\n\n"
+         << "#include <cmath>\n#include <cstdint>\n\n"
+         << "#include \"CCompiledMLPRegistry.hpp\"\n"
+         << "#include \"variable_def.hpp\"\n\n"
+         << "namespace MLPToolbox {\nnamespace Compiled {\nnamespace " << name
+         << " {\n\n";
+
+    code << "constexpr std::uint64_t CONTENT_HASH = 0x" << std::hex
+         << CModelCache::HashFile(mlp_filename) << std::dec << "ull;\n";
+    code << "constexpr std::size_t N_INPUTS = " << n_inputs
+         << ", N_OUTPUTS = " << output_scale.size() << ";\n\n";
+    WriteArray(code, "INPUT_OFFSET", input_offset);
+    WriteArray(code, "INPUT_SCALE", input_scale);
+    WriteArray(code, "OUTPUT_OFFSET", output_offset);
+    WriteArray(code, "OUTPUT_SCALE", output_scale);
+
+    /* Weights [neuron][previous layer neuron] and biases per layer. */
+    for (auto iLayer = 1u; iLayer < n_layers; iLayer++) {
+      const std::size_t nNeurons = Reader.GetNneurons(iLayer),
+                        nPrevious = Reader.GetNneurons(iLayer - 1);
+      code << "alignas(64) constexpr mlpdouble W" << iLayer << "[" << nNeurons
+           << "][" << nPrevious << "] = {";
+      for (auto iNeuron = 0u; iNeuron < nNeurons; iNeuron++) {
+        code << (iNeuron > 0 ? ",\n    {" : "\n    {");
+        for (auto jNeuron = 0u; jNeuron < nPrevious; jNeuron++)
+          code << (jNeuron > 0 ? ", " : "")
+               << Literal(Reader.GetWeight(iLayer - 1, jNeuron, iNeuron));
+        code << "}";
+      }
+      code << "};\n";
+      std::vector<mlpdouble> biases(nNeurons);
+      for (auto iNeuron = 0u; iNeuron < nNeurons; iNeuron++)
+        biases[iNeuron] = Reader.GetBias(iLayer, iNeuron);
+      WriteArray(code, "B" + std::to_string(iLayer), biases);
+    }
+    code << "\n";
+
+    for (unsigned short order = 0; order < 3; order++)
+      WriteEvaluation(code, order);
+
+    code << "static inline void Evaluate(const mlpdouble *inputs, mlpdouble "
+            "*outputs,\n"
+            "                            mlpdouble *doutputs_dinputs,\n"
+            "                            mlpdouble *d2outputs_dinputs2) {\n"
+            "  if (d2outputs_dinputs2 != nullptr)\n"
+            "    EvaluateHessian(inputs, outputs, doutputs_dinputs, "
+            "d2outputs_dinputs2);\n"
+            "  else if (doutputs_dinputs != nullptr)\n"
+            "    EvaluateGradient(inputs, outputs, doutputs_dinputs);\n"
+            "  else\n"
+            "    EvaluateOutputs(inputs, outputs);\n"
+            "}\n\n"
+            "static const CCompiledMLPRegistry::Registration\n"
+            "    registration(CONTENT_HASH, N_INPUTS, N_OUTPUTS, Evaluate);\n\n"
+            "} // namespace "
+         << name << "\n} // namespace Compiled\n} // namespace MLPToolbox\n";
+  }
+};
+} // namespace MLPToolbox
@@ -0,0 +1,282 @@
+/*!
+* \file CModelCache.hpp
+* \brief Process-wide cache of loaded multi-layer perceptrons.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "CNeuralNetwork.hpp"
+#include "CSharedWeights.hpp"
+
+namespace MLPToolbox {
+class CModelCache {
+  /*!
+   *\class CModelCache
+   *\brief Process-wide registry of loaded multi-layer perceptrons. Networks are
+   *identified by their input file name and a hash of the file content, such
+   *that a file is only parsed once for as long as any look-up class uses it.
+   *The cached networks are never modified; look-up classes define their own
+   *networks from them through CNeuralNetwork::ShareArchitecture, which shares
+   *the weights while keeping the evaluation data separate. Entries expire when
+   *the last look-up class referring to them is destroyed. Optionally, the
+   *weights are shared between processes through CSharedWeights.
+   */
+private:
+  std::mutex cache_mutex; /*!< Guards the registry. */
+  std::map<std::string, std::weak_ptr<const CNeuralNetwork>>
+      networks; /*!< Loaded networks per file name and content hash. */
+  bool use_shared_memory{false}; /*!< Share weights between processes. */
+
+  std::map<std::string, std::shared_ptr<const CNeuralNetwork>>
+      published; /*!< Latest reloaded version of each network file. */
+  std::atomic<unsigned long> reload_epoch{0}; /*!< Number of reloads. */
+
+  CModelCache() = default;
+
+  /*!
+   * \brief Get a network from the registry, loading it if it is not present.
+   * The file is parsed without holding the cache mutex.
+   * \param[in] filename - MLP input file name.
+   * \param[in] content_hash - Hash of the file content.
+   * \param[in] generate - function defining a network from an input file.
+   * \param[in] check_content - Only load the file if its content still has
+   * the given hash.
+   * \returns Shared pointer to the cached network.
+   */
+  std::shared_ptr<const CNeuralNetwork>
+  FindOrLoad(const std::string &filename, std::uint64_t content_hash,
+             const std::function<void(CNeuralNetwork &, const std::string &)>
+                 &generate,
+             bool check_content = false) {
+    std::ostringstream key;
+    key << filename << "#" << std::hex << content_hash;
+
+    bool share_memory;
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      auto network = networks[key.str()].lock();
+      if (network)
+        return network;
+      share_memory = use_shared_memory;
+    }
+
+    if (check_content && (HashFile(filename) != content_hash))
+      throw std::invalid_argument("MLP file " + filename +
+                                  " changed since its header was read");
+    auto new_network = std::make_shared<CNeuralNetwork>();
+    generate(*new_network, filename);
+    if (share_memory) {
+      auto shared_weights = CSharedWeights::Share(
+          content_hash, new_network->GetWeights().GetData(),
+          new_network->GetWeights().GetNWeights());
+      if (shared_weights)
+        new_network->SetExternalWeights(shared_weights);
+    }
+
+    /* Another thread may have loaded the same network in the meantime. */
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::shared_ptr<const CNeuralNetwork> network = networks[key.str()].lock();
+    if (!network) {
+      network = new_network;
+      networks[key.str()] = network;
+    }
+    return network;
+  }
+
+public:
+  CModelCache(const CModelCache &) = delete;
+  CModelCache &operator=(const CModelCache &) = delete;
+
+  /*!
+   * \brief Compute the hash of the content of a network input file. The
+   * 64-bit FNV-1a hash is used, which is identical across processes.
+   * \param[in] filename - MLP input file name.
+   * \returns Content hash.
+   */
+  static std::uint64_t HashFile(const std::string &filename) {
+    std::ifstream file_stream(filename.c_str(), std::ifstream::binary);
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::istreambuf_iterator<char> it(file_stream), end; it != end;
+         ++it) {
+      hash ^= static_cast<unsigned char>(*it);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  /*!
+   * \brief Get the process-wide model cache.
+   * \returns Reference to the model cache.
+   */
+  static CModelCache &GetInstance() {
+    static CModelCache instance;
+    return instance;
+  }
+
+  /*!
+   * \brief Get the network loaded from an input file, loading it if it is not
+   * in the cache.
+   * \param[in] filename - MLP input file name.
+   * \param[in] generate - function defining a network from an input file.
+   * \returns Shared pointer to the cached network.
+   */
+  std::shared_ptr<const CNeuralNetwork>
+  GetNetwork(const std::string &filename,
+             const std::function<void(CNeuralNetwork &, const std::string &)>
+                 &generate) {
+    return FindOrLoad(filename, HashFile(filename), generate);
+  }
+
+  /*!
+   * \brief Get the network loaded from a specific version of an input file.
+   * If this version is not in the cache, the file is only loaded if its
+   * content is still the same.
+   * \param[in] filename - MLP input file name.
+   * \param[in] content_hash - Hash of the file content, see HashFile.
+   * \param[in] generate - function defining a network from an input file.
+   * \returns Shared pointer to the cached network.
+   */
+  std::shared_ptr<const CNeuralNetwork>
+  GetNetwork(const std::string &filename, std::uint64_t content_hash,
+             const std::function<void(CNeuralNetwork &, const std::string &)>
+                 &generate) {
+    return FindOrLoad(filename, content_hash, generate, true);
+  }
+
+  /*!
+   * \brief Load the current content of a network input file as a new version
+   * of the network and publish it to all look-up classes using the file. The
+   * look-up classes switch to the new version at the start of their next
+   * evaluation; the previous version is released once none of them uses it
+   * anymore. This method may be called from a background thread.
+   * \param[in] filename - MLP input file name.
+   * \param[in] generate - function defining a network from an input file.
+   * \param[in] check - function called with the current and the new version
+   * of the network before publishing, which throws to reject the new version.
+   * The check is skipped if no version of the file is in use.
+   */
+  void Reload(const std::string &filename,
+              const std::function<void(CNeuralNetwork &, const std::string &)>
+                  &generate,
+              const std::function<void(const CNeuralNetwork &,
+                                       const CNeuralNetwork &)> &check) {
+    auto network = FindOrLoad(filename, HashFile(filename), generate);
+    auto current = GetCurrentNetwork(filename);
+    if (current && (current != network))
+      check(*current, *network);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    published[filename] = network;
+    reload_epoch.fetch_add(1, std::memory_order_release);
+  }
+
+  /*!
+   * \brief Get the version of a network file currently in use: the latest
+   * reloaded version, or otherwise any loaded version of the file.
+   * \param[in] filename - MLP input file name.
+   * \returns Shared pointer to the network, nullptr if no version is in use.
+   */
+  std::shared_ptr<const CNeuralNetwork>
+  GetCurrentNetwork(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = published.find(filename);
+    if (it != published.end())
+      return it->second;
+    const std::string prefix = filename + "#";
+    for (auto entry = networks.lower_bound(prefix);
+         (entry != networks.end()) &&
+         (entry->first.compare(0, prefix.size(), prefix) == 0);
+         ++entry) {
+      auto network = entry->second.lock();
+      if (network)
+        return network;
+    }
+    return nullptr;
+  }
+
+  /*!
+   * \brief Get the number of reloads published so far. Look-up classes compare
+   * this value against the last epoch they applied, which only requires a
+   * single atomic load when no reload is pending.
+   * \returns Reload epoch.
+   */
+  unsigned long GetReloadEpoch() const {
+    return reload_epoch.load(std::memory_order_acquire);
+  }
+
+  /*!
+   * \brief Get the latest reloaded version of a network file.
+   * \param[in] filename - MLP input file name.
+   * \returns Shared pointer to the network, nullptr if the file was never
+   * reloaded.
+   */
+  std::shared_ptr<const CNeuralNetwork>
+  GetPublishedNetwork(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = published.find(filename);
+    return (it == published.end()) ? nullptr : it->second;
+  }
+
+  /*!
+   * \brief Enable sharing of network weights between processes on the same
+   * node. Networks loaded afterwards publish their weights in a named POSIX
+   * shared memory segment, or map the segment read-only if another process
+   * already published the same network.
+   * \param[in] enable - Share weights between processes.
+   */
+  void SetSharedMemory(bool enable) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    use_shared_memory = enable;
+  }
+
+  /*!
+   * \brief Get the number of networks currently held in the cache.
+   * \returns Number of networks in use by at least one look-up class.
+   */
+  std::size_t GetNNetworks() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    for (auto it = networks.begin(); it != networks.end();) {
+      if (it->second.expired())
+        it = networks.erase(it);
+      else
+        ++it;
+    }
+    return networks.size();
+  }
+};
+
+} // namespace MLPToolbox
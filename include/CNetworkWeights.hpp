@@ -0,0 +1,175 @@
+/*!
+* \file CNetworkWeights.hpp
+* \brief Contiguous storage of the synapse weights of a network.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CNetworkWeights {
+  /*!
+   *\class CNetworkWeights
+   *\brief This class stores the synapse weights of all layers of a network in
+   *a single contiguous array, with the weights of every layer stored row by
+   *row ([layer][neuron][previous layer neuron]). The array is either owned by
+   *the class or provided externally, for example when the weights are mapped
+   *from a shared memory segment, in which case they are read-only.
+   */
+private:
+  std::vector<std::size_t> layer_offsets, /*!< Array offset of each layer. */
+      n_rows,                             /*!< Neuron count of each layer. */
+      n_columns; /*!< Neuron count of the previous layer of each layer. */
+  std::vector<mlpdouble> storage; /*!< Owned weight array. */
+  std::shared_ptr<const mlpdouble>
+      external_data; /*!< Externally provided weight array. */
+
+public:
+  /*!
+   * \brief Size the weight array and reset all weights to zero.
+   * \param[in] layer_sizes - Neuron count of every network layer, including
+   * the input and output layer.
+   */
+  void SetSize(const std::vector<std::size_t> &layer_sizes) {
+    std::size_t n_layers = layer_sizes.size() - 1;
+    layer_offsets.resize(n_layers);
+    n_rows.resize(n_layers);
+    n_columns.resize(n_layers);
+    std::size_t n_weights = 0;
+    for (auto iLayer = 0u; iLayer < n_layers; iLayer++) {
+      layer_offsets[iLayer] = n_weights;
+      n_rows[iLayer] = layer_sizes[iLayer + 1];
+      n_columns[iLayer] = layer_sizes[iLayer];
+      n_weights += n_rows[iLayer] * n_columns[iLayer];
+    }
+    storage.assign(n_weights, 0.0);
+    external_data.reset();
+  }
+
+  /*!
+   * \brief Get the total number of weights.
+   * \returns Number of weights over all layers.
+   */
+  std::size_t GetNWeights() const {
+    return layer_offsets.empty() ? 0
+                                 : layer_offsets.back() +
+                                       n_rows.back() * n_columns.back();
+  }
+
+  /*!
+   * \brief Get the number of neurons of the previous layer of a weight layer.
+   * \param[in] iLayer - Weight layer index.
+   * \returns Row length of the weight layer.
+   */
+  std::size_t GetNColumns(std::size_t iLayer) const {
+    return n_columns[iLayer];
+  }
+
+  /*!
+   * \brief Get the contiguous weight array.
+   * \returns Pointer to the first weight.
+   */
+  const mlpdouble *GetData() const {
+    return external_data ? external_data.get() : storage.data();
+  }
+
+  /*!
+   * \brief Replace the weight array by an externally provided array of the
+   * same size. The owned array is released.
+   * \param[in] data - Shared pointer to the external weight array.
+   */
+  void SetExternalData(std::shared_ptr<const mlpdouble> data) {
+    external_data = data;
+    std::vector<mlpdouble>().swap(storage);
+  }
+
+  /*!
+   * \brief Define the weights as an owned copy of other weights. The copy is
+   * allocated and written by the calling thread, which places it on the NUMA
+   * node of that thread.
+   * \param[in] source - Weights to copy.
+   */
+  void CopyFrom(const CNetworkWeights &source) {
+    layer_offsets = source.layer_offsets;
+    n_rows = source.n_rows;
+    n_columns = source.n_columns;
+    storage.assign(source.GetData(), source.GetData() + source.GetNWeights());
+    external_data.reset();
+  }
+
+  /*!
+   * \brief Check whether the weights are provided externally.
+   * \returns Weights are stored outside of the class.
+   */
+  bool IsExternal() const { return external_data != nullptr; }
+
+  /*!
+   * \brief Get the weights connecting a neuron to the previous layer.
+   * \param[in] iLayer - Weight layer index.
+   * \param[in] iNeuron - Neuron index.
+   * \returns Pointer to the weight row of the neuron.
+   */
+  const mlpdouble *GetRow(std::size_t iLayer, std::size_t iNeuron) const {
+    return GetData() + layer_offsets[iLayer] + iNeuron * n_columns[iLayer];
+  }
+
+  /*!
+   * \brief Get a synapse weight.
+   * \param[in] iLayer - Weight layer index.
+   * \param[in] iNeuron - Neuron index.
+   * \param[in] jNeuron - Previous layer neuron index.
+   * \returns Weight value.
+   */
+  mlpdouble GetWeight(std::size_t iLayer, std::size_t iNeuron,
+                      std::size_t jNeuron) const {
+    return GetRow(iLayer, iNeuron)[jNeuron];
+  }
+
+  /*!
+   * \brief Set a synapse weight. External weights are first copied into the
+   * owned array.
+   * \param[in] iLayer - Weight layer index.
+   * \param[in] iNeuron - Neuron index.
+   * \param[in] jNeuron - Previous layer neuron index.
+   * \param[in] value - Weight value.
+   */
+  void SetWeight(std::size_t iLayer, std::size_t iNeuron, std::size_t jNeuron,
+                 mlpdouble value) {
+    if (external_data) {
+      storage.assign(external_data.get(), external_data.get() + GetNWeights());
+      external_data.reset();
+    }
+    storage[layer_offsets[iLayer] + iNeuron * n_columns[iLayer] + jNeuron] =
+        value;
+  }
+};
+
+} // namespace MLPToolbox
@@ -28,15 +28,25 @@
 */
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <memory>
 
+#include "CAffineRegion.hpp"
+#include "CCompiledMLPRegistry.hpp"
+#include "CComputeKernels.hpp"
 #include "CLayer.hpp"
+#include "CNetworkWeights.hpp"
+#include "CReducedLayer.hpp"
+#include "CSnapshotBuffer.hpp"
+#include "CThreadPool.hpp"
 #include "variable_def.hpp"
 
 namespace MLPToolbox {
@@ -66,23 +76,64 @@ private:
 
   // std::vector<su2activematrix> weights_mat; /*!< Weights of synapses
   // connecting layers */
-  std::vector<std::vector<std::vector<mlpdouble>>> weights_mat;
+  std::shared_ptr<CNetworkWeights>
+      weights_mat; /*!< Weights of synapses connecting layers, shared between
+                      networks loaded from the same file. */
 
   std::vector<std::pair<mlpdouble, mlpdouble>>
       input_norm,  /*!< Normalization factors for network inputs */
       output_norm; /*!< Normalization factors for network outputs */
 
-  mlpdouble *ANN_outputs; /*!< Pointer to network outputs */
+  mlpdouble *ANN_outputs = nullptr; /*!< Pointer to network outputs */
   std::vector<std::vector<mlpdouble>>
       dOutputs_dInputs; /*!< Network output derivatives w.r.t inputs */
   std::vector<std::vector<std::vector<mlpdouble>>> d2Outputs_dInputs2;
 
-  mlpdouble Phi,        /*!< Activation function output value. */
-            Phi_prime,  /*!< Activation function derivative w.r.t. input. */
-            Phi_dprime; /*!< Activation function second derivative w.r.t. input. */
-
   bool compute_gradient = false,        /*!< Evaluate network output gradients. */
        compute_second_gradient = false; /*!< Evaluate network output second order gradients. */
+
+  std::vector<mlpdouble>
+      X_first_layer, /*!< Activation function inputs of the first hidden layer
+                        of the last evaluation. */
+      last_inputs;   /*!< Dimensional network inputs of the last evaluation,
+                        empty if unknown. */
+
+  std::vector<CAffineRegion>
+      region_cache; /*!< Recently visited activation regions of a
+                       piecewise-linear network, most recent first. */
+  std::size_t region_cache_size{0}; /*!< Maximum number of cached regions. */
+  unsigned long region_cache_hits{0}; /*!< Number of evaluations served from
+                                         the region cache. */
+  std::vector<mlpdouble> region_inputs; /*!< Normalized network inputs of a
+                                           region cache look-up. */
+
+  CompiledEvaluation compiled_evaluation{
+      nullptr}; /*!< Ahead-of-time compiled evaluation function, if any. */
+  std::vector<mlpdouble>
+      compiled_gradient, /*!< Output derivatives of the compiled evaluation. */
+      compiled_hessian;  /*!< Output second derivatives of the compiled
+                            evaluation. */
+
+  const CComputeKernels *kernels{
+      &CComputeKernels::GetInstance()}; /*!< Dense kernels for the instruction
+                                           set of the processor. */
+  std::vector<mlpdouble>
+      X_layer, /*!< Activation function inputs of the current layer. */
+      reduced_inputs; /*!< Retained previous layer outputs of a reduced
+                         layer evaluation. */
+  std::vector<mlpdouble>
+      batch_Y,       /*!< Neuron outputs of the previous layer of a batched
+                        evaluation [neuron][point]. */
+      batch_X,       /*!< Activation function inputs of the current layer of
+                        a batched evaluation [neuron][point]. */
+      batch_outputs; /*!< Network outputs of the last batched evaluation
+                        [output][point]. */
+  std::size_t batch_size{0}; /*!< Number of points of the last batched
+                                evaluation. */
+  std::size_t parallel_threshold{0}; /*!< Minimum layer width times number of
+                                        points for which the layer neurons are
+                                        split over the thread pool, 0 to
+                                        evaluate serially. */
   /*!
    * \brief Available activation function enumeration.
    */
@@ -123,14 +174,38 @@ private:
   ENUM_SCALING_FUNCTIONS input_reg_method {ENUM_SCALING_FUNCTIONS::MINMAX},
                          output_reg_method {ENUM_SCALING_FUNCTIONS::MINMAX};
 public:
-  ~CNeuralNetwork() {
+  ~CNeuralNetwork() { Reset(); };
+
+  /*!
+   * \brief Release the layers, weights and evaluation data of the network, such
+   * that it can be defined anew. The region cache size setting is kept.
+   */
+  void Reset() {
     delete inputLayer;
     delete outputLayer;
-    for (std::size_t i = 1; i < total_layers.size() - 1; i++) {
-      delete total_layers[i];
+    for (std::size_t i = 0; i < hiddenLayers.size(); i++) {
+      delete hiddenLayers[i];
     }
     delete[] ANN_outputs;
-  };
+    inputLayer = outputLayer = nullptr;
+    ANN_outputs = nullptr;
+    hiddenLayers.clear();
+    total_layers.clear();
+    n_hidden_layers = 0;
+    weights_mat.reset();
+    input_names.clear();
+    output_names.clear();
+    input_norm.clear();
+    output_norm.clear();
+    activation_function_types.clear();
+    activation_function_names.clear();
+    dOutputs_dInputs.clear();
+    d2Outputs_dInputs2.clear();
+    X_first_layer.clear();
+    last_inputs.clear();
+    region_cache.clear();
+    compiled_evaluation = nullptr;
+  }
   /*!
    * \brief Set the input layer of the network.
    * \param[in] n_neurons - Number of inputs
@@ -176,9 +251,311 @@ public:
    */
   void SetWeight(unsigned long i_layer, unsigned long i_neuron,
                  unsigned long j_neuron, mlpdouble value) {
-    weights_mat[i_layer][j_neuron][i_neuron] = value;
+    /* Weights shared with other networks are copied before modification. */
+    if (weights_mat.use_count() > 1)
+      weights_mat = std::make_shared<CNetworkWeights>(*weights_mat);
+    weights_mat->SetWeight(i_layer, j_neuron, i_neuron, value);
   };
 
+  /*!
+   * \brief Define the network as a copy of another network, sharing its
+   * weights. Only the layers and evaluation data are allocated for this
+   * network, such that several look-ups can evaluate the same network
+   * independently without duplicating the weights.
+   * \param[in] source - network to copy.
+   */
+  void ShareArchitecture(const CNeuralNetwork &source) {
+    ShareHeader(source);
+    ShareWeights(source);
+  }
+
+  /*!
+   * \brief Define the layers, variable names, normalization and activation
+   * functions of the network as those of another network, without allocating
+   * the weights and evaluation data.
+   * \param[in] source - network to copy.
+   */
+  void ShareHeader(const CNeuralNetwork &source) {
+    SetInputRegularization(source.input_reg_method);
+    SetOutputRegularization(source.output_reg_method);
+
+    DefineInputLayer(source.inputLayer->GetNNeurons());
+    for (auto iLayer = 0u; iLayer < source.n_hidden_layers; iLayer++)
+      PushHiddenLayer(source.hiddenLayers[iLayer]->GetNNeurons());
+    DefineOutputLayer(source.outputLayer->GetNNeurons());
+    input_names = source.input_names;
+    output_names = source.output_names;
+    input_norm = source.input_norm;
+    output_norm = source.output_norm;
+
+    SizeActivationFunctions(source.activation_function_names.size());
+    for (auto iLayer = 0u; iLayer < source.activation_function_names.size();
+         iLayer++)
+      SetActivationFunction(iLayer, source.activation_function_names[iLayer]);
+  }
+
+  /*!
+   * \brief Share the weights of another network with the same header and
+   * allocate the evaluation data of this network.
+   * \param[in] source - network of which to share the weights.
+   */
+  void ShareWeights(const CNeuralNetwork &source) {
+    /* The header of this network must describe the shared weights. */
+    bool same_header = (n_hidden_layers == source.n_hidden_layers) &&
+                       (input_names == source.input_names) &&
+                       (output_names == source.output_names) &&
+                       (input_norm == source.input_norm) &&
+                       (output_norm == source.output_norm);
+    for (auto iLayer = 0u; same_header && (iLayer < n_hidden_layers); iLayer++)
+      same_header = (hiddenLayers[iLayer]->GetNNeurons() ==
+                     source.hiddenLayers[iLayer]->GetNNeurons());
+    if (!same_header)
+      throw std::invalid_argument(
+          "Shared network does not match the network header");
+
+    weights_mat = source.weights_mat;
+    compiled_evaluation = source.compiled_evaluation;
+    SizeWeights();
+
+    for (auto iLayer = 0u; iLayer < total_layers.size(); iLayer++) {
+      for (auto iNeuron = 0u; iNeuron < total_layers[iLayer]->GetNNeurons();
+           iNeuron++)
+        SetBias(iLayer, iNeuron, source.GetBias(iLayer, iNeuron));
+    }
+  }
+
+  /*!
+   * \brief Append the network to a snapshot, in its evaluation layout.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void WriteSnapshot(CSnapshotBuffer &snapshot) const {
+    snapshot.WriteSize(static_cast<std::uint64_t>(input_reg_method));
+    snapshot.WriteSize(static_cast<std::uint64_t>(output_reg_method));
+    snapshot.WriteSize(total_layers.size());
+    for (auto iLayer = 0u; iLayer < total_layers.size(); iLayer++)
+      snapshot.WriteSize(total_layers[iLayer]->GetNNeurons());
+    for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+      snapshot.WriteString(input_names[iInput]);
+      snapshot.WriteArray(&input_norm[iInput].first, 1);
+      snapshot.WriteArray(&input_norm[iInput].second, 1);
+    }
+    for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++) {
+      snapshot.WriteString(output_names[iOutput]);
+      snapshot.WriteArray(&output_norm[iOutput].first, 1);
+      snapshot.WriteArray(&output_norm[iOutput].second, 1);
+    }
+    for (auto iLayer = 0u; iLayer < total_layers.size(); iLayer++) {
+      snapshot.WriteString(activation_function_names[iLayer]);
+      std::vector<mlpdouble> biases(total_layers[iLayer]->GetNNeurons());
+      for (auto iNeuron = 0u; iNeuron < biases.size(); iNeuron++)
+        biases[iNeuron] = GetBias(iLayer, iNeuron);
+      snapshot.WriteVector(biases);
+    }
+    snapshot.WriteArray(weights_mat->GetData(), weights_mat->GetNWeights());
+  }
+
+  /*!
+   * \brief Define the network from a snapshot. The weights are used directly
+   * from the snapshot buffer.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void ReadSnapshot(CSnapshotBuffer &snapshot) {
+    auto check = [](bool valid) {
+      if (!valid)
+        throw std::invalid_argument("Snapshot network is corrupt");
+    };
+    const std::uint64_t input_reg = snapshot.ReadSize(),
+                        output_reg = snapshot.ReadSize();
+    const auto max_reg =
+        static_cast<std::uint64_t>(ENUM_SCALING_FUNCTIONS::ROBUST);
+    check((input_reg <= max_reg) && (output_reg <= max_reg));
+    SetInputRegularization(static_cast<ENUM_SCALING_FUNCTIONS>(input_reg));
+    SetOutputRegularization(static_cast<ENUM_SCALING_FUNCTIONS>(output_reg));
+
+    /* Every neuron holds a bias and every synapse a weight in the snapshot,
+     * which bounds the layer sizes before anything is allocated. */
+    std::vector<std::size_t> layer_sizes(
+        snapshot.ReadCount(sizeof(std::uint64_t)));
+    check(layer_sizes.size() >= 2);
+    const std::size_t max_values =
+        snapshot.GetNUnreadBytes() / sizeof(mlpdouble);
+    std::size_t n_synapses = 0;
+    for (auto iLayer = 0u; iLayer < layer_sizes.size(); iLayer++) {
+      layer_sizes[iLayer] = snapshot.ReadSize();
+      check((layer_sizes[iLayer] > 0) && (layer_sizes[iLayer] <= max_values));
+      if (iLayer > 0) {
+        check(layer_sizes[iLayer] <= max_values / layer_sizes[iLayer - 1]);
+        n_synapses += layer_sizes[iLayer] * layer_sizes[iLayer - 1];
+        check(n_synapses <= max_values);
+      }
+    }
+
+    DefineInputLayer(layer_sizes.front());
+    for (auto iLayer = 1u; iLayer < layer_sizes.size() - 1; iLayer++)
+      PushHiddenLayer(layer_sizes[iLayer]);
+    DefineOutputLayer(layer_sizes.back());
+
+    std::vector<mlpdouble> norm;
+    for (auto iInput = 0u; iInput < input_names.size(); iInput++) {
+      input_names[iInput] = snapshot.ReadString();
+      snapshot.ReadVector(norm);
+      check(norm.size() == 1);
+      input_norm[iInput].first = norm[0];
+      snapshot.ReadVector(norm);
+      check(norm.size() == 1);
+      input_norm[iInput].second = norm[0];
+    }
+    for (auto iOutput = 0u; iOutput < output_names.size(); iOutput++) {
+      output_names[iOutput] = snapshot.ReadString();
+      snapshot.ReadVector(norm);
+      check(norm.size() == 1);
+      output_norm[iOutput].first = norm[0];
+      snapshot.ReadVector(norm);
+      check(norm.size() == 1);
+      output_norm[iOutput].second = norm[0];
+    }
+
+    /* Weights are read after the layers, so size them beforehand. */
+    weights_mat = std::make_shared<CNetworkWeights>();
+    weights_mat->SetSize(layer_sizes);
+    SizeWeights();
+
+    SizeActivationFunctions(layer_sizes.size());
+    std::vector<mlpdouble> biases;
+    for (auto iLayer = 0u; iLayer < layer_sizes.size(); iLayer++) {
+      const std::string activation_function = snapshot.ReadString();
+      check(activation_function_map.find(activation_function) !=
+            activation_function_map.end());
+      SetActivationFunction(iLayer, activation_function);
+      snapshot.ReadVector(biases);
+      check(biases.size() == layer_sizes[iLayer]);
+      for (auto iNeuron = 0u; iNeuron < biases.size(); iNeuron++)
+        SetBias(iLayer, iNeuron, biases[iNeuron]);
+    }
+
+    std::size_t n_weights;
+    auto weights = snapshot.MapArray(n_weights);
+    if (n_weights != weights_mat->GetNWeights())
+      throw std::invalid_argument("Snapshot network weight count mismatch");
+    weights_mat->SetExternalData(weights);
+  }
+
+  /*!
+   * \brief Check whether the weights of the network have been loaded.
+   * \returns Network weights are available.
+   */
+  bool IsLoaded() const { return weights_mat != nullptr; }
+
+  /*!
+   * \brief Evaluate the network through an ahead-of-time compiled function
+   * generated from the same input file. The weights remain loaded for the
+   * evaluation modes the compiled function does not cover.
+   * \param[in] evaluate - Compiled evaluation function (nullptr to disable).
+   */
+  void SetCompiledEvaluation(CompiledEvaluation evaluate) {
+    compiled_evaluation = evaluate;
+  }
+
+  /*!
+   * \brief Check whether the network is evaluated through compiled code.
+   * \returns Network has a compiled evaluation function.
+   */
+  bool IsCompiled() const { return compiled_evaluation != nullptr; }
+
+  /*!
+   * \brief Set the dense kernels used in the evaluation of the network.
+   * \param[in] kernel_set - Kernel set (nullptr selects the process-wide
+   * default).
+   */
+  void SetKernels(const CComputeKernels *kernel_set) {
+    kernels = (kernel_set != nullptr) ? kernel_set
+                                      : &CComputeKernels::GetInstance();
+  }
+
+  /*!
+   * \brief Get the dense kernels used in the evaluation of the network.
+   * \returns Kernel set.
+   */
+  const CComputeKernels &GetKernels() const { return *kernels; }
+
+  /*!
+   * \brief Split the neurons of wide layers over the threads of the
+   * process-wide thread pool. A layer is evaluated in parallel when its number
+   * of neurons times the number of evaluated points reaches the threshold.
+   * The setting is kept when the network is reset.
+   * \param[in] threshold - Minimum layer width times number of points, 0 to
+   * evaluate all layers serially.
+   */
+  void SetParallelThreshold(std::size_t threshold) {
+    parallel_threshold = threshold;
+  }
+
+  /*!
+   * \brief Get the layer size from which layers are evaluated in parallel.
+   * \returns Minimum layer width times number of points, 0 if disabled.
+   */
+  std::size_t GetParallelThreshold() const { return parallel_threshold; }
+
+  /*!
+   * \brief Estimate the number of floating point operations of an evaluation,
+   * used to balance batch evaluations over threads. Every weight costs a
+   * multiply-add for the neuron output and for each first and second order
+   * derivative w.r.t. the network inputs.
+   * \param[in] derivative_order - Evaluated derivative order (0, 1 or 2).
+   * \returns Estimated number of floating point operations.
+   */
+  double GetEvaluationCost(unsigned short derivative_order) const {
+    const double nInputs = static_cast<double>(inputLayer->GetNNeurons());
+    double n_sums = 1;
+    if (derivative_order > 0)
+      n_sums += nInputs;
+    if (derivative_order > 1)
+      n_sums += nInputs * nInputs;
+    double n_weights = 0;
+    for (auto iLayer = 1u; iLayer < total_layers.size(); iLayer++)
+      n_weights += static_cast<double>(total_layers[iLayer]->GetNNeurons()) *
+                   total_layers[iLayer - 1]->GetNNeurons();
+    return 2 * n_weights * n_sums;
+  }
+
+  /*!
+   * \brief Get the synapse weights of the network.
+   * \returns Network weights.
+   */
+  const CNetworkWeights &GetWeights() const { return *weights_mat; }
+
+  /*!
+   * \brief Replace the weights of the network by a private copy, allocated by
+   * the calling thread, such that they reside on the NUMA node of that thread.
+   */
+  void ReplicateWeights() {
+    std::shared_ptr<CNetworkWeights> replica =
+        std::make_shared<CNetworkWeights>();
+    replica->CopyFrom(*weights_mat);
+    weights_mat = replica;
+  }
+
+  /*!
+   * \brief Use the weights of another network holding the same weights, such
+   * as a replica made through ReplicateWeights, without reallocating the
+   * evaluation data of this network.
+   * \param[in] source - network of which to share the weights.
+   */
+  void ShareReplica(const CNeuralNetwork &source) {
+    weights_mat = source.weights_mat;
+  }
+
+  /*!
+   * \brief Replace the weight array of the network by an externally provided,
+   * read-only array of the same size, such as a shared memory segment.
+   * \param[in] data - Shared pointer to the external weight array.
+   */
+  void SetExternalWeights(std::shared_ptr<const mlpdouble> data) {
+    if (weights_mat.use_count() > 1)
+      weights_mat = std::make_shared<CNetworkWeights>(*weights_mat);
+    weights_mat->SetExternalData(data);
+  }
+
   /*!
    * \brief Set bias value at a specific neuron.
    * \param[in] i_layer - Layer index.
@@ -189,6 +566,16 @@ public:
     total_layers[i_layer]->SetBias(i_neuron, value);
   }
 
+  /*!
+   * \brief Get bias value at a specific neuron.
+   * \param[in] i_layer - Layer index.
+   * \param[in] i_neuron - Neuron index of current layer.
+   * \returns Bias value.
+   */
+  mlpdouble GetBias(unsigned long i_layer, unsigned long i_neuron) const {
+    return total_layers[i_layer]->GetBias(i_neuron);
+  }
+
   /*!
    * \brief Set layer activation function.
    * \param[in] i_layer - Layer index.
@@ -374,23 +761,13 @@ public:
     }
     total_layers[total_layers.size() - 1] = outputLayer;
 
-    weights_mat.resize(n_hidden_layers + 1);
-    weights_mat[0].resize(hiddenLayers[0]->GetNNeurons());
-    for (auto iNeuron = 0u; iNeuron < hiddenLayers[0]->GetNNeurons(); iNeuron++)
-      weights_mat[0][iNeuron].resize(inputLayer->GetNNeurons());
-
-    for (auto iLayer = 1u; iLayer < n_hidden_layers; iLayer++) {
-      weights_mat[iLayer].resize(hiddenLayers[iLayer]->GetNNeurons());
-      for (auto iNeuron = 0u; iNeuron < hiddenLayers[iLayer]->GetNNeurons();
-           iNeuron++) {
-        weights_mat[iLayer][iNeuron].resize(
-            hiddenLayers[iLayer - 1]->GetNNeurons());
-      }
-    }
-    weights_mat[n_hidden_layers].resize(outputLayer->GetNNeurons());
-    for (auto iNeuron = 0u; iNeuron < outputLayer->GetNNeurons(); iNeuron++) {
-      weights_mat[n_hidden_layers][iNeuron].resize(
-          hiddenLayers[n_hidden_layers - 1]->GetNNeurons());
+    /* Weights shared from another network are kept. */
+    if (!weights_mat) {
+      std::vector<std::size_t> layer_sizes(total_layers.size());
+      for (auto iLayer = 0u; iLayer < total_layers.size(); iLayer++)
+        layer_sizes[iLayer] = total_layers[iLayer]->GetNNeurons();
+      weights_mat = std::make_shared<CNetworkWeights>();
+      weights_mat->SetSize(layer_sizes);
     }
 
     ANN_outputs = new mlpdouble[outputLayer->GetNNeurons()];
@@ -418,6 +795,15 @@ public:
    */
   unsigned long GetNWeightLayers() const { return total_layers.size() - 1; }
 
+  /*!
+   * \brief Get the activation function name of a layer.
+   * \param[in] iLayer - Network layer index.
+   * \returns Activation function name.
+   */
+  std::string GetActivationFunctionName(std::size_t iLayer) const {
+    return activation_function_names[iLayer];
+  }
+
   /*!
    * \brief Get the total number of layers in the network
    * \returns number of netowork layers.
@@ -450,6 +836,14 @@ public:
     mlpdouble x_norm = NormalizeInput(inputs[iNeuron], iNeuron);
 
     inputLayer->SetOutput(iNeuron, x_norm);
+  }
+
+  /*!
+   * \brief Set the derivatives of the input layer neuron outputs w.r.t. the
+   * network inputs.
+   * \param[in] iNeuron - Input neuron index.
+   */
+  void ComputeInputLayerGradient(std::size_t iNeuron) {
     if (compute_gradient) {
       for (auto jInput = 0u; jInput < inputLayer->GetNNeurons(); jInput++) {
         if (jInput == iNeuron) {
@@ -471,16 +865,23 @@ public:
    * \brief Evaluate activation function applied to the current layer.
    * \param[in] iLayer - Current layer index.
    * \param[in] input - Activation function input value.
+   * \param[out] Phi - Activation function output value.
+   * \param[out] Phi_prime - Activation function derivative w.r.t. its input,
+   * set in case of gradient computation.
+   * \param[out] Phi_dprime - Activation function second derivative w.r.t. its
+   * input, set in case of second order gradient computation.
    */
-  void ActivationFunction(std::size_t iLayer, mlpdouble input) {
-    /* Evaluating the activation function sets the value of the class parameter
-     * Phi. In case of gradient computation, Phi_prime and/or Phi_dprime are set
-     * as well, corresponding to the first and second analytical derivative of
-     * the activation function w.r.t. its input respectively. */
+  void ActivationFunction(std::size_t iLayer, mlpdouble input, mlpdouble &Phi,
+                          mlpdouble &Phi_prime, mlpdouble &Phi_dprime) const {
+    /* Evaluating the activation function sets the value of Phi. In case of
+     * gradient computation, Phi_prime and/or Phi_dprime are set as well,
+     * corresponding to the first and second analytical derivative of the
+     * activation function w.r.t. its input respectively. The values are
+     * returned through arguments, such that neurons can be evaluated from
+     * several threads. */
 
     /* Constants used for various activation functions. */
-    mlpdouble exp_x, tanh_x, alpha = 1.67326324, lambda = 1.05070098,
-                             gelu_c = 1.702;
+    mlpdouble exp_x, tanh_x, alpha = 1.67326324, lambda = 1.05070098;
 
     switch (activation_function_types[iLayer]) {
     case ENUM_ACTIVATION_FUNCTION::ELU:
@@ -581,12 +982,11 @@ public:
     case ENUM_ACTIVATION_FUNCTION::GELU:
       Phi = 0.5 * input * (1 + erf(input / sqrt(2)));
       if (compute_gradient) {
-        exp_x = exp(-gelu_c * input);
-        Phi_prime = exp_x * (gelu_c * input + exp_x + 1) / pow(exp_x + 1, 2);
+        /* Standard normal density at the input. */
+        exp_x = 0.3989422804014327 * exp(-0.5 * input * input);
+        Phi_prime = 0.5 * (1 + erf(input / sqrt(2))) + input * exp_x;
         if (compute_second_gradient)
-          Phi_dprime = input * ((5.79361 * pow(exp_x, 2) / pow(exp_x + 1, 3)) -
-                                (2.8968 * exp_x / pow(exp_x + 1, 2))) +
-                       3.404 * exp_x / pow(exp_x + 1, 2);
+          Phi_dprime = (2 - input * input) * exp_x;
       }
       break;
     case ENUM_ACTIVATION_FUNCTION::NONE:
@@ -605,10 +1005,17 @@ public:
   /*!
    * \brief De-normalize the network outputs based on output normalization
    * values.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are de-normalized.
    */
-  void DeNormalizeOutputs() {
+  void DeNormalizeOutputs(const CReducedLayer *output_layer = nullptr) {
     /* Compute and de-normalize MLP output */
-    for (auto iNeuron = 0u; iNeuron < outputLayer->GetNNeurons(); iNeuron++) {
+    std::size_t nOutputs = (output_layer != nullptr)
+                               ? output_layer->GetNNeurons()
+                               : outputLayer->GetNNeurons();
+    for (auto iRow = 0u; iRow < nOutputs; iRow++) {
+      std::size_t iNeuron =
+          (output_layer != nullptr) ? output_layer->GetRowIndex(iRow) : iRow;
       mlpdouble y_norm = outputLayer->GetOutput(iNeuron);
       mlpdouble output_scale = GetRegularizationScale(iNeuron, false);
 
@@ -642,55 +1049,578 @@ public:
     }
   }
 
+  /*!
+   * \brief Evaluate the activation function of a neuron and, if requested,
+   * the derivatives of its output w.r.t. the network inputs.
+   * \param[in] iLayer - Network layer index.
+   * \param[in] iNeuron - Layer neuron index.
+   * \param[in] X - Activation function input value.
+   */
+  void ComputeNeuron(std::size_t iLayer, std::size_t iNeuron, mlpdouble X) {
+    /* Evaluate activation function. */
+    mlpdouble Phi, Phi_prime, Phi_dprime;
+    ActivationFunction(iLayer, X, Phi, Phi_prime, Phi_dprime);
+
+    /* Store activation function output in current neuron. */
+    mlpdouble Yi = Phi;
+    total_layers[iLayer]->SetOutput(iNeuron, Yi);
+
+    /* Compute first and/or second order derivatives. */
+    if (compute_gradient) {
+      for (auto jInput = 0u; jInput < inputLayer->GetNNeurons(); jInput++) {
+        mlpdouble psi_j = ComputePsi(iLayer, iNeuron, jInput);
+        mlpdouble dYi_dIj = psi_j * Phi_prime;
+        total_layers[iLayer]->SetdYdX(iNeuron, jInput, dYi_dIj);
+        if (compute_second_gradient) {
+          for (auto kInput = 0u; kInput < inputLayer->GetNNeurons();
+               kInput++) {
+            mlpdouble psi_k = ComputePsi(iLayer, iNeuron, kInput);
+            mlpdouble chi = ComputeChi(iLayer, iNeuron, jInput, kInput);
+            mlpdouble d2Yi_dIjdIk =
+                Phi_dprime * psi_j * psi_k + Phi_prime * chi;
+
+            total_layers[iLayer]->Setd2YdX2(iNeuron, jInput, kInput,
+                                            d2Yi_dIjdIk);
+          } // kInput
+        }   // compute_second_gradient
+      }     // jInput
+    }       // compute_gradient
+  }
+
+  /*!
+   * \brief Evaluate the layers following the first hidden layer and
+   * de-normalize the network outputs.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
+   */
+  void PropagateHiddenLayers(const CReducedLayer *output_layer = nullptr) {
+    for (auto iLayer = 2u; iLayer < n_hidden_layers + 1; iLayer++) {
+      X_layer.resize(total_layers[iLayer]->GetNNeurons());
+      ForEachNeuronRange(
+          total_layers[iLayer]->GetNNeurons(), 1,
+          [&](std::size_t iBegin, std::size_t iEnd) {
+            ComputeLayerX(iLayer, X_layer.data(), iBegin, iEnd);
+            for (auto iNeuron = iBegin; iNeuron < iEnd; iNeuron++)
+              ComputeNeuron(iLayer, iNeuron, X_layer[iNeuron]);
+          });
+    }
+
+    /* Output layer, restricted to the retained outputs if a reduced view is
+     * provided. */
+    std::size_t iOutputLayer = n_hidden_layers + 1;
+    if (output_layer != nullptr) {
+      X_layer.resize(output_layer->GetNNeurons());
+      output_layer->ComputeX(total_layers[iOutputLayer - 1], *kernels,
+                             reduced_inputs, X_layer.data());
+      for (auto iRow = 0u; iRow < output_layer->GetNNeurons(); iRow++)
+        ComputeNeuron(iOutputLayer, output_layer->GetRowIndex(iRow),
+                      X_layer[iRow]);
+    } else {
+      X_layer.resize(outputLayer->GetNNeurons());
+      ForEachNeuronRange(
+          outputLayer->GetNNeurons(), 1,
+          [&](std::size_t iBegin, std::size_t iEnd) {
+            ComputeLayerX(iOutputLayer, X_layer.data(), iBegin, iEnd);
+            for (auto iNeuron = iBegin; iNeuron < iEnd; iNeuron++)
+              ComputeNeuron(iOutputLayer, iNeuron, X_layer[iNeuron]);
+          });
+    }
+
+    // De-normalize the network outputs and gradients.
+    DeNormalizeOutputs(output_layer);
+  }
+
   /*!
    * \brief Evaluate the network based on dimensionalized inputs.
    * \param[in] inputs - Vector containing non-normalized network inputs.
+   * \param[in] first_layer - Optional reduced view of the first weight layer,
+   * used in place of the full first weight matrix for the activation function
+   * inputs of the first hidden layer.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
    */
-  void Predict(std::vector<mlpdouble> &inputs) {
+  void Predict(std::vector<mlpdouble> &inputs,
+               const CReducedLayer *first_layer = nullptr,
+               const CReducedLayer *output_layer = nullptr) {
 
-    for (auto iLayer = 0u; iLayer < n_hidden_layers + 2; iLayer++) {
-      for (auto iNeuron = 0u; iNeuron < total_layers[iLayer]->GetNNeurons();
+    if (compiled_evaluation != nullptr) {
+      PredictCompiled(inputs);
+      return;
+    }
+
+    if ((region_cache_size > 0) && PredictFromRegionCache(inputs))
+      return;
+
+    for (auto iNeuron = 0u; iNeuron < inputLayer->GetNNeurons(); iNeuron++) {
+      ComputeInputLayer(inputs, iNeuron);
+    }
+
+    X_first_layer.resize(total_layers[1]->GetNNeurons());
+    if (first_layer != nullptr) {
+      first_layer->ComputeX(inputLayer, *kernels, reduced_inputs,
+                            X_first_layer.data());
+    } else {
+      ComputeLayerX(1, X_first_layer.data());
+    }
+    last_inputs = inputs;
+
+    EvaluateFromFirstLayer(output_layer);
+
+    if (region_cache_size > 0)
+      CacheActivationRegion();
+  }
+
+  /*!
+   * \brief Evaluate the network through its compiled evaluation function. All
+   * network outputs are evaluated.
+   * \param[in] inputs - Vector containing non-normalized network inputs.
+   */
+  void PredictCompiled(const std::vector<mlpdouble> &inputs) {
+    const std::size_t nInputs = inputLayer->GetNNeurons(),
+                      nOutputs = outputLayer->GetNNeurons();
+    const bool compute_hessian = compute_gradient && compute_second_gradient;
+    compiled_gradient.resize(compute_gradient ? nOutputs * nInputs : 0);
+    compiled_hessian.resize(compute_hessian ? nOutputs * nInputs * nInputs
+                                            : 0);
+    compiled_evaluation(
+        inputs.data(), ANN_outputs,
+        compute_gradient ? compiled_gradient.data() : nullptr,
+        compute_hessian ? compiled_hessian.data() : nullptr);
+    last_inputs.clear();
+
+    if (compute_gradient) {
+      for (auto iOutput = 0u; iOutput < nOutputs; iOutput++) {
+        for (auto jInput = 0u; jInput < nInputs; jInput++) {
+          dOutputs_dInputs[iOutput][jInput] =
+              compiled_gradient[iOutput * nInputs + jInput];
+          for (auto kInput = 0u; compute_hessian && (kInput < nInputs);
+               kInput++)
+            d2Outputs_dInputs2[iOutput][jInput][kInput] =
+                compiled_hessian[(iOutput * nInputs + jInput) * nInputs +
+                                 kInput];
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Evaluate the network outputs for a batch of points. Every weight
+   * layer is applied to all points through a single matrix-matrix product,
+   * which is handed to an external BLAS library if MLP_USE_BLAS is defined.
+   * Only output values are computed; the outputs are retrieved through
+   * GetBatchOutput.
+   * \param[in] inputs - Non-normalized network inputs per point.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
+   */
+  void PredictBatch(const std::vector<std::vector<mlpdouble>> &inputs,
+                    const CReducedLayer *output_layer = nullptr) {
+    const std::size_t nPoints = inputs.size(),
+                      nOutputs = outputLayer->GetNNeurons();
+    batch_size = nPoints;
+    batch_outputs.assign(nOutputs * nPoints, 0.0);
+
+    /* Batched evaluations do not compute derivatives. */
+    const bool gradient = compute_gradient;
+    compute_gradient = false;
+
+    if (compiled_evaluation != nullptr) {
+      for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+        PredictCompiled(inputs[iPoint]);
+        for (auto iOutput = 0u; iOutput < nOutputs; iOutput++)
+          batch_outputs[iOutput * nPoints + iPoint] = ANN_outputs[iOutput];
+      }
+      compute_gradient = gradient;
+      return;
+    }
+
+    /* The points are processed in blocks, such that the neuron outputs of a
+     * block remain in cache from one layer to the next. */
+    const std::size_t block_size = 256, iOutputLayer = n_hidden_layers + 1,
+                      nRows = (output_layer != nullptr)
+                                  ? output_layer->GetNNeurons()
+                                  : nOutputs;
+    for (std::size_t iStart = 0; iStart < nPoints; iStart += block_size) {
+      const std::size_t nBlock = std::min(block_size, nPoints - iStart);
+
+      batch_Y.resize(inputLayer->GetNNeurons() * nBlock);
+      for (auto iInput = 0u; iInput < inputLayer->GetNNeurons(); iInput++) {
+        for (auto iPoint = 0u; iPoint < nBlock; iPoint++)
+          batch_Y[iInput * nBlock + iPoint] =
+              NormalizeInput(inputs[iStart + iPoint][iInput], iInput);
+      }
+
+      for (auto iLayer = 1u; iLayer < n_hidden_layers + 1; iLayer++) {
+        const std::size_t nNeurons = total_layers[iLayer]->GetNNeurons();
+        batch_X.resize(nNeurons * nBlock);
+        ForEachNeuronRange(nNeurons, nBlock, [&](std::size_t iBegin,
+                                                 std::size_t iEnd) {
+          kernels->Gemm(weights_mat->GetRow(iLayer - 1, iBegin),
+                        batch_Y.data(), &batch_X[iBegin * nBlock],
+                        iEnd - iBegin, total_layers[iLayer - 1]->GetNNeurons(),
+                        nBlock);
+          mlpdouble Phi, Phi_prime, Phi_dprime;
+          for (auto iNeuron = iBegin; iNeuron < iEnd; iNeuron++) {
+            mlpdouble *X = &batch_X[iNeuron * nBlock];
+            const mlpdouble bias = total_layers[iLayer]->GetBias(iNeuron);
+            for (auto iPoint = 0u; iPoint < nBlock; iPoint++) {
+              ActivationFunction(iLayer, X[iPoint] + bias, Phi, Phi_prime,
+                                 Phi_dprime);
+              X[iPoint] = Phi;
+            }
+          }
+        });
+        std::swap(batch_Y, batch_X);
+      }
+
+      /* Output layer, restricted to the retained outputs if a reduced view is
+       * provided. */
+      batch_X.resize(nBlock);
+      mlpdouble Phi, Phi_prime, Phi_dprime;
+      for (auto iRow = 0u; iRow < nRows; iRow++) {
+        std::size_t iNeuron =
+            (output_layer != nullptr) ? output_layer->GetRowIndex(iRow) : iRow;
+        kernels->Gemm(weights_mat->GetRow(iOutputLayer - 1, iNeuron),
+                      batch_Y.data(), batch_X.data(), 1,
+                      total_layers[iOutputLayer - 1]->GetNNeurons(), nBlock);
+        const mlpdouble bias = outputLayer->GetBias(iNeuron);
+        for (auto iPoint = 0u; iPoint < nBlock; iPoint++) {
+          ActivationFunction(iOutputLayer, batch_X[iPoint] + bias, Phi,
+                             Phi_prime, Phi_dprime);
+          batch_outputs[iNeuron * nPoints + iStart + iPoint] =
+              DimensionalizeOutput(Phi, iNeuron);
+        }
+      }
+    }
+    compute_gradient = gradient;
+  }
+
+  /*!
+   * \brief Get a network output of the last batched evaluation.
+   * \param[in] iPoint - Batch point index.
+   * \param[in] iOutput - Output index.
+   * \returns Dimensional network output.
+   */
+  mlpdouble GetBatchOutput(std::size_t iPoint, std::size_t iOutput) const {
+    return batch_outputs[iOutput * batch_size + iPoint];
+  }
+
+  /*!
+   * \brief Check whether the network is piecewise linear, i.e. only applies
+   * linear and relu activation functions.
+   * \returns Network is piecewise linear.
+   */
+  bool IsPiecewiseLinear() const {
+    for (auto iLayer = 1u; iLayer < activation_function_types.size(); iLayer++) {
+      switch (activation_function_types[iLayer]) {
+      case ENUM_ACTIVATION_FUNCTION::LINEAR:
+      case ENUM_ACTIVATION_FUNCTION::RELU:
+      case ENUM_ACTIVATION_FUNCTION::NONE:
+        break;
+      default:
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*!
+   * \brief Set the number of activation regions to cache for piecewise-linear
+   * networks. Queries within a cached region are evaluated through its
+   * collapsed affine map. The cache is not used for other networks.
+   * \param[in] n_regions - Maximum number of cached regions (0 disables).
+   */
+  void SetRegionCacheSize(std::size_t n_regions) {
+    region_cache_size = IsPiecewiseLinear() ? n_regions : 0;
+    region_cache.clear();
+    region_inputs.resize(inputLayer->GetNNeurons());
+  }
+
+  /*!
+   * \brief Get the number of activation regions cached by the network.
+   * \returns Maximum number of cached regions, 0 if the cache is not used.
+   */
+  std::size_t GetRegionCacheSize() const { return region_cache_size; }
+
+  /*!
+   * \brief Get the number of evaluations served from the region cache.
+   * \returns Number of cache hits.
+   */
+  unsigned long GetNRegionCacheHits() const { return region_cache_hits; }
+
+  /*!
+   * \brief Evaluate the network through a cached activation region containing
+   * the inputs, if any.
+   * \param[in] inputs - Vector containing non-normalized network inputs.
+   * \returns Whether a cached region contained the inputs.
+   */
+  bool PredictFromRegionCache(const std::vector<mlpdouble> &inputs) {
+    std::vector<mlpdouble> &x_norm = region_inputs;
+    x_norm.resize(inputs.size());
+    for (auto iInput = 0u; iInput < inputs.size(); iInput++)
+      x_norm[iInput] = NormalizeInput(inputs[iInput], iInput);
+
+    for (auto iRegion = 0u; iRegion < region_cache.size(); iRegion++) {
+      if (!region_cache[iRegion].Contains(x_norm))
+        continue;
+
+      /* Move the region to the front of the cache. */
+      if (iRegion > 0)
+        std::swap(region_cache[0], region_cache[iRegion]);
+      const CAffineRegion &region = region_cache[0];
+
+      for (auto iOutput = 0u; iOutput < outputLayer->GetNNeurons(); iOutput++) {
+        ANN_outputs[iOutput] =
+            DimensionalizeOutput(region.EvaluateOutput(iOutput, x_norm), iOutput);
+        if (compute_gradient) {
+          mlpdouble output_scale = GetRegularizationScale(iOutput, false);
+          for (auto iInput = 0u; iInput < inputs.size(); iInput++) {
+            dOutputs_dInputs[iOutput][iInput] =
+                output_scale * region.GetOutputDerivative(iOutput, iInput) /
+                GetRegularizationScale(iInput, true);
+            if (compute_second_gradient)
+              for (auto jInput = 0u; jInput < inputs.size(); jInput++)
+                d2Outputs_dInputs2[iOutput][iInput][jInput] = 0.0;
+          }
+        }
+      }
+      /* The stored first hidden layer no longer matches the inputs. */
+      last_inputs.clear();
+      region_cache_hits++;
+      return true;
+    }
+    return false;
+  }
+
+  /*!
+   * \brief Store the activation region of the last full evaluation in the
+   * region cache. The affine maps of the neuron activation function inputs
+   * w.r.t. the normalized network inputs are propagated layer by layer, with
+   * the relu neurons fixed in their on/off state.
+   */
+  void CacheActivationRegion() {
+    std::size_t nInputs = inputLayer->GetNNeurons();
+    CAffineRegion region;
+    region.Initialize(nInputs, outputLayer->GetNNeurons());
+
+    /* Affine map of the previous layer outputs: identity for the input layer.
+     */
+    std::vector<std::vector<mlpdouble>> Y_previous(
+        nInputs, std::vector<mlpdouble>(nInputs, 0.0));
+    std::vector<mlpdouble> y_previous(nInputs, 0.0);
+    for (auto iInput = 0u; iInput < nInputs; iInput++)
+      Y_previous[iInput][iInput] = 1.0;
+
+    std::vector<mlpdouble> Z(nInputs);
+    for (auto iLayer = 1u; iLayer < total_layers.size(); iLayer++) {
+      std::size_t nNeurons = total_layers[iLayer]->GetNNeurons();
+      std::vector<std::vector<mlpdouble>> Y(nNeurons,
+                                            std::vector<mlpdouble>(nInputs));
+      std::vector<mlpdouble> y(nNeurons);
+      for (auto iNeuron = 0u; iNeuron < nNeurons; iNeuron++) {
+        const mlpdouble *w = weights_mat->GetRow(iLayer - 1, iNeuron);
+        mlpdouble z = total_layers[iLayer]->GetBias(iNeuron);
+        std::fill(Z.begin(), Z.end(), 0.0);
+        for (auto jNeuron = 0u; jNeuron < weights_mat->GetNColumns(iLayer - 1); jNeuron++) {
+          z += w[jNeuron] * y_previous[jNeuron];
+          for (auto iInput = 0u; iInput < nInputs; iInput++)
+            Z[iInput] += w[jNeuron] * Y_previous[jNeuron][iInput];
+        }
+        switch (activation_function_types[iLayer]) {
+        case ENUM_ACTIVATION_FUNCTION::RELU:
+          if (total_layers[iLayer]->GetOutput(iNeuron) > 0) {
+            region.PushConstraint(Z, z);
+            Y[iNeuron] = Z;
+            y[iNeuron] = z;
+          } else {
+            for (auto iInput = 0u; iInput < nInputs; iInput++)
+              Z[iInput] = -Z[iInput];
+            region.PushConstraint(Z, -z);
+            std::fill(Y[iNeuron].begin(), Y[iNeuron].end(), 0.0);
+            y[iNeuron] = 0.0;
+          }
+          break;
+        case ENUM_ACTIVATION_FUNCTION::LINEAR:
+          Y[iNeuron] = Z;
+          y[iNeuron] = z;
+          break;
+        default:
+          std::fill(Y[iNeuron].begin(), Y[iNeuron].end(), 0.0);
+          y[iNeuron] = 0.0;
+          break;
+        }
+      }
+      Y_previous = Y;
+      y_previous = y;
+    }
+    for (auto iOutput = 0u; iOutput < outputLayer->GetNNeurons(); iOutput++)
+      region.SetOutputMap(iOutput, Y_previous[iOutput], y_previous[iOutput]);
+
+    region_cache.insert(region_cache.begin(), region);
+    if (region_cache.size() > region_cache_size)
+      region_cache.pop_back();
+  }
+
+  /*!
+   * \brief Evaluate the network from given activation function inputs of the
+   * first hidden layer, skipping the first weight layer.
+   * \param[in] X_first - Activation function inputs of the first hidden layer
+   * (weighted normalized inputs plus bias).
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
+   */
+  void PredictFromFirstLayer(const std::vector<mlpdouble> &X_first,
+                             const CReducedLayer *output_layer = nullptr) {
+    X_first_layer = X_first;
+    last_inputs.clear();
+
+    EvaluateFromFirstLayer(output_layer);
+  }
+
+  /*!
+   * \brief Evaluate the network for inputs which differ from those of the last
+   * evaluation in at most one entry. The stored activation function inputs of
+   * the first hidden layer are then updated with a single column of the first
+   * weight matrix instead of the full matrix-vector product. If more than one
+   * input has changed, or no previous evaluation is available, the network is
+   * evaluated in full.
+   * \param[in] inputs - Vector containing non-normalized network inputs.
+   * \param[in] first_layer - Optional reduced view of the first weight layer,
+   * used in case of a full evaluation.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
+   */
+  void PredictUpdate(std::vector<mlpdouble> &inputs,
+                     const CReducedLayer *first_layer = nullptr,
+                     const CReducedLayer *output_layer = nullptr) {
+    if ((last_inputs.size() != inputs.size()) ||
+        (compiled_evaluation != nullptr)) {
+      Predict(inputs, first_layer, output_layer);
+      return;
+    }
+    std::size_t n_changed = 0, iChanged = 0;
+    for (auto iInput = 0u; iInput < inputs.size(); iInput++) {
+      if (inputs[iInput] != last_inputs[iInput]) {
+        n_changed++;
+        iChanged = iInput;
+      }
+    }
+    if (n_changed > 1) {
+      Predict(inputs, first_layer, output_layer);
+      return;
+    }
+    if (n_changed == 1) {
+      /* Rank-1 update of the first hidden layer activation function inputs. */
+      mlpdouble x_norm = NormalizeInput(inputs[iChanged], iChanged);
+      mlpdouble delta_x = x_norm - inputLayer->GetOutput(iChanged);
+      inputLayer->SetOutput(iChanged, x_norm);
+      for (auto iNeuron = 0u; iNeuron < total_layers[1]->GetNNeurons();
            iNeuron++) {
-        if (total_layers[iLayer]->IsInput()) {
-          ComputeInputLayer(inputs, iNeuron);
-        } else {
-          /* Compute activation function input value. */
-          mlpdouble X = ComputeX(iLayer, iNeuron);
-
-          /* Evaluate activation function. */
-          ActivationFunction(iLayer, X);
-
-          /* Store activation function output in current neuron. */
-          mlpdouble Yi = Phi;
-          total_layers[iLayer]->SetOutput(iNeuron, Yi);
-
-          /* Compute first and/or second order derivatives. */
-          if (compute_gradient) {
-            for (auto jInput = 0u; jInput < inputLayer->GetNNeurons();
-                 jInput++) {
-              mlpdouble psi_j = ComputePsi(iLayer, iNeuron, jInput);
-              mlpdouble dYi_dIj = psi_j * Phi_prime;
-              total_layers[iLayer]->SetdYdX(iNeuron, jInput, dYi_dIj);
-              if (compute_second_gradient) {
-                for (auto kInput = 0u; kInput < inputLayer->GetNNeurons();
-                     kInput++) {
-                  mlpdouble psi_k = ComputePsi(iLayer, iNeuron, kInput);
-                  mlpdouble chi = ComputeChi(iLayer, iNeuron, jInput, kInput);
-                  mlpdouble d2Yi_dIjdIk =
-                      Phi_dprime * psi_j * psi_k + Phi_prime * chi;
-
-                  total_layers[iLayer]->Setd2YdX2(iNeuron, jInput, kInput,
-                                                  d2Yi_dIjdIk);
-                } // kInput
-              }   // compute_second_gradient
-            }     // jInput
-          }       // compute_gradient
-        }         // is_input_layer
-      }           // iNeuron
-    }             // iLayer
+        X_first_layer[iNeuron] += weights_mat->GetWeight(0, iNeuron, iChanged) * delta_x;
+      }
+      last_inputs[iChanged] = inputs[iChanged];
+    }
 
-    // De-normalize the network outputs and gradients.
-    DeNormalizeOutputs();
+    EvaluateFromFirstLayer(output_layer);
+  }
+
+  /*!
+   * \brief Evaluate the network from the stored activation function inputs of
+   * the first hidden layer.
+   * \param[in] output_layer - Optional reduced view of the output layer, in
+   * which case only its retained outputs are evaluated.
+   */
+  void EvaluateFromFirstLayer(const CReducedLayer *output_layer = nullptr) {
+    for (auto iNeuron = 0u; iNeuron < inputLayer->GetNNeurons(); iNeuron++) {
+      ComputeInputLayerGradient(iNeuron);
+    }
+    ForEachNeuronRange(total_layers[1]->GetNNeurons(), 1,
+                       [&](std::size_t iBegin, std::size_t iEnd) {
+                         for (auto iNeuron = iBegin; iNeuron < iEnd; iNeuron++)
+                           ComputeNeuron(1, iNeuron, X_first_layer[iNeuron]);
+                       });
+
+    PropagateHiddenLayers(output_layer);
+  }
+
+  /*!
+   * \brief Compute the contribution of a single network input to the
+   * activation function inputs of the first hidden layer.
+   * \param[in] iInput - Network input index.
+   * \param[in] val_input - Dimensional input value.
+   * \param[out] contribution - Weighted normalized input per first hidden layer
+   * neuron.
+   */
+  void ComputeFirstLayerContribution(std::size_t iInput, mlpdouble val_input,
+                                     std::vector<mlpdouble> &contribution) const {
+    mlpdouble x_norm = NormalizeInput(val_input, iInput);
+    contribution.resize(total_layers[1]->GetNNeurons());
+    for (auto iNeuron = 0u; iNeuron < total_layers[1]->GetNNeurons();
+         iNeuron++) {
+      contribution[iNeuron] = weights_mat->GetWeight(0, iNeuron, iInput) * x_norm;
+    }
+  }
+
+  /*!
+   * \brief Fold the contribution of inputs with a fixed value into the biases
+   * of the first hidden layer.
+   * \param[in] is_bound - Per network input, whether its value is fixed.
+   * \param[in] bound_values - Per network input, the fixed (dimensional) value.
+   * \param[out] first_layer - Reduced first weight layer over the free inputs.
+   */
+  void ReduceFirstLayer(const std::vector<bool> &is_bound,
+                        const std::vector<mlpdouble> &bound_values,
+                        CReducedLayer &first_layer) const {
+    std::vector<std::size_t> free_inputs;
+    for (auto iInput = 0u; iInput < inputLayer->GetNNeurons(); iInput++) {
+      if (!is_bound[iInput])
+        free_inputs.push_back(iInput);
+    }
+
+    std::vector<std::size_t> neurons(total_layers[1]->GetNNeurons());
+    for (auto iNeuron = 0u; iNeuron < neurons.size(); iNeuron++)
+      neurons[iNeuron] = iNeuron;
+
+    first_layer.SetSize(neurons, free_inputs);
+    for (auto iNeuron = 0u; iNeuron < total_layers[1]->GetNNeurons();
+         iNeuron++) {
+      /* Effective bias: neuron bias plus the weighted normalized bound inputs.
+       */
+      mlpdouble bias = total_layers[1]->GetBias(iNeuron);
+      for (auto iInput = 0u; iInput < inputLayer->GetNNeurons(); iInput++) {
+        if (is_bound[iInput])
+          bias += weights_mat->GetWeight(0, iNeuron, iInput) *
+                  NormalizeInput(bound_values[iInput], iInput);
+      }
+      first_layer.SetBias(iNeuron, bias);
+      for (auto iFree = 0u; iFree < free_inputs.size(); iFree++) {
+        first_layer.SetWeight(iNeuron, iFree,
+                              weights_mat->GetWeight(0, iNeuron, free_inputs[iFree]));
+      }
+    }
+  }
+
+  /*!
+   * \brief Restrict the output layer to a subset of the network outputs.
+   * \param[in] outputs - Indices of the network outputs to retain.
+   * \param[out] output_layer - Reduced output layer over the retained outputs.
+   */
+  void ReduceOutputLayer(const std::vector<std::size_t> &outputs,
+                         CReducedLayer &output_layer) const {
+    std::size_t iOutputLayer = n_hidden_layers + 1;
+    std::vector<std::size_t> neurons(
+        total_layers[iOutputLayer - 1]->GetNNeurons());
+    for (auto iNeuron = 0u; iNeuron < neurons.size(); iNeuron++)
+      neurons[iNeuron] = iNeuron;
+
+    output_layer.SetSize(outputs, neurons);
+    for (auto iRow = 0u; iRow < outputs.size(); iRow++) {
+      output_layer.SetBias(iRow, outputLayer->GetBias(outputs[iRow]));
+      for (auto iNeuron = 0u; iNeuron < neurons.size(); iNeuron++) {
+        output_layer.SetWeight(
+            iRow, iNeuron, weights_mat->GetWeight(iOutputLayer - 1, outputs[iRow], iNeuron));
+      }
+    }
   }
 
   /*!
@@ -814,14 +1744,63 @@ public:
    * \returns Neuron activation function input.
    */
   mlpdouble ComputeX(std::size_t iLayer, std::size_t iNeuron) const {
-    mlpdouble x;
-    x = total_layers[iLayer]->GetBias(iNeuron);
-    std::size_t nNeurons_previous = total_layers[iLayer - 1]->GetNNeurons();
-    for (std::size_t jNeuron = 0; jNeuron < nNeurons_previous; jNeuron++) {
-      x += weights_mat[iLayer - 1][iNeuron][jNeuron] *
-           total_layers[iLayer - 1]->GetOutput(jNeuron);
+    return total_layers[iLayer]->GetBias(iNeuron) +
+           kernels->Dot(weights_mat->GetRow(iLayer - 1, iNeuron),
+                        total_layers[iLayer - 1]->GetOutputs(),
+                        total_layers[iLayer - 1]->GetNNeurons());
+  }
+
+  /*!
+   * \brief Compute the activation function inputs of all neurons in a layer
+   * through a single matrix-vector product.
+   * \param[in] iLayer - Network layer index.
+   * \param[out] X - Activation function input per layer neuron.
+   */
+  void ComputeLayerX(std::size_t iLayer, mlpdouble *X) const {
+    ComputeLayerX(iLayer, X, 0, total_layers[iLayer]->GetNNeurons());
+  }
+
+  /*!
+   * \brief Compute the activation function inputs of a range of neurons in a
+   * layer through a single matrix-vector product.
+   * \param[in] iLayer - Network layer index.
+   * \param[out] X - Activation function input per layer neuron.
+   * \param[in] iBegin - First neuron of the range.
+   * \param[in] iEnd - Neuron following the range.
+   */
+  void ComputeLayerX(std::size_t iLayer, mlpdouble *X, std::size_t iBegin,
+                     std::size_t iEnd) const {
+    kernels->Gemv(weights_mat->GetRow(iLayer - 1, iBegin),
+                  total_layers[iLayer - 1]->GetOutputs(), X + iBegin,
+                  iEnd - iBegin, total_layers[iLayer - 1]->GetNNeurons());
+    for (auto iNeuron = iBegin; iNeuron < iEnd; iNeuron++)
+      X[iNeuron] += total_layers[iLayer]->GetBias(iNeuron);
+  }
+
+  /*!
+   * \brief Evaluate the neurons of a layer, split in contiguous ranges over
+   * the threads of the thread pool if the layer is wide enough. The function
+   * returns once all neurons are evaluated.
+   * \param[in] nNeurons - Number of layer neurons.
+   * \param[in] nPoints - Number of points evaluated per neuron.
+   * \param[in] evaluate - Function evaluating the neuron range [begin, end).
+   */
+  void ForEachNeuronRange(
+      std::size_t nNeurons, std::size_t nPoints,
+      const std::function<void(std::size_t, std::size_t)> &evaluate) const {
+    if ((parallel_threshold == 0) || (nNeurons * nPoints < parallel_threshold)) {
+      evaluate(0, nNeurons);
+      return;
     }
-    return x;
+
+    /* Ranges span multiples of eight neurons, such that threads do not write
+     * to the same cache lines. */
+    CThreadPool &pool = CThreadPool::GetInstance();
+    std::size_t range = (nNeurons + pool.GetNThreads() - 1) / pool.GetNThreads();
+    range = 8 * ((range + 7) / 8);
+    pool.ParallelFor((nNeurons + range - 1) / range, [&](std::size_t iRange) {
+      evaluate(iRange * range, std::min(nNeurons, (iRange + 1) * range));
+    });
   }
 
   /*!
@@ -833,13 +1812,9 @@ public:
    */
   mlpdouble ComputePsi(std::size_t iLayer, std::size_t iNeuron,
                        std::size_t jInput) const {
-    mlpdouble psi = 0;
-    for (auto jNeuron = 0u; jNeuron < total_layers[iLayer - 1]->GetNNeurons();
-         jNeuron++) {
-      psi += weights_mat[iLayer - 1][iNeuron][jNeuron] *
-             total_layers[iLayer - 1]->GetdYdX(jNeuron, jInput);
-    }
-    return psi;
+    return kernels->Dot(weights_mat->GetRow(iLayer - 1, iNeuron),
+                        total_layers[iLayer - 1]->GetdYdX(jInput),
+                        total_layers[iLayer - 1]->GetNNeurons());
   }
 
   /*!
@@ -853,13 +1828,9 @@ public:
    */
   mlpdouble ComputeChi(std::size_t iLayer, std::size_t iNeuron,
                        std::size_t jInput, std::size_t kInput) const {
-    mlpdouble chi = 0;
-    for (auto jNeuron = 0u; jNeuron < total_layers[iLayer - 1]->GetNNeurons();
-         jNeuron++) {
-      chi += weights_mat[iLayer - 1][iNeuron][jNeuron] *
-             total_layers[iLayer - 1]->Getd2YdX2(jNeuron, jInput, kInput);
-    }
-    return chi;
+    return kernels->Dot(weights_mat->GetRow(iLayer - 1, iNeuron),
+                        total_layers[iLayer - 1]->Getd2YdX2(jInput, kInput),
+                        total_layers[iLayer - 1]->GetNNeurons());
   }
 
   /*!
@@ -871,13 +1842,9 @@ public:
    */
   mlpdouble ComputedOutputdInput(std::size_t iLayer, std::size_t iNeuron,
                                  std::size_t iInput) const {
-    mlpdouble doutput_dinput = 0;
-    for (auto jNeuron = 0u; jNeuron < total_layers[iLayer - 1]->GetNNeurons();
-         jNeuron++) {
-      doutput_dinput += weights_mat[iLayer - 1][iNeuron][jNeuron] *
-                        total_layers[iLayer - 1]->GetdYdX(jNeuron, iInput);
-    }
-    return doutput_dinput;
+    return kernels->Dot(weights_mat->GetRow(iLayer - 1, iNeuron),
+                        total_layers[iLayer - 1]->GetdYdX(iInput),
+                        total_layers[iLayer - 1]->GetNNeurons());
   }
 
   /*!
@@ -966,6 +1933,29 @@ public:
     return val_dim_output;
   }
 
+  /*!
+   * \brief Get the input range of the network, consistent with the range used
+   * in CheckInputInclusion.
+   * \param[in] iInput - Input index.
+   * \returns Lower and upper dimensional input bound.
+   */
+  std::pair<mlpdouble, mlpdouble> GetInputBounds(std::size_t iInput) const {
+    mlpdouble n_scales;
+    switch(input_reg_method)
+    {
+    case ENUM_SCALING_FUNCTIONS::STANDARD:
+      n_scales = 2.0;
+      break;
+    case ENUM_SCALING_FUNCTIONS::ROBUST:
+      n_scales = 10.0;
+      break;
+    case ENUM_SCALING_FUNCTIONS::MINMAX:
+    default:
+      return input_norm[iInput];
+    }
+    return std::make_pair(input_norm[iInput].first - n_scales * input_norm[iInput].second,
+                          input_norm[iInput].first + n_scales * input_norm[iInput].second);
+  }
 
   bool CheckInputInclusion(mlpdouble val_input, size_t iInput) const {
     bool inside {true};
@@ -994,6 +1984,20 @@ public:
     return inside;
   }
 
+  /*!
+   * \brief Check whether a query lies within the training data range of the
+   * network, which requires every input to lie within its range.
+   * \param[in] inputs - Non-normalized network inputs.
+   * \returns All inputs lie within the training data range.
+   */
+  bool CheckInputInclusion(const std::vector<mlpdouble> &inputs) const {
+    for (auto iInput = 0u; iInput < inputs.size(); iInput++) {
+      if (!CheckInputInclusion(inputs[iInput], iInput))
+        return false;
+    }
+    return true;
+  }
+
 };
 
 } // namespace MLPToolbox
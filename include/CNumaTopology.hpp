@@ -0,0 +1,220 @@
+/*!
+* \file CNumaTopology.hpp
+* \brief NUMA node layout of the machine, read from sysfs, and thread
+placement.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#define MLP_HAVE_NUMA_TOPOLOGY
+#endif
+
+namespace MLPToolbox {
+class CNumaTopology {
+  /*!
+   *\class CNumaTopology
+   *\brief Process-wide description of the NUMA nodes of the machine and of
+   *the CPUs belonging to each of them. On Linux, the layout is read from the
+   *node directories in /sys/devices/system/node, restricted to the CPUs the
+   *process is allowed to run on; nodes without such CPUs are left out. On
+   *other systems, or when sysfs is not available, all CPUs are treated as a
+   *single node. The class also pins threads to CPUs, which places the memory
+   *they first write on the node of that CPU.
+   */
+private:
+  std::vector<std::vector<int>> node_cpus; /*!< CPUs per node. */
+  std::vector<int> cpu_nodes; /*!< Node index per CPU, -1 if not available. */
+
+  CNumaTopology() {
+#ifdef MLP_HAVE_NUMA_TOPOLOGY
+    ReadSysfs();
+#endif
+    if (node_cpus.empty()) {
+      node_cpus.resize(1);
+      for (auto iCPU = 0u;
+           iCPU < std::max(1u, std::thread::hardware_concurrency()); iCPU++)
+        node_cpus[0].push_back(iCPU);
+    }
+    for (auto iNode = 0u; iNode < node_cpus.size(); iNode++) {
+      for (auto cpu : node_cpus[iNode]) {
+        if (cpu >= static_cast<int>(cpu_nodes.size()))
+          cpu_nodes.resize(cpu + 1, -1);
+        cpu_nodes[cpu] = iNode;
+      }
+    }
+  }
+
+#ifdef MLP_HAVE_NUMA_TOPOLOGY
+  /*!
+   * \brief Read the CPU list of every node directory in sysfs.
+   */
+  void ReadSysfs() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_mask =
+        (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+    std::vector<int> node_ids;
+    DIR *directory = opendir("/sys/devices/system/node");
+    if (directory == nullptr)
+      return;
+    for (dirent *entry = readdir(directory); entry != nullptr;
+         entry = readdir(directory)) {
+      const std::string name = entry->d_name;
+      if ((name.size() > 4) && (name.compare(0, 4, "node") == 0) &&
+          (name.find_first_not_of("0123456789", 4) == std::string::npos))
+        node_ids.push_back(std::stoi(name.substr(4)));
+    }
+    closedir(directory);
+    std::sort(node_ids.begin(), node_ids.end());
+
+    for (auto node_id : node_ids) {
+      std::ifstream file("/sys/devices/system/node/node" +
+                         std::to_string(node_id) + "/cpulist");
+      std::string line;
+      if (!std::getline(file, line))
+        continue;
+      std::vector<int> cpus;
+      for (auto cpu : ParseCPUList(line)) {
+        if (!have_mask || ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &allowed)))
+          cpus.push_back(cpu);
+      }
+      if (!cpus.empty())
+        node_cpus.push_back(cpus);
+    }
+  }
+#endif
+
+public:
+  CNumaTopology(const CNumaTopology &) = delete;
+  CNumaTopology &operator=(const CNumaTopology &) = delete;
+
+  /*!
+   * \brief Get the process-wide NUMA topology.
+   * \returns Reference to the topology.
+   */
+  static CNumaTopology &GetInstance() {
+    static CNumaTopology instance;
+    return instance;
+  }
+
+  /*!
+   * \brief Parse a Linux CPU list, such as "0-3,8-11".
+   * \param[in] cpu_list - CPU list.
+   * \returns CPU indices in the list.
+   */
+  static std::vector<int> ParseCPUList(const std::string &cpu_list) {
+    std::vector<int> cpus;
+    std::size_t position = 0;
+    while (position < cpu_list.size()) {
+      std::size_t end = cpu_list.find(',', position);
+      if (end == std::string::npos)
+        end = cpu_list.size();
+      const std::string range = cpu_list.substr(position, end - position);
+      position = end + 1;
+      if (range.find_first_of("0123456789") == std::string::npos)
+        continue;
+      const std::size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash)),
+                last = (dash == std::string::npos)
+                           ? first
+                           : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++)
+        cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  /*!
+   * \brief Get the number of NUMA nodes with CPUs available to the process.
+   * \returns Number of nodes.
+   */
+  std::size_t GetNNodes() const { return node_cpus.size(); }
+
+  /*!
+   * \brief Get the CPUs of a NUMA node available to the process.
+   * \param[in] iNode - Node index.
+   * \returns CPU indices.
+   */
+  const std::vector<int> &GetNodeCPUs(std::size_t iNode) const {
+    return node_cpus[iNode];
+  }
+
+  /*!
+   * \brief Get the NUMA node of a CPU.
+   * \param[in] cpu - CPU index.
+   * \returns Node index, zero for unknown CPUs.
+   */
+  std::size_t GetCPUNode(int cpu) const {
+    if ((cpu < 0) || (cpu >= static_cast<int>(cpu_nodes.size())) ||
+        (cpu_nodes[cpu] < 0))
+      return 0;
+    return cpu_nodes[cpu];
+  }
+
+  /*!
+   * \brief Get the NUMA node of the CPU the calling thread currently runs on.
+   * \returns Node index.
+   */
+  std::size_t GetCurrentNode() const {
+#ifdef MLP_HAVE_NUMA_TOPOLOGY
+    return GetCPUNode(sched_getcpu());
+#else
+    return 0;
+#endif
+  }
+
+  /*!
+   * \brief Restrict the calling thread to a single CPU.
+   * \param[in] cpu - CPU index.
+   * \returns The thread was pinned.
+   */
+  static bool PinCurrentThread(int cpu) {
+#ifdef MLP_HAVE_NUMA_TOPOLOGY
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE))
+      return false;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#else
+    return false;
+#endif
+  }
+};
+
+} // namespace MLPToolbox
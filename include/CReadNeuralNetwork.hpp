@@ -83,8 +83,10 @@ public:
 
   /*!
    * \brief Read input file and store necessary information
+   * \param[in] header_only - Only read the file header (architecture, variable
+   * names and normalization), skipping the weights and biases.
    */
-  void ReadMLPFile() {
+  void ReadMLPFile(bool header_only = false) {
     std::ifstream file_stream;
     file_stream.open(filename.c_str(), std::ifstream::in);
     if (!file_stream.is_open()) {
@@ -128,7 +130,8 @@ public:
         }
         /* Loop over spaces between layers and size the weight matrices
          * accordingly */
-        for (auto iLayer = 0u; iLayer < n_layers - 1; iLayer++) {
+        for (auto iLayer = 0u; (iLayer < n_layers - 1) && !header_only;
+             iLayer++) {
           weights_mat[iLayer].resize(n_neurons[iLayer]);
           for (auto iNeuron = 0u; iNeuron < n_neurons[iLayer]; iNeuron++)
             weights_mat[iLayer][iNeuron].resize(n_neurons[iLayer + 1]);
@@ -246,6 +249,8 @@ public:
     if (!found_output_names) {
       throw std::invalid_argument("No MLP input variable names provided");
     }
+    if (header_only)
+      return;
 
     /* Read weights for each layer */
     line = SkipToFlag(&file_stream, "[weights per layer]");
@@ -0,0 +1,210 @@
+/*!
+* \file CReducedLayer.hpp
+* \brief Reduced view of a network weight layer used by look-up operations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "CComputeKernels.hpp"
+#include "CLayer.hpp"
+#include "CSnapshotBuffer.hpp"
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CReducedLayer {
+  /*!
+   *\class CReducedLayer
+   *\brief This class stores a reduced copy of the weights and biases
+   *connecting two layers of a CNeuralNetwork for a specific look-up operation.
+   *Only the neurons of the layer listed in the row index set are evaluated,
+   *and only the neurons of the previous layer listed in the column index set
+   *are retained in the weight matrix. The contribution of the dropped columns
+   *is folded into the effective biases, such that the reduced layer produces
+   *the same activation function inputs as the full layer for the retained
+   *neurons. The retained weights are stored as one contiguous row-major
+   *matrix, which is applied through the dense kernels of the network.
+   */
+private:
+  std::vector<std::size_t>
+      row_indices,    /*!< Layer neuron indices retained in the reduced
+                         weight matrix. */
+      column_indices; /*!< Previous layer neuron indices retained in the
+                         reduced weight matrix. */
+  std::vector<mlpdouble> biases, /*!< Effective neuron biases. */
+      weights; /*!< Reduced weight matrix [retained row][retained column],
+                  row-major. */
+
+public:
+  /*!
+   * \brief Size the reduced layer.
+   * \param[in] rows - Layer neuron indices to retain.
+   * \param[in] columns - Previous layer neuron indices to retain.
+   */
+  void SetSize(const std::vector<std::size_t> &rows,
+               const std::vector<std::size_t> &columns) {
+    row_indices = rows;
+    column_indices = columns;
+    biases.assign(rows.size(), 0.0);
+    weights.assign(rows.size() * columns.size(), 0.0);
+  }
+
+  /*!
+   * \brief Get the number of retained neurons of the reduced layer.
+   * \returns Number of retained rows.
+   */
+  std::size_t GetNNeurons() const { return row_indices.size(); }
+
+  /*!
+   * \brief Get the layer neuron index of a retained row.
+   * \param[in] iRow - Retained row index.
+   * \returns Layer neuron index.
+   */
+  std::size_t GetRowIndex(std::size_t iRow) const { return row_indices[iRow]; }
+
+  /*!
+   * \brief Get the number of retained previous layer neurons.
+   * \returns Number of retained columns.
+   */
+  std::size_t GetNColumns() const { return column_indices.size(); }
+
+  /*!
+   * \brief Get the previous layer neuron index of a retained column.
+   * \param[in] iColumn - Retained column index.
+   * \returns Previous layer neuron index.
+   */
+  std::size_t GetColumnIndex(std::size_t iColumn) const {
+    return column_indices[iColumn];
+  }
+
+  /*!
+   * \brief Set the effective bias of a retained neuron.
+   * \param[in] iRow - Retained row index.
+   * \param[in] value - Effective bias value.
+   */
+  void SetBias(std::size_t iRow, mlpdouble value) { biases[iRow] = value; }
+
+  /*!
+   * \brief Get the effective bias of a retained neuron.
+   * \param[in] iRow - Retained row index.
+   * \returns Effective bias value.
+   */
+  mlpdouble GetBias(std::size_t iRow) const { return biases[iRow]; }
+
+  /*!
+   * \brief Set the weight of a retained synapse.
+   * \param[in] iRow - Retained row index.
+   * \param[in] iColumn - Retained column index.
+   * \param[in] value - Weight value.
+   */
+  void SetWeight(std::size_t iRow, std::size_t iColumn, mlpdouble value) {
+    weights[iRow * column_indices.size() + iColumn] = value;
+  }
+
+  /*!
+   * \brief Get the weight of a retained synapse.
+   * \param[in] iRow - Retained row index.
+   * \param[in] iColumn - Retained column index.
+   * \returns Weight value.
+   */
+  mlpdouble GetWeight(std::size_t iRow, std::size_t iColumn) const {
+    return weights[iRow * column_indices.size() + iColumn];
+  }
+
+  /*!
+   * \brief Compute the activation function inputs of all retained neurons
+   * from the retained neurons of the previous layer. The reduced layer may be
+   * shared between threads, so the caller provides the work vector.
+   * \param[in] previous_layer - Previous network layer.
+   * \param[in] kernels - Dense kernels applying the weight matrix.
+   * \param[in] previous_outputs - Work vector for the retained outputs of the
+   * previous layer.
+   * \param[out] X - Activation function input per retained row.
+   */
+  void ComputeX(const CLayer *previous_layer, const CComputeKernels &kernels,
+                std::vector<mlpdouble> &previous_outputs, mlpdouble *X) const {
+    previous_outputs.resize(column_indices.size());
+    for (auto iColumn = 0u; iColumn < column_indices.size(); iColumn++)
+      previous_outputs[iColumn] =
+          previous_layer->GetOutput(column_indices[iColumn]);
+    kernels.Gemv(weights.data(), previous_outputs.data(), X,
+                 row_indices.size(), column_indices.size());
+    for (auto iRow = 0u; iRow < row_indices.size(); iRow++)
+      X[iRow] += biases[iRow];
+  }
+
+  /*!
+   * \brief Append the reduced layer to a snapshot.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void WriteSnapshot(CSnapshotBuffer &snapshot) const {
+    snapshot.WriteVector(row_indices);
+    snapshot.WriteVector(column_indices);
+    snapshot.WriteVector(biases);
+    snapshot.WriteVector(weights);
+  }
+
+  /*!
+   * \brief Restore the reduced layer from a snapshot.
+   * \param[in] snapshot - Snapshot buffer.
+   */
+  void ReadSnapshot(CSnapshotBuffer &snapshot) {
+    snapshot.ReadVector(row_indices);
+    snapshot.ReadVector(column_indices);
+    snapshot.ReadVector(biases);
+    snapshot.ReadVector(weights);
+    bool valid = (biases.size() == row_indices.size());
+    if (row_indices.empty())
+      valid = valid && weights.empty();
+    else
+      valid = valid && (weights.size() % row_indices.size() == 0) &&
+              (weights.size() / row_indices.size() == column_indices.size());
+    if (!valid)
+      throw std::invalid_argument("Snapshot reduced layer is corrupt");
+  }
+
+  /*!
+   * \brief Check whether the retained neurons exist in the layers connected by
+   * the reduced layer.
+   * \param[in] n_neurons - Number of neurons of the layer.
+   * \param[in] n_previous - Number of neurons of the previous layer.
+   * \returns All retained neuron indices are within the layers.
+   */
+  bool FitsLayers(std::size_t n_neurons, std::size_t n_previous) const {
+    for (auto iRow : row_indices)
+      if (iRow >= n_neurons)
+        return false;
+    for (auto iColumn : column_indices)
+      if (iColumn >= n_previous)
+        return false;
+    return true;
+  }
+};
+
+} // namespace MLPToolbox
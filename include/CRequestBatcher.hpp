@@ -0,0 +1,267 @@
+/*!
+* \file CRequestBatcher.hpp
+* \brief Groups single-query look-ups from concurrent callers into batch
+evaluations.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CLookUp_ANN.hpp"
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CRequestBatcher {
+  /*!
+   *\class CRequestBatcher
+   *\brief Front end of a CLookUp_ANN for applications which evaluate single
+   *queries from many threads. Callers submit a query and receive a future of
+   *its outputs, on which they block or poll, while a collector thread groups
+   *the pending queries per input-output map and evaluates each group through
+   *CLookUp_ANN::PredictANNBatch once it holds the maximum batch size or its
+   *oldest query has waited for the maximum latency. Submission is lock-free:
+   *queries are pushed onto an atomic list, which the collector takes over as a
+   *whole. While the batcher exists, the look-up collection must not be used by
+   *other threads.
+   */
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /*!
+   * \brief Single query waiting for evaluation.
+   */
+  struct CRequest {
+    CIOMap *input_output_map; /*!< Input-output map of the query. */
+    std::vector<mlpdouble> inputs; /*!< Call input values. */
+    std::promise<std::vector<mlpdouble>> outputs; /*!< Call output values. */
+    Clock::time_point submitted; /*!< Submission time. */
+    CRequest *next{nullptr}; /*!< Request submitted before this one. */
+  };
+
+  CLookUp_ANN &lookup; /*!< Collection evaluating the queries. */
+  std::atomic<CRequest *> submitted{nullptr}; /*!< Submitted requests, most
+                                                 recent first. */
+  std::atomic<std::size_t> max_batch_size{64}; /*!< Queries per batch. */
+  std::atomic<long> max_latency_us{100}; /*!< Maximum waiting time of a query
+                                            before its batch is evaluated. */
+  std::atomic<unsigned long> n_batches{0},  /*!< Evaluated batches. */
+      n_queries{0};                          /*!< Evaluated queries. */
+
+  std::mutex wake_mutex;               /*!< Guards sleeping of the collector. */
+  std::condition_variable wake_condition; /*!< Wakes the collector. */
+  bool stopping{false};                /*!< The collector is asked to exit. */
+  std::thread collector;               /*!< Collector thread. */
+
+  /*!
+   * \brief Evaluate a group of queries with the same input-output map and
+   * fulfill their futures.
+   * \param[in] group - Requests to evaluate.
+   */
+  void EvaluateGroup(std::vector<std::unique_ptr<CRequest>> &group) {
+    CIOMap *input_output_map = group.front()->input_output_map;
+    std::vector<std::vector<mlpdouble>> inputs(group.size()), outputs;
+    for (auto iQuery = 0u; iQuery < group.size(); iQuery++)
+      inputs[iQuery].swap(group[iQuery]->inputs);
+    try {
+      lookup.PredictANNBatch(input_output_map, inputs, outputs);
+    } catch (...) {
+      for (auto &request : group)
+        request->outputs.set_exception(std::current_exception());
+      group.clear();
+      return;
+    }
+    /* Counted before the futures are fulfilled, such that callers which
+     * received their outputs see the batch in the statistics. */
+    n_batches++;
+    n_queries += group.size();
+    for (auto iQuery = 0u; iQuery < group.size(); iQuery++) {
+      std::vector<mlpdouble> query_outputs(outputs.size());
+      for (auto iOutput = 0u; iOutput < outputs.size(); iOutput++)
+        query_outputs[iOutput] = outputs[iOutput][iQuery];
+      group[iQuery]->outputs.set_value(std::move(query_outputs));
+    }
+    group.clear();
+  }
+
+  /*!
+   * \brief Main loop of the collector thread.
+   */
+  void CollectorLoop() {
+    std::map<CIOMap *, std::vector<std::unique_ptr<CRequest>>> pending;
+    for (;;) {
+      /* Take over the submitted requests in submission order. */
+      CRequest *request = submitted.exchange(nullptr, std::memory_order_acquire),
+               *ordered = nullptr;
+      while (request != nullptr) {
+        CRequest *next = request->next;
+        request->next = ordered;
+        ordered = request;
+        request = next;
+      }
+      const std::size_t batch_size = std::max<std::size_t>(max_batch_size, 1);
+      for (request = ordered; request != nullptr;) {
+        CRequest *next = request->next;
+        auto &group = pending[request->input_output_map];
+        group.emplace_back(request);
+        if (group.size() >= batch_size)
+          EvaluateGroup(group);
+        request = next;
+      }
+
+      /* Evaluate the groups whose oldest query reached the latency limit. */
+      bool stop;
+      {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stop = stopping;
+      }
+      const Clock::time_point now = Clock::now();
+      const auto latency = std::chrono::microseconds(max_latency_us.load());
+      Clock::time_point deadline = Clock::time_point::max();
+      for (auto &group : pending) {
+        if (group.second.empty())
+          continue;
+        if (stop || (group.second.front()->submitted + latency <= now))
+          EvaluateGroup(group.second);
+        else
+          deadline = std::min(deadline, group.second.front()->submitted + latency);
+      }
+      if (stop && (submitted.load(std::memory_order_acquire) == nullptr))
+        return;
+
+      std::unique_lock<std::mutex> lock(wake_mutex);
+      auto wake = [&] {
+        return stopping ||
+               (submitted.load(std::memory_order_acquire) != nullptr);
+      };
+      if (deadline == Clock::time_point::max())
+        wake_condition.wait(lock, wake);
+      else
+        wake_condition.wait_until(lock, deadline, wake);
+    }
+  }
+
+public:
+  /*!
+   * \brief Start the collector thread of a look-up collection.
+   * \param[in] lookup_collection - Collection evaluating the queries.
+   */
+  explicit CRequestBatcher(CLookUp_ANN &lookup_collection)
+      : lookup(lookup_collection) {
+    collector = std::thread(&CRequestBatcher::CollectorLoop, this);
+  }
+
+  CRequestBatcher(const CRequestBatcher &) = delete;
+  CRequestBatcher &operator=(const CRequestBatcher &) = delete;
+
+  /*!
+   * \brief Evaluate all pending queries and stop the collector thread. No
+   * queries may be submitted meanwhile.
+   */
+  ~CRequestBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex);
+      stopping = true;
+    }
+    wake_condition.notify_one();
+    collector.join();
+  }
+
+  /*!
+   * \brief Set the number of queries at which a batch is evaluated without
+   * waiting for the latency limit.
+   * \param[in] n_queries - Maximum batch size.
+   */
+  void SetMaxBatchSize(std::size_t n_queries) { max_batch_size = n_queries; }
+
+  /*!
+   * \brief Set the time after which a query is evaluated, even if its batch
+   * is not full.
+   * \param[in] latency - Maximum waiting time.
+   */
+  void SetMaxLatency(std::chrono::microseconds latency) {
+    max_latency_us = latency.count();
+  }
+
+  /*!
+   * \brief Submit a single query.
+   * \param[in] input_output_map - input-output map coupling desired inputs and
+   * outputs to loaded ANNs, which must remain valid until the query is done.
+   * \param[in] inputs - call input values.
+   * \returns Future of the call output values, in the order of the output
+   * variables of the map. Errors of the evaluation are passed on through the
+   * future.
+   */
+  std::future<std::vector<mlpdouble>> Submit(CIOMap *input_output_map,
+                                             std::vector<mlpdouble> inputs) {
+    CRequest *request = new CRequest;
+    request->input_output_map = input_output_map;
+    request->inputs = std::move(inputs);
+    request->submitted = Clock::now();
+    std::future<std::vector<mlpdouble>> result =
+        request->outputs.get_future();
+
+    CRequest *previous = submitted.load(std::memory_order_relaxed);
+    do {
+      request->next = previous;
+    } while (!submitted.compare_exchange_weak(previous, request,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+    /* Only the first request after the collector emptied the list needs to
+     * wake it up; the lock prevents the wake-up from being missed. */
+    if (previous == nullptr) {
+      { std::lock_guard<std::mutex> lock(wake_mutex); }
+      wake_condition.notify_one();
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Get the number of batches evaluated so far.
+   * \returns Number of batches.
+   */
+  unsigned long GetNBatches() const { return n_batches; }
+
+  /*!
+   * \brief Get the number of queries evaluated so far.
+   * \returns Number of queries.
+   */
+  unsigned long GetNQueries() const { return n_queries; }
+};
+
+} // namespace MLPToolbox
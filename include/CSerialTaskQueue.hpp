@@ -0,0 +1,131 @@
+/*!
+* \file CSerialTaskQueue.hpp
+* \brief Runs tasks one at a time, in submission order, on the thread
+pool.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "CThreadPool.hpp"
+
+namespace MLPToolbox {
+class CSerialTaskQueue {
+  /*!
+   *\class CSerialTaskQueue
+   *\brief Queue of tasks operating on the same object, which are run
+   *asynchronously by the workers of the process-wide thread pool (see
+   *CThreadPool), one at a time and in submission order. The queue waits for
+   *its remaining tasks when it is destroyed, such that tasks may refer to the
+   *object owning the queue as long as the queue is declared after the data the
+   *tasks use.
+   */
+private:
+  /*!
+   * \brief State shared with the job running the tasks.
+   */
+  struct CState {
+    std::mutex state_mutex;             /*!< Guards the state. */
+    std::condition_variable idle_condition; /*!< Signals an empty queue. */
+    std::deque<std::function<void()>> tasks; /*!< Tasks not yet started. */
+    bool running{false}; /*!< A job of the thread pool runs the tasks. */
+  };
+
+  std::unique_ptr<CState> state{new CState}; /*!< Queue state. */
+
+  /*!
+   * \brief Run the queued tasks until none are left.
+   * \param[in] queue_state - Queue state.
+   */
+  static void RunTasks(CState *queue_state) {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::lock_guard<std::mutex> lock(queue_state->state_mutex);
+        if (queue_state->tasks.empty()) {
+          queue_state->running = false;
+          queue_state->idle_condition.notify_all();
+          return;
+        }
+        task = std::move(queue_state->tasks.front());
+        queue_state->tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+public:
+  CSerialTaskQueue() = default;
+  CSerialTaskQueue(CSerialTaskQueue &&) = default;
+
+  /*!
+   * \brief Wait for the remaining tasks, then take over the tasks of another
+   * queue.
+   * \param[in] other - Queue to take over.
+   */
+  CSerialTaskQueue &operator=(CSerialTaskQueue &&other) {
+    Wait();
+    state = std::move(other.state);
+    return *this;
+  }
+
+  ~CSerialTaskQueue() { Wait(); }
+
+  /*!
+   * \brief Queue a task. Tasks must not throw.
+   * \param[in] task - Function running the task.
+   */
+  void Push(std::function<void()> task) {
+    if (!state)
+      state.reset(new CState);
+    {
+      std::lock_guard<std::mutex> lock(state->state_mutex);
+      state->tasks.push_back(std::move(task));
+      if (state->running)
+        return;
+      state->running = true;
+    }
+    CState *queue_state = state.get();
+    CThreadPool::GetInstance().SubmitJob([queue_state] { RunTasks(queue_state); });
+  }
+
+  /*!
+   * \brief Wait until all queued tasks are done.
+   */
+  void Wait() {
+    if (!state)
+      return;
+    std::unique_lock<std::mutex> lock(state->state_mutex);
+    state->idle_condition.wait(lock, [&] { return !state->running; });
+  }
+};
+
+} // namespace MLPToolbox
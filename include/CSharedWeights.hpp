@@ -0,0 +1,262 @@
+/*!
+* \file CSharedWeights.hpp
+* \brief Sharing of network weights between processes through POSIX shared
+* memory.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MLP_HAVE_SHARED_MEMORY
+#endif
+
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CSharedWeights {
+  /*!
+   *\class CSharedWeights
+   *\brief Publishes the weight array of a network in a named POSIX shared
+   *memory segment, such that processes on the same node loading the same
+   *network map a single read-only copy of the weights. The first process to
+   *create the segment writes the weights and marks the segment as ready; other
+   *processes wait for the ready flag and map the segment read-only. The
+   *segment header stores the content hash and size of the network, which are
+   *checked before attaching, and the process identifier of the creator. A
+   *segment of which the creator died before marking it as ready is removed
+   *and created anew. Whenever sharing is not possible, the caller keeps its
+   *private copy of the weights.
+   */
+private:
+  /*!
+   * \brief Header at the start of a shared memory segment.
+   */
+  struct SegmentHeader {
+    std::atomic<std::uint32_t> state; /*!< Segment state (writing, ready). */
+    std::uint32_t value_size;         /*!< Size of a single weight in bytes. */
+    std::uint64_t content_hash;       /*!< Hash of the network input file. */
+    std::uint64_t n_weights;          /*!< Number of weights. */
+    std::int64_t creator;             /*!< Process writing the weights. */
+    unsigned char padding[32];        /*!< Aligns the weights to 64 bytes. */
+  };
+
+  static constexpr std::uint32_t SEGMENT_WRITING = 1, /*!< Weights are being
+                                                         written. */
+      SEGMENT_READY = 2; /*!< Weights are available. */
+
+#ifdef MLP_HAVE_SHARED_MEMORY
+  /*!
+   * \brief Fill a shared memory segment created by this process.
+   * \param[in] fd - File descriptor of the new segment.
+   * \param[in] name - Segment name.
+   * \param[in] content_hash - Hash of the network input file content.
+   * \param[in] weights - Private weight array of the network.
+   * \param[in] n_weights - Number of weights.
+   * \returns Shared pointer to the mapped weights, nullptr if the segment
+   * could not be filled.
+   */
+  static std::shared_ptr<const mlpdouble>
+  Create(int fd, const std::string &name, std::uint64_t content_hash,
+         const mlpdouble *weights, std::size_t n_weights) {
+    std::size_t segment_size =
+        sizeof(SegmentHeader) + n_weights * sizeof(mlpdouble);
+    void *segment = MAP_FAILED;
+    if (ftruncate(fd, segment_size) == 0)
+      segment = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+      shm_unlink(name.c_str());
+      return nullptr;
+    }
+    auto header = new (segment) SegmentHeader;
+    header->value_size = sizeof(mlpdouble);
+    header->content_hash = content_hash;
+    header->n_weights = n_weights;
+    header->creator = getpid();
+    header->state.store(SEGMENT_WRITING, std::memory_order_release);
+    auto data = reinterpret_cast<mlpdouble *>(header + 1);
+    std::memcpy(data, weights, n_weights * sizeof(mlpdouble));
+    header->state.store(SEGMENT_READY, std::memory_order_release);
+    mprotect(segment, segment_size, PROT_READ);
+
+    /* The segment name is removed once the publishing process releases the
+     * weights; processes already attached keep their mapping. */
+    return std::shared_ptr<const mlpdouble>(
+        data, [segment, segment_size, name](const mlpdouble *) {
+          munmap(segment, segment_size);
+          shm_unlink(name.c_str());
+        });
+  }
+
+  /*!
+   * \brief Wait until a segment created by another process is ready and map
+   * it read-only.
+   * \param[in] name - Segment name.
+   * \param[in] content_hash - Hash of the network input file content.
+   * \param[in] n_weights - Number of weights.
+   * \param[in] timeout - Maximum time in seconds to wait for the segment.
+   * \param[out] stale - The creator died before the segment was ready, or
+   * the segment was never initialized within the timeout.
+   * \returns Shared pointer to the mapped weights, nullptr if the segment
+   * could not be mapped.
+   */
+  static std::shared_ptr<const mlpdouble>
+  Attach(const std::string &name, std::uint64_t content_hash,
+         std::size_t n_weights, double timeout, bool &stale) {
+    std::size_t segment_size =
+        sizeof(SegmentHeader) + n_weights * sizeof(mlpdouble);
+    bool initialized = false;
+    stale = false;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration<double>(timeout);
+    while (std::chrono::steady_clock::now() < deadline) {
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd < 0)
+        return nullptr;
+      struct stat segment_stat;
+      if (fstat(fd, &segment_stat) != 0)
+        segment_stat.st_size = 0;
+      std::size_t current_size = segment_stat.st_size;
+
+      /* A segment of a different size belongs to a different network. */
+      if ((current_size > 0) && (current_size != segment_size)) {
+        close(fd);
+        return nullptr;
+      }
+      void *segment = MAP_FAILED;
+      if (current_size == segment_size)
+        segment = mmap(nullptr, segment_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (segment != MAP_FAILED) {
+        auto header = static_cast<const SegmentHeader *>(segment);
+        const std::uint32_t state =
+            header->state.load(std::memory_order_acquire);
+        if (state == SEGMENT_READY) {
+          if ((header->value_size != sizeof(mlpdouble)) ||
+              (header->content_hash != content_hash) ||
+              (header->n_weights != n_weights)) {
+            munmap(segment, segment_size);
+            return nullptr;
+          }
+          return std::shared_ptr<const mlpdouble>(
+              reinterpret_cast<const mlpdouble *>(header + 1),
+              [segment, segment_size](const mlpdouble *) {
+                munmap(segment, segment_size);
+              });
+        }
+        if (state == SEGMENT_WRITING) {
+          initialized = true;
+          const pid_t creator = static_cast<pid_t>(header->creator);
+          if ((kill(creator, 0) != 0) && (errno == ESRCH)) {
+            munmap(segment, segment_size);
+            stale = true;
+            return nullptr;
+          }
+        }
+        munmap(segment, segment_size);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    /* The creator died before it could store its process identifier. */
+    stale = !initialized;
+    return nullptr;
+  }
+#endif
+
+public:
+  /*!
+   * \brief Get the shared memory segment name of a network.
+   * \param[in] content_hash - Hash of the network input file content.
+   * \returns Segment name.
+   */
+  static std::string GetSegmentName(std::uint64_t content_hash) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/mlpcpp_%016llx",
+                  static_cast<unsigned long long>(content_hash));
+    return name;
+  }
+
+  /*!
+   * \brief Publish or attach to the shared weight array of a network.
+   * \param[in] content_hash - Hash of the network input file content.
+   * \param[in] weights - Private weight array of the network.
+   * \param[in] n_weights - Number of weights.
+   * \param[in] timeout - Maximum time in seconds to wait for another process
+   * to publish the weights.
+   * \returns Shared pointer to the mapped weights, nullptr if the weights
+   * could not be shared.
+   */
+  static std::shared_ptr<const mlpdouble> Share(std::uint64_t content_hash,
+                                                const mlpdouble *weights,
+                                                std::size_t n_weights,
+                                                double timeout = 30.0) {
+#ifdef MLP_HAVE_SHARED_MEMORY
+    if (!std::is_trivially_copyable<mlpdouble>::value)
+      return nullptr;
+
+    std::string name = GetSegmentName(content_hash);
+    for (auto attempt = 0u; attempt < 2; attempt++) {
+      /* The first process creates and fills the segment. */
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+      if (fd >= 0)
+        return Create(fd, name, content_hash, weights, n_weights);
+      if (errno != EEXIST)
+        return nullptr;
+
+      /* Other processes wait until the segment is complete and map it. A
+       * segment abandoned by its creator is removed and created anew. */
+      bool stale;
+      auto shared_weights =
+          Attach(name, content_hash, n_weights, timeout, stale);
+      if (!stale)
+        return shared_weights;
+      shm_unlink(name.c_str());
+    }
+#endif
+    return nullptr;
+  }
+};
+
+} // namespace MLPToolbox
@@ -0,0 +1,249 @@
+/*!
+* \file CSnapshotBuffer.hpp
+* \brief Binary buffer used to write and restore snapshots of MLP collections.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CSnapshotBuffer {
+  /*!
+   *\class CSnapshotBuffer
+   *\brief Binary buffer holding a snapshot of a fully built MLP collection.
+   *Values are appended to the buffer when writing a snapshot, and read back in
+   *the same order when restoring it. The snapshot file is read with a single
+   *read operation, after which weight arrays can be used directly from the
+   *buffer without copying. Arrays are therefore aligned within the buffer.
+   */
+private:
+  std::shared_ptr<std::vector<char>> buffer; /*!< Snapshot data. */
+  std::size_t position{0}; /*!< Read position within the buffer. */
+
+  static constexpr std::size_t ARRAY_ALIGNMENT = 16; /*!< Array alignment. */
+
+  /*!
+   * \brief Advance the write or read position to the next array boundary.
+   * \param[in] writing - Pad the buffer instead of moving the read position.
+   */
+  void Align(bool writing) {
+    if (writing) {
+      while (buffer->size() % ARRAY_ALIGNMENT != 0)
+        buffer->push_back(0);
+    } else {
+      position = (position + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT *
+                 ARRAY_ALIGNMENT;
+    }
+  }
+
+  /*!
+   * \brief Check that a number of values can be read from the buffer.
+   * \param[in] n_values - Number of values to read.
+   * \param[in] value_size - Size of a value in bytes.
+   */
+  void CheckRead(std::size_t n_values, std::size_t value_size = 1) const {
+    if ((position > buffer->size()) ||
+        (n_values > (buffer->size() - position) / value_size))
+      throw std::invalid_argument("Snapshot is truncated");
+  }
+
+public:
+  CSnapshotBuffer() : buffer(std::make_shared<std::vector<char>>()) {}
+
+  /*!
+   * \brief Append an unsigned integer to the buffer.
+   * \param[in] value - Value to write.
+   */
+  void WriteSize(std::uint64_t value) {
+    const char *bytes = reinterpret_cast<const char *>(&value);
+    buffer->insert(buffer->end(), bytes, bytes + sizeof(value));
+  }
+
+  /*!
+   * \brief Append a string to the buffer.
+   * \param[in] value - String to write.
+   */
+  void WriteString(const std::string &value) {
+    WriteSize(value.size());
+    buffer->insert(buffer->end(), value.begin(), value.end());
+  }
+
+  /*!
+   * \brief Append an aligned array of values to the buffer.
+   * \param[in] values - Pointer to the first value.
+   * \param[in] n_values - Number of values.
+   */
+  template <typename T> void WriteArray(const T *values, std::size_t n_values) {
+    WriteSize(n_values);
+    Align(true);
+    if (n_values == 0)
+      return;
+    const char *bytes = reinterpret_cast<const char *>(values);
+    buffer->insert(buffer->end(), bytes, bytes + n_values * sizeof(T));
+  }
+
+  /*!
+   * \brief Append a vector of values to the buffer.
+   * \param[in] values - Values to write.
+   */
+  template <typename T> void WriteVector(const std::vector<T> &values) {
+    WriteArray(values.data(), values.size());
+  }
+
+  /*!
+   * \brief Write the buffer to a file.
+   * \param[in] filename - Snapshot file name.
+   */
+  void WriteFile(const std::string &filename) const {
+    std::ofstream file_stream(filename, std::ios::binary);
+    if (!file_stream.is_open())
+      throw std::invalid_argument("Unable to write snapshot file " + filename);
+    file_stream.write(buffer->data(), buffer->size());
+  }
+
+  /*!
+   * \brief Read a snapshot file into the buffer in a single read operation.
+   * \param[in] filename - Snapshot file name.
+   */
+  void ReadFile(const std::string &filename) {
+    std::ifstream file_stream(filename, std::ios::binary | std::ios::ate);
+    if (!file_stream.is_open())
+      throw std::invalid_argument("There is no snapshot file called " +
+                                  filename);
+    buffer = std::make_shared<std::vector<char>>(
+        static_cast<std::size_t>(file_stream.tellg()));
+    file_stream.seekg(0);
+    file_stream.read(buffer->data(), buffer->size());
+    position = 0;
+  }
+
+  /*!
+   * \brief Read an unsigned integer from the buffer.
+   * \returns Value read.
+   */
+  std::uint64_t ReadSize() {
+    std::uint64_t value;
+    CheckRead(sizeof(value));
+    std::memcpy(&value, buffer->data() + position, sizeof(value));
+    position += sizeof(value);
+    return value;
+  }
+
+  /*!
+   * \brief Read the number of items of a list from the buffer, checking that
+   * the rest of the buffer can hold them before the list is allocated.
+   * \param[in] item_size - Smallest size of an item in bytes.
+   * \returns Number of items.
+   */
+  std::size_t ReadCount(std::size_t item_size) {
+    const std::uint64_t n_items = ReadSize();
+    CheckRead(n_items, item_size);
+    return n_items;
+  }
+
+  /*!
+   * \brief Get the number of bytes which have not been read yet.
+   * \returns Number of unread bytes.
+   */
+  std::size_t GetNUnreadBytes() const {
+    return (position < buffer->size()) ? buffer->size() - position : 0;
+  }
+
+  /*!
+   * \brief Read a string from the buffer.
+   * \returns String read.
+   */
+  std::string ReadString() {
+    std::size_t length = ReadSize();
+    CheckRead(length);
+    std::string value(buffer->data() + position, length);
+    position += length;
+    return value;
+  }
+
+  /*!
+   * \brief Read fixed-length raw data from the buffer, such as a file marker.
+   * \param[in] n_bytes - Number of bytes to read.
+   * \returns Data read.
+   */
+  std::string ReadBytes(std::size_t n_bytes) {
+    CheckRead(n_bytes);
+    std::string value(buffer->data() + position, n_bytes);
+    position += n_bytes;
+    return value;
+  }
+
+  /*!
+   * \brief Append fixed-length raw data to the buffer.
+   * \param[in] value - Data to write.
+   */
+  void WriteBytes(const std::string &value) {
+    buffer->insert(buffer->end(), value.begin(), value.end());
+  }
+
+  /*!
+   * \brief Read a vector of values from the buffer.
+   * \param[out] values - Values read.
+   */
+  template <typename T> void ReadVector(std::vector<T> &values) {
+    const std::uint64_t n_values = ReadSize();
+    Align(false);
+    CheckRead(n_values, sizeof(T));
+    values.resize(n_values);
+    if (!values.empty())
+      std::memcpy(values.data(), buffer->data() + position,
+                  values.size() * sizeof(T));
+    position += values.size() * sizeof(T);
+  }
+
+  /*!
+   * \brief Map an array of values in the buffer without copying. The returned
+   * pointer keeps the buffer alive.
+   * \param[out] n_values - Number of values in the array.
+   * \returns Shared pointer to the first value.
+   */
+  std::shared_ptr<const mlpdouble> MapArray(std::size_t &n_values) {
+    n_values = ReadSize();
+    Align(false);
+    CheckRead(n_values, sizeof(mlpdouble));
+    std::shared_ptr<const mlpdouble> values(
+        buffer, reinterpret_cast<const mlpdouble *>(buffer->data() + position));
+    position += n_values * sizeof(mlpdouble);
+    return values;
+  }
+};
+
+} // namespace MLPToolbox
@@ -0,0 +1,589 @@
+/*!
+* \file CTabulatedMLP.hpp
+* \brief Adaptive piecewise-cubic table generated from an MLP look-up operation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CLookUp_ANN.hpp"
+#include "variable_def.hpp"
+
+namespace MLPToolbox {
+class CTabulatedMLP {
+  /*!
+   *\class CTabulatedMLP
+   *\brief This class replaces a look-up operation on an MLP collection with up
+   *to three call inputs by an adaptively refined piecewise-cubic table. The
+   *table is generated by sampling the look-up operation over the input range of
+   *the paired MLPs. Every cell interpolates the network outputs with a
+   *tensor-product cubic Hermite polynomial, using the analytical first-order
+   *and mixed second-order output derivatives at the cell corners. Cells are
+   *split in half along every axis until the interpolation error at the
+   *would-be child corners is below a user-defined tolerance, relative to the
+   *range of each output. The table can be written to and read from a binary
+   *file, such that it only needs to be generated once.
+   */
+private:
+  std::size_t n_dim{0},  /*!< Number of table inputs. */
+      n_outputs{0},      /*!< Number of table outputs. */
+      n_corners{0};      /*!< Number of cell corners (2^n_dim). */
+  unsigned short max_depth{10}; /*!< Maximum refinement level. */
+
+  std::vector<std::string> input_names, /*!< Table input variable names. */
+      output_names;                     /*!< Table output variable names. */
+  std::vector<mlpdouble> lower_bounds, /*!< Table lower bound per input. */
+      upper_bounds;                     /*!< Table upper bound per input. */
+
+  std::vector<mlpdouble>
+      node_data; /*!< Hermite data per node [node][output][derivative set]. */
+  std::vector<long>
+      cell_children; /*!< Index of the first child cell, -1 for leaf cells. */
+  std::vector<std::size_t>
+      cell_nodes; /*!< Corner node indices per cell [cell][corner]. */
+
+  std::map<std::uint64_t, std::size_t>
+      node_keys; /*!< Node index per lattice coordinate key (build only). */
+
+  /*!
+   * \brief Encode integer lattice coordinates into a node key. Coordinates
+   * range over [0, 2^max_depth] inclusive, which takes 21 bits per input at
+   * the maximum refinement level of 20.
+   * \param[in] lattice - Lattice coordinate per input.
+   * \returns Node key.
+   */
+  static std::uint64_t NodeKey(const std::vector<std::uint64_t> &lattice) {
+    std::uint64_t key = 0;
+    for (auto iDim = 0u; iDim < lattice.size(); iDim++)
+      key |= lattice[iDim] << (21 * iDim);
+    return key;
+  }
+
+  /*!
+   * \brief Get the node at a lattice point, sampling the look-up operation if
+   * the node does not exist yet.
+   * \param[in] ANN - MLP collection.
+   * \param[in] input_output_map - Input-output map of the look-up operation.
+   * \param[in] lattice - Lattice coordinate per input.
+   * \returns Node index.
+   */
+  std::size_t GetNode(CLookUp_ANN &ANN, CIOMap *input_output_map,
+                      const std::vector<std::uint64_t> &lattice) {
+    auto key = NodeKey(lattice);
+    auto it = node_keys.find(key);
+    if (it != node_keys.end())
+      return it->second;
+
+    std::vector<mlpdouble> inputs(n_dim), outputs(n_outputs);
+    std::vector<mlpdouble *> output_refs(n_outputs);
+    std::vector<std::vector<mlpdouble>> doutputs(
+        n_outputs, std::vector<mlpdouble>(n_dim));
+    std::vector<std::vector<mlpdouble *>> doutput_refs(
+        n_outputs, std::vector<mlpdouble *>(n_dim));
+    std::vector<std::vector<std::vector<mlpdouble>>> d2outputs(
+        n_outputs, std::vector<std::vector<mlpdouble>>(
+                       n_dim, std::vector<mlpdouble>(n_dim)));
+    std::vector<std::vector<std::vector<mlpdouble *>>> d2output_refs(
+        n_outputs, std::vector<std::vector<mlpdouble *>>(
+                       n_dim, std::vector<mlpdouble *>(n_dim)));
+    for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+      output_refs[iOutput] = &outputs[iOutput];
+      for (auto iDim = 0u; iDim < n_dim; iDim++) {
+        doutput_refs[iOutput][iDim] = &doutputs[iOutput][iDim];
+        for (auto jDim = 0u; jDim < n_dim; jDim++)
+          d2output_refs[iOutput][iDim][jDim] = &d2outputs[iOutput][iDim][jDim];
+      }
+    }
+
+    mlpdouble n_lattice = mlpdouble(std::uint64_t(1) << max_depth);
+    for (auto iDim = 0u; iDim < n_dim; iDim++)
+      inputs[iDim] = lower_bounds[iDim] + (upper_bounds[iDim] - lower_bounds[iDim]) *
+                                              mlpdouble(lattice[iDim]) / n_lattice;
+    ANN.PredictANN(input_output_map, inputs, output_refs, &doutput_refs,
+                   n_dim > 1 ? &d2output_refs : nullptr);
+
+    /* Store value, first derivatives and mixed second derivatives. The mixed
+     * third derivative used in three-dimensional tables is not available and
+     * set to zero. */
+    std::size_t iNode = node_data.size() / (n_outputs * n_corners);
+    for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+      for (auto iSet = 0u; iSet < n_corners; iSet++) {
+        std::vector<std::size_t> axes;
+        for (auto iDim = 0u; iDim < n_dim; iDim++)
+          if (iSet & (1u << iDim))
+            axes.push_back(iDim);
+        mlpdouble value = 0;
+        if (axes.size() == 0)
+          value = outputs[iOutput];
+        else if (axes.size() == 1)
+          value = doutputs[iOutput][axes[0]];
+        else if (axes.size() == 2)
+          value = d2outputs[iOutput][axes[0]][axes[1]];
+        node_data.push_back(value);
+      }
+    }
+    node_keys[key] = iNode;
+    return iNode;
+  }
+
+  /*!
+   * \brief Evaluate the cubic Hermite basis functions along one axis.
+   * \param[in] t - Local cell coordinate (0-1).
+   * \param[in] h - Cell size.
+   * \param[out] B - Basis values [corner][derivative flag].
+   * \param[out] dB - Basis derivatives w.r.t. the dimensional input.
+   */
+  static void HermiteBasis(mlpdouble t, mlpdouble h, mlpdouble B[2][2],
+                           mlpdouble dB[2][2]) {
+    mlpdouble t2 = t * t, t3 = t2 * t;
+    B[0][0] = 2 * t3 - 3 * t2 + 1;
+    B[1][0] = -2 * t3 + 3 * t2;
+    B[0][1] = (t3 - 2 * t2 + t) * h;
+    B[1][1] = (t3 - t2) * h;
+    dB[0][0] = (6 * t2 - 6 * t) / h;
+    dB[1][0] = (-6 * t2 + 6 * t) / h;
+    dB[0][1] = 3 * t2 - 4 * t + 1;
+    dB[1][1] = 3 * t2 - 2 * t;
+  }
+
+  /*!
+   * \brief Interpolate the table outputs within a cell.
+   * \param[in] iCell - Cell index.
+   * \param[in] inputs - Table input values.
+   * \param[in] lower - Cell lower bound per input.
+   * \param[in] upper - Cell upper bound per input.
+   * \param[out] values - Interpolated outputs.
+   * \param[out] gradients - Optional interpolated output gradients.
+   */
+  void InterpolateCell(std::size_t iCell, const std::vector<mlpdouble> &inputs,
+                       const std::vector<mlpdouble> &lower,
+                       const std::vector<mlpdouble> &upper,
+                       std::vector<mlpdouble> &values,
+                       std::vector<std::vector<mlpdouble>> *gradients) const {
+    mlpdouble B[3][2][2], dB[3][2][2];
+    for (auto iDim = 0u; iDim < n_dim; iDim++) {
+      mlpdouble h = upper[iDim] - lower[iDim];
+      HermiteBasis((inputs[iDim] - lower[iDim]) / h, h, B[iDim], dB[iDim]);
+    }
+    values.assign(n_outputs, 0.0);
+    if (gradients != nullptr)
+      gradients->assign(n_outputs, std::vector<mlpdouble>(n_dim, 0.0));
+
+    for (auto iCorner = 0u; iCorner < n_corners; iCorner++) {
+      const mlpdouble *data =
+          &node_data[cell_nodes[iCell * n_corners + iCorner] * n_outputs *
+                     n_corners];
+      for (auto iSet = 0u; iSet < n_corners; iSet++) {
+        mlpdouble weight = 1, dweight[3] = {1, 1, 1};
+        for (auto iDim = 0u; iDim < n_dim; iDim++) {
+          auto c = (iCorner >> iDim) & 1u, s = (iSet >> iDim) & 1u;
+          for (auto jDim = 0u; jDim < n_dim; jDim++)
+            dweight[jDim] *= (jDim == iDim) ? dB[iDim][c][s] : B[iDim][c][s];
+          weight *= B[iDim][c][s];
+        }
+        for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+          mlpdouble coefficient = data[iOutput * n_corners + iSet];
+          values[iOutput] += coefficient * weight;
+          if (gradients != nullptr)
+            for (auto iDim = 0u; iDim < n_dim; iDim++)
+              (*gradients)[iOutput][iDim] += coefficient * dweight[iDim];
+        }
+      }
+    }
+  }
+
+  /*!
+   * \brief Find the leaf cell containing a point.
+   * \param[in] inputs - Table input values.
+   * \param[out] lower - Cell lower bound per input.
+   * \param[out] upper - Cell upper bound per input.
+   * \returns Leaf cell index.
+   */
+  std::size_t FindCell(const std::vector<mlpdouble> &inputs,
+                       std::vector<mlpdouble> &lower,
+                       std::vector<mlpdouble> &upper) const {
+    lower = lower_bounds;
+    upper = upper_bounds;
+    std::size_t iCell = 0;
+    while (cell_children[iCell] >= 0) {
+      std::size_t iChild = 0;
+      for (auto iDim = 0u; iDim < n_dim; iDim++) {
+        mlpdouble middle = 0.5 * (lower[iDim] + upper[iDim]);
+        if (inputs[iDim] >= middle) {
+          iChild |= (1u << iDim);
+          lower[iDim] = middle;
+        } else {
+          upper[iDim] = middle;
+        }
+      }
+      iCell = cell_children[iCell] + iChild;
+    }
+    return iCell;
+  }
+
+public:
+  /*!
+   * \brief Generate the table for a look-up operation.
+   * \param[in] ANN - MLP collection.
+   * \param[in] input_output_map - Input-output map of the look-up operation,
+   * paired with the MLP collection.
+   * \param[in] tolerance - Maximum interpolation error relative to the range of
+   * each output.
+   * \param[in] max_level - Maximum refinement level (at most 20).
+   * \param[in] min_level - Uniform refinement level applied before adaptive
+   * refinement.
+   */
+  void Build(CLookUp_ANN &ANN, CIOMap *input_output_map, mlpdouble tolerance,
+             unsigned short max_level = 10, unsigned short min_level = 2) {
+    input_names = input_output_map->GetInputVars();
+    output_names = input_output_map->GetOutputVars();
+    n_dim = input_names.size();
+    n_outputs = output_names.size();
+    if ((n_dim < 1) || (n_dim > 3))
+      throw std::invalid_argument(
+          "Tabulation is only supported for look-up operations with one to "
+          "three inputs.");
+    if (max_level > 20)
+      throw std::invalid_argument("Maximum table refinement level is 20.");
+    n_corners = std::size_t(1) << n_dim;
+    max_depth = max_level;
+
+    lower_bounds.resize(n_dim);
+    upper_bounds.resize(n_dim);
+    for (auto iDim = 0u; iDim < n_dim; iDim++) {
+      auto bounds = ANN.GetInputBounds(input_output_map, iDim);
+      lower_bounds[iDim] = bounds.first;
+      upper_bounds[iDim] = bounds.second;
+    }
+
+    node_data.clear();
+    node_keys.clear();
+    cell_children.assign(1, -1);
+    cell_nodes.clear();
+
+    /* Output ranges at the corners of the uniform initial grid scale the
+     * tolerance. */
+    std::vector<mlpdouble> output_min(n_outputs,
+                                      std::numeric_limits<mlpdouble>::max()),
+        output_max(n_outputs, std::numeric_limits<mlpdouble>::lowest());
+    std::uint64_t n_initial = std::uint64_t(1) << std::min(min_level, max_level);
+    std::uint64_t n_lattice_initial = 1;
+    for (auto iDim = 0u; iDim < n_dim; iDim++)
+      n_lattice_initial *= (n_initial + 1);
+    std::vector<std::uint64_t> lattice(n_dim);
+    for (auto iPoint = 0u; iPoint < n_lattice_initial; iPoint++) {
+      std::uint64_t index = iPoint;
+      for (auto iDim = 0u; iDim < n_dim; iDim++) {
+        lattice[iDim] = (index % (n_initial + 1)) << (max_depth - std::min(min_level, max_level));
+        index /= (n_initial + 1);
+      }
+      auto iNode = GetNode(ANN, input_output_map, lattice);
+      for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+        mlpdouble value = node_data[iNode * n_outputs * n_corners + iOutput * n_corners];
+        output_min[iOutput] = std::min(output_min[iOutput], value);
+        output_max[iOutput] = std::max(output_max[iOutput], value);
+      }
+    }
+    std::vector<mlpdouble> abs_tolerance(n_outputs);
+    for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+      mlpdouble range = output_max[iOutput] - output_min[iOutput];
+      abs_tolerance[iOutput] = tolerance * ((range > 0) ? range : 1.0);
+    }
+
+    /* Refine cells depth-first, starting from the root cell. */
+    std::vector<std::size_t> cell_stack{0};
+    std::vector<std::vector<std::uint64_t>> cell_origin{
+        std::vector<std::uint64_t>(n_dim, 0)};
+    std::vector<unsigned short> cell_level{0};
+    std::vector<mlpdouble> x_test(n_dim), lower(n_dim), upper(n_dim), values;
+    std::uint64_t n_test = 1;
+    for (auto iDim = 0u; iDim < n_dim; iDim++)
+      n_test *= 3;
+
+    while (!cell_stack.empty()) {
+      auto iCell = cell_stack.back();
+      cell_stack.pop_back();
+      auto origin = cell_origin[iCell];
+      auto level = cell_level[iCell];
+      std::uint64_t size = std::uint64_t(1) << (max_depth - level);
+
+      /* Corner nodes */
+      for (auto iCorner = 0u; iCorner < n_corners; iCorner++) {
+        for (auto iDim = 0u; iDim < n_dim; iDim++)
+          lattice[iDim] = origin[iDim] + (((iCorner >> iDim) & 1u) ? size : 0);
+        cell_nodes.resize(std::max(cell_nodes.size(), (iCell + 1) * n_corners));
+        cell_nodes[iCell * n_corners + iCorner] =
+            GetNode(ANN, input_output_map, lattice);
+      }
+
+      bool split = (level < min_level) && (level < max_depth);
+      if (!split && (level < max_depth)) {
+        /* Compare interpolation with the network at the would-be child
+         * corners. */
+        mlpdouble n_lattice = mlpdouble(std::uint64_t(1) << max_depth);
+        for (auto iDim = 0u; iDim < n_dim; iDim++) {
+          mlpdouble scale = (upper_bounds[iDim] - lower_bounds[iDim]) / n_lattice;
+          lower[iDim] = lower_bounds[iDim] + scale * mlpdouble(origin[iDim]);
+          upper[iDim] = lower_bounds[iDim] + scale * mlpdouble(origin[iDim] + size);
+        }
+        for (auto iTest = 0u; (iTest < n_test) && !split; iTest++) {
+          std::uint64_t index = iTest;
+          bool is_corner = true;
+          for (auto iDim = 0u; iDim < n_dim; iDim++) {
+            auto offset = index % 3;
+            index /= 3;
+            if (offset == 1)
+              is_corner = false;
+            lattice[iDim] = origin[iDim] + offset * (size / 2);
+          }
+          if (is_corner)
+            continue;
+          auto iNode = GetNode(ANN, input_output_map, lattice);
+          for (auto iDim = 0u; iDim < n_dim; iDim++)
+            x_test[iDim] = lower_bounds[iDim] +
+                           (upper_bounds[iDim] - lower_bounds[iDim]) *
+                               mlpdouble(lattice[iDim]) / n_lattice;
+          InterpolateCell(iCell, x_test, lower, upper, values, nullptr);
+          for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+            mlpdouble reference =
+                node_data[iNode * n_outputs * n_corners + iOutput * n_corners];
+            if (fabs(values[iOutput] - reference) > abs_tolerance[iOutput])
+              split = true;
+          }
+        }
+      }
+
+      if (split) {
+        std::size_t iFirstChild = cell_children.size();
+        cell_children[iCell] = long(iFirstChild);
+        for (auto iChild = 0u; iChild < n_corners; iChild++) {
+          std::vector<std::uint64_t> child_origin(n_dim);
+          for (auto iDim = 0u; iDim < n_dim; iDim++)
+            child_origin[iDim] =
+                origin[iDim] + (((iChild >> iDim) & 1u) ? size / 2 : 0);
+          cell_children.push_back(-1);
+          cell_origin.push_back(child_origin);
+          cell_level.push_back(level + 1);
+          cell_stack.push_back(iFirstChild + iChild);
+        }
+      }
+    }
+    node_keys.clear();
+  }
+
+  /*!
+   * \brief Interpolate the table outputs and output gradients.
+   * \param[in] inputs - Call input values.
+   * \param[in] outputs - Pointers to call output variables.
+   * \param[in] doutputs_dinputs - Pointers to output derivatives w.r.t. inputs.
+   * \returns 0 if the query lies within the table range, 1 otherwise (in which
+   * case the nearest cell is extrapolated).
+   */
+  unsigned long Predict(
+      const std::vector<mlpdouble> &inputs, std::vector<mlpdouble *> &outputs,
+      const std::vector<std::vector<mlpdouble *>> *doutputs_dinputs =
+          nullptr) const {
+    std::vector<mlpdouble> lower, upper, values;
+    std::vector<std::vector<mlpdouble>> gradients;
+    bool within_range = true;
+    for (auto iDim = 0u; iDim < n_dim; iDim++)
+      if ((inputs[iDim] < lower_bounds[iDim]) ||
+          (inputs[iDim] > upper_bounds[iDim]))
+        within_range = false;
+
+    auto iCell = FindCell(inputs, lower, upper);
+    InterpolateCell(iCell, inputs, lower, upper, values,
+                    doutputs_dinputs != nullptr ? &gradients : nullptr);
+    for (auto iOutput = 0u; iOutput < n_outputs; iOutput++) {
+      *outputs[iOutput] = values[iOutput];
+      if (doutputs_dinputs != nullptr)
+        for (auto iDim = 0u; iDim < n_dim; iDim++)
+          *(doutputs_dinputs->at(iOutput).at(iDim)) = gradients[iOutput][iDim];
+    }
+    return within_range ? 0 : 1;
+  }
+
+  /*!
+   * \brief Get the number of table nodes.
+   * \returns Number of sampled nodes.
+   */
+  std::size_t GetNNodes() const {
+    return (n_outputs * n_corners > 0) ? node_data.size() / (n_outputs * n_corners) : 0;
+  }
+
+  /*!
+   * \brief Get the number of table cells, including refined parent cells.
+   * \returns Number of cells.
+   */
+  std::size_t GetNCells() const { return cell_children.size(); }
+
+  /*!
+   * \brief Get table input variable names.
+   * \returns Input variable names.
+   */
+  std::vector<std::string> GetInputVars() const { return input_names; }
+
+  /*!
+   * \brief Get table output variable names.
+   * \returns Output variable names.
+   */
+  std::vector<std::string> GetOutputVars() const { return output_names; }
+
+  /*!
+   * \brief Write the table to a binary file.
+   * \param[in] filename - Table file name.
+   */
+  void WriteTable(const std::string &filename) const {
+    std::ofstream file_stream(filename, std::ios::binary);
+    if (!file_stream.is_open())
+      throw std::invalid_argument("Unable to write table file " + filename);
+
+    auto write_size = [&file_stream](std::uint64_t value) {
+      file_stream.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+    auto write_string = [&](const std::string &value) {
+      write_size(value.size());
+      file_stream.write(value.data(), value.size());
+    };
+    file_stream.write("MLPCPPTB", 8);
+    write_size(sizeof(mlpdouble));
+    write_size(n_dim);
+    write_size(n_outputs);
+    write_size(max_depth);
+    for (auto &name : input_names)
+      write_string(name);
+    for (auto &name : output_names)
+      write_string(name);
+    file_stream.write(reinterpret_cast<const char *>(lower_bounds.data()),
+                      n_dim * sizeof(mlpdouble));
+    file_stream.write(reinterpret_cast<const char *>(upper_bounds.data()),
+                      n_dim * sizeof(mlpdouble));
+    write_size(node_data.size());
+    file_stream.write(reinterpret_cast<const char *>(node_data.data()),
+                      node_data.size() * sizeof(mlpdouble));
+    write_size(cell_children.size());
+    file_stream.write(reinterpret_cast<const char *>(cell_children.data()),
+                      cell_children.size() * sizeof(long));
+    write_size(cell_nodes.size());
+    file_stream.write(reinterpret_cast<const char *>(cell_nodes.data()),
+                      cell_nodes.size() * sizeof(std::size_t));
+  }
+
+  /*!
+   * \brief Read the table from a binary file written by WriteTable.
+   * \param[in] filename - Table file name.
+   */
+  void ReadTable(const std::string &filename) {
+    std::ifstream file_stream(filename, std::ios::binary | std::ios::ate);
+    if (!file_stream.is_open())
+      throw std::invalid_argument("There is no table file called " + filename);
+    const std::streamoff file_size = file_stream.tellg();
+    file_stream.seekg(0);
+
+    auto check = [&filename](bool valid) {
+      if (!valid)
+        throw std::invalid_argument("Table file " + filename + " is corrupt");
+    };
+    auto read_size = [&file_stream]() {
+      std::uint64_t value = 0;
+      file_stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+      return value;
+    };
+    /* Counts are checked against the rest of the file before allocating. */
+    auto read_count = [&](std::size_t item_size) {
+      std::uint64_t n_items = read_size();
+      check(file_stream &&
+            (n_items <= std::uint64_t(file_size - file_stream.tellg()) /
+                            item_size));
+      return std::size_t(n_items);
+    };
+    auto read_string = [&]() {
+      std::string value(read_count(1), ' ');
+      file_stream.read(&value[0], value.size());
+      return value;
+    };
+    char header[8];
+    file_stream.read(header, 8);
+    if (!file_stream || (std::strncmp(header, "MLPCPPTB", 8) != 0) ||
+        (read_size() != sizeof(mlpdouble)))
+      throw std::invalid_argument(filename + " is not a compatible table file");
+    n_dim = read_size();
+    n_outputs = read_count(sizeof(std::uint64_t));
+    const std::uint64_t depth = read_size();
+    check(file_stream && (n_dim >= 1) && (n_dim <= 3) && (n_outputs > 0) &&
+          (depth <= 20));
+    max_depth = static_cast<unsigned short>(depth);
+    n_corners = std::size_t(1) << n_dim;
+    input_names.resize(n_dim);
+    for (auto &name : input_names)
+      name = read_string();
+    output_names.resize(n_outputs);
+    for (auto &name : output_names)
+      name = read_string();
+    lower_bounds.resize(n_dim);
+    upper_bounds.resize(n_dim);
+    file_stream.read(reinterpret_cast<char *>(lower_bounds.data()),
+                     n_dim * sizeof(mlpdouble));
+    file_stream.read(reinterpret_cast<char *>(upper_bounds.data()),
+                     n_dim * sizeof(mlpdouble));
+    node_data.resize(read_count(sizeof(mlpdouble)));
+    file_stream.read(reinterpret_cast<char *>(node_data.data()),
+                     node_data.size() * sizeof(mlpdouble));
+    cell_children.resize(read_count(sizeof(long)));
+    file_stream.read(reinterpret_cast<char *>(cell_children.data()),
+                     cell_children.size() * sizeof(long));
+    cell_nodes.resize(read_count(sizeof(std::size_t)));
+    file_stream.read(reinterpret_cast<char *>(cell_nodes.data()),
+                     cell_nodes.size() * sizeof(std::size_t));
+    if (!file_stream)
+      throw std::invalid_argument("Table file " + filename + " is truncated");
+
+    /* Every cell has its corner nodes, and children follow their parent such
+     * that FindCell always descends to a leaf. */
+    check((node_data.size() % (n_outputs * n_corners) == 0) &&
+          !cell_children.empty() &&
+          (cell_nodes.size() == cell_children.size() * n_corners));
+    const std::size_t n_nodes = GetNNodes(), n_cells = cell_children.size();
+    for (auto iCell = 0u; iCell < n_cells; iCell++) {
+      const long iChild = cell_children[iCell];
+      check((iChild == -1) ||
+            ((iChild > long(iCell)) &&
+             (std::size_t(iChild) + n_corners <= n_cells)));
+    }
+    for (auto iNode : cell_nodes)
+      check(iNode < n_nodes);
+  }
+};
+
+} // namespace MLPToolbox
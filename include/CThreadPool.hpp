@@ -0,0 +1,350 @@
+/*!
+* \file CThreadPool.hpp
+* \brief Persistent pool of worker threads for parallel loops within a network
+evaluation.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CNumaTopology.hpp"
+
+namespace MLPToolbox {
+class CThreadPool {
+  /*!
+   *\class CThreadPool
+   *\brief Process-wide pool of persistent worker threads, used to split the
+   *neurons of wide layers of a single network evaluation over several cores.
+   *A parallel loop hands its tasks to the waiting workers, runs tasks on the
+   *calling thread as well, and returns once all tasks are done, which acts as
+   *a barrier between consecutive layers. Workers spin briefly before going to
+   *sleep, such that the layers of one evaluation follow each other without
+   *wake-up delays. The pool serves one parallel loop at a time; loops started
+   *while the pool is busy, for example from another evaluating thread, run on
+   *the calling thread only. Optionally, the workers are pinned to the CPUs
+   *of the NUMA nodes of the machine (see CNumaTopology), spread evenly over
+   *the nodes, such that data a worker allocates stays local to it.
+   *Besides parallel loops, the pool runs asynchronous jobs on workers that are
+   *not taking part in a loop. Loops started by such a job run on the worker
+   *itself, and loops of other threads wait for workers busy with a job.
+   */
+private:
+  std::vector<std::thread> workers; /*!< Worker threads. */
+  std::mutex submit_mutex,          /*!< Held by the loop using the pool. */
+      pool_mutex;                   /*!< Guards the loop state. */
+  std::condition_variable start_condition, /*!< Signals a new loop. */
+      done_condition; /*!< Signals that all workers finished the loop. */
+
+  const std::function<void(std::size_t)> *loop_task{
+      nullptr};                    /*!< Task of the current loop. */
+  std::size_t n_tasks{0};          /*!< Number of tasks of the current loop. */
+  bool per_thread{false}; /*!< The current loop runs one task per thread,
+                             indexed by the thread. */
+  std::atomic<std::size_t> next_task{0}; /*!< Next task to be claimed. */
+  std::atomic<unsigned long> loop_index{0}; /*!< Number of loops started. */
+  std::size_t n_busy{0}; /*!< Workers which did not finish the loop yet. */
+  bool stopping{false};  /*!< Workers are asked to exit. */
+  bool pinned{false};    /*!< Workers are pinned to CPUs. */
+  std::deque<std::function<void()>> jobs; /*!< Asynchronous jobs. */
+  std::atomic<std::size_t> n_jobs{0};     /*!< Number of queued jobs. */
+  std::vector<std::size_t> thread_nodes; /*!< NUMA node per pinned thread. */
+
+  /*!
+   * \brief Start the pool with one worker less than the number of hardware
+   * threads, the calling thread being the remaining one.
+   */
+  CThreadPool() {
+    SetNThreads(std::max(1u, std::thread::hardware_concurrency()));
+  }
+
+  ~CThreadPool() { StopWorkers(); }
+
+  /*!
+   * \brief Flag marking the worker threads of the pool.
+   * \returns Reference to the flag of the calling thread.
+   */
+  static bool &IsWorkerThread() {
+    static thread_local bool is_worker = false;
+    return is_worker;
+  }
+
+  /*!
+   * \brief Claim and run tasks of the current loop until none are left.
+   * \param[in] iThread - Index of the running thread.
+   */
+  void RunTasks(std::size_t iThread) {
+    if (per_thread) {
+      (*loop_task)(iThread);
+      return;
+    }
+    for (std::size_t iTask = next_task++; iTask < n_tasks;
+         iTask = next_task++)
+      (*loop_task)(iTask);
+  }
+
+  /*!
+   * \brief Main loop of a worker thread.
+   * \param[in] iThread - Index of the worker thread.
+   * \param[in] cpu - CPU to pin the worker to, negative to leave it unpinned.
+   * \param[in] last_loop - Loop count when the worker was started, such that
+   * loops started before the thread runs are not missed.
+   */
+  void WorkerLoop(std::size_t iThread, int cpu, unsigned long last_loop) {
+    if (cpu >= 0)
+      CNumaTopology::PinCurrentThread(cpu);
+    IsWorkerThread() = true;
+    for (;;) {
+      /* Spin for a short while before waiting for the next loop or job. */
+      for (auto iSpin = 0u; (iSpin < 2000) &&
+                            (loop_index.load() == last_loop) &&
+                            (n_jobs.load() == 0);
+           iSpin++)
+        std::this_thread::yield();
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        start_condition.wait(lock, [&] {
+          return stopping || (loop_index.load() != last_loop) || !jobs.empty();
+        });
+        if (loop_index.load() == last_loop) {
+          /* Queued jobs are completed before the workers exit. */
+          if (jobs.empty())
+            return;
+          job = std::move(jobs.front());
+          jobs.pop_front();
+          n_jobs--;
+        } else {
+          last_loop = loop_index.load();
+        }
+      }
+      if (job) {
+        job();
+        continue;
+      }
+      RunTasks(iThread);
+      {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (--n_busy == 0)
+          done_condition.notify_one();
+      }
+    }
+  }
+
+  /*!
+   * \brief Ask the workers to exit and wait for them.
+   */
+  void StopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      stopping = true;
+    }
+    start_condition.notify_all();
+    for (auto &worker : workers)
+      worker.join();
+    workers.clear();
+    stopping = false;
+  }
+
+  /*!
+   * \brief Start the workers. Pinned threads are dealt to the NUMA nodes in
+   * contiguous blocks, and to the CPUs of their node in turn.
+   * \param[in] n_threads - Number of threads, including the calling thread.
+   */
+  void StartWorkers(std::size_t n_threads) {
+    const CNumaTopology &topology = CNumaTopology::GetInstance();
+    const std::size_t nNodes = topology.GetNNodes();
+    thread_nodes.assign(n_threads, 0);
+    std::size_t iFirstOfNode = 0;
+    for (auto iThread = 0u; iThread < n_threads; iThread++) {
+      const std::size_t iNode = iThread * nNodes / n_threads;
+      if ((iThread == 0) || (iNode != thread_nodes[iThread - 1]))
+        iFirstOfNode = iThread;
+      thread_nodes[iThread] = iNode;
+      if (iThread == 0)
+        continue;
+      const std::vector<int> &cpus = topology.GetNodeCPUs(iNode);
+      const int cpu = pinned ? cpus[(iThread - iFirstOfNode) % cpus.size()] : -1;
+      workers.emplace_back(&CThreadPool::WorkerLoop, this, iThread, cpu,
+                           loop_index.load());
+    }
+  }
+
+public:
+  CThreadPool(const CThreadPool &) = delete;
+  CThreadPool &operator=(const CThreadPool &) = delete;
+
+  /*!
+   * \brief Get the process-wide thread pool.
+   * \returns Reference to the thread pool.
+   */
+  static CThreadPool &GetInstance() {
+    static CThreadPool instance;
+    return instance;
+  }
+
+  /*!
+   * \brief Set the number of threads taking part in parallel loops, including
+   * the calling thread. This should not be done while loops are running.
+   * \param[in] n_threads - Number of threads, at least one.
+   */
+  void SetNThreads(std::size_t n_threads) {
+    std::lock_guard<std::mutex> submit_lock(submit_mutex);
+    StopWorkers();
+    StartWorkers(std::max<std::size_t>(n_threads, 1));
+  }
+
+  /*!
+   * \brief Get the number of threads taking part in parallel loops.
+   * \returns Number of worker threads plus the calling thread.
+   */
+  std::size_t GetNThreads() const { return workers.size() + 1; }
+
+  /*!
+   * \brief Pin the worker threads to the CPUs of the NUMA nodes, or release
+   * them. The workers are restarted, which should not be done while loops are
+   * running. The calling thread of a loop is never pinned.
+   * \param[in] pin - Pin the workers.
+   */
+  void SetPinning(bool pin) {
+    std::lock_guard<std::mutex> submit_lock(submit_mutex);
+    const std::size_t n_threads = workers.size() + 1;
+    StopWorkers();
+    pinned = pin;
+    StartWorkers(n_threads);
+  }
+
+  /*!
+   * \brief Check whether the worker threads are pinned to CPUs.
+   * \returns Workers are pinned.
+   */
+  bool IsPinned() const { return pinned; }
+
+  /*!
+   * \brief Get the NUMA node a thread of the pool runs on. For the calling
+   * thread, index zero, this is the node it currently runs on. Without
+   * pinning, all threads are attributed to node zero.
+   * \param[in] iThread - Thread index, below GetNThreads.
+   * \returns Node index.
+   */
+  std::size_t GetThreadNode(std::size_t iThread) const {
+    if (!pinned)
+      return 0;
+    if (iThread == 0)
+      return CNumaTopology::GetInstance().GetCurrentNode();
+    return thread_nodes[iThread];
+  }
+
+  /*!
+   * \brief Run a set of independent tasks in parallel and wait until all of
+   * them are done. Tasks must not throw.
+   * \param[in] n - Number of tasks.
+   * \param[in] task - Function running the task with the given index.
+   */
+  void ParallelFor(std::size_t n, const std::function<void(std::size_t)> &task) {
+    RunLoop(n, task, false);
+  }
+
+  /*!
+   * \brief Run a task once on every thread of the pool, passing the index of
+   * the thread, and wait until all of them are done. This allows per-thread
+   * data to be allocated and used by the same, possibly pinned, thread. When
+   * the pool is busy, all thread indices are run on the calling thread.
+   * Tasks must not throw.
+   * \param[in] task - Function running the task of the thread with the given
+   * index.
+   */
+  void ForEachThread(const std::function<void(std::size_t)> &task) {
+    RunLoop(workers.size() + 1, task, true);
+  }
+
+  /*!
+   * \brief Queue a job to be run asynchronously by the next available worker,
+   * in submission order. Without workers, the job is run immediately on the
+   * calling thread. Jobs must not throw.
+   * \param[in] job - Function running the job.
+   */
+  void SubmitJob(std::function<void()> job) {
+    bool queued = false;
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      if (!workers.empty()) {
+        jobs.push_back(std::move(job));
+        n_jobs++;
+        queued = true;
+      }
+    }
+    if (queued)
+      start_condition.notify_one();
+    else
+      job();
+  }
+
+private:
+  /*!
+   * \brief Hand a loop to the workers, take part in it and wait for it to
+   * finish.
+   * \param[in] n - Number of tasks.
+   * \param[in] task - Function running the task with the given index.
+   * \param[in] by_thread - Run task iThread on thread iThread.
+   */
+  void RunLoop(std::size_t n, const std::function<void(std::size_t)> &task,
+               bool by_thread) {
+    std::unique_lock<std::mutex> submit_lock(submit_mutex, std::defer_lock);
+    if (IsWorkerThread() || !submit_lock.try_lock() || workers.empty() ||
+        (n < 2) ||
+        (by_thread && (n != workers.size() + 1))) {
+      for (auto iTask = 0u; iTask < n; iTask++)
+        task(iTask);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      loop_task = &task;
+      n_tasks = n;
+      per_thread = by_thread;
+      next_task = 0;
+      n_busy = workers.size();
+      loop_index++;
+    }
+    start_condition.notify_all();
+    RunTasks(0);
+
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    done_condition.wait(lock, [&] { return n_busy == 0; });
+  }
+};
+
+} // namespace MLPToolbox
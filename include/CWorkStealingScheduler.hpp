@@ -0,0 +1,201 @@
+/*!
+* \file CWorkStealingScheduler.hpp
+* \brief Cost-weighted work-stealing distribution of batch evaluations over the
+thread pool.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "CThreadPool.hpp"
+
+namespace MLPToolbox {
+class CWorkStealingScheduler {
+  /*!
+   *\class CWorkStealingScheduler
+   *\brief Distributes the points of a batch over the threads of the
+   *process-wide thread pool according to an estimated cost per point. The
+   *points are split into contiguous chunks of about equal cost, several per
+   *thread, and consecutive chunks are dealt to each thread such that all
+   *threads start with the same estimated amount of work. Each thread takes
+   *chunks from the front of its own queue; once its queue is empty, it steals
+   *chunks from the back of the queues of the other threads. Threads thereby
+   *keep working on neighbouring points for as long as possible, while
+   *differences between estimated and actual cost are balanced at the end.
+   *Chunks are stolen from threads on the same NUMA node first.
+   */
+private:
+  using Chunk = std::pair<std::size_t, std::size_t>;
+
+  /*!
+   * \brief Chunk queue of a single thread.
+   */
+  struct CChunkQueue {
+    std::mutex queue_mutex;    /*!< Guards the queue. */
+    std::deque<Chunk> chunks;  /*!< Point ranges [begin, end) to evaluate. */
+  };
+
+  std::vector<std::unique_ptr<CChunkQueue>> queues; /*!< Queue per thread. */
+  std::size_t chunks_per_thread{8}; /*!< Number of chunks per thread. */
+  std::vector<unsigned long> n_steals; /*!< Chunks taken from the queues of
+                                          other threads, per thread. */
+  std::vector<std::size_t> thread_nodes; /*!< NUMA node per thread. */
+
+  /*!
+   * \brief Take the next chunk from the front of the queue of a thread.
+   * \param[in] iThread - Thread index.
+   * \param[out] chunk - Point range of the chunk.
+   * \returns A chunk was available.
+   */
+  bool PopChunk(std::size_t iThread, Chunk &chunk) {
+    CChunkQueue &queue = *queues[iThread];
+    std::lock_guard<std::mutex> lock(queue.queue_mutex);
+    if (queue.chunks.empty())
+      return false;
+    chunk = queue.chunks.front();
+    queue.chunks.pop_front();
+    return true;
+  }
+
+  /*!
+   * \brief Take a chunk from the back of the queue of another thread.
+   * \param[in] iThread - Index of the stealing thread.
+   * \param[out] chunk - Point range of the chunk.
+   * \returns A chunk was available.
+   */
+  bool StealChunk(std::size_t iThread, Chunk &chunk) {
+    for (auto local : {true, false}) {
+      for (auto iOffset = 1u; iOffset < queues.size(); iOffset++) {
+        const std::size_t iVictim = (iThread + iOffset) % queues.size();
+        if ((thread_nodes[iVictim] == thread_nodes[iThread]) != local)
+          continue;
+        CChunkQueue &queue = *queues[iVictim];
+        std::lock_guard<std::mutex> lock(queue.queue_mutex);
+        if (queue.chunks.empty())
+          continue;
+        chunk = queue.chunks.back();
+        queue.chunks.pop_back();
+        n_steals[iThread]++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  /*!
+   * \brief Set the number of chunks the points are split into per thread. More
+   * chunks balance better, fewer chunks keep more neighbouring points on the
+   * same thread.
+   * \param[in] n_chunks - Number of chunks per thread.
+   */
+  void SetChunksPerThread(std::size_t n_chunks) {
+    chunks_per_thread = std::max<std::size_t>(n_chunks, 1);
+  }
+
+  /*!
+   * \brief Get the number of chunks stolen from other threads since the
+   * scheduler was created.
+   * \returns Number of stolen chunks.
+   */
+  unsigned long GetNSteals() const {
+    unsigned long n_total = 0;
+    for (auto n : n_steals)
+      n_total += n;
+    return n_total;
+  }
+
+  /*!
+   * \brief Evaluate a batch of points on the threads of the thread pool and
+   * wait until all points are done.
+   * \param[in] costs - Estimated cost per point.
+   * \param[in] task - Function evaluating the points [begin, end) on the
+   * thread with the given index, below CThreadPool::GetNThreads. Each thread
+   * index is served by the pool thread of that index, unless the pool is
+   * busy, in which case the calling thread serves all of them.
+   */
+  void Run(const std::vector<double> &costs,
+           const std::function<void(std::size_t, std::size_t, std::size_t)>
+               &task) {
+    CThreadPool &pool = CThreadPool::GetInstance();
+    const std::size_t nThreads = pool.GetNThreads(), nPoints = costs.size();
+    if (nPoints == 0)
+      return;
+
+    queues.resize(nThreads);
+    thread_nodes.resize(nThreads);
+    for (auto iThread = 0u; iThread < nThreads; iThread++)
+      thread_nodes[iThread] = pool.GetThreadNode(iThread);
+    if (n_steals.size() < nThreads)
+      n_steals.resize(nThreads, 0);
+    for (auto &queue : queues) {
+      if (!queue)
+        queue.reset(new CChunkQueue);
+      queue->chunks.clear();
+    }
+
+    /* Points without a cost estimate are weighted equally. */
+    double total_cost = 0;
+    for (auto cost : costs)
+      total_cost += cost;
+    const bool uniform = !(total_cost > 0);
+    if (uniform)
+      total_cost = static_cast<double>(nPoints);
+    const double chunk_cost = total_cost / (nThreads * chunks_per_thread);
+
+    /* Deal contiguous chunks to the threads by their cumulative cost. */
+    double chunk_start_cost = 0, accumulated_cost = 0;
+    std::size_t iBegin = 0;
+    for (auto iPoint = 0u; iPoint < nPoints; iPoint++) {
+      accumulated_cost += uniform ? 1.0 : costs[iPoint];
+      if ((accumulated_cost - chunk_start_cost < chunk_cost) &&
+          (iPoint + 1 < nPoints))
+        continue;
+      std::size_t iThread = std::min(
+          nThreads - 1, static_cast<std::size_t>(chunk_start_cost * nThreads /
+                                                 total_cost));
+      queues[iThread]->chunks.emplace_back(iBegin, iPoint + 1);
+      chunk_start_cost = accumulated_cost;
+      iBegin = iPoint + 1;
+    }
+
+    pool.ForEachThread([&](std::size_t iThread) {
+      Chunk chunk;
+      while (PopChunk(iThread, chunk) || StealChunk(iThread, chunk))
+        task(iThread, chunk.first, chunk.second);
+    });
+  }
+};
+
+} // namespace MLPToolbox
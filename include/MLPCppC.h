@@ -0,0 +1,175 @@
+/*!
+* \file MLPCppC.h
+* \brief Stable C interface for loading MLP collections and evaluating
+batches of look-ups over raw strided buffers.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#pragma once
+
+/*
+ * C interface of the MLPCpp library, built as the MLPCppC shared library.
+ * The interface only uses C types, such that it can be called from C,
+ * Fortran (through bind(C)) and Python (through ctypes) without compiling
+ * against the C++ headers.
+ *
+ * Functions returning a pointer return NULL on failure, functions returning
+ * an int return MLP_C_SUCCESS or MLP_C_FAILURE. The message of the last
+ * failure on the calling thread is returned by mlp_last_error.
+ *
+ * Batches are passed as raw strided buffers of doubles which are read and
+ * written in place. Strides are counted in values, not bytes: element
+ * [query][output] of the outputs is found at
+ * outputs[query * output_strides[0] + output * output_strides[1]].
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#ifdef MLP_C_BUILD
+#define MLP_C_API __declspec(dllexport)
+#else
+#define MLP_C_API __declspec(dllimport)
+#endif
+#else
+#define MLP_C_API __attribute__((visibility("default")))
+#endif
+
+/*! \brief Version of the C interface, raised on incompatible changes. */
+#define MLP_C_ABI_VERSION 1
+
+#define MLP_C_SUCCESS 0  /*!< Call succeeded. */
+#define MLP_C_FAILURE -1 /*!< Call failed, see mlp_last_error. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief Opaque collection of loaded MLPs. */
+typedef struct mlp_collection mlp_collection;
+
+/*! \brief Opaque query plan pairing variable names to the MLPs of a
+ * collection. */
+typedef struct mlp_plan mlp_plan;
+
+/*!
+ * \brief Get the version of the C interface implemented by the library.
+ * \returns MLP_C_ABI_VERSION of the library.
+ */
+MLP_C_API int mlp_abi_version(void);
+
+/*!
+ * \brief Get the message of the last failed call on the calling thread.
+ * \returns Error message, empty if no call failed.
+ */
+MLP_C_API const char *mlp_last_error(void);
+
+/*!
+ * \brief Load a collection of MLPs from MLP input files.
+ * \param[in] filenames - MLP input file names.
+ * \param[in] n_files - number of MLP input files.
+ * \returns Collection, NULL on failure.
+ */
+MLP_C_API mlp_collection *mlp_collection_load(const char *const *filenames,
+                                              size_t n_files);
+
+/*!
+ * \brief Release a collection. Plans created from it must be released first.
+ * \param[in] collection - collection to release, may be NULL.
+ */
+MLP_C_API void mlp_collection_free(mlp_collection *collection);
+
+/*!
+ * \brief Create a query plan evaluating output variables from input variables
+ * with the MLPs of a collection.
+ * \param[in] collection - loaded collection.
+ * \param[in] input_names - input variable names.
+ * \param[in] n_inputs - number of input variables.
+ * \param[in] output_names - output variable names.
+ * \param[in] n_outputs - number of output variables.
+ * \returns Query plan, NULL on failure.
+ */
+MLP_C_API mlp_plan *mlp_plan_create(mlp_collection *collection,
+                                    const char *const *input_names,
+                                    size_t n_inputs,
+                                    const char *const *output_names,
+                                    size_t n_outputs);
+
+/*!
+ * \brief Release a query plan.
+ * \param[in] plan - plan to release, may be NULL.
+ */
+MLP_C_API void mlp_plan_free(mlp_plan *plan);
+
+/*!
+ * \brief Get the number of input variables of a query plan.
+ * \param[in] plan - query plan.
+ * \returns Number of input variables.
+ */
+MLP_C_API size_t mlp_plan_n_inputs(const mlp_plan *plan);
+
+/*!
+ * \brief Get the number of output variables of a query plan.
+ * \param[in] plan - query plan.
+ * \returns Number of output variables.
+ */
+MLP_C_API size_t mlp_plan_n_outputs(const mlp_plan *plan);
+
+/*!
+ * \brief Evaluate a batch of queries on the threads of the library, reading
+ * the inputs from and writing the results to the caller's buffers in place.
+ * Calls on plans of the same collection are serialized.
+ * \param[in] plan - query plan.
+ * \param[in] n_points - number of queries.
+ * \param[in] inputs - input values, element [query][input].
+ * \param[in] input_strides - strides of the inputs {query, input}.
+ * \param[out] outputs - output values, element [query][output].
+ * \param[in] output_strides - strides of the outputs {query, output}.
+ * \param[out] doutputs_dinputs - output derivatives w.r.t. inputs, element
+ * [query][output][input], or NULL.
+ * \param[in] doutput_strides - strides of the output derivatives {query,
+ * output, input}, or NULL.
+ * \param[out] d2outputs_dinputs2 - output second order derivatives w.r.t.
+ * inputs, element [query][output][input][input], or NULL. Requires the first
+ * order derivatives to be evaluated as well.
+ * \param[in] d2output_strides - strides of the second order derivatives
+ * {query, output, input, input}, or NULL.
+ * \param[out] n_outside - number of queries outside the range of all MLPs of
+ * the plan, or NULL.
+ * \returns MLP_C_SUCCESS or MLP_C_FAILURE.
+ */
+MLP_C_API int mlp_evaluate(mlp_plan *plan, size_t n_points,
+                           const double *inputs,
+                           const ptrdiff_t *input_strides, double *outputs,
+                           const ptrdiff_t *output_strides,
+                           double *doutputs_dinputs,
+                           const ptrdiff_t *doutput_strides,
+                           double *d2outputs_dinputs2,
+                           const ptrdiff_t *d2output_strides,
+                           unsigned long *n_outside);
+
+#ifdef __cplusplus
+}
+#endif
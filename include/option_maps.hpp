@@ -1,3 +1,4 @@
+#pragma once
 #include <string>
 #include <map>
 
@@ -8,4 +9,13 @@ enum class ENUM_SCALING_FUNCTIONS {
 MINMAX = 0,
 STANDARD = 1,
 ROBUST = 2,
-};
\ No newline at end of file
+};
+/*!
+* \brief Instruction set enumeration of the compute kernels.
+*/
+enum class ENUM_INSTRUCTION_SET {
+SCALAR = 0,
+SSE2 = 1,
+AVX2 = 2,
+AVX512 = 3,
+};
@@ -144,15 +144,16 @@ int main() {
                      << scientific << MLP_inputs[1] << "\t"
                      << scientific << val_output << endl;
 
-    /* Validate gradient computation */
+    /* Validate gradient computation. Only a single input is perturbed, such
+     * that the first hidden layer can be updated incrementally. */
     double delta_CV = 1e-5;
     double val_output_c = val_output;
     double val_output_p, val_output_m;
     MLP_inputs[0] += delta_CV;
-    ANN_test.PredictANN(&iomap, MLP_inputs, MLP_outputs);
+    ANN_test.PredictANNUpdate(&iomap, MLP_inputs, MLP_outputs);
     val_output_p = val_output;
     MLP_inputs[0] -= 2*delta_CV;
-    ANN_test.PredictANN(&iomap, MLP_inputs, MLP_outputs);
+    ANN_test.PredictANNUpdate(&iomap, MLP_inputs, MLP_outputs);
     val_output_m = val_output;
     double dy_du_fd = (val_output_p - val_output_m) / (2*delta_CV);
     double d2y_du2_fd = (val_output_p - 2 * val_output_c + val_output_m) / (delta_CV*delta_CV);
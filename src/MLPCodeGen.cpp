@@ -0,0 +1,70 @@
+/*!
+* \file MLPCodeGen.cpp
+* \brief Command line tool generating a C++ evaluation header from an MLP
+input file.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <cctype>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "CMLPCodeGenerator.hpp"
+
+/*!
+ * \brief Derive a C++ identifier from the stem of a file name.
+ * \param[in] filename - File name.
+ * \returns Identifier.
+ */
+std::string IdentifierFromFilename(const std::string &filename) {
+  std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+  name = name.substr(0, name.find_last_of('.'));
+  for (auto &c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)))
+      c = '_';
+  }
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+    name = "MLP_" + name;
+  return name;
+}
+
+int main(int argc, char *argv[]) {
+  if ((argc < 3) || (argc > 4)) {
+    std::cerr << "Usage: " << argv[0]
+              << " <input.mlp> <output.hpp> [namespace name]" << std::endl;
+    return 1;
+  }
+  const std::string name =
+      (argc == 4) ? argv[3] : IdentifierFromFilename(argv[1]);
+  try {
+    MLPToolbox::CMLPCodeGenerator generator(argv[1]);
+    generator.WriteHeader(argv[2], name);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
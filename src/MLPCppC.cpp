@@ -0,0 +1,163 @@
+/*!
+* \file MLPCppC.cpp
+* \brief Shared library implementing the C interface of MLPCppC.h on top
+of CLookUp_ANN.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "CLookUp_ANN.hpp"
+#include "MLPCppC.h"
+
+static_assert(std::is_same<mlpdouble, double>::value,
+              "The C interface evaluates double buffers in place and requires "
+              "mlpdouble to be double.");
+
+/*! \brief Loaded MLP collection behind the opaque C handle. */
+struct mlp_collection {
+  std::unique_ptr<MLPToolbox::CLookUp_ANN> lookup; /*!< MLP collection. */
+  std::mutex evaluation_mutex; /*!< Serializes batch evaluations. */
+};
+
+/*! \brief Query plan behind the opaque C handle. */
+struct mlp_plan {
+  mlp_collection *collection; /*!< Collection the plan is paired with. */
+  MLPToolbox::CIOMap input_output_map; /*!< Paired input-output map. */
+  std::size_t n_inputs, n_outputs;     /*!< Number of variables. */
+};
+
+/*! \brief Message of the last failed call on this thread. */
+static thread_local std::string last_error;
+
+/*!
+ * \brief Run a call body, translating exceptions into the last error.
+ * \param[in] body - call body.
+ * \returns The call body completed without exception.
+ */
+template <class Body> static bool GuardCall(Body body) {
+  try {
+    body();
+    return true;
+  } catch (const std::exception &e) {
+    last_error = e.what();
+  } catch (...) {
+    last_error = "Unknown error.";
+  }
+  return false;
+}
+
+/*!
+ * \brief Copy an array of C strings.
+ * \param[in] names - C strings.
+ * \param[in] n_names - number of strings.
+ * \returns Copied strings.
+ */
+static std::vector<std::string> CopyNames(const char *const *names,
+                                          size_t n_names) {
+  if ((names == nullptr) && (n_names > 0))
+    throw std::invalid_argument("Missing variable or file names.");
+  std::vector<std::string> copied(n_names);
+  for (auto iName = 0u; iName < n_names; iName++) {
+    if (names[iName] == nullptr)
+      throw std::invalid_argument("Missing variable or file names.");
+    copied[iName] = names[iName];
+  }
+  return copied;
+}
+
+int mlp_abi_version(void) { return MLP_C_ABI_VERSION; }
+
+const char *mlp_last_error(void) { return last_error.c_str(); }
+
+mlp_collection *mlp_collection_load(const char *const *filenames,
+                                    size_t n_files) {
+  mlp_collection *collection = nullptr;
+  GuardCall([&]() {
+    auto input_filenames = CopyNames(filenames, n_files);
+    if (input_filenames.empty())
+      throw std::invalid_argument("No MLP input files provided.");
+    std::unique_ptr<mlp_collection> loaded(new mlp_collection());
+    loaded->lookup.reset(new MLPToolbox::CLookUp_ANN(
+        static_cast<unsigned short>(input_filenames.size()),
+        input_filenames.data()));
+    collection = loaded.release();
+  });
+  return collection;
+}
+
+void mlp_collection_free(mlp_collection *collection) { delete collection; }
+
+mlp_plan *mlp_plan_create(mlp_collection *collection,
+                          const char *const *input_names, size_t n_inputs,
+                          const char *const *output_names, size_t n_outputs) {
+  mlp_plan *plan = nullptr;
+  GuardCall([&]() {
+    if (collection == nullptr)
+      throw std::invalid_argument("No MLP collection provided.");
+    auto inputs = CopyNames(input_names, n_inputs),
+         outputs = CopyNames(output_names, n_outputs);
+    std::unique_ptr<mlp_plan> created(new mlp_plan{
+        collection, MLPToolbox::CIOMap(inputs, outputs), n_inputs, n_outputs});
+    std::lock_guard<std::mutex> lock(collection->evaluation_mutex);
+    collection->lookup->PairVariableswithMLPs(created->input_output_map);
+    plan = created.release();
+  });
+  return plan;
+}
+
+void mlp_plan_free(mlp_plan *plan) { delete plan; }
+
+size_t mlp_plan_n_inputs(const mlp_plan *plan) {
+  return (plan != nullptr) ? plan->n_inputs : 0;
+}
+
+size_t mlp_plan_n_outputs(const mlp_plan *plan) {
+  return (plan != nullptr) ? plan->n_outputs : 0;
+}
+
+int mlp_evaluate(mlp_plan *plan, size_t n_points, const double *inputs,
+                 const ptrdiff_t *input_strides, double *outputs,
+                 const ptrdiff_t *output_strides, double *doutputs_dinputs,
+                 const ptrdiff_t *doutput_strides, double *d2outputs_dinputs2,
+                 const ptrdiff_t *d2output_strides, unsigned long *n_outside) {
+  bool success = GuardCall([&]() {
+    if (plan == nullptr)
+      throw std::invalid_argument("No query plan provided.");
+    std::lock_guard<std::mutex> lock(plan->collection->evaluation_mutex);
+    unsigned long n_outside_batch = plan->collection->lookup->PredictANNStrided(
+        &plan->input_output_map, n_points, inputs, input_strides, outputs,
+        output_strides, doutputs_dinputs, doutput_strides, d2outputs_dinputs2,
+        d2output_strides);
+    if (n_outside != nullptr)
+      *n_outside = n_outside_batch;
+  });
+  return success ? MLP_C_SUCCESS : MLP_C_FAILURE;
+}
@@ -0,0 +1,80 @@
+/*!
+* \file MLPServer.cpp
+* \brief Command line tool serving an MLP collection to local client
+processes over a Unix domain socket.
+* \author E.C.Bunschoten
+* \version 1.2.0
+*
+* MLPCpp Project Website: https://github.com/EvertBunschoten/MLPCpp
+*
+* Copyright (c) 2023 Evert Bunschoten
+
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CInferenceServer.hpp"
+
+/*! \brief Server to stop on SIGINT or SIGTERM. */
+static MLPToolbox::CInferenceServer *running_server = nullptr;
+
+/*!
+ * \brief Ask the running server to stop.
+ */
+extern "C" void StopServer(int) {
+  if (running_server != nullptr)
+    running_server->Stop();
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <socket path> <input.mlp> [input.mlp ...]" << std::endl;
+    return 1;
+  }
+  std::vector<std::string> input_filenames(argv + 2, argv + argc);
+  try {
+    MLPToolbox::CLookUp_ANN lookup(
+        static_cast<unsigned short>(input_filenames.size()),
+        input_filenames.data());
+    MLPToolbox::CInferenceServer server(lookup);
+
+    struct sigaction action;
+    action.sa_handler = StopServer;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    running_server = &server;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Serving " << input_filenames.size() << " MLP(s) on "
+              << argv[1] << std::endl;
+    server.Run(argv[1]);
+    running_server = nullptr;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}